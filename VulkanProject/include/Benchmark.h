@@ -0,0 +1,57 @@
+#pragma once
+#include "Renderer.h"
+#include "Scene.h"
+#include "Culling.h"
+#include "MeshFile.h"
+#include "MeshImport.h"
+#include "Primitives.h"
+#include "MeshLod.h"
+#include "Meshlet.h"
+#include "TransformHierarchy.h"
+#include "DrawList.h"
+#include "Bvh.h"
+#include "BlockCompression.h"
+#include "TextureFile.h"
+
+#include <vector>
+#include <string>
+#include <ostream>
+
+struct BenchmarkOptions {
+	uint32_t frameCount{ 1000 };
+	uint32_t warmupFrames{ 60 };
+	RendererConfig rendererConfig{
+		.headless = true,
+		.syntheticDrawCount = 1000,
+		.collectFrameTimes = true
+	};
+};
+
+struct SampleSummary {
+	double mean;
+	double p50;
+	double p95;
+	double p99;
+	double max;
+};
+
+namespace Benchmark {
+	SampleSummary summarize(std::vector<double> samples);
+	void writeSummaryJson(std::ostream& out, const std::string& name, const SampleSummary& summary);
+	void runFrameBenchmark(const BenchmarkOptions& options, std::ostream& out);
+	void runAllocatorBenchmark(uint32_t operationCount, std::ostream& out);
+	void runVertexBenchmark(uint32_t vertexCount, std::ostream& out);
+	void runUploadBenchmark(const BenchmarkOptions& options, uint32_t megabytes, std::ostream& out);
+	void runSceneBenchmark(uint32_t objectCount, std::ostream& out);
+	void runCullingBenchmark(uint32_t objectCount, std::ostream& out);
+	void runGpuCullingBenchmark(const BenchmarkOptions& options, uint32_t objectCount, std::ostream& out);
+	void runMeshLoadBenchmark(const BenchmarkOptions& options, uint32_t megabytes, std::ostream& out);
+	void runLodBenchmark(const BenchmarkOptions& options, uint32_t objectCount, std::ostream& out);
+	void runMeshletBenchmark(const BenchmarkOptions& options, uint32_t objectCount, std::ostream& out);
+	void runRenderGraphBenchmark(const BenchmarkOptions& options, std::ostream& out);
+	void runOcclusionBenchmark(const BenchmarkOptions& options, uint32_t objectCount, std::ostream& out);
+	void runTransformBenchmark(uint32_t nodeCount, std::ostream& out);
+	void runDrawListBenchmark(const BenchmarkOptions& options, uint32_t objectCount, std::ostream& out);
+	void runBvhBenchmark(uint32_t objectCount, std::ostream& out);
+	void runTextureBenchmark(const BenchmarkOptions& options, uint32_t textureCount, std::ostream& out);
+}
\ No newline at end of file
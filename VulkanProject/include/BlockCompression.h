@@ -0,0 +1,37 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+constexpr uint32_t BC_BLOCK_EXTENT = 4; //texels along each side of a block
+constexpr uint32_t BC_BLOCK_TEXELS = BC_BLOCK_EXTENT * BC_BLOCK_EXTENT;
+
+//CPU side of the block compressed texture formats: encoders for cooking and decoders for devices that cannot sample
+//them. Block functions take and return the 16 texels of a block as RGBA8 in row major order; BC1 is the opaque variant,
+//BC5 keeps red and green. Encoders fit one endpoint pair along the block's principal axis, BC7 always uses mode 6.
+//Decoders handle every mode of their format, so files cooked elsewhere transcode too.
+namespace BlockCompression {
+	//Formats textures can be stored in: BC1 RGB, BC5, BC7 and RGBA8, each in their UNORM and, where it exists, SRGB variant
+	bool isSupported(VkFormat format);
+	bool isCompressed(VkFormat format);
+	//Bytes of one block, or of one texel for the uncompressed formats
+	uint32_t getBlockBytes(VkFormat format);
+	VkDeviceSize getLevelSize(VkFormat format, uint32_t width, uint32_t height);
+	//What decode() produces: RGBA8 for BC1 and BC7, RG8 for BC5, the format itself when it is not compressed
+	VkFormat getTranscodeFormat(VkFormat format);
+
+	void encodeBc1Block(const uint8_t* pTexels, uint8_t* pBlock);
+	void encodeBc5Block(const uint8_t* pTexels, uint8_t* pBlock);
+	void encodeBc7Block(const uint8_t* pTexels, uint8_t* pBlock);
+	void decodeBc1Block(const uint8_t* pBlock, uint8_t* pTexels);
+	void decodeBc5Block(const uint8_t* pBlock, uint8_t* pTexels); //blue 0, alpha 255
+	void decodeBc7Block(const uint8_t* pBlock, uint8_t* pTexels); //reserved modes decode to transparent black
+
+	//Tightly packed RGBA8 texels of one level in, the level in format out. Partial blocks at the edges repeat the last texel.
+	std::vector<std::byte> encode(VkFormat format, std::span<const std::byte> rgba8, uint32_t width, uint32_t height);
+	//One level in format to tightly packed getTranscodeFormat(format) texels, out is resized to match
+	void decode(VkFormat format, std::span<const std::byte> data, uint32_t width, uint32_t height, std::vector<std::byte>& out);
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+#include "Culling.h"
+#include "Scene.h"
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <span>
+#include <atomic>
+#include <cstdint>
+
+constexpr uint32_t BVH_BIN_COUNT = 16; //SAH candidates per axis
+constexpr uint32_t BVH_MAX_LEAF_OBJECTS = 8; //leaves may stay this large when splitting them costs more than testing every object
+constexpr uint32_t BVH_PARALLEL_OBJECTS = 16384; //ranges at least this large bin in parallel and build one child on another worker
+constexpr float BVH_TRAVERSAL_COST = 1.0f; //relative to testing one object
+constexpr float BVH_REBUILD_RATIO = 1.3f; //SAH cost growth since the build that makes rebuildDegraded() rebuild a subtree
+constexpr uint32_t BVH_NO_NODE = ~0u;
+constexpr uint32_t BVH_DEAD_NODE = ~0u; //count of nodes in unused children pairs
+
+//Internal nodes have count 0 and their children at first and first + 1, leaves own objects [first, first + count) of
+//the BVH's object order
+struct BvhNode {
+	glm::vec3 min;
+	uint32_t first;
+	glm::vec3 max;
+	uint32_t count;
+};
+
+//An object's box in the BVH's order, so the objects of a leaf are contiguous
+struct BvhPrimitive {
+	glm::vec3 min;
+	uint32_t object;
+	glm::vec3 max;
+	uint32_t padding;
+};
+
+//Box of a range of primitives and of their centroids, which is what the bins split
+struct BvhRange {
+	glm::vec3 min;
+	glm::vec3 max;
+	glm::vec3 centroidMin;
+	glm::vec3 centroidMax;
+};
+
+struct BvhRayHit {
+	uint32_t object{ BVH_NO_NODE };
+	float distance{ 0.0f }; //to the entry point of the object's box, 0 when the origin is inside
+};
+
+struct BvhNeighbor {
+	uint32_t object;
+	float distance; //to the closest point of the object's box
+};
+
+struct BvhStats {
+	uint32_t nodeCount{ 0 }; //including unused nodes left over from partial rebuilds
+	uint32_t freeNodeCount{ 0 };
+	uint32_t leafCount{ 0 };
+	uint32_t maxDepth{ 0 }; //partial rebuilds only ever raise it
+	float sahCost{ 0.0f }; //expected cost of a query relative to testing one object, as of the last build() or rebuildDegraded()
+	float builtSahCost{ 0.0f }; //what sahCost would be had nothing moved since the subtrees were built
+	double buildMs{ 0.0 };
+	double refitMs{ 0.0 }; //of the last refit()
+	double rebuildMs{ 0.0 }; //of the last rebuildDegraded()
+	uint32_t rebuiltObjects{ 0 };
+};
+
+//Bounding volume hierarchy over the axis aligned boxes of scene objects, indexed by dense object index like the cull.
+//build() splits at the best of BVH_BIN_COUNT SAH candidates per axis and recurses on the job system. Moved objects are
+//refitted in place, which keeps queries correct but lets boxes grow and overlap; rebuildDegraded() then rebuilds the
+//subtree that lost the most, a bounded number of objects at a time. Adding or removing scene objects needs a new build.
+//Queries are const and may run on several threads at once, updates may not overlap them.
+class Bvh {
+public:
+	//Without pJobs everything is built on the calling thread
+	void build(std::span<const ObjectBounds> bounds, JobSystem* pJobs = nullptr);
+	//Updates the boxes of the moved objects and their ancestors, stops climbing where a box did not change
+	void refit(std::span<const ObjectBounds> bounds, std::span<const uint32_t> movedObjects);
+	//Updates every box, bottom up
+	void refit(std::span<const ObjectBounds> bounds);
+	//Rebuilds the most degraded subtree of at most maxObjects objects once the SAH cost grew by BVH_REBUILD_RATIO.
+	//Returns the objects that were rebuilt, 0 when the tree was still good enough. maxObjects 0 only updates sahCost.
+	uint32_t rebuildDegraded(uint32_t maxObjects);
+
+	//Nearest object whose box the ray enters within maxDistance, object BVH_NO_NODE when nothing is hit
+	BvhRayHit raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+	//Each clears out and writes the matching objects in no particular order
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const;
+	void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const;
+	//The k objects whose boxes are closest to the point, nearest first
+	void queryNearest(const glm::vec3& point, uint32_t k, std::vector<BvhNeighbor>& out) const;
+
+	std::span<const BvhNode> getNodes() const;
+	const BvhStats& getStats() const;
+
+private:
+	std::vector<BvhNode> m_nodes; //root at 0, children pairs from 1
+	std::vector<uint32_t> m_parents;
+	std::vector<float> m_builtCosts; //SAH cost of each subtree when it was built
+	std::vector<float> m_costs; //scratch of the cost pass
+	std::vector<BvhPrimitive> m_primitives;
+	std::vector<uint32_t> m_primitiveLeaves; //leaf holding each primitive
+	std::vector<uint32_t> m_objectPrimitives; //primitive of each object
+	std::vector<uint32_t> m_freePairs; //first node of each unused children pair
+	std::vector<uint32_t> m_pairPool; //free pairs a partial rebuild may use, descending so they are handed out in ascending order
+	std::atomic<uint32_t> m_nodeCount{ 0 };
+	BvhStats m_stats{};
+
+	uint32_t allocatePair();
+	BvhRange computeRange(uint32_t first, uint32_t count, JobSystem* pJobs) const;
+	//Returns the depth of the deepest leaf below the node
+	uint32_t buildNode(uint32_t node, uint32_t first, uint32_t count, const BvhRange& range, uint32_t depth, JobSystem* pJobs);
+	void releaseSubtree(uint32_t node);
+	void refitNode(uint32_t node);
+	float updateCosts();
+	uint32_t getSubtreeObjects(uint32_t node, uint32_t& first) const;
+};
\ No newline at end of file
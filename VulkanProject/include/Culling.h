@@ -0,0 +1,62 @@
+#pragma once
+#include "Camera.h"
+#include "Scene.h"
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+constexpr uint32_t CULL_CHUNK_SIZE = 16384; //objects per worker task
+
+//Planes point inwards and are normalized, a point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0
+struct Frustum {
+	glm::vec4 planes[6];
+};
+
+enum class CullShape {
+	Sphere,
+	Aabb
+};
+
+enum class CullPath {
+	Auto, //widest path the CPU supports
+	Scalar,
+	Sse,
+	Avx2
+};
+
+namespace Culling {
+	Frustum extractFrustum(const glm::mat4& viewProjection);
+	Frustum extractFrustum(const CameraProjectionData& data);
+
+	bool testSphere(const Frustum& frustum, const ObjectBounds& bounds);
+	bool testAabb(const Frustum& frustum, const ObjectBounds& bounds);
+
+	//Each writes the indices (offset by firstIndex) of the visible bounds to pOut and returns how many were written
+	uint32_t cullScalar(const Frustum& frustum, std::span<const ObjectBounds> bounds, CullShape shape, uint32_t firstIndex, uint32_t* pOut);
+	uint32_t cullSse(const Frustum& frustum, std::span<const ObjectBounds> bounds, CullShape shape, uint32_t firstIndex, uint32_t* pOut);
+	uint32_t cullAvx2(const Frustum& frustum, std::span<const ObjectBounds> bounds, CullShape shape, uint32_t firstIndex, uint32_t* pOut);
+
+	bool hasSse();
+	bool hasAvx2();
+	CullPath resolvePath(CullPath path);
+}
+
+//Culls bounds in parallel on a JobSystem and returns a compact, ascending list of visible indices.
+//The returned span stays valid until the next cull() call.
+class FrustumCuller {
+public:
+	explicit FrustumCuller(JobSystem& jobs);
+
+	std::span<const uint32_t> cull(const Frustum& frustum, std::span<const ObjectBounds> bounds, CullShape shape, CullPath path = CullPath::Auto);
+
+private:
+	JobSystem& m_jobs;
+	std::vector<uint32_t> m_scratch;
+	std::vector<uint32_t> m_visible;
+	std::vector<uint32_t> m_chunkCounts;
+	std::vector<uint32_t> m_chunkOffsets;
+};
\ No newline at end of file
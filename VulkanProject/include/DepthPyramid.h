@@ -0,0 +1,42 @@
+#pragma once
+#include "DescriptorAllocator.h"
+#include "RenderGraph.h"
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+constexpr uint32_t DEPTH_PYRAMID_WORKGROUP_SIZE = 8; //per axis, passed to depthPyramid.comp as WORKGROUP_SIZE
+constexpr VkFormat DEPTH_PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+constexpr float DEPTH_PYRAMID_SCALE = 0.5f; //level 0 relative to the depth attachment
+
+struct DepthPyramidPushConstants {
+	glm::uvec2 sourceSize;
+	glm::uvec2 destinationSize;
+};
+
+//Reduces a depth attachment into a mip chain where every texel holds the farthest depth of the texels it covers,
+//one compute dispatch per level. A bound whose nearest depth is farther than every pyramid texel under it is hidden
+//behind what was drawn. The images belong to the render graph, this only owns the pipeline.
+class DepthPyramid {
+public:
+	void init(VkDevice device, DescriptorAllocator& descriptors);
+	void createPipeline(VkShaderModule pyramidModule, VkPipelineCache pipelineCache);
+	void destroy();
+
+	//Expects the depth in SHADER_READ_ONLY_OPTIMAL and the pyramid in GENERAL, as the graph's accesses leave them.
+	//Descriptor sets are transient because the graph recreates the views whenever it is resized.
+	void record(VkCommandBuffer cmdBuffer, const RenderGraph& graph, RenderGraphImage depth, RenderGraphImage pyramid);
+
+	//Nearest filtering, the pyramid is only ever read with texelFetch
+	VkSampler getSampler() const;
+
+private:
+	VkDevice m_device{ VK_NULL_HANDLE };
+	DescriptorAllocator* m_pDescriptors;
+	VkDescriptorSetLayout m_setLayout; //owned by the descriptor allocator's layout cache
+	VkPipelineLayout m_pipelineLayout{ VK_NULL_HANDLE };
+	VkPipeline m_pipeline{ VK_NULL_HANDLE };
+	VkSampler m_sampler{ VK_NULL_HANDLE };
+};
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+#include "Hash.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <span>
+#include <unordered_map>
+#include <cstdint>
+#include <stdexcept>
+
+constexpr uint32_t DESCRIPTOR_POOL_INITIAL_SETS = 64;
+constexpr uint32_t DESCRIPTOR_POOL_MAX_SETS = 4096; //each new pool in a chain doubles in size up to this
+
+struct DescriptorPoolRatio {
+	VkDescriptorType type;
+	float perSet; //descriptors of this type reserved per set
+};
+
+constexpr DescriptorPoolRatio DESCRIPTOR_POOL_RATIOS[]{
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+	{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+	{ VK_DESCRIPTOR_TYPE_SAMPLER, 1.0f }
+};
+
+//One descriptor written into a set. Buffer types read bufferInfo, image and sampler types read imageInfo.
+struct DescriptorBinding {
+	uint32_t binding;
+	VkDescriptorType type;
+	VkDescriptorBufferInfo bufferInfo{};
+	VkDescriptorImageInfo imageInfo{};
+};
+
+struct DescriptorStats {
+	uint64_t transientAllocations{ 0 };
+	uint64_t persistentAllocations{ 0 };
+	uint64_t persistentCacheHits{ 0 };
+	uint64_t persistentReleases{ 0 };
+	uint64_t layoutsCreated{ 0 };
+	uint64_t layoutCacheHits{ 0 };
+	uint32_t poolsCreated{ 0 };
+	uint64_t poolGrowthEvents{ 0 }; //allocations that found their pool full and moved on to the next one in the chain
+	uint64_t poolReuses{ 0 }; //allocations served by an earlier pool of the chain that regained space after sets were freed
+	uint64_t transientResets{ 0 };
+};
+
+//Owns every descriptor set layout and descriptor pool of the renderer.
+//Layouts are deduplicated by their bindings, so pipelines with matching interfaces share one layout.
+//Transient sets come from a per-frame pool chain that is reset wholesale in beginFrame(). Persistent sets are cached
+//by layout and bound resources and live until a resource they reference is released.
+//Pool chains grow a new, larger pool whenever the current one runs out. Earlier persistent pools that sets were freed
+//from are retried first, so churning objects refill them instead of growing the chain. Not thread safe, meant to be
+//driven from the render thread.
+class DescriptorAllocator {
+public:
+	void init(VkDevice device, uint32_t frameCount);
+	void destroy();
+
+	VkDescriptorSetLayout getLayout(std::span<const VkDescriptorSetLayoutBinding> bindings);
+
+	//Resets the slot's transient pools. Call once the slot's fence has signaled.
+	void beginFrame(uint32_t frameIndex);
+	//Valid until the slot comes around again. The caller writes the descriptors.
+	VkDescriptorSet allocateTransient(VkDescriptorSetLayout layout);
+
+	//Returns the cached set for this layout and these exact resources, allocating and writing it on a miss
+	VkDescriptorSet getPersistentSet(VkDescriptorSetLayout layout, std::span<const DescriptorBinding> bindings);
+	//Frees every persistent set referencing the resource. Call before destroying it, once the GPU no longer uses those sets.
+	void releaseSetsUsing(VkBuffer buffer);
+	void releaseSetsUsing(VkImageView imageView);
+
+	const DescriptorStats& getStats() const;
+
+private:
+	struct PoolChain {
+		std::vector<VkDescriptorPool> pools;
+		uint32_t current{ 0 };
+		VkDescriptorPoolCreateFlags flags{ 0 };
+		std::vector<VkDescriptorPool> partial; //pools before current that sets were freed from since they last ran full
+	};
+
+	struct CachedLayout {
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		VkDescriptorSetLayout layout;
+	};
+
+	struct CachedSet {
+		VkDescriptorSetLayout layout;
+		std::vector<DescriptorBinding> bindings;
+		VkDescriptorSet set;
+		VkDescriptorPool pool;
+	};
+
+	VkDevice m_device;
+	std::vector<PoolChain> m_transientChains; //one per frame slot
+	PoolChain m_persistentChain;
+	uint32_t m_currentFrame{ 0 };
+
+	std::unordered_map<uint64_t, std::vector<CachedLayout>> m_layouts;
+	std::unordered_map<uint64_t, std::vector<CachedSet>> m_persistentSets;
+	DescriptorStats m_stats{};
+
+	VkDescriptorPool createPool(const PoolChain& chain);
+	VkDescriptorSet allocate(PoolChain& chain, VkDescriptorSetLayout layout, VkDescriptorPool& outPool);
+	VkResult tryAllocate(VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet& outSet);
+	template<typename Predicate>
+	void releaseSets(Predicate references);
+};
\ No newline at end of file
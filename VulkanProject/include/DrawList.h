@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <cstdint>
+
+//Field widths of a draw key, most significant first. Draws sort by pipeline, then descriptor set, then mesh, so state
+//only changes between runs, and front to back inside a run so the depth test rejects as early as possible.
+constexpr uint32_t DRAW_KEY_PIPELINE_BITS = 8;
+constexpr uint32_t DRAW_KEY_SET_BITS = 12;
+constexpr uint32_t DRAW_KEY_MESH_BITS = 20;
+constexpr uint32_t DRAW_KEY_DEPTH_BITS = 24;
+constexpr uint32_t DRAW_KEY_MAX_MESH = (1u << DRAW_KEY_MESH_BITS) - 1;
+constexpr uint32_t DRAW_SORT_RADIX_BITS = 8; //one byte of the key per counting pass
+
+//One visible object's draw. The key decides the order, the index range whether it can share a draw with its neighbours.
+struct DrawItem {
+	uint64_t key;
+	uint32_t object; //written to the instance data, the vertex shader looks its transform up through it
+	uint32_t firstIndex;
+	uint32_t indexCount; //0 drops the item, for objects culling left nothing of
+};
+
+//Consecutive items whose keys only differ in depth and that draw the same index range, drawn with one call
+struct InstancedDraw {
+	uint64_t key; //of the nearest instance, every instance shares the fields above the depth
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t firstInstance; //into DrawList::getInstances()
+	uint32_t instanceCount;
+};
+
+struct DrawListStats {
+	uint32_t items{ 0 };
+	uint32_t draws{ 0 };
+	uint32_t sortPasses{ 0 }; //digits every key agrees on are skipped
+	double sortMs{ 0.0 }; //radix sort and merge
+};
+
+namespace DrawKeys {
+	uint64_t encode(uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, uint32_t depthBucket);
+	uint32_t pipeline(uint64_t key);
+	uint32_t descriptorSet(uint64_t key);
+	uint32_t mesh(uint64_t key);
+	//The key without its depth, equal for draws that need no state change between them
+	uint64_t state(uint64_t key);
+	//Distances at or beyond maxDistance share the last bucket
+	uint32_t depthBucket(float distance, float maxDistance);
+
+	//Stable least significant digit radix sort by key. scratch is resized to match. Returns the passes that ran, the
+	//sorted items are back in items either way.
+	uint32_t radixSort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch);
+}
+
+//Per-frame list of visible draws, sorted by key and merged into instanced draws. Keeps its buffers across frames so
+//building a list does not allocate once they have grown. Not thread safe, but the items may be filled in parallel.
+class DrawList {
+public:
+	//Resized, not cleared. Every item has to be written before sortAndMerge().
+	std::span<DrawItem> reset(uint32_t itemCount);
+	void sortAndMerge();
+
+	std::span<const InstancedDraw> getDraws() const;
+	//Objects of every draw in draw order, nearest first within a draw
+	std::span<const uint32_t> getInstances() const;
+	const DrawListStats& getStats() const; //of the last sortAndMerge()
+
+private:
+	std::vector<DrawItem> m_items;
+	std::vector<DrawItem> m_scratch;
+	std::vector<InstancedDraw> m_draws;
+	std::vector<uint32_t> m_instances;
+	DrawListStats m_stats{};
+};
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+struct FramePacingStats {
+	uint64_t frames{ 0 };
+	uint64_t delayedFrames{ 0 }; //frames held back to keep the target frame rate
+	double delayMs{ 0.0 };
+	double inputToSubmitMs{ 0.0 }; //summed over frames, CPU time between sampling input and handing the frame to the present engine
+	double inputToRetireMs{ 0.0 }; //summed over retired frames
+	uint64_t retiredFrames{ 0 };
+};
+
+//Limits the frame rate to an optional target and measures input latency per frame slot. Input is expected to be
+//sampled right after waitForFrameStart(), as late as possible, so a delayed frame renders fresh input instead of
+//input that aged while sleeping.
+//A frame retires when the CPU first sees its fence signaled. Without a present timing extension that is the closest
+//observable point to the image reaching the screen, so input-to-retire latency is input-to-display latency minus
+//compositor and scanout time. Polling the fences of pending frames often keeps the retire time close to the signal.
+//Not thread safe, meant to be driven from the render thread.
+class FramePacer {
+public:
+	void init(uint32_t frameSlots, uint32_t targetFrameRate, bool collectSamples);
+
+	void waitForFrameStart();
+	void inputSampled(uint32_t slot);
+	void presented(uint32_t slot);
+	void retired(uint32_t slot);
+	bool isPending(uint32_t slot) const;
+
+	const FramePacingStats& getStats() const;
+	const std::vector<double>& getLatencySamples() const; //input-to-retire per frame, only kept when collectSamples is set
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Slot {
+		Clock::time_point inputTime;
+		bool pending{ false };
+	};
+
+	std::vector<Slot> m_slots;
+	Clock::duration m_frameInterval{ 0 };
+	Clock::time_point m_nextFrameStart{};
+	bool m_collectSamples{ false };
+	FramePacingStats m_stats{};
+	std::vector<double> m_latencySamples;
+};
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+constexpr VkDeviceSize DEFAULT_MEMORY_BLOCK_SIZE = 64ull * 1024 * 1024;
+constexpr uint32_t INVALID_MEMORY_TYPE = ~0u;
+
+enum class AllocationStrategy {
+	FreeList, //long lived resources, freed individually
+	Linear    //per-frame resources, released all at once by beginFrame()
+};
+
+//Offset-only sub-allocators. They never touch Vulkan objects, so their behaviour can be checked without a GPU.
+//"linear" marks buffers and linear-tiling images, which may not share a bufferImageGranularity page with optimal-tiling images.
+class FreeListBlock {
+public:
+	FreeListBlock(VkDeviceSize size, VkDeviceSize granularity);
+
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, bool linear, VkDeviceSize& outOffset);
+	void free(VkDeviceSize offset);
+
+	VkDeviceSize getSize() const;
+	VkDeviceSize getUsedBytes() const;
+	VkDeviceSize getLargestFreeRange() const;
+	uint32_t getFreeRangeCount() const;
+	uint32_t getAllocationCount() const;
+
+private:
+	struct Range {
+		VkDeviceSize size;
+		bool free;
+		bool linear;
+	};
+
+	VkDeviceSize m_size;
+	VkDeviceSize m_granularity;
+	VkDeviceSize m_usedBytes{ 0 };
+	uint32_t m_allocationCount{ 0 };
+	std::map<VkDeviceSize, Range> m_ranges; //keyed by offset, covers the whole block
+	std::multimap<VkDeviceSize, VkDeviceSize> m_freeBySize; //size -> offset of every free range, for best fit lookups
+
+	void insertFree(VkDeviceSize offset, VkDeviceSize size);
+	void eraseFree(VkDeviceSize offset, VkDeviceSize size);
+};
+
+class LinearBlock {
+public:
+	LinearBlock(VkDeviceSize size, VkDeviceSize granularity);
+
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, bool linear, VkDeviceSize& outOffset);
+	void reset();
+
+	VkDeviceSize getSize() const;
+	VkDeviceSize getUsedBytes() const;
+	uint32_t getAllocationCount() const;
+
+private:
+	VkDeviceSize m_size;
+	VkDeviceSize m_granularity;
+	VkDeviceSize m_head{ 0 };
+	bool m_lastLinear{ false };
+	uint32_t m_allocationCount{ 0 };
+};
+
+struct Allocation {
+	VkDeviceMemory memory{ VK_NULL_HANDLE };
+	VkDeviceSize offset{ 0 };
+	VkDeviceSize size{ 0 };
+	void* pMapped{ nullptr }; //non-null for host visible memory, blocks stay mapped for their whole lifetime
+	uint32_t memoryTypeIndex{ 0 };
+	uint32_t frameIndex{ 0 };
+	AllocationStrategy strategy{ AllocationStrategy::FreeList };
+	bool dedicated{ false };
+};
+
+struct HeapStats {
+	VkDeviceSize heapSize{ 0 };
+	VkDeviceSize blockBytes{ 0 }; //VkDeviceMemory allocated from this heap
+	VkDeviceSize usedBytes{ 0 };  //sub-allocated out of those blocks
+	uint32_t blockCount{ 0 };
+	uint32_t allocationCount{ 0 };
+};
+
+class GpuAllocator {
+public:
+	void init(VkPhysicalDevice physDevice, VkDevice device, uint32_t frameCount, VkDeviceSize blockSize = DEFAULT_MEMORY_BLOCK_SIZE);
+	void destroy();
+
+	//Releases every Linear allocation made during the last use of this frame slot. Call once its fence has signaled.
+	void beginFrame(uint32_t frameIndex);
+
+	Allocation allocate(const VkMemoryRequirements& reqs, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred,
+		AllocationStrategy strategy, bool linear);
+	void free(const Allocation& allocation);
+
+	Allocation createBuffer(const VkBufferCreateInfo& info, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred,
+		AllocationStrategy strategy, VkBuffer& outBuffer);
+	Allocation createImage(const VkImageCreateInfo& info, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkImage& outImage);
+	void destroyBuffer(VkBuffer buffer, const Allocation& allocation);
+	void destroyImage(VkImage image, const Allocation& allocation);
+
+	uint32_t findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const;
+	std::vector<HeapStats> getHeapStats() const;
+	uint32_t getDeviceAllocationCount() const;
+
+private:
+	struct MemoryBlock {
+		VkDeviceMemory memory;
+		VkDeviceSize size;
+		void* pMapped;
+		std::unique_ptr<FreeListBlock> freeList;
+		std::unique_ptr<LinearBlock> linear;
+	};
+
+	struct MemoryTypePool {
+		std::vector<MemoryBlock> freeListBlocks;
+		std::vector<std::vector<MemoryBlock>> linearBlocks; //[frameIndex]
+		std::vector<MemoryBlock> dedicatedBlocks;
+		std::vector<std::vector<MemoryBlock>> linearDedicatedBlocks; //[frameIndex], destroyed when the frame slot comes around
+	};
+
+	VkPhysicalDevice m_physDevice{ VK_NULL_HANDLE };
+	VkDevice m_device{ VK_NULL_HANDLE };
+	VkPhysicalDeviceMemoryProperties m_memProps{};
+	VkDeviceSize m_blockSize{ DEFAULT_MEMORY_BLOCK_SIZE };
+	VkDeviceSize m_granularity{ 1 };
+	uint32_t m_maxAllocationCount{ 0 };
+	uint32_t m_deviceAllocationCount{ 0 };
+	uint32_t m_currentFrame{ 0 };
+	std::vector<MemoryTypePool> m_pools;
+
+	MemoryBlock createBlock(uint32_t memoryTypeIndex, VkDeviceSize size);
+	void destroyBlock(MemoryBlock& block);
+	bool tryAllocate(uint32_t memoryTypeIndex, const VkMemoryRequirements& reqs, AllocationStrategy strategy, bool linear, Allocation& outAllocation);
+};
\ No newline at end of file
@@ -0,0 +1,162 @@
+#pragma once
+#include "GpuAllocator.h"
+#include "DescriptorAllocator.h"
+#include "Scene.h"
+#include "Culling.h"
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+constexpr uint32_t CULL_WORKGROUP_SIZE = 64; //passed to cullObjects.comp as WORKGROUP_SIZE
+constexpr uint32_t BINDING_SCENE_OBJECTS = 0;
+constexpr uint32_t BINDING_VISIBLE_INSTANCES = 1;
+constexpr uint32_t BINDING_DRAW_COMMANDS = 2;
+constexpr uint32_t BINDING_CULL_STATS = 3;
+constexpr uint32_t BINDING_OBJECT_VISIBILITY = 4;
+constexpr uint32_t BINDING_OCCLUSION_PYRAMID = 0; //of the occlusion set, set 1 of the late cull
+constexpr uint32_t BINDING_OCCLUSION_CAMERA = 1;
+
+//std430 mirror of SceneObject in shaders/sceneObjects.glsl
+struct GpuObject {
+	glm::mat4 transform;
+	glm::vec4 boundingSphere; //world space center and radius
+	uint32_t firstDraw; //draw command of the mesh's finest LOD, the coarser levels follow it
+	uint32_t lodCount;
+	float lodErrorScale; //largest axis scale of the transform, converts the mesh's LOD errors to world space
+	uint32_t padding;
+};
+
+//One indirect draw per mesh LOD. The cull shader picks the level, bumps its instanceCount and writes the visible object
+//indices to visibleInstances[instanceBase + n]. firstInstance stays 0 so drawIndirectFirstInstance is not required.
+struct GpuDrawCommand {
+	VkDrawIndexedIndirectCommand command;
+	uint32_t instanceBase;
+	float lodError; //object space error of the level, read by the cull shader's LOD selection
+	uint32_t padding;
+};
+
+struct CullPushConstants {
+	glm::vec4 frustumPlanes[6];
+	glm::vec4 lodCamera; //xyz eye position, w MeshLod::projectionScale or 0 to draw every object at its finest LOD
+	uint32_t objectCount;
+	uint32_t drawOffset; //first draw command of the phase, the late phase has its own copy of every draw
+	uint32_t padding[2];
+};
+
+//Written by the cull shader, every object of the scene ends up in exactly one of the rejected counts or in a draw
+struct GpuCullStats {
+	uint32_t frustumRejected;
+	uint32_t occlusionRejected; //in the frustum but hidden behind the depth pyramid, never drawn this frame
+	uint32_t lateDrawn; //passed the occlusion test without having been visible last frame, drawn by the late phase
+	uint32_t padding;
+};
+
+//std140 mirror of OcclusionCullData in cullObjects.comp
+struct OcclusionCullData {
+	glm::mat4 viewMatrix;
+	glm::vec4 projection; //[0][0], [1][1], [2][2] and [3][2] of the projection matrix, enough to project a view space sphere
+	float nearPlane;
+	uint32_t padding[3];
+};
+
+//What the late phase tests against, the depth pyramid of the frame's early draws and the camera they were drawn with
+struct OcclusionCullInputs {
+	VkDescriptorBufferInfo cameraData; //an OcclusionCullData
+	VkImageView pyramidView; //every level, in SHADER_READ_ONLY_OPTIMAL
+	VkSampler pyramidSampler;
+};
+
+//Resources of one frame slot, reused once the slot's graphics fence has signaled
+struct GpuSceneFrame {
+	VkCommandPool cmdPool;
+	VkCommandBuffer cmdBuffer;
+	VkSemaphore cullCompleteSem;
+	VkBuffer drawBuf; //host visible so the visible count can be read back after the frame retires
+	Allocation drawAlloc;
+	VkBuffer instanceBuf;
+	Allocation instanceAlloc;
+	VkBuffer statsBuf; //host visible GpuCullStats, read back like the draws
+	Allocation statsAlloc;
+	VkDescriptorSet descSet; //persistent set of the descriptor allocator, rewritten whenever setObjects() recreates the buffers
+};
+
+//Keeps the scene's objects resident on the GPU and culls them in a compute shader that writes one indirect draw
+//per mesh LOD plus a compacted list of visible object indices. Buffers are shared concurrently between the graphics
+//and compute families, so no ownership transfers are needed on a dedicated compute queue.
+//With occlusion pipelines the cull runs in two phases recorded into the frame's graphics command buffer instead. The
+//early phase draws what passed the occlusion test last frame, the late phase tests everything in the frustum against
+//a depth pyramid of those draws and draws what became visible, so nothing pops in a frame late. Both phases use the
+//same per-object visibility buffer, which the graphics queue's submission order keeps consistent across frames.
+class GpuScene {
+public:
+	//occlusionCulling selects the two phase cull, which needs createOcclusionPipelines() instead of createPipeline()
+	void init(VkDevice device, GpuAllocator& allocator, DescriptorAllocator& descriptors, uint32_t graphicsFamily, uint32_t computeFamily, VkQueue computeQueue,
+		uint32_t frameCount, bool occlusionCulling = false);
+	void createPipeline(VkShaderModule cullModule, VkPipelineCache pipelineCache);
+	//Variants of the cull shader built with OCCLUSION_EARLY and OCCLUSION_LATE
+	void createOcclusionPipelines(VkShaderModule earlyModule, VkShaderModule lateModule, VkPipelineCache pipelineCache);
+	void destroy();
+
+	//Uploads every object of the scene and rebuilds the draw templates. The GPU must be idle.
+	void setObjects(const Scene& scene, std::span<const Mesh* const> meshes);
+
+	//Records and submits the cull dispatch for a retired frame slot. Draws consuming its output must wait on the returned semaphore.
+	VkSemaphore cull(uint32_t frameIndex, const Frustum& frustum, const glm::vec4& lodCamera);
+	//Two phase cull, recorded outside of any render pass. The early phase fills draws [0, getDrawCount()), the late
+	//phase draws [getDrawCount(), 2 * getDrawCount()). Each ends in a barrier that makes its draws readable.
+	void recordEarlyCull(VkCommandBuffer cmdBuffer, uint32_t frameIndex, const Frustum& frustum, const glm::vec4& lodCamera);
+	void recordLateCull(VkCommandBuffer cmdBuffer, uint32_t frameIndex, const Frustum& frustum, const glm::vec4& lodCamera,
+		const OcclusionCullInputs& inputs);
+	bool isTwoPhase() const;
+
+	//Sum of the instance counts the slot's last cull wrote. Only meaningful once that frame has retired.
+	uint32_t readVisibleCount(uint32_t frameIndex) const;
+	//Triangles the slot's last cull submitted at the LODs it picked, same rules as readVisibleCount()
+	uint64_t readTriangleCount(uint32_t frameIndex) const;
+	GpuCullStats readCullStats(uint32_t frameIndex) const;
+
+	VkDescriptorSetLayout getSetLayout() const;
+	VkDescriptorSet getDescriptorSet(uint32_t frameIndex) const;
+	//Read by the vertex shader of CPU culled scenes too, which bring their own instance list
+	VkBuffer getObjectBuffer() const;
+	VkBuffer getDrawBuffer(uint32_t frameIndex) const;
+	uint32_t getInstanceBase(uint32_t drawIndex) const;
+	uint32_t getObjectCount() const;
+	//Per phase, one per mesh LOD
+	uint32_t getDrawCount() const;
+
+private:
+	VkDevice m_device{ VK_NULL_HANDLE };
+	GpuAllocator* m_pAllocator;
+	DescriptorAllocator* m_pDescriptors;
+	VkQueue m_computeQueue;
+	std::vector<uint32_t> m_queueFamilies;
+
+	VkDescriptorSetLayout m_setLayout; //owned by the descriptor allocator's layout cache
+	VkDescriptorSetLayout m_occlusionSetLayout;
+	VkPipelineLayout m_pipelineLayout{ VK_NULL_HANDLE };
+	VkPipelineLayout m_occlusionPipelineLayout{ VK_NULL_HANDLE };
+	VkPipeline m_pipeline{ VK_NULL_HANDLE };
+	VkPipeline m_earlyPipeline{ VK_NULL_HANDLE };
+	VkPipeline m_latePipeline{ VK_NULL_HANDLE };
+	bool m_twoPhase{ false };
+
+	std::vector<GpuSceneFrame> m_frames;
+	VkBuffer m_objectBuf{ VK_NULL_HANDLE };
+	Allocation m_objectAlloc{};
+	VkBuffer m_visibilityBuf{ VK_NULL_HANDLE }; //one uint per object, non-zero if it passed the last late phase
+	Allocation m_visibilityAlloc{};
+	bool m_visibilityResetPending{ false };
+	std::vector<GpuDrawCommand> m_drawTemplates; //both phases' draws in two phase mode
+	uint32_t m_drawCount{ 0 };
+	uint32_t m_objectCount{ 0 };
+
+	VkBufferCreateInfo getSharedBufferInfo(VkDeviceSize size, VkBufferUsageFlags usage) const;
+	void recordReset(VkCommandBuffer cmdBuffer, const GpuSceneFrame& frame);
+	void recordDispatch(VkCommandBuffer cmdBuffer, const Frustum& frustum, const glm::vec4& lodCamera, uint32_t drawOffset);
+	void destroyBuffers();
+};
\ No newline at end of file
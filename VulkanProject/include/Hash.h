@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ull;
+
+//64-bit FNV-1a. Pass a previous result as the seed to hash several pieces of data into one key.
+inline uint64_t fnv1a64(const void* pData, size_t size, uint64_t seed = FNV_OFFSET_BASIS) {
+	const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= pBytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
+
+inline uint64_t fnv1a64(std::string_view str, uint64_t seed = FNV_OFFSET_BASIS) {
+	return fnv1a64(str.data(), str.size(), seed);
+}
+
+inline uint64_t hashCombine(uint64_t seed, uint64_t value) {
+	return fnv1a64(&value, sizeof(value), seed);
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+#include "GpuAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+
+constexpr VkDeviceSize DEFAULT_INDEX_RING_FRAME_SIZE = 16 * 1024 * 1024;
+
+struct IndexAllocation {
+	void* pData;
+	uint32_t firstIndex; //of the data when the ring buffer is bound at offset 0 with the allocation's index type
+};
+
+//Persistently mapped index buffer split into one region per frame slot, like UniformRing. Record jobs compact the
+//triangles that survive culling into it, so allocation is thread safe and lock free. The region is recycled once the
+//slot's fence has signaled.
+class IndexRing {
+public:
+	void init(GpuAllocator& allocator, uint32_t frameCount, VkDeviceSize frameSize = DEFAULT_INDEX_RING_FRAME_SIZE);
+	void destroy();
+
+	//Recycles the slot's region. Call once the slot's fence has signaled, before any record job starts.
+	void beginFrame(uint32_t frameIndex);
+
+	//Returns a null pData when the frame's region is exhausted, callers then draw from their uncompacted indices
+	IndexAllocation allocate(uint32_t indexCount, VkIndexType indexType);
+
+	VkBuffer getBuffer() const;
+
+private:
+	GpuAllocator* m_pAllocator;
+	VkBuffer m_buffer{ VK_NULL_HANDLE };
+	Allocation m_allocation{};
+	VkDeviceSize m_frameSize{ 0 };
+
+	VkDeviceSize m_frameBegin{ 0 };
+	std::atomic<VkDeviceSize> m_head{ 0 };
+};
\ No newline at end of file
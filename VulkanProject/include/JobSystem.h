@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+//Jobs receive the index of the worker running them: 0 is the thread that created the JobSystem, 1..n are its threads.
+//Jobs must not throw.
+using Job = std::function<void(uint32_t workerIndex)>;
+
+//Counts the jobs that still have to finish. Jobs can be queued to run once a counter reaches zero.
+//A counter must outlive every job that signals or depends on it, destroy it only after JobSystem::wait() returned.
+class JobCounter {
+public:
+	bool isDone() const;
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> m_pending{ 0 };
+	std::mutex m_mutex;
+	std::vector<Job> m_continuations;
+};
+
+struct JobWorkerStats {
+	uint64_t jobsExecuted{ 0 };
+	uint64_t jobsStolen{ 0 }; //taken from another worker's deque
+	double busyMs{ 0.0 };
+};
+
+struct JobSystemStats {
+	std::vector<JobWorkerStats> workers;
+	double elapsedMs{ 0.0 }; //wall time since construction or the last resetStats()
+
+	double utilization(size_t worker) const { return elapsedMs > 0.0 ? workers.at(worker).busyMs / elapsedMs : 0.0; }
+};
+
+//Work stealing scheduler. Every worker owns a deque, pushes and pops its own jobs at the back (newest first, cache warm)
+//and steals from the front of the others when it runs dry. The creating thread is worker 0 and only runs jobs while
+//inside wait(), so submission never blocks on it.
+class JobSystem {
+public:
+	explicit JobSystem(uint32_t threadCount = 0); //total workers including the calling thread, 0 uses every hardware thread
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	//pSignal is decremented when the job finishes. With pDependency the job is held back until that counter reaches zero.
+	void run(Job job, JobCounter* pSignal = nullptr, JobCounter* pDependency = nullptr);
+
+	//Splits [0, count) into ranges of at most batchSize and calls function(begin, end, workerIndex) for each of them
+	void parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t, uint32_t, uint32_t)>& function, JobCounter& signal);
+
+	//Runs queued jobs on the calling thread until the counter reaches zero
+	void wait(JobCounter& counter);
+
+	uint32_t getWorkerCount() const;
+	uint32_t getCurrentWorkerIndex() const;
+	JobSystemStats getStats() const;
+	void resetStats();
+
+private:
+	struct Worker {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+		std::atomic<uint64_t> jobsExecuted{ 0 };
+		std::atomic<uint64_t> jobsStolen{ 0 };
+		std::atomic<uint64_t> busyNs{ 0 };
+	};
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::vector<std::thread> m_threads;
+	std::atomic<uint32_t> m_queuedJobs{ 0 };
+	std::atomic<uint32_t> m_sleepingThreads{ 0 };
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeCondition;
+	bool m_quit{ false };
+	std::chrono::steady_clock::time_point m_statsStart;
+
+	void push(uint32_t workerIndex, Job job);
+	bool tryRunJob(uint32_t workerIndex);
+	void finishJob(JobCounter* pSignal);
+	void threadLoop(uint32_t workerIndex);
+};
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include <filesystem>
+#include <stdexcept>
+#include <cstddef>
+
+//Read-only memory mapping of a whole file. The view is page aligned, so it can be handed straight to APIs
+//that require aligned data (SPIR-V, staging copies) without an intermediate buffer.
+class MappedFile {
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::filesystem::path& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	const std::byte* data() const;
+	size_t size() const;
+	bool isOpen() const;
+	void close();
+
+private:
+	const std::byte* m_pData{ nullptr };
+	size_t m_size{ 0 };
+#ifdef _WIN32
+	void* m_fileHandle{ nullptr };
+	void* m_mappingHandle{ nullptr };
+#else
+	int m_fd{ -1 };
+#endif
+};
\ No newline at end of file
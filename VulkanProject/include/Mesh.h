@@ -0,0 +1,61 @@
+#pragma once
+#include "Vertex.h"
+#include "Hash.h"
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+//A range of the index buffer drawn in place of the full mesh. Every level indexes the same vertices, error is the
+//largest object space distance the level's surface may deviate from the original.
+struct MeshLodLevel {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error;
+};
+
+//Indexed triangle mesh stored in its GPU layout. Vertices that are identical after encoding are merged, so quantization
+//never costs index buffer efficiency, and indices are stored as 16-bit whenever the vertex count allows it.
+class Mesh {
+public:
+	Mesh() = default;
+	Mesh(const std::vector<Vertex>& vertices, const VertexLayout& layout); //unindexed triangle list
+	Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const VertexLayout& layout);
+	//Indices hold every level back to back, finest first. Without levels the whole index buffer is the only one.
+	Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<MeshLodLevel> lods, const VertexLayout& layout);
+
+	const VertexLayout& getLayout() const;
+	const PositionDecode& getPositionDecode() const;
+	glm::vec3 getBoundsMin() const;
+	glm::vec3 getBoundsMax() const;
+
+	uint32_t getVertexCount() const;
+	uint32_t getIndexCount() const;
+	VkIndexType getIndexType() const;
+	uint32_t getIndex(uint32_t i) const;
+	std::span<const MeshLodLevel> getLods() const;
+
+	const std::vector<std::byte>& getVertexData() const;
+	const std::vector<std::byte>& getIndexData() const;
+
+	Vertex getVertex(uint32_t index) const;
+	std::vector<Vertex> decodeVertices() const;
+
+private:
+	VertexLayout m_layout{};
+	PositionDecode m_positionDecode{};
+	glm::vec3 m_boundsMin{ 0.0f };
+	glm::vec3 m_boundsMax{ 0.0f };
+	uint32_t m_vertexCount{ 0 };
+	uint32_t m_indexCount{ 0 };
+	VkIndexType m_indexType{ VK_INDEX_TYPE_UINT16 };
+	std::vector<std::byte> m_vertexData;
+	std::vector<std::byte> m_indexData;
+	std::vector<MeshLodLevel> m_lods;
+
+	void build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>* pIndices);
+};
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#include "Mesh.h"
+#include "MappedFile.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <span>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+
+constexpr uint32_t MESH_FILE_MAGIC = 0x48534D56; //"VMSH" read as little endian
+constexpr uint32_t MESH_FILE_VERSION = 1; //bump whenever a header or section layout changes, older files are rejected
+constexpr uint64_t MESH_FILE_SECTION_ALIGNMENT = 64; //also satisfies STAGING_ALIGNMENT and every index and vertex attribute alignment
+
+enum class MeshSection : uint32_t {
+	Vertices, //VertexLayout encoded, interleaved
+	Indices,  //every LOD's indices back to back, 16 or 32 bit
+	Bounds,   //MeshFileBounds
+	Lods      //MeshFileLod per level, finest first
+};
+
+struct MeshFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t fileSize; //catches truncated files
+	uint32_t positionFormat; //PositionFormat
+	uint32_t normalFormat;   //NormalFormat
+	uint32_t indexType;      //VkIndexType
+	uint32_t vertexCount;
+	uint32_t indexCount; //over every LOD
+	uint32_t sectionCount;
+	float decodeScale[3];
+	float decodeOffset[3];
+};
+
+struct MeshFileSectionEntry {
+	uint32_t type; //MeshSection
+	uint32_t padding;
+	uint64_t offset; //from the start of the file, MESH_FILE_SECTION_ALIGNMENT aligned
+	uint64_t size;
+};
+
+struct MeshFileBounds {
+	float min[3];
+	float max[3];
+	float sphereCenter[3];
+	float sphereRadius;
+};
+
+struct MeshFileLod {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error; //object space error against LOD 0, 0 for LOD 0
+	uint32_t padding;
+};
+
+static_assert(sizeof(MeshFileHeader) == 64, "MeshFileHeader layout is part of the file format");
+static_assert(sizeof(MeshFileSectionEntry) == 24, "MeshFileSectionEntry layout is part of the file format");
+
+//Cooked mesh container: a header, a section table and MESH_FILE_SECTION_ALIGNMENT aligned sections holding the data in
+//its final GPU layout. Loading maps the file and validates the tables, section views point straight into the mapping,
+//so uploading a mesh is one copy from the page cache into staging memory with nothing allocated or decoded on the way.
+//Files are little endian, which every platform the renderer targets is.
+class MeshFile {
+public:
+	MeshFile() = default;
+	explicit MeshFile(const std::filesystem::path& path);
+
+	//Writes the mesh with every LOD level, returns the file size
+	static uint64_t write(const std::filesystem::path& path, const Mesh& mesh);
+
+	VertexLayout getLayout() const;
+	PositionDecode getPositionDecode() const;
+	VkIndexType getIndexType() const;
+	uint32_t getVertexCount() const;
+	uint32_t getIndexCount() const;
+	const MeshFileBounds& getBounds() const;
+	std::span<const MeshFileLod> getLods() const;
+
+	std::span<const std::byte> getVertexData() const;
+	std::span<const std::byte> getIndexData() const;
+	size_t getFileSize() const;
+
+private:
+	MappedFile m_file;
+	const MeshFileHeader* m_pHeader{ nullptr };
+	std::span<const std::byte> m_sections[4]; //indexed by MeshSection
+
+	std::span<const std::byte> getSection(MeshSection section) const;
+};
\ No newline at end of file
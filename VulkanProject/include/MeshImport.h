@@ -0,0 +1,27 @@
+#pragma once
+#include "Vertex.h"
+#include "MappedFile.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <ostream>
+#include <cstdint>
+
+//Unindexed source data is deduplicated on (position, normal) index pairs, so the result is ready for Mesh
+struct ImportedMesh {
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+};
+
+//Text mesh formats, meant for the offline cooker. Runtime loading goes through cooked MeshFile containers.
+namespace MeshImport {
+	//Wavefront OBJ: v, vn and f records, polygons are fanned into triangles, texture coordinates are ignored.
+	//Faces without normals get smooth normals accumulated from the faces around each position.
+	ImportedMesh parseObj(std::string_view text);
+	ImportedMesh loadObj(const std::filesystem::path& path);
+	void writeObj(std::ostream& out, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+}
\ No newline at end of file
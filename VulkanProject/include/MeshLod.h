@@ -0,0 +1,39 @@
+#pragma once
+#include "Mesh.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+constexpr uint32_t MAX_MESH_LODS = 8;
+constexpr float LOD_REDUCTION_RATIO = 0.5f; //triangle count of each level relative to the one before
+constexpr uint32_t LOD_MIN_TRIANGLES = 64; //the chain stops before a level would drop below this
+constexpr float DEFAULT_LOD_THRESHOLD_PIXELS = 1.0f;
+
+//Index buffer of every level back to back, ready for the Mesh LOD constructor
+struct LodChain {
+	std::vector<uint32_t> indices;
+	std::vector<MeshLodLevel> levels;
+};
+
+namespace MeshLod {
+	//Quadric error edge collapse. Vertices only ever collapse onto a neighbour, so the result indexes the input vertices
+	//unchanged. Open borders, positions shared by several vertices (normal seams) and non-manifold edges are locked, and a
+	//vertex collapsing onto a seam takes the seam vertex with the closest normal.
+	//Stops at targetIndexCount or once the next collapse would exceed targetError, an object space distance.
+	std::vector<uint32_t> simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices, uint32_t targetIndexCount,
+		float targetError, float* pResultError = nullptr);
+
+	//Levels are simplified from the original indices, each one aiming for LOD_REDUCTION_RATIO of the previous level's
+	//triangles. Errors never decrease along the chain.
+	LodChain buildChain(std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+
+	//Pixels covered by one unit of object space error at distance one, divided by the pixel error that is still acceptable
+	float projectionScale(float fovY, float viewportHeight, float thresholdPixels);
+	//Largest axis scale of an object transform, converts mesh errors to world space
+	float transformScale(const glm::mat4& transform);
+	//Coarsest level whose projected error stays within the threshold. Distance is from the eye to the bounding sphere surface.
+	uint32_t selectLod(std::span<const MeshLodLevel> lods, float errorScale, float distance, float projectionScale);
+}
\ No newline at end of file
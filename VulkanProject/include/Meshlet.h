@@ -0,0 +1,64 @@
+#pragma once
+#include "Mesh.h"
+#include "Culling.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+constexpr uint32_t VERTEX_CACHE_SIZE = 16; //FIFO entries the cache optimization plans for
+constexpr float MESHLET_NO_CONE_CUTOFF = 2.0f; //normals spread too far for a cone, never rejected as back facing
+constexpr uint32_t MESHLET_CULL_MIN_MESHLETS = 16; //coarser levels have cones too wide to reject enough to pay for the test
+constexpr uint32_t MESHLET_BOUNDS_PADDING = 7; //trailing entries that let the widest path load a full batch at the end of any range
+
+//A contiguous run of triangles in the mesh index buffer
+struct Meshlet {
+	uint32_t firstIndex;
+	uint32_t triangleCount;
+	uint32_t vertexCount;
+};
+
+//Culling data in mesh space, one entry per meshlet in each array so the SIMD paths load four or eight meshlets at once.
+//A meshlet faces away from every eye for which dot(normalize(coneApex - eye), coneAxis) >= coneCutoff.
+struct MeshletBounds {
+	std::vector<float> centerX, centerY, centerZ, radius;
+	std::vector<float> coneApexX, coneApexY, coneApexZ;
+	std::vector<float> coneAxisX, coneAxisY, coneAxisZ, coneCutoff;
+};
+
+struct MeshletSet {
+	std::vector<Meshlet> meshlets;
+	MeshletBounds bounds;
+	std::vector<uint32_t> lodFirstMeshlet; //meshlets of LOD i are [lodFirstMeshlet[i], lodFirstMeshlet[i + 1])
+};
+
+//Frustum planes and eye moved into one object's mesh space. Cone tests are only exact for transforms without
+//non-uniform scale, which is all the scene generates.
+struct MeshletCullView {
+	Frustum frustum;
+	glm::vec3 eye;
+};
+
+namespace Meshlets {
+	//Tipsify (Sander et al. 2007), reorders the triangles of an index list in place for a FIFO post transform cache
+	void optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+	//Average vertex shader invocations per triangle with a FIFO cache, 0.5 is the ideal for large regular meshes
+	float averageCacheMissRatio(std::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+	//Optimizes every LOD range of the indices for the vertex cache, then cuts each range into meshlets in that order.
+	//Indices are reordered in place but every range keeps its triangles, so the levels stay valid.
+	MeshletSet build(std::span<const Vertex> vertices, std::span<uint32_t> indices, std::span<const MeshLodLevel> lods);
+
+	MeshletCullView makeView(const Frustum& frustum, const glm::vec3& eye, const glm::mat4& transform);
+
+	//Each writes the indices of the meshlets in [first, first + count) that are inside the frustum and not facing away
+	//from the eye to pOut and returns how many were written
+	uint32_t cullScalar(const MeshletCullView& view, const MeshletBounds& bounds, uint32_t first, uint32_t count, uint32_t* pOut);
+	uint32_t cullSse(const MeshletCullView& view, const MeshletBounds& bounds, uint32_t first, uint32_t count, uint32_t* pOut);
+	uint32_t cullAvx2(const MeshletCullView& view, const MeshletBounds& bounds, uint32_t first, uint32_t count, uint32_t* pOut);
+	uint32_t cull(CullPath path, const MeshletCullView& view, const MeshletBounds& bounds, uint32_t first, uint32_t count, uint32_t* pOut);
+}
\ No newline at end of file
@@ -1,8 +0,0 @@
-#pragma once
-#include <vector>
-#include <glm/glm.hpp>
-
-class Object {
-public:
-	std::vector<glm::vec3> m_verts;
-};
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <filesystem>
+#include <fstream>
+#include <chrono>
+#include <stdexcept>
+
+const std::filesystem::path PIPELINE_CACHE_PATH = std::filesystem::current_path() / "pipeline_cache.bin";
+
+constexpr uint32_t PIPELINE_CACHE_FILE_MAGIC = 0x43505056; //"VPPC"
+constexpr uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+//Written in front of the driver's cache blob. A file is only reused when every field matches the current device and driver.
+struct PipelineCacheFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	uint32_t reserved; //zero, spells out the padding in front of dataSize so every byte of the header is written deterministically
+	uint64_t dataSize;
+	uint64_t dataHash;
+};
+
+static_assert(sizeof(PipelineCacheFileHeader) == 56, "PipelineCacheFileHeader must not contain padding");
+
+class PipelineDiskCache {
+public:
+	void init(VkPhysicalDevice physDevice, VkDevice device, const std::filesystem::path& path = PIPELINE_CACHE_PATH);
+	void destroy();
+
+	//Writes the cache to a temporary file and renames it over the old one, so a crash never leaves a torn file behind.
+	void save();
+	//Saves when the interval has passed since the last write and the driver's blob has grown.
+	void saveIfDue(std::chrono::seconds interval);
+
+	VkPipelineCache get() const;
+	bool isWarm() const;
+
+private:
+	VkDevice m_device{ VK_NULL_HANDLE };
+	VkPipelineCache m_cache{ VK_NULL_HANDLE };
+	VkPhysicalDeviceProperties m_deviceProps{};
+	std::filesystem::path m_path;
+	bool m_warm{ false };
+	size_t m_savedSize{ 0 };
+	std::chrono::steady_clock::time_point m_lastSave;
+
+	std::vector<char> loadValidated() const;
+	PipelineCacheFileHeader makeHeader(const std::vector<char>& data) const;
+};
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+#include "Vertex.h"
+#include "Hash.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <future>
+#include <cstdint>
+#include <stdexcept>
+
+//Everything that makes two graphics pipelines different. Viewport and scissor are always dynamic and not part of the
+//key, so render target size changes never create pipelines. Pipelines built against the same render pass handle are
+//assumed compatible; callers that recreate a render pass get new pipelines.
+struct GraphicsPipelineKey {
+	VkShaderModule vertexModule{ VK_NULL_HANDLE };
+	VkShaderModule fragmentModule{ VK_NULL_HANDLE };
+	VertexLayout vertexLayout{};
+	uint32_t vertexBinding{ 0 };
+	VkPrimitiveTopology topology{ VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST };
+	VkPolygonMode polygonMode{ VK_POLYGON_MODE_FILL };
+	VkCullModeFlags cullMode{ VK_CULL_MODE_NONE };
+	VkFrontFace frontFace{ VK_FRONT_FACE_COUNTER_CLOCKWISE };
+	bool depthTest{ true };
+	bool depthWrite{ true };
+	VkCompareOp depthCompare{ VK_COMPARE_OP_LESS };
+	bool blendEnable{ false };
+	VkPipelineLayout layout{ VK_NULL_HANDLE };
+	VkRenderPass renderPass{ VK_NULL_HANDLE };
+	uint32_t subpass{ 0 };
+
+	uint64_t hash() const;
+	bool operator==(const GraphicsPipelineKey& other) const;
+};
+
+struct PipelineLibraryStats {
+	uint64_t requests{ 0 };
+	uint64_t hits{ 0 };
+	uint64_t created{ 0 };
+	uint64_t deduplicatedWaits{ 0 }; //requests that found the same pipeline being created by another thread and waited for it
+	double creationMs{ 0.0 };
+};
+
+//Creates graphics pipelines on first request and memoizes them by key. Safe to call from any thread: lookups share
+//a reader lock, and a pipeline requested by several threads at once is created by the first and awaited by the rest.
+class PipelineLibrary {
+public:
+	void init(VkDevice device, VkPipelineCache pipelineCache);
+	void destroy();
+
+	VkPipeline getGraphicsPipeline(const GraphicsPipelineKey& key);
+	PipelineLibraryStats getStats() const;
+
+private:
+	struct Entry {
+		GraphicsPipelineKey key;
+		std::shared_future<VkPipeline> pipeline;
+	};
+
+	VkDevice m_device;
+	VkPipelineCache m_pipelineCache;
+
+	mutable std::shared_mutex m_mutex;
+	std::unordered_map<uint64_t, std::vector<std::shared_ptr<Entry>>> m_entries;
+
+	mutable std::mutex m_statsMutex;
+	PipelineLibraryStats m_stats{};
+
+	std::shared_ptr<Entry> find(uint64_t hash, const GraphicsPipelineKey& key) const;
+	VkPipeline createGraphicsPipeline(const GraphicsPipelineKey& key);
+};
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+#include "MeshImport.h"
+
+#include <cstdint>
+
+//Procedural placeholder geometry for the generated scenes and benchmarks, with smooth normals and shared vertices
+namespace Primitives {
+	//Unit icosphere, each subdivision quadruples the 20 base triangles. Displacement pushes the surface in and out
+	//along low frequency bumps plus per vertex noise, so simplification has real detail to remove.
+	ImportedMesh icosphere(uint32_t subdivisions, float displacement, uint32_t seed);
+	//Heightfield over [-0.5, 0.5] on x and z, gridSize^2 vertices
+	ImportedMesh grid(uint32_t gridSize, float heightNoise, uint32_t seed);
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <ostream>
+#include <cstdint>
+
+constexpr uint32_t PROFILER_MAX_GPU_ZONES = 64; //per frame, zones past this are not timed
+constexpr uint32_t PROFILER_STATS_WINDOW = 240; //latest samples per zone the rolling statistics cover
+constexpr size_t PROFILER_MAX_TRACE_EVENTS = 1 << 20; //events kept for the trace, later zones only update the statistics
+constexpr uint32_t PROFILER_GPU_TRACK = ~0u;
+
+struct ProfileEvent {
+	const char* name;
+	uint32_t track; //CPU thread index, or PROFILER_GPU_TRACK
+	double startUs; //since the profiler was created
+	double durationUs;
+};
+
+struct ProfileZoneSummary {
+	std::string name;
+	bool gpu;
+	uint64_t calls;
+	double totalMs;
+	double windowAvgMs; //over the last PROFILER_STATS_WINDOW samples
+	double windowMaxMs;
+};
+
+//Records scoped CPU zones from any thread and GPU zones as timestamp query pairs in the command buffers of the frame
+//ring. Each frame slot has its own query pool, which is read back once the slot's fence has signaled, so resolving
+//GPU zones never waits on the GPU. GPU zones are placed on the CPU timeline by mapping the first resolved frame's
+//first timestamp to the time that frame was submitted.
+//Zones are keyed by their name pointer, names must be string literals or otherwise outlive the profiler.
+//Zone macros compile to nothing unless PROFILER_ENABLED is defined, and init() then creates no query pools. Only the
+//Debug configuration defines it, Release ships without zones or timestamp queries.
+class Profiler {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	void init(VkPhysicalDevice physDevice, VkDevice device, uint32_t queueFamily, uint32_t frameCount);
+	void destroy();
+
+	//Resolves the slot's previous GPU zones and resets its queries, cmdBuffer must be outside a render pass
+	void beginFrame(uint32_t frameIndex, VkCommandBuffer cmdBuffer);
+	void frameSubmitted(uint32_t frameIndex);
+	void resolveFrame(uint32_t frameIndex); //the slot's fence must have signaled
+
+	//Thread safe, secondary command buffers of the current frame may open zones concurrently
+	uint32_t beginGpuZone(VkCommandBuffer cmdBuffer, const char* name);
+	void endGpuZone(VkCommandBuffer cmdBuffer, uint32_t zone);
+	void recordCpuZone(const char* name, Clock::time_point start, Clock::time_point end);
+
+	std::vector<ProfileZoneSummary> getSummary() const; //sorted by total time, longest first
+	void writeChromeTrace(std::ostream& out) const;
+
+private:
+	struct GpuZone {
+		const char* name;
+	};
+
+	struct FrameQueries {
+		VkQueryPool pool;
+		std::vector<GpuZone> zones;
+		std::atomic<uint32_t> zoneCount;
+		Clock::time_point submitTime;
+		bool pending;
+	};
+
+	struct ZoneKey {
+		const char* name;
+		bool gpu;
+		bool operator==(const ZoneKey& other) const { return name == other.name && gpu == other.gpu; }
+	};
+
+	struct ZoneKeyHash {
+		size_t operator()(const ZoneKey& key) const { return std::hash<const void*>{}(key.name) ^ static_cast<size_t>(key.gpu); }
+	};
+
+	struct ZoneStats {
+		uint64_t calls{ 0 };
+		double totalMs{ 0.0 };
+		std::vector<double> window; //ring of the latest samples
+		uint32_t windowNext{ 0 };
+	};
+
+	VkDevice m_device{ VK_NULL_HANDLE };
+	float m_timestampPeriod{ 1.0f }; //nanoseconds per tick
+	uint64_t m_timestampMask{ ~0ull };
+	std::vector<FrameQueries> m_frames;
+	uint32_t m_currentFrame{ 0 };
+	bool m_gpuCalibrated{ false };
+	double m_gpuOffsetUs{ 0.0 }; //added to converted GPU timestamps to land on the CPU timeline
+
+	Clock::time_point m_epoch{ Clock::now() };
+	mutable std::mutex m_mutex; //guards everything below
+	std::unordered_map<ZoneKey, ZoneStats, ZoneKeyHash> m_stats;
+	std::vector<ProfileEvent> m_events;
+	std::unordered_map<std::thread::id, uint32_t> m_threadTracks;
+
+	void addSample(const char* name, bool gpu, uint32_t track, double startUs, double durationUs);
+};
+
+class ProfileCpuZone {
+public:
+	ProfileCpuZone(Profiler& profiler, const char* name) : m_profiler{ profiler }, m_name{ name }, m_start{ Profiler::Clock::now() } {}
+	~ProfileCpuZone() { m_profiler.recordCpuZone(m_name, m_start, Profiler::Clock::now()); }
+
+	ProfileCpuZone(const ProfileCpuZone&) = delete;
+	ProfileCpuZone& operator=(const ProfileCpuZone&) = delete;
+
+private:
+	Profiler& m_profiler;
+	const char* m_name;
+	Profiler::Clock::time_point m_start;
+};
+
+class ProfileGpuZone {
+public:
+	ProfileGpuZone(Profiler& profiler, VkCommandBuffer cmdBuffer, const char* name) :
+		m_profiler{ profiler }, m_cmdBuffer{ cmdBuffer }, m_zone{ profiler.beginGpuZone(cmdBuffer, name) } {}
+	~ProfileGpuZone() { m_profiler.endGpuZone(m_cmdBuffer, m_zone); }
+
+	ProfileGpuZone(const ProfileGpuZone&) = delete;
+	ProfileGpuZone& operator=(const ProfileGpuZone&) = delete;
+
+private:
+	Profiler& m_profiler;
+	VkCommandBuffer m_cmdBuffer;
+	uint32_t m_zone;
+};
+
+#define PROFILER_CONCAT_INNER(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_INNER(a, b)
+
+#ifdef PROFILER_ENABLED
+#define PROFILE_ZONE(profiler, name) ProfileCpuZone PROFILER_CONCAT(profileZone, __LINE__){ profiler, name }
+#define PROFILE_GPU_ZONE(profiler, cmdBuffer, name) ProfileGpuZone PROFILER_CONCAT(profileGpuZone, __LINE__){ profiler, cmdBuffer, name }
+#define PROFILE_RECORD_ZONE(profiler, name, start, end) (profiler).recordCpuZone(name, start, end) //for spans the caller already timed
+#else
+#define PROFILE_ZONE(profiler, name)
+#define PROFILE_GPU_ZONE(profiler, cmdBuffer, name)
+#define PROFILE_RECORD_ZONE(profiler, name, start, end)
+#endif
\ No newline at end of file
@@ -0,0 +1,191 @@
+#pragma once
+#include "GpuAllocator.h"
+#include "Profiler.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+using RenderGraphImage = uint32_t;
+using RenderGraphPass = uint32_t;
+
+constexpr uint32_t RENDER_GRAPH_FULL_MIP_CHAIN = 0; //mip count that halves the image down to 1x1
+
+enum class RenderGraphPassType {
+	Graphics, //begins a render pass over its attachments around the record function
+	Transfer, //records copies and blits outside of any render pass
+	Compute   //records dispatches outside of any render pass
+};
+
+enum class RenderGraphAccess {
+	ColorAttachment,
+	DepthAttachment,
+	Sampled, //read by fragment shaders
+	ComputeSampled, //read by compute shaders through a sampler
+	ComputeStorage, //written and read by compute shaders as a storage image, in the general layout
+	TransferSrc,
+	TransferDst
+};
+
+//Where the accesses planned so far leave an image
+struct RenderGraphImageState {
+	VkImageLayout layout;
+	VkPipelineStageFlags writeStages; //of the last write, also ordered before every later read
+	VkAccessFlags writeAccess;
+	VkPipelineStageFlags readStages; //reads since that write that the write was made visible to
+	VkAccessFlags readAccess;
+};
+
+struct RenderGraphStats {
+	uint32_t passCount{ 0 };
+	uint32_t culledPassCount{ 0 }; //declared passes no output depends on, never recorded
+	uint32_t imageCount{ 0 }; //images the graph owns, imported ones are not counted
+	uint32_t aliasSlotCount{ 0 }; //memory ranges those images were packed into
+	VkDeviceSize imageBytes{ 0 }; //sum of every owned image's memory requirements
+	VkDeviceSize allocatedBytes{ 0 }; //what the slots actually take
+	uint32_t pipelineBarriers{ 0 }; //vkCmdPipelineBarrier calls per frame
+	uint32_t imageBarriers{ 0 }; //image memory barriers in those calls
+	uint32_t subpassDependencies{ 0 }; //external dependencies of the render passes, which also carry their layout transitions
+
+	VkDeviceSize savedBytes() const { return imageBytes - allocatedBytes; }
+};
+
+//Frame graph of passes that declare which images they access and how. compile() culls the passes no output depends on,
+//derives a render pass per graphics pass, folds layout transitions into attachment layouts where it can and batches
+//what is left into one barrier per pass. Owned images whose lifetimes do not overlap share memory. The plan assumes
+//the same graph runs every frame, so the first use of an image also waits for the last use of its memory in the
+//previous frame, which may still be executing.
+class RenderGraph {
+public:
+	using RecordFunction = std::function<void(VkCommandBuffer cmdBuffer)>;
+
+	//Images are sized by scale relative to the extent given to resize(). Their contents do not survive the frame unless
+	//they are marked as outputs, so the first pass that uses one has to write it. Barriers cover every mip level, passes
+	//that write the levels one after another synchronize between them themselves. Attachments have a single level.
+	RenderGraphImage createImage(const char* name, VkFormat format, float scale = 1.0f, uint32_t mipLevels = 1);
+	//Color images owned elsewhere, such as swapchain images. Their VkImage is set every frame, before execute(). The graph
+	//waits for initialStage before the first use and leaves the image in finalLayout. Imported images are outputs.
+	RenderGraphImage importImage(const char* name, VkImageLayout initialLayout, VkPipelineStageFlags initialStage, VkImageLayout finalLayout);
+	//record may be empty for passes that are only planned
+	RenderGraphPass addPass(const char* name, RenderGraphPassType type, RecordFunction record);
+	//Without a clear value the attachment keeps what earlier passes wrote
+	void addColorAttachment(RenderGraphPass pass, RenderGraphImage image, const VkClearColorValue* pClear = nullptr);
+	void addDepthAttachment(RenderGraphPass pass, RenderGraphImage image, const VkClearDepthStencilValue* pClear = nullptr);
+	void addRead(RenderGraphPass pass, RenderGraphImage image, RenderGraphAccess access);
+	void addWrite(RenderGraphPass pass, RenderGraphImage image, RenderGraphAccess access);
+	//Keeps the passes that write the image and its contents after the frame
+	void markOutput(RenderGraphImage image);
+	//Keeps a pass no output depends on through its images, for passes that write buffers the graph does not track.
+	//Such passes synchronize their buffer accesses themselves.
+	void markSideEffects(RenderGraphPass pass);
+
+	//Plans barriers and memory and creates the render passes, which do not depend on the extent. Declaring anything
+	//after this is not supported.
+	void compile(VkDevice device, GpuAllocator& allocator);
+	//(Re)creates the images, their memory, views and framebuffers. The GPU must be done with the previous ones.
+	void resize(VkExtent2D extent);
+	void destroy();
+
+	void setImportedImage(RenderGraphImage image, VkImage vkImage);
+	void setSubpassContents(RenderGraphPass pass, VkSubpassContents contents);
+	void execute(VkCommandBuffer cmdBuffer, Profiler& profiler);
+
+	VkRenderPass getRenderPass(RenderGraphPass pass) const;
+	VkFramebuffer getFramebuffer(RenderGraphPass pass) const;
+	VkImage getImage(RenderGraphImage image) const;
+	//View of every mip level, or of one level for images with more than one
+	VkImageView getView(RenderGraphImage image) const;
+	VkImageView getMipView(RenderGraphImage image, uint32_t level) const;
+	uint32_t getMipLevels(RenderGraphImage image) const;
+	VkExtent2D getExtent(RenderGraphImage image) const;
+	bool isCulled(RenderGraphPass pass) const;
+	const RenderGraphStats& getStats() const;
+
+private:
+	struct Barrier {
+		RenderGraphImage image;
+		VkImageLayout oldLayout;
+		VkImageLayout newLayout;
+		VkPipelineStageFlags srcStages;
+		VkPipelineStageFlags dstStages;
+		VkAccessFlags srcAccess;
+		VkAccessFlags dstAccess;
+	};
+
+	struct ImageResource {
+		const char* name;
+		VkFormat format;
+		float scale;
+		uint32_t mipLevels; //as requested, RENDER_GRAPH_FULL_MIP_CHAIN until resize() knows the extent
+		uint32_t levelCount;
+		bool imported;
+		bool output;
+		RenderGraphImageState importState; //initial state of imported images
+		VkImageLayout finalLayout;
+		VkImageUsageFlags usage;
+		uint32_t firstUse; //alive pass positions in m_order, ~0u when unused
+		uint32_t lastUse;
+		uint32_t slot;
+		VkImage image;
+		VkImageView view;
+		std::vector<VkImageView> mipViews; //one per level when there is more than one
+		VkExtent2D extent;
+		VkMemoryRequirements memoryReqs;
+	};
+
+	struct PassAccess {
+		RenderGraphImage image;
+		RenderGraphAccess access;
+		bool write;
+		bool clear;
+		VkClearValue clearValue;
+	};
+
+	struct PassNode {
+		const char* name;
+		RenderGraphPassType type;
+		RecordFunction record;
+		std::vector<PassAccess> accesses;
+		bool culled;
+		bool sideEffects;
+		VkSubpassContents contents;
+		std::vector<Barrier> barriers; //recorded before the pass, and before its render pass begins
+		std::vector<RenderGraphImage> attachmentImages;
+		std::vector<VkAttachmentDescription> attachments;
+		std::vector<VkSubpassDependency> dependencies;
+		std::vector<VkClearValue> clearValues; //per attachment
+		VkRenderPass renderPass;
+		VkFramebuffer framebuffer;
+		VkExtent2D extent;
+	};
+
+	//Images whose lifetimes do not overlap, bound at offset 0 of one allocation in order of use
+	struct AliasSlot {
+		std::vector<RenderGraphImage> images;
+		bool depth;
+		float footprint; //bytes per texel at scale 1, used to match images to slots before any extent is known
+		Allocation allocation;
+	};
+
+	VkDevice m_device{ VK_NULL_HANDLE };
+	GpuAllocator* m_pAllocator{ nullptr };
+	std::vector<ImageResource> m_images;
+	std::vector<PassNode> m_passes;
+	std::vector<uint32_t> m_order; //alive passes in declaration order
+	std::vector<AliasSlot> m_slots;
+	std::vector<Barrier> m_finalBarriers; //imported images to their final layouts
+	std::vector<VkImageMemoryBarrier> m_scratchBarriers;
+	VkExtent2D m_extent{ 0, 0 };
+	RenderGraphStats m_stats{};
+	bool m_compiled{ false };
+
+	void cullPasses();
+	void assignSlots();
+	void planBarriers();
+	std::vector<RenderGraphImageState> simulate(const std::vector<RenderGraphImageState>& initialStates, bool record);
+	void createRenderPass(PassNode& pass);
+	void destroyResources();
+	void recordBarriers(VkCommandBuffer cmdBuffer, const std::vector<Barrier>& barriers);
+};
\ No newline at end of file
@@ -1,7 +1,27 @@
 #pragma once
 #include "Camera.h"
 #include "ShaderCompile.h"
-#include "Vertex.h"
+#include "Mesh.h"
+#include "GpuAllocator.h"
+#include "UploadManager.h"
+#include "PipelineDiskCache.h"
+#include "JobSystem.h"
+#include "Scene.h"
+#include "Culling.h"
+#include "GpuScene.h"
+#include "UniformRing.h"
+#include "DescriptorAllocator.h"
+#include "PipelineLibrary.h"
+#include "FramePacer.h"
+#include "Profiler.h"
+#include "MeshLod.h"
+#include "Primitives.h"
+#include "Meshlet.h"
+#include "IndexRing.h"
+#include "RenderGraph.h"
+#include "DepthPyramid.h"
+#include "DrawList.h"
+#include "TextureStreamer.h"
 #include <vulkan/vulkan.h>
 #include <GLFW/glfw3.h>
 
@@ -10,12 +30,23 @@
 
 #include <stdexcept>
 #include <vector>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <span>
+#include <atomic>
+#include <cstddef>
+#include <cmath>
 
 constexpr uint32_t UINT32_MAX{ 0xffffffff };
 constexpr uint64_t UINT64_MAX {0xffffffffffffffff};
 
 #ifndef NDEBUG
-const std::vector<const char*> VALIDATION_LAYERS{
+const std::vector<const char*> ENABLED_VALIDATION_LAYERS{
 	"VK_LAYER_KHRONOS_validation"
 };
 #else
@@ -34,6 +65,56 @@ constexpr VkAllocationCallbacks* P_DEFAULT_ALLOC = nullptr;
 
 constexpr uint32_t BINDING_VERTEX_BUFFER = 0;
 constexpr uint32_t BINDING_LOW_FREQ = 1;
+constexpr uint32_t SET_LOW_FREQ = 0;
+constexpr uint32_t SET_SCENE_OBJECTS = 1;
+
+constexpr VkFormat COLOR_ATTACHMENT_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+constexpr VkFormat DEPTH_ATTACHMENT_FORMAT = VK_FORMAT_D32_SFLOAT;
+
+constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+constexpr uint32_t TIMESTAMPS_PER_FRAME = 2;
+constexpr uint32_t DRAWS_PER_RECORD_JOB = 256; //below two jobs worth of draws the frame is recorded inline
+constexpr std::chrono::seconds PIPELINE_CACHE_SAVE_INTERVAL{ 30 };
+constexpr float SCENE_EXTENT = 1000.0f; //generated scene objects are scattered over [-SCENE_EXTENT, SCENE_EXTENT] on every axis
+constexpr float SCENE_OBJECT_SCALE = 5.0f;
+constexpr uint32_t SCENE_MESH_SUBDIVISIONS = 5; //20480 triangles at LOD 0
+constexpr uint32_t CITY_BUILDING_INTERVAL = 8; //every 8th object of the city layout is a building, the rest are props between them
+constexpr float CITY_BLOCK_SIZE = 40.0f; //distance between building centers, buildings are 32 wide so streets are 8 wide
+constexpr float CITY_CAMERA_HEIGHT = 2.0f;
+constexpr uint32_t DRAW_MESH_INDEX_RING = DRAW_KEY_MAX_MESH; //mesh field of draw keys whose indices were compacted into the index ring, levels of the scene mesh use their LOD
+
+enum class PresentPolicy {
+	PowerSaving, //FIFO, the CPU and GPU idle until the next vertical blank
+	LowLatency //mailbox or immediate when the surface supports them
+};
+
+enum class SceneLayout {
+	Scattered, //objects spread over a cube around the camera, most hidden ones are outside the frustum
+	City //a grid of buildings with props between them, seen from street level, most hidden ones are behind buildings
+};
+
+struct RendererConfig {
+	bool headless{ false }; //render into the offscreen attachments only, no window, surface or swapchain
+	uint32_t width{ WIDTH };
+	uint32_t height{ HEIGHT };
+	uint32_t framesInFlight{ DEFAULT_FRAMES_IN_FLIGHT };
+	uint32_t syntheticDrawCount{ 0 };
+	bool collectFrameTimes{ false };
+	uint32_t workerThreads{ 0 }; //recording workers including the main thread, 0 uses every hardware thread
+	uint32_t sceneObjectCount{ 0 }; //draws a generated, frustum culled scene instead of the synthetic draws when non-zero
+	bool gpuCulling{ false }; //cull the scene in a compute shader and draw it indirectly instead of culling and recording on the CPU
+	bool occlusionCulling{ false }; //GPU culling only, also skips objects hidden behind what was visible last frame
+	SceneLayout sceneLayout{ SceneLayout::Scattered };
+	float lodThresholdPixels{ DEFAULT_LOD_THRESHOLD_PIXELS }; //screen space error a scene object's LOD may show, 0 always draws LOD 0
+	bool meshletCulling{ true }; //CPU culled scene frames also cull each visible object's meshlets and draw the survivors' indices
+	bool instancing{ true }; //CPU culled scene frames sort their draws by key and draw objects sharing a mesh level as instances of one draw
+	PresentPolicy presentPolicy{ PresentPolicy::PowerSaving };
+	uint32_t targetFrameRate{ 0 }; //frames per second the pacer holds, 0 leaves pacing to the present mode
+	uint32_t frameLimit{ 0 }; //run() returns after this many frames when non-zero
+	std::string tracePath{}; //Chrome trace of the profiled zones written at shutdown when set, needs PROFILER_ENABLED
+	TextureStreamerConfig textures{}; //memory budget and streaming policy of getTextures()
+};
 
 struct QueueIndices {
 	uint32_t graphicsIndex{ UINT32_MAX };
@@ -41,51 +122,243 @@ struct QueueIndices {
 	uint32_t transferIndex{ UINT32_MAX };
 };
 
+//Triangles one visible object draws this frame, a level of the scene mesh or what survived meshlet culling
+struct ObjectDraw {
+	float distance; //from the eye to the object's bounding sphere, 0 inside it
+	uint32_t lod;
+	uint32_t firstIndex;
+	uint32_t indexCount; //0 when every meshlet was culled
+	bool compacted; //firstIndex is into the index ring instead of the mesh's index buffer
+};
+
+//Tallied by one record or draw list job without contention, added to the renderer's counters when it is done
+struct SceneRecordCounters {
+	uint64_t triangles{ 0 };
+	uint64_t meshletsTested{ 0 };
+	uint64_t meshletsRejected{ 0 };
+	uint64_t trianglesRejected{ 0 };
+	uint64_t drawCalls{ 0 };
+	uint64_t stateChanges{ 0 };
+};
+
+//Secondary command buffers recorded by one worker for one frame slot. Only that worker allocates from or records into the pool.
+struct WorkerCommands {
+	VkCommandPool cmdPool;
+	std::vector<VkCommandBuffer> cmdBuffers; //grown on demand, recycled when the slot's pools are reset
+	uint32_t usedCount;
+};
+
+//One slot of the frame ring. The CPU may record into a slot once its fence has signaled.
+struct FrameData {
+	VkCommandPool cmdPool;
+	VkCommandBuffer cmdBuffer;
+	VkFence inFlightFence;
+	VkSemaphore imageAvailableSem;
+	VkSemaphore renderCompleteSem;
+	std::vector<WorkerCommands> workerCommands; //indexed by JobSystem worker
+	std::vector<VkCommandBuffer> secondaryCmdBuffers; //one per record job, executed in job order
+	VkQueryPool timestampPool;
+	bool timestampsPending;
+	bool visibleCountPending; //the GPU culled this slot's last frame, its visible count can be read once the fence signals
+	double cpuFrameMs;
+};
+
+//Per-draw vertex stage push constants of the projection pipeline, per-frame data lives in the uniform ring
+struct MeshPushConstants {
+	glm::vec4 positionScale;
+	glm::vec4 positionOffset;
+	uint32_t instanceBase; //first slot of the draw's objects in the visible instance list, GPU culled or built by the draw list
+	uint32_t padding[3];
+};
+
+struct FrameStats {
+	uint64_t frameCount{ 0 };
+	uint64_t overlappedFrames{ 0 }; //frames recorded while the previous frame was still executing on the GPU
+	double cpuFrameMs{ 0.0 };
+	double fenceWaitMs{ 0.0 };
+	double gpuFrameMs{ 0.0 }; //summed over frames whose timestamps have been read back
+	double recordMs{ 0.0 }; //main thread time from starting draw recording until every secondary buffer was done
+	uint64_t parallelRecordedFrames{ 0 };
+	double cullMs{ 0.0 }; //main thread time spent culling on the CPU or recording and submitting the GPU cull
+	uint64_t visibleObjects{ 0 }; //summed over frames, GPU culled frames are counted once they retire
+	uint64_t submittedTriangles{ 0 }; //scene triangles at the selected LODs, summed like visibleObjects
+	uint64_t meshletsTested{ 0 }; //CPU culled frames only, summed over frames
+	uint64_t meshletsRejected{ 0 };
+	uint64_t meshletTrianglesRejected{ 0 }; //not part of submittedTriangles
+	uint64_t frustumRejected{ 0 }; //summed over frames like visibleObjects
+	uint64_t occlusionRejected{ 0 };
+	uint64_t lateDrawnObjects{ 0 }; //part of visibleObjects, drawn after the occlusion test because they were hidden last frame
+	uint64_t culledFrames{ 0 };
+	uint64_t drawCalls{ 0 }; //scene pass draw commands, summed over frames
+	uint64_t stateChanges{ 0 }; //pipeline, descriptor set, vertex and index buffer binds and push constant writes of the scene pass
+	double drawListMs{ 0.0 }; //main thread time building, sorting and merging the draw list of instanced CPU culled frames
+	double drawSortMs{ 0.0 }; //part of drawListMs
+	uint64_t swapchainRecreations{ 0 };
+
+	//Fraction of CPU frame time not spent blocked on the GPU.
+	double overlapRatio() const { return cpuFrameMs > 0.0 ? 1.0 - fenceWaitMs / cpuFrameMs : 0.0; }
+};
+
+struct StartupStats {
+	double initMs{ 0.0 };
+	double pipelineCreationMs{ 0.0 }; //time spent inside vkCreate*Pipelines
+	bool warmPipelineCache{ false };
+	ShaderBuildStats shaderBuild{};
+};
+
+//Per-frame samples, only recorded when RendererConfig::collectFrameTimes is set.
+//GPU samples lag CPU samples by up to framesInFlight frames until finishFrames() is called.
+struct FrameTimeSamples {
+	std::vector<double> cpuMs;
+	std::vector<double> gpuMs;
+};
+
 class Renderer {
 public:
+	explicit Renderer(const RendererConfig& config = {});
+	~Renderer();
+
 	void run();
+	void init();
+	void renderFrames(uint32_t count);
+	void finishFrames();
+	const FrameStats& getFrameStats() const;
+	const FrameTimeSamples& getFrameTimeSamples() const;
+	const StartupStats& getStartupStats() const;
+	const FramePacer& getFramePacer() const;
+	const Profiler& getProfiler() const;
+	const RenderGraph& getRenderGraph() const;
+	std::string getDeviceName() const;
+	VkDevice getDevice() const;
+	std::vector<HeapStats> getHeapStats() const;
+	GpuAllocator& getAllocator();
+	UploadManager& getUploads();
+	JobSystem& getJobSystem();
+	UniformRing& getUniforms();
+	DescriptorAllocator& getDescriptors();
+	PipelineLibrary& getPipelines();
+	TextureStreamer& getTextures();
 
 private:
-	GLFWwindow* m_pWindow;
-	VkInstance m_instance;
-	VkSurfaceKHR m_surface;
+	RendererConfig m_config;
+	JobSystem m_jobs;
+	GLFWwindow* m_pWindow{ nullptr };
+	VkInstance m_instance{ VK_NULL_HANDLE };
+	VkSurfaceKHR m_surface{ VK_NULL_HANDLE };
 
-	VkPhysicalDevice m_physDevice;
+	VkPhysicalDevice m_physDevice{ VK_NULL_HANDLE };
 	QueueIndices m_queueIndices;
-	VkQueue m_graphicsQueue;
-	VkDevice m_device;
+	VkQueue m_graphicsQueue{ VK_NULL_HANDLE };
+	VkQueue m_transferQueue{ VK_NULL_HANDLE };
+	VkQueue m_computeQueue{ VK_NULL_HANDLE };
+	VkDevice m_device{ VK_NULL_HANDLE };
+	GpuAllocator m_allocator;
+	UploadManager m_uploads;
+	UniformRing m_uniforms;
+	DescriptorAllocator m_descriptors;
+	PipelineDiskCache m_pipelineCache;
+	PipelineLibrary m_pipelines;
+	TextureStreamer m_textures;
+	bool m_bcTexturesEnabled{ false }; //the device was created with textureCompressionBC
+	StartupStats m_startupStats;
 
-	VkCommandPool m_cmdPool;
-	VkCommandBuffer m_cmdBuffer;
-	
-	VkShaderModule m_projVertModule;
-	VkShaderModule m_projFragModule;
+	uint32_t m_framesInFlight;
+	uint32_t m_currentFrame{ 0 };
+	std::vector<FrameData> m_frames;
+	FrameStats m_frameStats;
+	FrameTimeSamples m_frameTimeSamples;
+	FramePacer m_pacer;
+	Profiler m_profiler;
+	bool m_timestampsSupported{ false };
+	float m_timestampPeriod{ 1.0f };
+
+	VkShaderModule m_projVertModule{ VK_NULL_HANDLE };
+	VkShaderModule m_projFragModule{ VK_NULL_HANDLE };
 
-	VkRenderPass m_renderPass;
-	VkImage m_colorAttachImage;
-	VkImage m_depthAttachImage;
-	VkImageView m_colorAttachView;
-	VkImageView m_depthAttachView;
-	VkFramebuffer m_framebuffer;
+	RenderGraph m_renderGraph;
+	RenderGraphImage m_sceneColor;
+	RenderGraphImage m_swapchainTarget; //the acquired swapchain image, windowed only
+	RenderGraphPass m_scenePass;
+	RenderGraphImage m_sceneDepth;
+	RenderGraphImage m_depthPyramidImage; //occlusion culling only
+	DepthPyramid m_depthPyramid;
+	OcclusionCullInputs m_occlusionInputs{}; //of the frame being recorded
+	uint32_t m_frameDrawCount{ 0 }; //how the scene pass records the frame being recorded
+	bool m_frameIndirect{ false };
+	bool m_frameParallel{ false };
 
-	VkBuffer m_projectionDataBuf;
-	VkDescriptorSetLayout m_lowFreqDescSetLayout;
-	VkPipelineLayout m_pipelineLayout;
-	VkPipeline m_pipeline;
+	VertexLayout m_meshLayout{};
+	Mesh m_mesh;
+	MeshletSet m_meshlets; //of m_mesh, empty for the synthetic triangle
+	IndexRing m_indexRing; //compacted indices of partially culled objects
+	VkBuffer m_meshVertexBuf{ VK_NULL_HANDLE };
+	Allocation m_meshVertexAlloc;
+	VkBuffer m_meshIndexBuf{ VK_NULL_HANDLE };
+	Allocation m_meshIndexAlloc;
+
+	Camera m_camera{};
+	Scene m_scene;
+	GpuScene m_gpuScene;
+	FrustumCuller m_culler{ m_jobs };
+	std::span<const uint32_t> m_visibleObjects; //CPU culled object indices of the frame being recorded
+	Frustum m_viewFrustum{}; //LOD selection and meshlet culling inputs of the frame being recorded
+	glm::vec3 m_viewEye{ 0.0f };
+	float m_lodProjectionScale{ 0.0f };
+	std::atomic<uint64_t> m_recordedTriangles{ 0 }; //added to by every record job of the frame
+	std::atomic<uint64_t> m_recordedMeshletsTested{ 0 };
+	std::atomic<uint64_t> m_recordedMeshletsRejected{ 0 };
+	std::atomic<uint64_t> m_recordedTrianglesRejected{ 0 };
+	std::atomic<uint64_t> m_recordedDrawCalls{ 0 };
+	std::atomic<uint64_t> m_recordedStateChanges{ 0 };
+	DrawList m_drawList; //of the frame being recorded, instanced CPU culled frames only
+	uint32_t m_instanceBase{ 0 }; //of the draw list's objects in the uniform ring, in uints
+
+	VkDescriptorSetLayout m_lowFreqDescSetLayout{ VK_NULL_HANDLE };
+	VkDescriptorSet m_lowFreqDescSet{ VK_NULL_HANDLE }; //written once, the camera data is selected by a dynamic offset every frame
+	uint32_t m_cameraDataOffset{ 0 };
+	VkDescriptorSet m_instanceDescSet{ VK_NULL_HANDLE }; //scene objects and the uniform ring as the instance list, instanced CPU culled scenes only
+	VkPipelineLayout m_pipelineLayout{ VK_NULL_HANDLE };
+	VkPipeline m_pipeline{ VK_NULL_HANDLE }; //owned by m_pipelines
 
 	VkExtent2D m_surfaceExtent;
-	VkSwapchainKHR m_swapchain;
+	VkSwapchainKHR m_swapchain{ VK_NULL_HANDLE };
+	VkFormat m_swapchainFormat{ VK_FORMAT_UNDEFINED };
+	VkPresentModeKHR m_presentMode{ VK_PRESENT_MODE_FIFO_KHR };
 	std::vector<VkImage> m_swapchainImages;
-
-	VkSemaphore m_imageAvailableSem;
-	VkSemaphore m_renderCompleteSem;
+	int m_windowWidth{ 0 }; //framebuffer size of the window when the swapchain was created
+	int m_windowHeight{ 0 };
 	
 	void setQueueIndices();
 	void chooseMostSuitablePhysicalDevice();
-	void createRenderPass();
+	void createDevice();
+	void createSwapchain();
+	VkSurfaceFormatKHR chooseSurfaceFormat() const;
+	VkPresentModeKHR choosePresentMode() const;
+	void recreateSwapchain();
+	bool windowResized() const;
+	void createFrameResources();
+	void destroyFrameResources();
+	void createRenderGraph();
 	void preparePipelineData();
+	void createMeshBuffers();
+	void createScene();
+	void createCityScene();
 	void createProjectionPipeline();
-	void init();
 	void loop();
+	void drawFrame();
+	void recordScenePass(VkCommandBuffer cmdBuffer);
+	bool usesDrawList() const;
+	void buildDrawList();
+	ObjectDraw prepareObjectDraw(uint32_t object, std::span<uint32_t> visibleMeshlets, SceneRecordCounters& counters);
+	void addRecordCounters(const SceneRecordCounters& counters);
+	void recordDraws(VkCommandBuffer cmdBuffer, uint32_t firstDraw, uint32_t drawCount);
+	void recordSecondaryDraws(FrameData& frame, uint32_t jobIndex, uint32_t workerIndex, uint32_t firstDraw, uint32_t drawCount);
+	void recordIndirectDraws(VkCommandBuffer cmdBuffer, uint32_t frameIndex, uint32_t firstDraw);
+	void setViewportAndScissor(VkCommandBuffer cmdBuffer);
+	void recordPresentBlit(VkCommandBuffer cmdBuffer);
+	void retireCompletedFrames();
+	void bindFrameDescriptorSets(VkCommandBuffer cmdBuffer, uint32_t frameIndex);
+	void readVisibleCount(FrameData& frame, uint32_t frameIndex);
+	void readFrameTimestamps(FrameData& frame);
 	void cleanup();
 };
\ No newline at end of file
@@ -1,11 +1,77 @@
 #pragma once
+#include "Mesh.h"
+
+#include <glm/glm.hpp>
+
 #include <vector>
+#include <span>
+#include <cstdint>
+
+//Refers to a scene object across removals of other objects. The generation is bumped whenever a slot is freed,
+//so a handle to a removed object stays invalid even after its slot has been reused.
+struct ObjectHandle {
+	uint32_t slot{ ~0u };
+	uint32_t generation{ 0 };
 
-#include "Object.h"
+	bool operator==(const ObjectHandle& other) const = default;
+};
 
+enum ObjectFlags : uint32_t {
+	OBJECT_VISIBLE = 1 << 0,
+	OBJECT_CAST_SHADOW = 1 << 1,
+	OBJECT_STATIC = 1 << 2
+};
+
+//World space bounds, kept in sync with the transform
+struct ObjectBounds {
+	glm::vec3 center;
+	float radius;
+	glm::vec3 extents; //half size of the axis aligned box
+};
+
+//Structure of arrays object store. Index i of every span belongs to the same object. Removal swaps the last object
+//into the hole, so dense indices are only stable between add/remove calls; hold on to handles instead.
 class Scene {
 public:
-	std::vector<Object*> m_objectRefs;
-	
-	void addObject(Object* obj);
+	ObjectHandle addObject(const glm::mat4& transform, const Mesh* pMesh, uint32_t flags = OBJECT_VISIBLE);
+	void removeObject(ObjectHandle handle);
+	bool isValid(ObjectHandle handle) const;
+	uint32_t getObjectCount() const;
+	uint32_t getDenseIndex(ObjectHandle handle) const;
+
+	const glm::mat4& getTransform(ObjectHandle handle) const;
+	void setTransform(ObjectHandle handle, const glm::mat4& transform);
+	const Mesh* getMesh(ObjectHandle handle) const;
+	uint32_t getFlags(ObjectHandle handle) const;
+	void setFlags(ObjectHandle handle, uint32_t flags);
+
+	//Writing transforms through the span leaves bounds stale until updateBounds() runs
+	std::span<glm::mat4> getTransforms();
+	std::span<const glm::mat4> getTransforms() const;
+	std::span<ObjectBounds> getBounds();
+	std::span<const ObjectBounds> getBounds() const;
+	std::span<const Mesh* const> getMeshes() const;
+	std::span<uint32_t> getFlags();
+	std::span<const uint32_t> getFlags() const;
+	std::span<const ObjectHandle> getHandles() const;
+
+	void updateBounds(uint32_t first, uint32_t count);
+
+private:
+	struct Slot {
+		uint32_t denseIndex;
+		uint32_t generation;
+	};
+
+	std::vector<glm::mat4> m_transforms;
+	std::vector<ObjectBounds> m_bounds;
+	std::vector<const Mesh*> m_meshes;
+	std::vector<uint32_t> m_flags;
+	std::vector<ObjectHandle> m_handles; //dense index -> handle, used to patch the slot of the object moved by a removal
+
+	std::vector<Slot> m_slots;
+	std::vector<uint32_t> m_freeSlots;
+
+	uint32_t checkedIndex(ObjectHandle handle) const;
+	void computeBounds(uint32_t denseIndex);
 };
\ No newline at end of file
@@ -1,17 +1,47 @@
 #pragma once
+#include "MappedFile.h"
+#include "Hash.h"
+
 #include <vulkan/vulkan.h>
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <filesystem>
 #include <fstream>
 #include <stdexcept>
 #include <cstdlib>
 
 const std::filesystem::path SHADER_DIRECTORY = std::filesystem::current_path() / "shaders";
+const std::filesystem::path COMPILED_SHADER_DIRECTORY = SHADER_DIRECTORY / "compiled";
+constexpr uint32_t SHADER_CACHE_VERSION = 1; //bump to invalidate every cached .spv
+
+//One compiled permutation of a GLSL file. The define set is part of the cache key and of the output name,
+//so several permutations of the same source can be cached side by side.
+struct ShaderVariant {
+	std::string filename;
+	std::vector<std::pair<std::string, std::string>> defines{};
+};
+
+struct ShaderBuildStats {
+	uint32_t upToDate{ 0 };
+	uint32_t compiled{ 0 };
+	double ms{ 0.0 };
+};
 
 namespace ShaderCompile {
-	void compileShader(const std::string& filename);
+	//Compiles every variant whose cached SPIR-V is missing or stale, spread across worker threads.
+	ShaderBuildStats buildShaders(const std::vector<ShaderVariant>& variants);
+	bool isUpToDate(const ShaderVariant& variant);
+	void compileShader(const ShaderVariant& variant);
+
+	//Hash of the source text, every file it #includes, the define set and the compiler in use
+	uint64_t hashShaderSource(const ShaderVariant& variant);
+	std::string getOutputName(const ShaderVariant& variant);
+
 	std::vector<char> readCompiledShader(const std::string& filename);
+	MappedFile mapCompiledShader(const std::string& filename);
 	VkShaderModule createShaderModule(VkDevice& device, const std::vector<char>& code);
+	VkShaderModule createShaderModule(VkDevice& device, const MappedFile& code);
 }
\ No newline at end of file
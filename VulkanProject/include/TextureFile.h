@@ -0,0 +1,70 @@
+#pragma once
+#include "MappedFile.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <span>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+
+constexpr uint32_t TEXTURE_FILE_MAX_LEVELS = 16; //a full chain of a 32768 texel wide texture
+
+//KTX2 header, section 3.1 of the KTX 2.0 specification
+struct TextureFileHeader {
+	uint8_t identifier[12];
+	uint32_t vkFormat;
+	uint32_t typeSize;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;  //0 for 2D textures
+	uint32_t layerCount;  //0 when the texture is not an array
+	uint32_t faceCount;   //1 unless it is a cube map
+	uint32_t levelCount;
+	uint32_t supercompressionScheme;
+	uint32_t dfdByteOffset;
+	uint32_t dfdByteLength;
+	uint32_t kvdByteOffset;
+	uint32_t kvdByteLength;
+	uint64_t sgdByteOffset;
+	uint64_t sgdByteLength;
+};
+
+//One entry of the level index that follows the header, level 0 first
+struct TextureFileLevel {
+	uint64_t byteOffset; //from the start of the file
+	uint64_t byteLength;
+	uint64_t uncompressedByteLength; //byteLength unless the file is supercompressed
+};
+
+static_assert(sizeof(TextureFileHeader) == 80, "TextureFileHeader layout is part of the file format");
+static_assert(sizeof(TextureFileLevel) == 24, "TextureFileLevel layout is part of the file format");
+
+//Cooked texture in a KTX2 container: single 2D image, full mip chain, no supercompression, any format
+//BlockCompression::isSupported() accepts. Like MeshFile, loading maps the file and validates the level index, level
+//views point straight into the mapping so a level streams into staging memory without being read or decoded first.
+class TextureFile {
+public:
+	TextureFile() = default;
+	explicit TextureFile(const std::filesystem::path& path);
+
+	//Builds the mip chain of the RGBA8 image with a box filter, in linear space for the SRGB formats, encodes every
+	//level in format and writes them smallest first like the specification asks. Returns the file size.
+	static uint64_t write(const std::filesystem::path& path, VkFormat format, uint32_t width, uint32_t height, std::span<const std::byte> rgba8);
+	//Levels of a full chain down to 1x1
+	static uint32_t getFullLevelCount(uint32_t width, uint32_t height);
+
+	VkFormat getFormat() const;
+	uint32_t getWidth() const;
+	uint32_t getHeight() const;
+	uint32_t getLevelCount() const;
+	VkExtent2D getLevelExtent(uint32_t level) const;
+	std::span<const std::byte> getLevelData(uint32_t level) const;
+	size_t getFileSize() const;
+
+private:
+	MappedFile m_file;
+	const TextureFileHeader* m_pHeader{ nullptr };
+	std::vector<std::span<const std::byte>> m_levels;
+};
\ No newline at end of file
@@ -0,0 +1,138 @@
+#pragma once
+#include "TextureFile.h"
+#include "GpuAllocator.h"
+#include "UploadManager.h"
+#include "DescriptorAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <filesystem>
+#include <cstdint>
+
+constexpr VkDeviceSize DEFAULT_TEXTURE_BUDGET = 256ull * 1024 * 1024;
+constexpr VkDeviceSize DEFAULT_TEXTURE_UPLOAD_BYTES = 8ull * 1024 * 1024; //per update(), a quarter of the default staging ring
+constexpr VkDeviceSize TEXTURE_MIP_TAIL_BYTES = 64ull * 1024; //the first request of a texture streams every level below this in one go
+
+//Index of a texture in the order it was added
+using TextureHandle = uint32_t;
+
+struct TextureStreamerConfig {
+	VkDeviceSize budgetBytes{ DEFAULT_TEXTURE_BUDGET }; //device memory of resident and in flight images
+	VkDeviceSize uploadBytesPerUpdate{ DEFAULT_TEXTURE_UPLOAD_BYTES }; //the first upgrade of an update always goes out
+	bool coarseToFine{ true }; //stream the mip tail first and then one finer level per upgrade, instead of the wanted level at once
+	bool forceTranscode{ false }; //decode block compressed textures on the CPU even when the device samples them
+};
+
+struct TextureStreamerStats {
+	uint32_t textureCount{ 0 };
+	uint32_t residentTextures{ 0 }; //with at least one level usable
+	VkDeviceSize residentBytes{ 0 }; //device memory of resident and in flight images, what the budget limits
+	VkDeviceSize peakResidentBytes{ 0 };
+	VkDeviceSize retiredBytes{ 0 }; //of replaced and evicted images the GPU may still sample, freed once their frame slot comes around
+	VkDeviceSize residentRgba8Bytes{ 0 }; //the resident levels tightly packed as RGBA8, what an uncompressed texture path would need
+	uint64_t uploadedBytes{ 0 };
+	uint64_t uploadedLevels{ 0 };
+	uint64_t upgrades{ 0 };
+	uint64_t evictions{ 0 };
+	uint64_t deferrals{ 0 }; //upgrades postponed because the budget was full of visible textures
+	uint64_t transcodedLevels{ 0 };
+	double transcodeMs{ 0.0 };
+	double updateMs{ 0.0 }; //summed over update() calls, transcoding included
+	//From the update a texture was first wanted in until one of its levels, or its wanted level, became usable
+	uint32_t firstMipCount{ 0 };
+	double firstMipMs{ 0.0 };
+	double maxFirstMipMs{ 0.0 };
+	uint32_t wantedLevelCount{ 0 };
+	double wantedLevelMs{ 0.0 };
+	double maxWantedLevelMs{ 0.0 };
+};
+
+//Residency manager of cooked textures. Files stay mapped for the lifetime of the streamer and only the levels a texture
+//needs live in device memory: every upgrade creates an image of the levels from the new finest one down to 1x1 and
+//copies them out of the mapping, the previous image keeps being sampled until the upload completes. Visible textures
+//stream coarse to fine within the memory budget, the least recently visible ones are evicted to make room.
+//Formats the device cannot sample are decoded to RGBA8 or RG8 on the CPU as they stream.
+//Not thread safe, meant to be driven from the render thread: markVisible() while preparing a frame, beginFrame() once
+//the frame slot's fence signaled and update() before the upload manager flushes.
+class TextureStreamer {
+public:
+	//bcFeatureEnabled tells whether the device was created with textureCompressionBC
+	void init(VkPhysicalDevice physDevice, VkDevice device, GpuAllocator& allocator, UploadManager& uploads, DescriptorAllocator& descriptors,
+		uint32_t frameCount, bool bcFeatureEnabled, const TextureStreamerConfig& config = {});
+	//Call once the device is idle
+	void destroy();
+
+	//Maps the file, nothing is uploaded until the texture is marked visible
+	TextureHandle addTexture(const std::filesystem::path& path);
+
+	//The texture is needed this frame down to wantedLevel, the finest of several calls in one frame wins
+	void markVisible(TextureHandle texture, uint32_t wantedLevel = 0);
+	//Finest level whose texels are no smaller than a screen pixel when the whole texture covers screenPixels along its longer side
+	uint32_t getLevelForScreenSize(TextureHandle texture, float screenPixels) const;
+
+	//Destroys the images retired during the last use of this frame slot and releases the descriptor sets using them.
+	//Call once its fence has signaled.
+	void beginFrame(uint32_t frameIndex);
+	//Swaps in completed uploads, evicts and records the upgrades of this frame
+	void update();
+
+	//VK_NULL_HANDLE until the first upload completed. The view covers every resident level, its base is getResidentLevel().
+	//Valid for the frame being recorded, later updates may retire it.
+	VkImageView getView(TextureHandle texture) const;
+	//Finest level of the file that is usable, the file's level count when nothing is
+	uint32_t getResidentLevel(TextureHandle texture) const;
+	//Format of the texture's images, the file's or what it transcodes to
+	VkFormat getFormat(TextureHandle texture) const;
+	const TextureFile& getFile(TextureHandle texture) const;
+	bool isIdle() const; //nothing is in flight
+
+	const TextureStreamerStats& getStats() const;
+
+private:
+	struct TextureImage {
+		VkImage image{ VK_NULL_HANDLE };
+		VkImageView view{ VK_NULL_HANDLE };
+		Allocation alloc{};
+	};
+
+	struct Texture {
+		TextureFile file;
+		VkFormat format; //of the images
+		bool transcode;
+		uint32_t wantedLevel;
+		uint64_t lastVisibleUpdate;
+		uint32_t residentLevel; //file level count when nothing is resident
+		TextureImage resident;
+		uint32_t pendingLevel;
+		TextureImage pending;
+		UploadTicket pendingTicket;
+		double requestedMs; //negative when the texture has everything it wants
+		bool awaitingFirstMip;
+	};
+
+	VkPhysicalDevice m_physDevice{ VK_NULL_HANDLE };
+	VkDevice m_device{ VK_NULL_HANDLE };
+	GpuAllocator* m_pAllocator{ nullptr };
+	UploadManager* m_pUploads{ nullptr };
+	DescriptorAllocator* m_pDescriptors{ nullptr };
+	TextureStreamerConfig m_config{};
+	bool m_bcSupported{ false };
+
+	std::vector<Texture> m_textures;
+	std::vector<std::vector<TextureImage>> m_retired; //per frame slot
+	uint32_t m_currentFrame{ 0 };
+	uint64_t m_updateIndex{ 1 }; //markVisible() calls belong to the next update()
+	std::vector<TextureHandle> m_requests; //scratch of update()
+	std::vector<std::byte> m_transcoded; //scratch of upgrade()
+	TextureStreamerStats m_stats{};
+
+	bool canSample(VkFormat format) const;
+	VkDeviceSize getUploadSize(const Texture& texture, uint32_t firstLevel) const;
+	uint32_t getTargetLevel(const Texture& texture) const;
+	bool makeRoom(VkDeviceSize bytes);
+	bool upgrade(Texture& texture, uint32_t level);
+	void retire(TextureImage& image);
+	void destroyImage(TextureImage& image);
+	double nowMs() const;
+};
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+#include "Culling.h"
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <vector>
+#include <span>
+#include <cstdint>
+
+using TransformId = uint32_t;
+
+constexpr TransformId TRANSFORM_NO_PARENT = ~0u;
+constexpr uint32_t TRANSFORM_UPDATE_BATCH = 4096; //nodes of one depth level per worker task
+constexpr uint32_t TRANSFORM_KERNEL_BATCH = 64; //matrices composed and multiplied per SIMD kernel call
+
+struct TransformTrs {
+	glm::vec3 translation{ 0.0f };
+	glm::quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+	glm::vec3 scale{ 1.0f };
+};
+
+struct TransformUpdateStats {
+	uint32_t updatedNodes{ 0 }; //dirty nodes and every node below them
+	uint32_t levelsVisited{ 0 }; //levels above the shallowest dirty node are skipped
+	bool resorted{ false }; //nodes were added out of depth order since the last update
+};
+
+namespace Transforms {
+	glm::mat4 compose(const TransformTrs& trs);
+	//Inverse of a rotation and translation without scale, the transpose of the rotation undoes it
+	glm::mat4 rigidInverse(const glm::mat4& transform);
+
+	//pOut[i] = compose(*pLocal[i]). The SIMD paths build the rotation of four (SSE) or eight (AVX2) nodes at once from
+	//their quaternions in structure of arrays form and transpose the result back into columns.
+	void composeScalar(const TransformTrs* const* pLocal, glm::mat4* pOut, uint32_t count);
+	void composeSse(const TransformTrs* const* pLocal, glm::mat4* pOut, uint32_t count);
+	void composeAvx2(const TransformTrs* const* pLocal, glm::mat4* pOut, uint32_t count);
+
+	//pOut[i] = *pLeft[i] * pRight[i], column major like glm. The SIMD paths broadcast each element of the right
+	//matrix's column against the left matrix's columns; AVX2 produces two columns per instruction.
+	void multiplyScalar(const glm::mat4* const* pLeft, const glm::mat4* pRight, glm::mat4* const* pOut, uint32_t count);
+	void multiplySse(const glm::mat4* const* pLeft, const glm::mat4* pRight, glm::mat4* const* pOut, uint32_t count);
+	void multiplyAvx2(const glm::mat4* const* pLeft, const glm::mat4* pRight, glm::mat4* const* pOut, uint32_t count);
+}
+
+//Parented transforms in flat arrays sorted by depth, so every parent is updated before its children and the nodes of
+//one level only depend on levels above it. setLocal() marks a node dirty, update() recomputes the world matrices of
+//dirty nodes and of everything below them, level by level, and leaves the rest untouched. Ids stay valid when the
+//arrays are resorted. Not thread safe, update() itself spreads large levels over the job system.
+class TransformHierarchy {
+public:
+	TransformId addNode(TransformId parent, const TransformTrs& local = {});
+	void setLocal(TransformId id, const TransformTrs& local);
+	const TransformTrs& getLocal(TransformId id) const;
+	//As of the last update()
+	const glm::mat4& getWorld(TransformId id) const;
+	TransformId getParent(TransformId id) const;
+	uint32_t getNodeCount() const;
+	uint32_t getLevelCount() const;
+	void markAllDirty();
+
+	//Without pJobs every level is updated on the calling thread
+	TransformUpdateStats update(JobSystem* pJobs = nullptr, CullPath path = CullPath::Auto);
+
+	//Depth sorted, index with getDenseIndex(). Dense indices change when update() resorts.
+	std::span<const glm::mat4> getWorldMatrices() const;
+	uint32_t getDenseIndex(TransformId id) const;
+
+private:
+	//Structure of arrays in depth order
+	std::vector<uint32_t> m_parents; //dense index of the parent, TRANSFORM_NO_PARENT for roots
+	std::vector<uint32_t> m_depths;
+	std::vector<TransformTrs> m_locals;
+	std::vector<glm::mat4> m_worlds;
+	std::vector<uint8_t> m_dirty; //set by setLocal(), and during update() for every node whose world changed
+	std::vector<uint32_t> m_levelOffsets; //level d is [m_levelOffsets[d], m_levelOffsets[d + 1])
+
+	std::vector<uint32_t> m_idToDense;
+	std::vector<TransformId> m_denseToId;
+	uint32_t m_minDirtyDepth{ ~0u };
+	bool m_sorted{ true };
+
+	void markDirty(uint32_t denseIndex);
+	void sortByDepth();
+	void updateRange(uint32_t begin, uint32_t end, CullPath path);
+};
\ No newline at end of file
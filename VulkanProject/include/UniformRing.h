@@ -0,0 +1,61 @@
+#pragma once
+#include "GpuAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+constexpr VkDeviceSize DEFAULT_UNIFORM_RING_FRAME_SIZE = 256 * 1024;
+
+struct UniformAllocation {
+	void* pData;
+	uint32_t offset; //dynamic offset of the data inside the ring buffer
+	VkDeviceSize size;
+};
+
+struct UniformRingStats {
+	VkDeviceSize frameSize{ 0 };
+	VkDeviceSize alignment{ 0 };
+	VkDeviceSize peakFrameBytes{ 0 }; //most bytes handed out during a single frame
+	uint64_t allocationCount{ 0 };
+};
+
+//Persistently mapped, host coherent buffer split into one region per frame slot. Per-frame constants are bumped out
+//of the current slot's region and the whole region is recycled once the slot's fence has signaled. Descriptors point
+//at the buffer once, UNIFORM_BUFFER_DYNAMIC or STORAGE_BUFFER_DYNAMIC offsets then select this frame's data, so
+//constants change every frame without rewriting descriptor sets or waiting on the GPU.
+//Not thread safe, meant to be driven from the render thread.
+class UniformRing {
+public:
+	void init(VkPhysicalDevice physDevice, GpuAllocator& allocator, uint32_t frameCount,
+		VkDeviceSize frameSize = DEFAULT_UNIFORM_RING_FRAME_SIZE);
+	void destroy();
+
+	//Recycles the slot's region. Call once the slot's fence has signaled.
+	void beginFrame(uint32_t frameIndex);
+
+	//Offsets are aligned for uniform and storage buffer descriptors alike. Throws when the frame's region is exhausted.
+	UniformAllocation allocate(VkDeviceSize size);
+
+	template<typename T>
+	UniformAllocation push(const T& data) {
+		UniformAllocation allocation{ allocate(sizeof(T)) };
+		std::memcpy(allocation.pData, &data, sizeof(T));
+		return allocation;
+	}
+
+	VkBuffer getBuffer() const;
+	const UniformRingStats& getStats() const;
+
+private:
+	GpuAllocator* m_pAllocator;
+	VkBuffer m_buffer{ VK_NULL_HANDLE };
+	Allocation m_allocation{};
+	UniformRingStats m_stats{};
+
+	VkDeviceSize m_frameBegin{ 0 };
+	VkDeviceSize m_head{ 0 };
+};
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+#include "GpuAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <stdexcept>
+
+constexpr VkDeviceSize DEFAULT_STAGING_RING_SIZE = 32ull * 1024 * 1024;
+constexpr VkDeviceSize STAGING_ALIGNMENT = 16; //multiple of 4 and of every block compressed texel size
+
+//Identifies the batch an upload was recorded into. Tickets increase monotonically, 0 is never handed out.
+using UploadTicket = uint64_t;
+
+struct UploadStats {
+	uint64_t uploadCount{ 0 };
+	uint64_t batchCount{ 0 };
+	uint64_t bytesUploaded{ 0 };   //bytes of completed batches
+	uint64_t stallCount{ 0 };      //times the staging ring was full and the CPU had to wait for the transfer queue
+	double stallMs{ 0.0 };
+	double activeMs{ 0.0 };        //wall time with at least one batch in flight
+
+	double throughputMBps() const { return activeMs > 0.0 ? static_cast<double>(bytesUploaded) / (1024.0 * 1024.0) / (activeMs / 1000.0) : 0.0; }
+};
+
+//Streams buffer and image data through a persistently mapped staging ring on the transfer queue. Uploads are batched
+//into one command buffer per flush(), and ownership of the written ranges is released to the graphics family.
+//The matching acquire barriers are recorded by recordAcquireBarriers() into a graphics command buffer once the batch
+//has completed, so a ticket reports complete only when its data is usable on the graphics queue.
+//Not thread safe, meant to be driven from the render thread.
+class UploadManager {
+public:
+	//transferFamily may be UINT32_MAX when the device has no dedicated transfer family, uploads then go through the graphics queue
+	void init(VkDevice device, GpuAllocator& allocator, uint32_t transferFamily, VkQueue transferQueue, uint32_t graphicsFamily, VkQueue graphicsQueue,
+		VkDeviceSize ringSize = DEFAULT_STAGING_RING_SIZE);
+	void destroy();
+
+	UploadTicket uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* pData, VkDeviceSize size);
+	//Tightly packed data for one subresource region. The image ends up in finalLayout, owned by the graphics family.
+	UploadTicket uploadImage(VkImage dst, const VkImageSubresourceLayers& subresource, VkOffset3D offset, VkExtent3D extent,
+		const void* pData, VkDeviceSize size, VkImageLayout finalLayout);
+
+	//Submits everything recorded since the last flush. Returns the ticket of the submitted batch, or the last one if nothing was pending.
+	UploadTicket flush();
+	bool isComplete(UploadTicket ticket);
+	void wait(UploadTicket ticket);
+	void waitIdle();
+
+	//Call at the start of every graphics command buffer, before any use of uploaded resources.
+	void recordAcquireBarriers(VkCommandBuffer graphicsCmdBuffer);
+
+	const UploadStats& getStats() const;
+	bool usesDedicatedQueue() const;
+	//Largest single upload the staging ring accepts
+	VkDeviceSize getMaxUploadSize() const;
+
+private:
+	struct BufferCopy {
+		VkBuffer dst;
+		VkBufferCopy region;
+	};
+
+	struct ImageCopy {
+		VkImage dst;
+		VkBufferImageCopy region;
+		VkImageLayout finalLayout;
+	};
+
+	struct Batch {
+		VkCommandPool cmdPool;
+		VkCommandBuffer cmdBuffer;
+		VkFence fence;
+		UploadTicket ticket;
+		VkDeviceSize ringBytes;  //staging space held until completion, including alignment and wrap padding
+		VkDeviceSize dataBytes;
+		double submitMs;
+		std::vector<BufferCopy> bufferCopies;
+		std::vector<ImageCopy> imageCopies;
+		std::vector<VkBufferMemoryBarrier> bufferAcquires;
+		std::vector<VkImageMemoryBarrier> imageAcquires;
+	};
+
+	VkDevice m_device{ VK_NULL_HANDLE };
+	GpuAllocator* m_pAllocator{ nullptr };
+	uint32_t m_transferFamily{ 0 };
+	uint32_t m_graphicsFamily{ 0 };
+	VkQueue m_transferQueue{ VK_NULL_HANDLE };
+
+	VkBuffer m_ringBuffer{ VK_NULL_HANDLE };
+	Allocation m_ringAlloc{};
+	VkDeviceSize m_ringSize{ 0 };
+	VkDeviceSize m_ringHead{ 0 };
+	VkDeviceSize m_ringUsed{ 0 };
+
+	std::vector<Batch> m_batches;
+	std::vector<uint32_t> m_freeBatches;
+	std::deque<uint32_t> m_inFlight; //oldest first
+	uint32_t m_openBatch{ ~0u };
+	UploadTicket m_nextTicket{ 1 };
+	UploadTicket m_completedTicket{ 0 };
+	UploadTicket m_acquiredTicket{ 0 };
+	std::vector<VkBufferMemoryBarrier> m_pendingBufferAcquires;
+	std::vector<VkImageMemoryBarrier> m_pendingImageAcquires;
+
+	UploadStats m_stats{};
+	double m_activeSinceMs{ 0.0 };
+
+	Batch& getOpenBatch();
+	VkDeviceSize allocateStaging(VkDeviceSize size);
+	void record(Batch& batch);
+	void retireCompleted();
+	void retireOldest();
+	double nowMs() const;
+};
\ No newline at end of file
@@ -1,5 +1,55 @@
 #pragma once
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
 
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+//Full precision vertex, used as the input to Mesh and as the result of decoding. GPU buffers hold VertexLayout encoded data.
 struct Vertex {
-	double pos[3];
-};
\ No newline at end of file
+	glm::vec3 pos;
+	glm::vec3 normal;
+};
+
+enum class PositionFormat {
+	Float32, //R32G32B32_SFLOAT, 12 bytes
+	Half,    //R16G16B16A16_SFLOAT, 8 bytes, w is padding
+	Snorm16  //R16G16B16A16_SNORM, 8 bytes, mapped onto the mesh bounds and decoded with PositionDecode
+};
+
+enum class NormalFormat {
+	Float32, //R32G32B32_SFLOAT, 12 bytes
+	Oct16    //R16G16_SNORM octahedral encoding, 4 bytes
+};
+
+//pos = encoded * scale + offset. Identity for the float formats.
+struct PositionDecode {
+	glm::vec3 scale{ 1.0f };
+	glm::vec3 offset{ 0.0f };
+};
+
+struct VertexLayout {
+	PositionFormat position{ PositionFormat::Snorm16 };
+	NormalFormat normal{ NormalFormat::Oct16 };
+
+	uint32_t getPositionSize() const;
+	uint32_t getNormalOffset() const;
+	uint32_t getStride() const;
+
+	//Location 0 is the position, location 1 the normal
+	VkVertexInputBindingDescription getBindingDescription(uint32_t binding) const;
+	std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(uint32_t binding) const;
+
+	void encode(const Vertex& vertex, const PositionDecode& decode, std::byte* pOut) const;
+	Vertex decode(const std::byte* pData, const PositionDecode& decode) const;
+};
+
+namespace VertexEncoding {
+	uint16_t floatToHalf(float value);
+	float halfToFloat(uint16_t value);
+	int16_t floatToSnorm16(float value);
+	float snorm16ToFloat(int16_t value);
+	glm::vec2 octEncode(glm::vec3 normal);
+	glm::vec3 octDecode(glm::vec2 encoded);
+}
\ No newline at end of file
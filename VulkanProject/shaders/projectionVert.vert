@@ -1,12 +1,41 @@
 #version 450
+#ifdef SCENE_OBJECTS
+#extension GL_GOOGLE_include_directive : require
+#include "sceneObjects.glsl"
+#endif
 
-layout(location = 0) out vec3 fragColor;
+layout(location = 0) in vec3 inPosition;
+#ifdef NORMAL_OCT16
+layout(location = 1) in vec2 inNormal;
+#else
+layout(location = 1) in vec3 inNormal;
+#endif
 
-vec2 positions[3] = vec2[](
-	vec2(0.0, -0.5),
-	vec2(0.5, 0.5),
-	vec2(-0.5, 0.5)
-);
+//Selected per frame through a dynamic offset into the uniform ring
+layout(set = 0, binding = 1) uniform CameraData {
+	mat4 view;
+	mat4 projection;
+} camera;
+
+layout(push_constant) uniform MeshPushConstants {
+	vec4 positionScale;
+	vec4 positionOffset;
+	uint instanceBase;
+} mesh;
+
+#ifdef SCENE_OBJECTS
+layout(std430, set = 1, binding = 0) readonly buffer SceneObjects {
+	SceneObject objects[];
+};
+//Objects of every draw back to back, written by the GPU cull or by the CPU draw list through the uniform ring
+#ifdef INSTANCE_LIST
+layout(std430, set = 1, binding = 1) readonly buffer VisibleInstances {
+	uint visibleInstances[];
+};
+#endif
+#endif
+
+layout(location = 0) out vec3 fragColor;
 
 vec3 colors[3] = vec3[](
     vec3(1.0, 0.0, 0.0),
@@ -14,7 +43,28 @@ vec3 colors[3] = vec3[](
     vec3(0.0, 0.0, 1.0)
 );
 
+vec3 octDecode(vec2 encoded) {
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (n.z < 0.0) {
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+
 void main(){
-	gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	fragColor = colors[gl_VertexIndex];
+#ifdef NORMAL_OCT16
+	vec3 normal = octDecode(inNormal);
+#else
+	vec3 normal = inNormal;
+#endif
+	vec3 position = inPosition * mesh.positionScale.xyz + mesh.positionOffset.xyz;
+#if defined(SCENE_OBJECTS) && defined(INSTANCE_LIST)
+	uint objectIndex = visibleInstances[mesh.instanceBase + gl_InstanceIndex];
+	gl_Position = camera.projection * camera.view * objects[objectIndex].transform * vec4(position, 1.0);
+#elif defined(SCENE_OBJECTS)
+	gl_Position = camera.projection * camera.view * objects[gl_InstanceIndex].transform * vec4(position, 1.0);
+#else
+	gl_Position = vec4(position, 1.0);
+#endif
+	fragColor = colors[gl_VertexIndex % 3] * abs(normal.z); //headlight along the view axis
 }
\ No newline at end of file
@@ -0,0 +1,21 @@
+//Shared by the cull shader and the vertex shader, mirrors GpuObject and GpuDrawCommand in GpuScene.h
+
+struct SceneObject {
+	mat4 transform;
+	vec4 boundingSphere; //world space center and radius
+	uint firstDraw; //draw of the finest LOD, coarser levels follow
+	uint lodCount;
+	float lodErrorScale;
+	uint padding0;
+};
+
+struct DrawCommand {
+	uint indexCount;
+	uint instanceCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint firstInstance;
+	uint instanceBase;
+	float lodError;
+	uint padding0;
+};
\ No newline at end of file
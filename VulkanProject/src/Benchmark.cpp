@@ -0,0 +1,1811 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+#include <limits>
+
+SampleSummary Benchmark::summarize(std::vector<double> samples) {
+	if (samples.empty()) {
+		return SampleSummary{};
+	}
+	std::sort(samples.begin(), samples.end());
+
+	//Nearest-rank percentile on the sorted samples
+	auto percentile = [&samples](double p) {
+		size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(samples.size()));
+		return samples.at(std::min(rank, samples.size() - 1));
+	};
+
+	return SampleSummary{
+		.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size()),
+		.p50 = percentile(50.0),
+		.p95 = percentile(95.0),
+		.p99 = percentile(99.0),
+		.max = samples.back()
+	};
+}
+
+void Benchmark::writeSummaryJson(std::ostream& out, const std::string& name, const SampleSummary& summary) {
+	out << "\"" << name << "\": { "
+		<< "\"mean\": " << summary.mean << ", "
+		<< "\"p50\": " << summary.p50 << ", "
+		<< "\"p95\": " << summary.p95 << ", "
+		<< "\"p99\": " << summary.p99 << ", "
+		<< "\"max\": " << summary.max << " }";
+}
+
+void Benchmark::runFrameBenchmark(const BenchmarkOptions& options, std::ostream& out) {
+	RendererConfig config{ options.rendererConfig };
+	config.headless = true;
+	config.collectFrameTimes = true;
+
+	Renderer renderer{ config };
+	renderer.init();
+	renderer.renderFrames(options.warmupFrames);
+	FrameStats warmupStats{ renderer.getFrameStats() };
+	renderer.getJobSystem().resetStats();
+	renderer.renderFrames(options.frameCount);
+	JobSystemStats jobStats{ renderer.getJobSystem().getStats() };
+	renderer.finishFrames();
+
+	//Samples come back oldest first, drop the warmup frames
+	const FrameTimeSamples& samples{ renderer.getFrameTimeSamples() };
+	std::vector<double> cpuMs(samples.cpuMs.begin() + std::min<size_t>(options.warmupFrames, samples.cpuMs.size()), samples.cpuMs.end());
+	std::vector<double> gpuMs(samples.gpuMs.begin() + std::min<size_t>(options.warmupFrames, samples.gpuMs.size()), samples.gpuMs.end());
+	const std::vector<double>& latencySamples{ renderer.getFramePacer().getLatencySamples() };
+	std::vector<double> latencyMs(latencySamples.begin() + std::min<size_t>(options.warmupFrames, latencySamples.size()), latencySamples.end());
+	const FrameStats& stats{ renderer.getFrameStats() };
+
+	out << "{\n"
+		<< "  \"benchmark\": \"frame\",\n"
+		<< "  \"device\": \"" << renderer.getDeviceName() << "\",\n"
+		<< "  \"width\": " << config.width << ",\n"
+		<< "  \"height\": " << config.height << ",\n"
+		<< "  \"framesInFlight\": " << config.framesInFlight << ",\n"
+		<< "  \"drawsPerFrame\": " << config.syntheticDrawCount << ",\n"
+		<< "  \"frames\": " << cpuMs.size() << ",\n"
+		<< "  \"gpuTimestamps\": " << (gpuMs.empty() ? "false" : "true") << ",\n"
+		<< "  \"cpuOverlapRatio\": " << stats.overlapRatio() << ",\n"
+		<< "  \"recording\": { \"workers\": " << jobStats.workers.size()
+		<< ", \"avgRecordMs\": " << (stats.recordMs - warmupStats.recordMs) / std::max(options.frameCount, 1u)
+		<< ", \"parallelFrames\": " << stats.parallelRecordedFrames - warmupStats.parallelRecordedFrames << ", \"utilization\": [";
+	for (size_t i = 0; i < jobStats.workers.size(); i++) {
+		out << (i == 0 ? "" : ", ") << "{ \"busy\": " << jobStats.utilization(i) << ", \"busyMs\": " << jobStats.workers[i].busyMs
+			<< ", \"jobs\": " << jobStats.workers[i].jobsExecuted << ", \"stolen\": " << jobStats.workers[i].jobsStolen << " }";
+	}
+	const UniformRingStats& uniformStats{ renderer.getUniforms().getStats() };
+	const DescriptorStats& descriptorStats{ renderer.getDescriptors().getStats() };
+	PipelineLibraryStats pipelineStats{ renderer.getPipelines().getStats() };
+	out << "] },\n"
+		<< "  \"uniformRing\": { \"frameBytes\": " << uniformStats.frameSize << ", \"alignment\": " << uniformStats.alignment
+		<< ", \"peakFrameBytes\": " << uniformStats.peakFrameBytes << ", \"allocations\": " << uniformStats.allocationCount << " },\n"
+		<< "  \"descriptors\": { \"layouts\": " << descriptorStats.layoutsCreated << ", \"layoutCacheHits\": " << descriptorStats.layoutCacheHits
+		<< ", \"persistentSets\": " << descriptorStats.persistentAllocations << ", \"persistentCacheHits\": " << descriptorStats.persistentCacheHits
+		<< ", \"transientSets\": " << descriptorStats.transientAllocations << ", \"pools\": " << descriptorStats.poolsCreated
+		<< ", \"poolGrowthEvents\": " << descriptorStats.poolGrowthEvents << ", \"poolReuses\": " << descriptorStats.poolReuses << " },\n"
+		<< "  \"pipelines\": { \"requests\": " << pipelineStats.requests << ", \"hits\": " << pipelineStats.hits
+		<< ", \"created\": " << pipelineStats.created << ", \"deduplicatedWaits\": " << pipelineStats.deduplicatedWaits
+		<< ", \"creationMs\": " << pipelineStats.creationMs << " },\n"
+		<< "  \"startup\": { \"initMs\": " << renderer.getStartupStats().initMs
+		<< ", \"pipelineCreationMs\": " << renderer.getStartupStats().pipelineCreationMs
+		<< ", \"warmPipelineCache\": " << (renderer.getStartupStats().warmPipelineCache ? "true" : "false")
+		<< ", \"shadersCompiled\": " << renderer.getStartupStats().shaderBuild.compiled
+		<< ", \"shadersCached\": " << renderer.getStartupStats().shaderBuild.upToDate
+		<< ", \"shaderBuildMs\": " << renderer.getStartupStats().shaderBuild.ms << " },\n  ";
+	writeSummaryJson(out, "cpuFrameMs", summarize(cpuMs));
+	out << ",\n  ";
+	writeSummaryJson(out, "gpuFrameMs", summarize(gpuMs));
+	out << ",\n  ";
+	writeSummaryJson(out, "inputToRetireMs", summarize(latencyMs));
+	const FramePacingStats& pacing{ renderer.getFramePacer().getStats() };
+	out << ",\n  \"pacing\": { \"targetFrameRate\": " << config.targetFrameRate << ", \"delayedFrames\": " << pacing.delayedFrames
+		<< ", \"delayMs\": " << pacing.delayMs << ", \"avgInputToSubmitMs\": " << pacing.inputToSubmitMs / std::max<uint64_t>(pacing.frames, 1) << " }";
+	std::vector<ProfileZoneSummary> zones{ renderer.getProfiler().getSummary() };
+	out << ",\n  \"zones\": [";
+	for (size_t i = 0; i < zones.size(); i++) {
+		out << (i == 0 ? "" : ", ") << "{ \"name\": \"" << zones[i].name << "\", \"gpu\": " << (zones[i].gpu ? "true" : "false")
+			<< ", \"calls\": " << zones[i].calls << ", \"windowAvgMs\": " << zones[i].windowAvgMs << ", \"windowMaxMs\": " << zones[i].windowMaxMs << " }";
+	}
+	out << "]";
+	out << ",\n  \"heaps\": [";
+
+	std::vector<HeapStats> heaps{ renderer.getHeapStats() };
+	for (size_t i = 0; i < heaps.size(); i++) {
+		out << (i == 0 ? "\n    " : ",\n    ")
+			<< "{ \"heapSize\": " << heaps.at(i).heapSize
+			<< ", \"blockBytes\": " << heaps.at(i).blockBytes
+			<< ", \"usedBytes\": " << heaps.at(i).usedBytes
+			<< ", \"blockCount\": " << heaps.at(i).blockCount
+			<< ", \"allocationCount\": " << heaps.at(i).allocationCount << " }";
+	}
+	out << "\n  ]\n}\n";
+}
+
+//Replays random churn against a shadow copy of the live ranges and throws on the first allocation that overlaps another,
+//leaves the block, misses its alignment or shares a bufferImageGranularity page with a resource of the other kind, and on
+//free ranges that did not coalesce. Returns the number of allocations checked.
+static uint64_t checkAllocatorBlocks(uint32_t operationCount, VkDeviceSize blockSize, VkDeviceSize granularity, size_t maxLiveAllocations) {
+	struct LiveRange {
+		VkDeviceSize size;
+		bool linear;
+	};
+
+	std::mt19937 rng{ 4321 };
+	std::uniform_int_distribution<VkDeviceSize> sizeDist{ 1, 256 * 1024 };
+	std::uniform_int_distribution<uint32_t> alignShiftDist{ 0, 12 };
+	uint64_t checked = 0;
+
+	auto fail = [](const std::string& what, VkDeviceSize offset) {
+		throw std::runtime_error("Allocator check failed: " + what + " at offset " + std::to_string(offset));
+	};
+	auto conflicts = [granularity](VkDeviceSize lastByte, bool lastLinear, VkDeviceSize firstByte, bool firstLinear) {
+		return lastLinear != firstLinear && lastByte / granularity == firstByte / granularity;
+	};
+
+	FreeListBlock block{ blockSize, granularity };
+	std::map<VkDeviceSize, LiveRange> live;
+	std::vector<VkDeviceSize> liveOffsets;
+	VkDeviceSize liveBytes = 0;
+
+	for (uint32_t i = 0; i < operationCount; i++) {
+		if (live.size() < maxLiveAllocations && rng() % 3 != 0) {
+			VkDeviceSize size = sizeDist(rng);
+			VkDeviceSize alignment = VkDeviceSize{ 1 } << alignShiftDist(rng);
+			bool linear = rng() % 2 == 0;
+			VkDeviceSize offset;
+			if (!block.allocate(size, alignment, linear, offset)) {
+				continue;
+			}
+
+			if (offset % alignment != 0) {
+				fail("misaligned allocation", offset);
+			}
+			if (offset + size > blockSize) {
+				fail("allocation past the end of the block", offset);
+			}
+			auto next = live.lower_bound(offset);
+			if (next != live.end() && (next->first < offset + size || conflicts(offset + size - 1, linear, next->first, next->second.linear))) {
+				fail("allocation overlaps or shares a granularity page with the next one", offset);
+			}
+			if (next != live.begin()) {
+				auto prev = std::prev(next);
+				VkDeviceSize prevEnd = prev->first + prev->second.size;
+				if (prevEnd > offset || conflicts(prevEnd - 1, prev->second.linear, offset, linear)) {
+					fail("allocation overlaps or shares a granularity page with the previous one", offset);
+				}
+			}
+
+			live.emplace(offset, LiveRange{ .size = size, .linear = linear });
+			liveOffsets.push_back(offset);
+			liveBytes += size;
+			checked++;
+		}
+		else if (!liveOffsets.empty()) {
+			size_t victim = rng() % liveOffsets.size();
+			VkDeviceSize offset = liveOffsets.at(victim);
+			block.free(offset);
+			liveBytes -= live.at(offset).size;
+			live.erase(offset);
+			liveOffsets.at(victim) = liveOffsets.back();
+			liveOffsets.pop_back();
+		}
+
+		if (block.getUsedBytes() != liveBytes || block.getAllocationCount() != live.size()) {
+			fail("used bytes or allocation count out of sync", 0);
+		}
+
+		//Coalesced free ranges are never adjacent, so there is exactly one per non-empty gap between live allocations
+		uint32_t gaps = 0;
+		VkDeviceSize cursor = 0;
+		for (const auto& [offset, range] : live) {
+			gaps += offset > cursor;
+			cursor = offset + range.size;
+		}
+		gaps += blockSize > cursor;
+		if (block.getFreeRangeCount() != gaps) {
+			fail("adjacent free ranges were not coalesced", cursor);
+		}
+	}
+
+	for (VkDeviceSize offset : liveOffsets) {
+		block.free(offset);
+	}
+	if (block.getFreeRangeCount() != 1 || block.getLargestFreeRange() != blockSize || block.getUsedBytes() != 0) {
+		fail("freeing every allocation did not restore a single free range", 0);
+	}
+
+	//Linear blocks only ever move forward, every allocation must start past the previous one and its granularity page
+	LinearBlock linearBlock{ blockSize, granularity };
+	VkDeviceSize prevEnd = 0;
+	bool prevLinear = false;
+	for (uint32_t i = 0; i < operationCount; i++) {
+		VkDeviceSize size = sizeDist(rng);
+		VkDeviceSize alignment = VkDeviceSize{ 1 } << alignShiftDist(rng);
+		bool linear = rng() % 2 == 0;
+		VkDeviceSize offset;
+		if (!linearBlock.allocate(size, alignment, linear, offset)) {
+			linearBlock.reset();
+			prevEnd = 0;
+			continue;
+		}
+
+		if (offset % alignment != 0 || offset + size > blockSize) {
+			fail("misaligned or out of bounds linear allocation", offset);
+		}
+		if (prevEnd > 0 && (offset < prevEnd || conflicts(prevEnd - 1, prevLinear, offset, linear))) {
+			fail("linear allocation overlaps or shares a granularity page with the previous one", offset);
+		}
+		prevEnd = offset + size;
+		prevLinear = linear;
+		checked++;
+	}
+	return checked;
+}
+
+void Benchmark::runAllocatorBenchmark(uint32_t operationCount, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+	constexpr VkDeviceSize blockSize = DEFAULT_MEMORY_BLOCK_SIZE;
+	constexpr VkDeviceSize granularity = 1024; //typical bufferImageGranularity on desktop GPUs
+	constexpr size_t maxLiveAllocations = 384; //keeps the block around 75% full on average
+
+	std::mt19937 rng{ 1234 };
+	std::uniform_int_distribution<VkDeviceSize> sizeDist{ 256, 256 * 1024 };
+	std::uniform_int_distribution<uint32_t> alignShiftDist{ 4, 12 };
+
+	FreeListBlock block{ blockSize, granularity };
+	std::vector<VkDeviceSize> live;
+	uint64_t failedAllocations = 0;
+	VkDeviceSize peakUsed = 0;
+
+	//Random churn between allocating and freeing long lived resources, biased towards filling the block
+	Clock::time_point start = Clock::now();
+	for (uint32_t i = 0; i < operationCount; i++) {
+		if (live.size() < maxLiveAllocations && rng() % 3 != 0) {
+			VkDeviceSize offset;
+			if (block.allocate(sizeDist(rng), VkDeviceSize{ 1 } << alignShiftDist(rng), rng() % 2 == 0, offset)) {
+				live.push_back(offset);
+				peakUsed = std::max(peakUsed, block.getUsedBytes());
+			}
+			else {
+				failedAllocations++;
+			}
+		}
+		else if (!live.empty()) {
+			size_t victim = rng() % live.size();
+			block.free(live.at(victim));
+			live.at(victim) = live.back();
+			live.pop_back();
+		}
+	}
+	double freeListNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / std::max(operationCount, 1u);
+
+	VkDeviceSize freeBytes = block.getSize() - block.getUsedBytes();
+	double fragmentation = freeBytes > 0 ? 1.0 - static_cast<double>(block.getLargestFreeRange()) / static_cast<double>(freeBytes) : 0.0;
+
+	//Per-frame pattern: fill a linear block then reset it
+	LinearBlock linearBlock{ blockSize, granularity };
+	uint64_t linearResets = 0;
+	start = Clock::now();
+	for (uint32_t i = 0; i < operationCount; i++) {
+		VkDeviceSize offset;
+		if (!linearBlock.allocate(sizeDist(rng), 256, true, offset)) {
+			linearBlock.reset();
+			linearResets++;
+		}
+	}
+	double linearNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / std::max(operationCount, 1u);
+
+	//Checked separately so the shadow bookkeeping stays out of the timings, a violation throws and fails the run
+	uint64_t checkedAllocations = checkAllocatorBlocks(operationCount, blockSize, granularity, maxLiveAllocations);
+
+	out << "{\n"
+		<< "  \"benchmark\": \"allocator\",\n"
+		<< "  \"operations\": " << operationCount << ",\n"
+		<< "  \"freeList\": { "
+		<< "\"nsPerOp\": " << freeListNs << ", "
+		<< "\"liveAllocations\": " << live.size() << ", "
+		<< "\"failedAllocations\": " << failedAllocations << ", "
+		<< "\"peakUsedBytes\": " << peakUsed << ", "
+		<< "\"freeRanges\": " << block.getFreeRangeCount() << ", "
+		<< "\"largestFreeRange\": " << block.getLargestFreeRange() << ", "
+		<< "\"fragmentation\": " << fragmentation << " },\n"
+		<< "  \"linear\": { "
+		<< "\"nsPerOp\": " << linearNs << ", "
+		<< "\"resets\": " << linearResets << " },\n"
+		<< "  \"checkedAllocations\": " << checkedAllocations << "\n"
+		<< "}\n";
+}
+
+void Benchmark::runVertexBenchmark(uint32_t vertexCount, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+	constexpr uint32_t legacyBytesPerVertex = 3 * sizeof(double); //the old Vertex, position only
+	constexpr float terrainSize = 1000.0f;
+
+	//Heightfield sized to roughly vertexCount unique vertices, emitted as an unindexed triangle list like a naive loader would
+	uint32_t side = std::max(2u, static_cast<uint32_t>(std::sqrt(static_cast<double>(vertexCount))));
+	auto gridVertex = [side](uint32_t x, uint32_t z) {
+		float u = static_cast<float>(x) / static_cast<float>(side - 1) * terrainSize;
+		float v = static_cast<float>(z) / static_cast<float>(side - 1) * terrainSize;
+		float height = 20.0f * std::sin(u * 0.01f) * std::cos(v * 0.013f);
+		float dx = 0.2f * std::cos(u * 0.01f) * std::cos(v * 0.013f);
+		float dz = -0.26f * std::sin(u * 0.01f) * std::sin(v * 0.013f);
+		float length = std::sqrt(dx * dx + 1.0f + dz * dz);
+		return Vertex{ .pos = glm::vec3(u, height, v), .normal = glm::vec3(-dx / length, 1.0f / length, -dz / length) };
+	};
+	std::vector<Vertex> triangles;
+	triangles.reserve(static_cast<size_t>(side - 1) * (side - 1) * 6);
+	for (uint32_t z = 0; z + 1 < side; z++) {
+		for (uint32_t x = 0; x + 1 < side; x++) {
+			triangles.push_back(gridVertex(x, z));
+			triangles.push_back(gridVertex(x + 1, z));
+			triangles.push_back(gridVertex(x, z + 1));
+			triangles.push_back(gridVertex(x + 1, z));
+			triangles.push_back(gridVertex(x + 1, z + 1));
+			triangles.push_back(gridVertex(x, z + 1));
+		}
+	}
+
+	struct NamedLayout {
+		const char* name;
+		VertexLayout layout;
+	};
+	std::vector<NamedLayout> layouts{
+		{ "float32", { .position = PositionFormat::Float32, .normal = NormalFormat::Float32 } },
+		{ "half_oct16", { .position = PositionFormat::Half, .normal = NormalFormat::Oct16 } },
+		{ "snorm16_float32", { .position = PositionFormat::Snorm16, .normal = NormalFormat::Float32 } },
+		{ "snorm16_oct16", { .position = PositionFormat::Snorm16, .normal = NormalFormat::Oct16 } }
+	};
+
+	out << "{\n"
+		<< "  \"benchmark\": \"vertex\",\n"
+		<< "  \"inputVertices\": " << triangles.size() << ",\n"
+		<< "  \"legacyBytesPerVertex\": " << legacyBytesPerVertex << ",\n"
+		<< "  \"legacyBytes\": " << triangles.size() * legacyBytesPerVertex << ",\n"
+		<< "  \"layouts\": [";
+	for (size_t l = 0; l < layouts.size(); l++) {
+		Clock::time_point start = Clock::now();
+		Mesh mesh{ triangles, layouts[l].layout };
+		double encodeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		start = Clock::now();
+		std::vector<Vertex> decoded{ mesh.decodeVertices() };
+		double decodeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		//Error measured through the index buffer, so a wrong merge during deduplication shows up too
+		double maxPositionError = 0.0;
+		double maxNormalErrorDeg = 0.0;
+		for (uint32_t i = 0; i < mesh.getIndexCount(); i++) {
+			const Vertex& original = triangles[i];
+			const Vertex& result = decoded[mesh.getIndex(i)];
+			maxPositionError = std::max(maxPositionError, static_cast<double>(glm::length(result.pos - original.pos)));
+			double chord = std::min(static_cast<double>(glm::length(result.normal - original.normal)), 2.0); //acos(dot) is too imprecise near zero
+			maxNormalErrorDeg = std::max(maxNormalErrorDeg, 2.0 * std::asin(chord * 0.5) * 180.0 / 3.14159265358979323846);
+		}
+
+		size_t totalBytes = mesh.getVertexData().size() + mesh.getIndexData().size();
+		out << (l == 0 ? "\n    " : ",\n    ") << "{ "
+			<< "\"layout\": \"" << layouts[l].name << "\", "
+			<< "\"bytesPerVertex\": " << layouts[l].layout.getStride() << ", "
+			<< "\"uniqueVertices\": " << mesh.getVertexCount() << ", "
+			<< "\"vertexBytes\": " << mesh.getVertexData().size() << ", "
+			<< "\"indexBytes\": " << mesh.getIndexData().size() << ", "
+			<< "\"reductionVsLegacy\": " << static_cast<double>(triangles.size() * legacyBytesPerVertex) / static_cast<double>(totalBytes) << ", "
+			<< "\"encodeMVertsPerSec\": " << static_cast<double>(triangles.size()) / std::max(encodeMs, 1e-6) / 1000.0 << ", "
+			<< "\"decodeMVertsPerSec\": " << static_cast<double>(mesh.getVertexCount()) / std::max(decodeMs, 1e-6) / 1000.0 << ", "
+			<< "\"maxPositionError\": " << maxPositionError << ", "
+			<< "\"maxNormalErrorDeg\": " << maxNormalErrorDeg << " }";
+	}
+	out << "\n  ]\n}\n";
+}
+
+void Benchmark::runUploadBenchmark(const BenchmarkOptions& options, uint32_t megabytes, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+	constexpr VkDeviceSize destinationSize = 64ull * 1024 * 1024;
+	constexpr VkDeviceSize bytesPerFrame = 8ull * 1024 * 1024; //streaming budget between two rendered frames
+	constexpr size_t maxUploadSize = 1024 * 1024;
+
+	Renderer renderer{ options.rendererConfig };
+	renderer.init();
+	UploadManager& uploads = renderer.getUploads();
+
+	VkBufferCreateInfo destinationInfo{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = destinationSize,
+		.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+	};
+	VkBuffer destination;
+	Allocation destinationAlloc = renderer.getAllocator().createBuffer(destinationInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+		AllocationStrategy::FreeList, destination);
+
+	std::mt19937 rng{ 1234 };
+	std::uniform_int_distribution<size_t> sizeDist{ 4 * 1024, maxUploadSize };
+	std::vector<std::byte> source(maxUploadSize);
+	for (size_t i = 0; i < source.size(); i++) {
+		source[i] = static_cast<std::byte>(rng());
+	}
+
+	//Many small geometry-sized uploads written sequentially through the destination, rendering a frame whenever the budget is spent
+	VkDeviceSize totalBytes = static_cast<VkDeviceSize>(megabytes) * 1024 * 1024;
+	VkDeviceSize uploaded = 0;
+	VkDeviceSize frameBytes = 0;
+	VkDeviceSize dstOffset = 0;
+	uint32_t frames = 0;
+	Clock::time_point start = Clock::now();
+	while (uploaded < totalBytes) {
+		VkDeviceSize size = std::min<VkDeviceSize>(sizeDist(rng), totalBytes - uploaded);
+		if (dstOffset + size > destinationSize) {
+			dstOffset = 0;
+		}
+		uploads.uploadBuffer(destination, dstOffset, source.data(), size);
+		dstOffset += (size + 255) & ~VkDeviceSize{ 255 };
+		uploaded += size;
+		frameBytes += size;
+
+		if (frameBytes >= bytesPerFrame) {
+			renderer.renderFrames(1);
+			frames++;
+			frameBytes = 0;
+		}
+	}
+	uploads.waitIdle();
+	double wallMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	renderer.finishFrames();
+	renderer.getAllocator().destroyBuffer(destination, destinationAlloc);
+
+	const UploadStats& stats = uploads.getStats();
+	out << "{\n"
+		<< "  \"benchmark\": \"upload\",\n"
+		<< "  \"device\": \"" << renderer.getDeviceName() << "\",\n"
+		<< "  \"dedicatedTransferQueue\": " << (uploads.usesDedicatedQueue() ? "true" : "false") << ",\n"
+		<< "  \"megabytes\": " << megabytes << ",\n"
+		<< "  \"frames\": " << frames << ",\n"
+		<< "  \"uploads\": " << stats.uploadCount << ",\n"
+		<< "  \"batches\": " << stats.batchCount << ",\n"
+		<< "  \"uploadsPerBatch\": " << static_cast<double>(stats.uploadCount) / std::max<uint64_t>(stats.batchCount, 1) << ",\n"
+		<< "  \"transferMBps\": " << stats.throughputMBps() << ",\n"
+		<< "  \"wallMBps\": " << static_cast<double>(uploaded) / (1024.0 * 1024.0) / (wallMs / 1000.0) << ",\n"
+		<< "  \"ringStalls\": " << stats.stallCount << ",\n"
+		<< "  \"ringStallMs\": " << stats.stallMs << "\n"
+		<< "}\n";
+}
+
+void Benchmark::runSceneBenchmark(uint32_t objectCount, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+	constexpr uint32_t passCount = 10;
+	constexpr float cullDistanceSq = 400.0f * 400.0f;
+
+	//The layout Scene replaced: one heap allocation per object, visited through a pointer array whose order has
+	//drifted away from allocation order
+	struct PointerObject {
+		glm::mat4 transform;
+		ObjectBounds bounds;
+		const Mesh* pMesh;
+		uint32_t flags;
+	};
+
+	std::vector<Vertex> cube;
+	for (int i = 0; i < 8; i++) {
+		cube.push_back(Vertex{ .pos = glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f), .normal = glm::vec3(0.0f, 1.0f, 0.0f) });
+	}
+	Mesh mesh{ cube, VertexLayout{} };
+
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> posDist{ -1000.0f, 1000.0f };
+	Scene scene;
+	std::vector<ObjectHandle> handles;
+	std::vector<std::unique_ptr<PointerObject>> pointerStorage;
+	std::vector<PointerObject*> pointerObjects;
+	handles.reserve(objectCount);
+	pointerStorage.reserve(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++) {
+		glm::mat4 transform{ 1.0f };
+		transform[3] = glm::vec4(posDist(rng), posDist(rng), posDist(rng), 1.0f);
+		uint32_t flags = rng() % 4 != 0 ? static_cast<uint32_t>(OBJECT_VISIBLE) : 0u;
+		handles.push_back(scene.addObject(transform, &mesh, flags));
+		pointerStorage.push_back(std::make_unique<PointerObject>(PointerObject{ transform, scene.getBounds().back(), &mesh, flags }));
+		pointerObjects.push_back(pointerStorage.back().get());
+	}
+	std::shuffle(pointerObjects.begin(), pointerObjects.end(), rng);
+
+	auto nsPerObject = [objectCount](Clock::time_point start) {
+		return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / passCount / std::max(objectCount, 1u);
+	};
+
+	//Read-only pass over bounds and flags, the shape of a culling system
+	uint64_t visibleSoa = 0;
+	Clock::time_point start = Clock::now();
+	for (uint32_t pass = 0; pass < passCount; pass++) {
+		std::span<const ObjectBounds> bounds{ std::as_const(scene).getBounds() };
+		std::span<const uint32_t> flags{ std::as_const(scene).getFlags() };
+		for (size_t i = 0; i < bounds.size(); i++) {
+			visibleSoa += (flags[i] & OBJECT_VISIBLE) != 0 && glm::dot(bounds[i].center, bounds[i].center) < cullDistanceSq;
+		}
+	}
+	double cullSoaNs = nsPerObject(start);
+
+	uint64_t visiblePointer = 0;
+	start = Clock::now();
+	for (uint32_t pass = 0; pass < passCount; pass++) {
+		for (const PointerObject* pObject : pointerObjects) {
+			visiblePointer += (pObject->flags & OBJECT_VISIBLE) != 0 && glm::dot(pObject->bounds.center, pObject->bounds.center) < cullDistanceSq;
+		}
+	}
+	double cullPointerNs = nsPerObject(start);
+
+	//Read-write pass moving every object and refreshing its bounds
+	glm::vec4 velocity{ 0.01f, 0.0f, -0.01f, 0.0f };
+	start = Clock::now();
+	for (uint32_t pass = 0; pass < passCount; pass++) {
+		std::span<glm::mat4> transforms{ scene.getTransforms() };
+		std::span<ObjectBounds> bounds{ scene.getBounds() };
+		for (size_t i = 0; i < transforms.size(); i++) {
+			transforms[i][3] = transforms[i][3] + velocity;
+			bounds[i].center = glm::vec3(transforms[i][3]);
+		}
+	}
+	double moveSoaNs = nsPerObject(start);
+
+	start = Clock::now();
+	for (uint32_t pass = 0; pass < passCount; pass++) {
+		for (PointerObject* pObject : pointerObjects) {
+			pObject->transform[3] = pObject->transform[3] + velocity;
+			pObject->bounds.center = glm::vec3(pObject->transform[3]);
+		}
+	}
+	double movePointerNs = nsPerObject(start);
+
+	//Churn: remove a random tenth by handle, then add them back
+	uint32_t churnCount = std::max(objectCount / 10, 1u);
+	std::shuffle(handles.begin(), handles.end(), rng);
+	start = Clock::now();
+	for (uint32_t i = 0; i < churnCount && i < handles.size(); i++) {
+		scene.removeObject(handles[i]);
+	}
+	double removeNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / churnCount;
+	bool staleHandlesRejected = handles.empty() || !scene.isValid(handles.front());
+
+	start = Clock::now();
+	for (uint32_t i = 0; i < churnCount && i < handles.size(); i++) {
+		handles[i] = scene.addObject(glm::mat4{ 1.0f }, &mesh);
+	}
+	double addNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / churnCount;
+
+	out << "{\n"
+		<< "  \"benchmark\": \"scene\",\n"
+		<< "  \"objects\": " << objectCount << ",\n"
+		<< "  \"soaBytesPerObject\": " << sizeof(glm::mat4) + sizeof(ObjectBounds) + sizeof(const Mesh*) + sizeof(uint32_t) + sizeof(ObjectHandle) << ",\n"
+		<< "  \"pointerBytesPerObject\": " << sizeof(PointerObject) + sizeof(PointerObject*) << ",\n"
+		<< "  \"cull\": { \"soaNsPerObject\": " << cullSoaNs << ", \"pointerNsPerObject\": " << cullPointerNs
+		<< ", \"speedup\": " << cullPointerNs / std::max(cullSoaNs, 1e-9) << ", \"resultsMatch\": " << (visibleSoa == visiblePointer ? "true" : "false") << " },\n"
+		<< "  \"move\": { \"soaNsPerObject\": " << moveSoaNs << ", \"pointerNsPerObject\": " << movePointerNs
+		<< ", \"speedup\": " << movePointerNs / std::max(moveSoaNs, 1e-9) << " },\n"
+		<< "  \"churn\": { \"removeNs\": " << removeNs << ", \"addNs\": " << addNs
+		<< ", \"staleHandlesRejected\": " << (staleHandlesRejected ? "true" : "false") << " }\n"
+		<< "}\n";
+}
+
+void Benchmark::runCullingBenchmark(uint32_t objectCount, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+	constexpr uint32_t passCount = 20;
+
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> posDist{ -1000.0f, 1000.0f };
+	std::uniform_real_distribution<float> sizeDist{ 0.5f, 20.0f };
+	std::vector<ObjectBounds> bounds(objectCount);
+	for (ObjectBounds& object : bounds) {
+		object.center = glm::vec3(posDist(rng), posDist(rng), posDist(rng));
+		object.extents = glm::vec3(sizeDist(rng), sizeDist(rng), sizeDist(rng));
+		object.radius = glm::length(object.extents);
+	}
+
+	Camera camera{};
+	Frustum frustum = Culling::extractFrustum(camera.fetchGPUData(static_cast<float>(WIDTH), static_cast<float>(HEIGHT)));
+
+	JobSystem jobs{};
+	JobSystem inlineJobs{ 1 };
+	FrustumCuller culler{ jobs };
+	FrustumCuller singleThreaded{ inlineJobs };
+	std::vector<uint32_t> reference(objectCount);
+	auto timeCull = [&](FrustumCuller& target, CullShape shape, CullPath path, bool& matches) {
+		std::span<const uint32_t> visible = target.cull(frustum, bounds, shape, path);
+		Clock::time_point start = Clock::now();
+		for (uint32_t pass = 0; pass < passCount; pass++) {
+			visible = target.cull(frustum, bounds, shape, path);
+		}
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / passCount;
+		uint32_t referenceCount = Culling::cullScalar(frustum, bounds, shape, 0, reference.data());
+		matches = visible.size() == referenceCount && std::equal(visible.begin(), visible.end(), reference.begin());
+		return ms;
+	};
+
+	out << "{\n"
+		<< "  \"benchmark\": \"culling\",\n"
+		<< "  \"objects\": " << objectCount << ",\n"
+		<< "  \"threads\": " << jobs.getWorkerCount() << ",\n"
+		<< "  \"avx2\": " << (Culling::hasAvx2() ? "true" : "false") << ",\n";
+
+	const std::pair<CullShape, const char*> shapes[] = { { CullShape::Sphere, "sphere" }, { CullShape::Aabb, "aabb" } };
+	const std::pair<CullPath, const char*> paths[] = { { CullPath::Scalar, "scalar" }, { CullPath::Sse, "sse" }, { CullPath::Avx2, "avx2" } };
+	for (size_t s = 0; s < std::size(shapes); s++) {
+		uint32_t visibleCount = static_cast<uint32_t>(culler.cull(frustum, bounds, shapes[s].first).size());
+		out << "  \"" << shapes[s].second << "\": { \"visible\": " << visibleCount;
+		for (const auto& [path, name] : paths) {
+			bool matches = false;
+			double ms = timeCull(singleThreaded, shapes[s].first, path, matches);
+			out << ", \"" << name << "Ms\": " << ms << ", \"" << name << "Matches\": " << (matches ? "true" : "false");
+		}
+		bool matches = false;
+		double ms = timeCull(culler, shapes[s].first, CullPath::Auto, matches);
+		out << ", \"threadedMs\": " << ms << ", \"threadedMatches\": " << (matches ? "true" : "false")
+			<< " }" << (s + 1 < std::size(shapes) ? "," : "") << "\n";
+	}
+	out << "}\n";
+}
+
+//A forest of shallow, wide trees, roughly props parented to a few anchors each. Every frame a tenth of the nodes get a
+//new local transform, then the hierarchy is updated in each configuration from the same sequence of edits, so all of
+//them end with the same world matrices. Recomputing every node is the baseline the dirty flags are measured against.
+void Benchmark::runTransformBenchmark(uint32_t nodeCount, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+	constexpr uint32_t frameCount = 20;
+	constexpr uint32_t rootCount = 1024;
+	constexpr uint32_t fanout = 8;
+	constexpr uint32_t viewMatrixCount = 1000000;
+
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> offsetDist{ -10.0f, 10.0f };
+	std::uniform_real_distribution<float> angleDist{ -PI, PI };
+	std::uniform_real_distribution<float> scaleDist{ 0.5f, 2.0f };
+	auto randomTrs = [&]() {
+		return TransformTrs{
+			.translation = glm::vec3(offsetDist(rng), offsetDist(rng), offsetDist(rng)),
+			.rotation = glm::angleAxis(angleDist(rng), glm::normalize(glm::vec3(offsetDist(rng), offsetDist(rng), offsetDist(rng)) + glm::vec3(0.0f, 0.0f, 20.0f))),
+			.scale = glm::vec3(scaleDist(rng))
+		};
+	};
+
+	TransformHierarchy hierarchy;
+	for (uint32_t i = 0; i < nodeCount; i++) {
+		hierarchy.addNode(i < rootCount ? TRANSFORM_NO_PARENT : (i - rootCount) / fanout, randomTrs());
+	}
+	hierarchy.update();
+
+	uint32_t dirtyCount = nodeCount / 10;
+	std::uniform_int_distribution<uint32_t> nodeDist{ 0, std::max(nodeCount, 1u) - 1 };
+	std::vector<std::vector<std::pair<TransformId, TransformTrs>>> edits(frameCount);
+	for (std::vector<std::pair<TransformId, TransformTrs>>& frameEdits : edits) {
+		for (uint32_t i = 0; i < dirtyCount; i++) {
+			frameEdits.emplace_back(nodeDist(rng), randomTrs());
+		}
+	}
+
+	JobSystem jobs{};
+	std::vector<glm::mat4> reference;
+	auto timeUpdate = [&](JobSystem* pJobs, CullPath path, bool full, uint64_t& updatedNodes, float& maxError) {
+		double ms = 0.0;
+		updatedNodes = 0;
+		for (const std::vector<std::pair<TransformId, TransformTrs>>& frameEdits : edits) {
+			for (const auto& [id, local] : frameEdits) {
+				hierarchy.setLocal(id, local);
+			}
+			if (full) {
+				hierarchy.markAllDirty();
+			}
+			Clock::time_point start = Clock::now();
+			TransformUpdateStats stats = hierarchy.update(pJobs, path);
+			ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			updatedNodes += stats.updatedNodes;
+		}
+
+		std::span<const glm::mat4> worlds = hierarchy.getWorldMatrices();
+		if (reference.empty()) {
+			reference.assign(worlds.begin(), worlds.end());
+		}
+		maxError = 0.0f;
+		for (size_t i = 0; i < worlds.size(); i++) {
+			for (int column = 0; column < 4; column++) {
+				for (int row = 0; row < 4; row++) {
+					maxError = std::max(maxError, std::abs(worlds[i][column][row] - reference[i][column][row]));
+				}
+			}
+		}
+		updatedNodes /= frameCount;
+		return ms / frameCount;
+	};
+
+	out << "{\n"
+		<< "  \"benchmark\": \"transforms\",\n"
+		<< "  \"nodes\": " << nodeCount << ",\n"
+		<< "  \"levels\": " << hierarchy.getLevelCount() << ",\n"
+		<< "  \"dirtyPerFrame\": " << dirtyCount << ",\n"
+		<< "  \"threads\": " << jobs.getWorkerCount() << ",\n"
+		<< "  \"avx2\": " << (Culling::hasAvx2() ? "true" : "false") << ",\n"
+		<< "  \"updates\": [\n";
+
+	struct UpdateConfig {
+		const char* name;
+		bool threaded;
+		CullPath path;
+		bool full;
+	};
+	const UpdateConfig configs[] = {
+		{ "fullScalar", false, CullPath::Scalar, true },
+		{ "fullSse", false, CullPath::Sse, true },
+		{ "fullAvx2", false, CullPath::Avx2, true },
+		{ "dirtyScalar", false, CullPath::Scalar, false },
+		{ "dirtySse", false, CullPath::Sse, false },
+		{ "dirtyAvx2", false, CullPath::Avx2, false },
+		{ "fullThreaded", true, CullPath::Auto, true },
+		{ "dirtyThreaded", true, CullPath::Auto, false }
+	};
+	for (size_t c = 0; c < std::size(configs); c++) {
+		uint64_t updatedNodes = 0;
+		float maxError = 0.0f;
+		double ms = timeUpdate(configs[c].threaded ? &jobs : nullptr, configs[c].path, configs[c].full, updatedNodes, maxError);
+		out << "    { \"name\": \"" << configs[c].name << "\", \"avgMs\": " << ms << ", \"avgUpdatedNodes\": " << updatedNodes
+			<< ", \"maxErrorVsFirst\": " << maxError << " }" << (c + 1 < std::size(configs) ? "," : "") << "\n";
+	}
+
+	//The camera's old view matrix, a general inverse of the composed matrices, against the rigid inverse it uses now
+	Camera camera{};
+	std::vector<glm::vec3> eyes(1024);
+	for (glm::vec3& eye : eyes) {
+		eye = glm::vec3(offsetDist(rng), offsetDist(rng), offsetDist(rng)) * 100.0f;
+	}
+	auto generalView = [&camera]() {
+		return glm::inverse(glm::translate(glm::mat4(1.0f), camera.m_pos) * glm::rotate(glm::mat4(1.0f), camera.m_pitch, glm::vec3(1.0f, 0.0f, 0.0f))
+			* glm::rotate(glm::mat4(1.0f), camera.m_yaw, glm::vec3(0.0f, 1.0f, 0.0f)));
+	};
+	//Summed so the loops are not optimized away
+	float checksum = 0.0f;
+	Clock::time_point start = Clock::now();
+	for (uint32_t i = 0; i < viewMatrixCount; i++) {
+		camera.m_pos = eyes[i % eyes.size()];
+		camera.m_yaw = static_cast<float>(i % 628) * 0.01f;
+		checksum += generalView()[3][2];
+	}
+	double generalNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / viewMatrixCount;
+	start = Clock::now();
+	for (uint32_t i = 0; i < viewMatrixCount; i++) {
+		camera.m_pos = eyes[i % eyes.size()];
+		camera.m_yaw = static_cast<float>(i % 628) * 0.01f;
+		checksum += camera.getViewMatrix()[3][2];
+	}
+	double rigidNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / viewMatrixCount;
+
+	float viewError = 0.0f;
+	for (uint32_t i = 0; i < eyes.size(); i++) {
+		camera.m_pos = eyes[i];
+		camera.m_yaw = static_cast<float>(i % 628) * 0.01f;
+		glm::mat4 general = generalView();
+		glm::mat4 rigid = camera.getViewMatrix();
+		for (int column = 0; column < 4; column++) {
+			for (int row = 0; row < 4; row++) {
+				viewError = std::max(viewError, std::abs(general[column][row] - rigid[column][row]));
+			}
+		}
+	}
+
+	out << "  ],\n"
+		<< "  \"viewMatrix\": { \"generalInverseNs\": " << generalNs << ", \"rigidInverseNs\": " << rigidNs
+		<< ", \"speedup\": " << generalNs / std::max(rigidNs, 1e-9) << ", \"maxError\": " << viewError << ", \"checksum\": " << checksum << " }\n"
+		<< "}\n";
+}
+
+//Renders the same generated scene twice: culled on the CPU with one draw recorded per visible object, then culled
+//by the compute shader and drawn with a single indirect draw. Both runs should report the same visible count.
+void Benchmark::runGpuCullingBenchmark(const BenchmarkOptions& options, uint32_t objectCount, std::ostream& out) {
+	out << "{\n"
+		<< "  \"benchmark\": \"gpuCulling\",\n"
+		<< "  \"objects\": " << objectCount << ",\n"
+		<< "  \"frames\": " << options.frameCount << ",\n";
+
+	for (bool gpuCulling : { false, true }) {
+		RendererConfig config{ options.rendererConfig };
+		config.headless = true;
+		config.collectFrameTimes = true;
+		config.syntheticDrawCount = 0;
+		config.sceneObjectCount = objectCount;
+		config.gpuCulling = gpuCulling;
+
+		Renderer renderer{ config };
+		renderer.init();
+		renderer.renderFrames(options.warmupFrames);
+		FrameStats warmupStats{ renderer.getFrameStats() };
+		renderer.renderFrames(options.frameCount);
+		renderer.finishFrames();
+
+		const FrameTimeSamples& samples{ renderer.getFrameTimeSamples() };
+		std::vector<double> cpuMs(samples.cpuMs.begin() + std::min<size_t>(options.warmupFrames, samples.cpuMs.size()), samples.cpuMs.end());
+		std::vector<double> gpuMs(samples.gpuMs.begin() + std::min<size_t>(options.warmupFrames, samples.gpuMs.size()), samples.gpuMs.end());
+		const FrameStats& stats{ renderer.getFrameStats() };
+		uint64_t culledFrames = std::max<uint64_t>(stats.culledFrames - warmupStats.culledFrames, 1);
+		uint32_t frames = std::max(options.frameCount, 1u);
+
+		out << "  \"" << (gpuCulling ? "gpu" : "cpu") << "\": { \"avgVisible\": " << (stats.visibleObjects - warmupStats.visibleObjects) / culledFrames
+			<< ", \"avgTriangles\": " << (stats.submittedTriangles - warmupStats.submittedTriangles) / culledFrames
+			<< ", \"avgCullMs\": " << (stats.cullMs - warmupStats.cullMs) / frames
+			<< ", \"avgRecordMs\": " << (stats.recordMs - warmupStats.recordMs) / frames << ", ";
+		writeSummaryJson(out, "cpuFrameMs", summarize(cpuMs));
+		out << ", ";
+		writeSummaryJson(out, "gpuFrameMs", summarize(gpuMs));
+		out << " }" << (gpuCulling ? "" : ",") << "\n";
+	}
+	out << "}\n";
+}
+
+//GPU culled city scene with and without the depth pyramid test. Most of the city is hidden behind the buildings next
+//to the camera but still inside the frustum, which the frustum cull alone cannot reject.
+void Benchmark::runOcclusionBenchmark(const BenchmarkOptions& options, uint32_t objectCount, std::ostream& out) {
+	out << "{\n"
+		<< "  \"benchmark\": \"occlusionCulling\",\n"
+		<< "  \"objects\": " << objectCount << ",\n"
+		<< "  \"frames\": " << options.frameCount << ",\n";
+
+	for (bool occlusionCulling : { false, true }) {
+		RendererConfig config{ options.rendererConfig };
+		config.headless = true;
+		config.collectFrameTimes = true;
+		config.syntheticDrawCount = 0;
+		config.sceneObjectCount = objectCount;
+		config.sceneLayout = SceneLayout::City;
+		config.gpuCulling = true;
+		config.occlusionCulling = occlusionCulling;
+
+		Renderer renderer{ config };
+		renderer.init();
+		renderer.renderFrames(options.warmupFrames);
+		FrameStats warmupStats{ renderer.getFrameStats() };
+		renderer.renderFrames(options.frameCount);
+		renderer.finishFrames();
+
+		const FrameTimeSamples& samples{ renderer.getFrameTimeSamples() };
+		std::vector<double> cpuMs(samples.cpuMs.begin() + std::min<size_t>(options.warmupFrames, samples.cpuMs.size()), samples.cpuMs.end());
+		std::vector<double> gpuMs(samples.gpuMs.begin() + std::min<size_t>(options.warmupFrames, samples.gpuMs.size()), samples.gpuMs.end());
+		const FrameStats& stats{ renderer.getFrameStats() };
+		uint64_t culledFrames = std::max<uint64_t>(stats.culledFrames - warmupStats.culledFrames, 1);
+
+		out << "  \"" << (occlusionCulling ? "occlusion" : "frustum") << "\": { \"avgVisible\": " << (stats.visibleObjects - warmupStats.visibleObjects) / culledFrames
+			<< ", \"avgFrustumRejected\": " << (stats.frustumRejected - warmupStats.frustumRejected) / culledFrames
+			<< ", \"avgOcclusionRejected\": " << (stats.occlusionRejected - warmupStats.occlusionRejected) / culledFrames
+			<< ", \"avgDrawnLate\": " << (stats.lateDrawnObjects - warmupStats.lateDrawnObjects) / culledFrames
+			<< ", \"avgTriangles\": " << (stats.submittedTriangles - warmupStats.submittedTriangles) / culledFrames << ", ";
+		writeSummaryJson(out, "cpuFrameMs", summarize(cpuMs));
+		out << ", ";
+		writeSummaryJson(out, "gpuFrameMs", summarize(gpuMs));
+		out << " }" << (occlusionCulling ? "" : ",") << "\n";
+	}
+	out << "}\n";
+}
+
+//Sorts keys shaped like the renderer's against std::stable_sort, then renders the generated scene culled on the CPU
+//with one draw per visible object and with the sorted, instanced draw list
+void Benchmark::runDrawListBenchmark(const BenchmarkOptions& options, uint32_t objectCount, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+	constexpr uint32_t sortRepetitions = 20;
+
+	std::mt19937 rng{ 1234 };
+	std::uniform_int_distribution<uint32_t> meshDist{ 0, 5 };
+	std::uniform_real_distribution<float> distanceDist{ 0.0f, 2.0f * SCENE_EXTENT };
+	std::vector<DrawItem> input(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++) {
+		input[i] = DrawItem{ .key = DrawKeys::encode(0, 0, meshDist(rng), DrawKeys::depthBucket(distanceDist(rng), 100000.0f)), .object = i };
+	}
+	std::vector<DrawItem> radixSorted;
+	std::vector<DrawItem> stdSorted;
+	std::vector<DrawItem> scratch;
+	uint32_t passes = 0;
+	double radixMs = 0.0;
+	double stdMs = 0.0;
+	for (uint32_t r = 0; r < sortRepetitions; r++) {
+		radixSorted = input;
+		Clock::time_point start = Clock::now();
+		passes = DrawKeys::radixSort(radixSorted, scratch);
+		radixMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		stdSorted = input;
+		start = Clock::now();
+		std::stable_sort(stdSorted.begin(), stdSorted.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+		stdMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+	bool sameOrder = std::equal(radixSorted.begin(), radixSorted.end(), stdSorted.begin(),
+		[](const DrawItem& a, const DrawItem& b) { return a.key == b.key && a.object == b.object; });
+
+	out << "{\n"
+		<< "  \"benchmark\": \"drawList\",\n"
+		<< "  \"objects\": " << objectCount << ",\n"
+		<< "  \"frames\": " << options.frameCount << ",\n"
+		<< "  \"sort\": { \"radixMs\": " << radixMs / sortRepetitions << ", \"radixPasses\": " << passes
+		<< ", \"stableSortMs\": " << stdMs / sortRepetitions << ", \"sameOrder\": " << (sameOrder ? "true" : "false") << " },\n";
+
+	const std::pair<bool, const char*> runs[] = { { false, "perObject" }, { true, "instanced" } };
+	for (size_t r = 0; r < std::size(runs); r++) {
+		RendererConfig config{ options.rendererConfig };
+		config.headless = true;
+		config.collectFrameTimes = true;
+		config.syntheticDrawCount = 0;
+		config.sceneObjectCount = objectCount;
+		config.instancing = runs[r].first;
+
+		Renderer renderer{ config };
+		renderer.init();
+		renderer.renderFrames(options.warmupFrames);
+		FrameStats warmupStats{ renderer.getFrameStats() };
+		renderer.renderFrames(options.frameCount);
+		renderer.finishFrames();
+
+		const FrameTimeSamples& samples{ renderer.getFrameTimeSamples() };
+		std::vector<double> cpuMs(samples.cpuMs.begin() + std::min<size_t>(options.warmupFrames, samples.cpuMs.size()), samples.cpuMs.end());
+		std::vector<double> gpuMs(samples.gpuMs.begin() + std::min<size_t>(options.warmupFrames, samples.gpuMs.size()), samples.gpuMs.end());
+		const FrameStats& stats{ renderer.getFrameStats() };
+		uint64_t frames = std::max<uint64_t>(stats.frameCount - warmupStats.frameCount, 1);
+		uint64_t culledFrames = std::max<uint64_t>(stats.culledFrames - warmupStats.culledFrames, 1);
+
+		out << "  \"" << runs[r].second << "\": { \"avgVisible\": " << (stats.visibleObjects - warmupStats.visibleObjects) / culledFrames
+			<< ", \"avgDrawCalls\": " << static_cast<double>(stats.drawCalls - warmupStats.drawCalls) / frames
+			<< ", \"avgStateChanges\": " << static_cast<double>(stats.stateChanges - warmupStats.stateChanges) / frames
+			<< ", \"avgDrawListMs\": " << (stats.drawListMs - warmupStats.drawListMs) / frames
+			<< ", \"avgSortMs\": " << (stats.drawSortMs - warmupStats.drawSortMs) / frames
+			<< ", \"avgRecordMs\": " << (stats.recordMs - warmupStats.recordMs) / frames
+			<< ", \"avgTriangles\": " << (stats.submittedTriangles - warmupStats.submittedTriangles) / culledFrames << ", ";
+		writeSummaryJson(out, "cpuFrameMs", summarize(cpuMs));
+		out << ", ";
+		writeSummaryJson(out, "gpuFrameMs", summarize(gpuMs));
+		out << " }" << (r + 1 < std::size(runs) ? "," : "") << "\n";
+	}
+	out << "}\n";
+}
+
+void Benchmark::runMeshLoadBenchmark(const BenchmarkOptions& options, uint32_t megabytes, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+	constexpr VkDeviceSize destinationSize = 4ull * 1024 * 1024; //holds the largest generated mesh, every load overwrites it
+	constexpr uint32_t gridSize = 255; //largest grid whose vertex count still fits 16-bit indices
+
+	//Cook the asset set up front, sized by its cooked bytes
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "mesh_load_bench";
+	std::filesystem::create_directories(directory);
+	std::vector<std::filesystem::path> objPaths;
+	std::vector<std::filesystem::path> meshPaths;
+	uint64_t textBytes = 0;
+	uint64_t cookedBytes = 0;
+	uint64_t totalBytes = static_cast<uint64_t>(megabytes) * 1024 * 1024;
+	for (uint32_t i = 0; cookedBytes < totalBytes; i++) {
+		ImportedMesh imported = Primitives::grid(gridSize, 0.05f, i); //heights vary per seed so no two files are identical
+		objPaths.push_back(directory / ("grid" + std::to_string(i) + ".obj"));
+		meshPaths.push_back(directory / ("grid" + std::to_string(i) + ".mesh"));
+		std::ofstream objFile(objPaths.back(), std::ios::binary | std::ios::trunc);
+		MeshImport::writeObj(objFile, imported.vertices, imported.indices);
+		objFile.close();
+		textBytes += std::filesystem::file_size(objPaths.back());
+		cookedBytes += MeshFile::write(meshPaths.back(), Mesh{ imported.vertices, imported.indices, VertexLayout{} });
+	}
+
+	Renderer renderer{ options.rendererConfig };
+	renderer.init();
+	UploadManager& uploads = renderer.getUploads();
+	VkBufferCreateInfo destinationInfo{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = destinationSize,
+		.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+	};
+	VkBuffer vertexDestination;
+	VkBuffer indexDestination;
+	Allocation vertexAlloc = renderer.getAllocator().createBuffer(destinationInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+		AllocationStrategy::FreeList, vertexDestination);
+	Allocation indexAlloc = renderer.getAllocator().createBuffer(destinationInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0,
+		AllocationStrategy::FreeList, indexDestination);
+
+	//Text path: parse, deduplicate and encode into a Mesh, then stage its buffers
+	Clock::time_point start = Clock::now();
+	for (const std::filesystem::path& path : objPaths) {
+		ImportedMesh imported = MeshImport::loadObj(path);
+		Mesh mesh{ imported.vertices, imported.indices, VertexLayout{} };
+		uploads.uploadBuffer(vertexDestination, 0, mesh.getVertexData().data(), mesh.getVertexData().size());
+		uploads.uploadBuffer(indexDestination, 0, mesh.getIndexData().data(), mesh.getIndexData().size());
+	}
+	uploads.waitIdle();
+	double textMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	//Cooked path: map, validate and copy the sections from the mapping straight into staging memory
+	start = Clock::now();
+	for (const std::filesystem::path& path : meshPaths) {
+		MeshFile file{ path };
+		uploads.uploadBuffer(vertexDestination, 0, file.getVertexData().data(), file.getVertexData().size());
+		uploads.uploadBuffer(indexDestination, 0, file.getIndexData().data(), file.getIndexData().size());
+	}
+	uploads.waitIdle();
+	double cookedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	renderer.getAllocator().destroyBuffer(vertexDestination, vertexAlloc);
+	renderer.getAllocator().destroyBuffer(indexDestination, indexAlloc);
+	std::filesystem::remove_all(directory);
+
+	//Both rates are over the GPU-ready bytes delivered, files were just written so both paths read from a warm page cache
+	double cookedGBps = static_cast<double>(cookedBytes) / 1e9 / (cookedMs / 1000.0);
+	double textGBps = static_cast<double>(cookedBytes) / 1e9 / (textMs / 1000.0);
+	out << "{\n"
+		<< "  \"benchmark\": \"meshLoad\",\n"
+		<< "  \"device\": \"" << renderer.getDeviceName() << "\",\n"
+		<< "  \"meshes\": " << meshPaths.size() << ",\n"
+		<< "  \"textBytes\": " << textBytes << ",\n"
+		<< "  \"cookedBytes\": " << cookedBytes << ",\n"
+		<< "  \"textMs\": " << textMs << ",\n"
+		<< "  \"cookedMs\": " << cookedMs << ",\n"
+		<< "  \"textGBps\": " << textGBps << ",\n"
+		<< "  \"cookedGBps\": " << cookedGBps << ",\n"
+		<< "  \"speedup\": " << textMs / std::max(cookedMs, 1e-6) << "\n"
+		<< "}\n";
+}
+
+//Flat shaded geometry, where every position on a hard edge is one vertex per face. Two quads meeting at an edge must come
+//back unchanged when nothing is removed, and every triangle of a subdivided box's chain must keep indexing vertices of a
+//single face. Throws on the first triangle that does not, returns the number of triangles checked.
+static uint64_t checkLodSeams() {
+	std::vector<Vertex> quadVertices{
+		{ { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } }, { { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+		{ { 1.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } }, { { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+		{ { 1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } }, { { 1.0f, 0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f } },
+		{ { 1.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } }, { { 1.0f, 1.0f, -1.0f }, { 1.0f, 0.0f, 0.0f } }
+	};
+	std::vector<uint32_t> quadIndices{ 0, 1, 2, 0, 2, 3, 4, 5, 7, 4, 7, 6 };
+	if (MeshLod::simplify(quadVertices, quadIndices, static_cast<uint32_t>(quadIndices.size()), std::numeric_limits<float>::max()) != quadIndices) {
+		throw std::runtime_error("LOD seam check failed: unsimplified indices were remapped");
+	}
+
+	//Grid coordinates are multiples of 1/16, so the faces agree exactly on their shared edges
+	constexpr uint32_t gridSize = 17;
+	const glm::vec3 axes[] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+	ImportedMesh box;
+	for (uint32_t face = 0; face < 6; face++) {
+		float sign = face % 2 == 0 ? 1.0f : -1.0f;
+		glm::vec3 normal = axes[face / 2] * sign;
+		glm::vec3 u = axes[(face / 2 + 1) % 3] * sign;
+		glm::vec3 v = axes[(face / 2 + 2) % 3];
+		uint32_t base = static_cast<uint32_t>(box.vertices.size());
+		for (uint32_t y = 0; y < gridSize; y++) {
+			for (uint32_t x = 0; x < gridSize; x++) {
+				glm::vec3 pos = normal * 0.5f + u * (static_cast<float>(x) / (gridSize - 1) - 0.5f) + v * (static_cast<float>(y) / (gridSize - 1) - 0.5f);
+				box.vertices.push_back(Vertex{ pos, normal });
+			}
+		}
+		for (uint32_t y = 0; y + 1 < gridSize; y++) {
+			for (uint32_t x = 0; x + 1 < gridSize; x++) {
+				uint32_t i = base + y * gridSize + x;
+				box.indices.insert(box.indices.end(), { i, i + 1, i + gridSize + 1, i, i + gridSize + 1, i + gridSize });
+			}
+		}
+	}
+
+	LodChain chain = MeshLod::buildChain(box.vertices, box.indices);
+	if (chain.levels.size() < 2) {
+		throw std::runtime_error("LOD seam check failed: the box was not simplified");
+	}
+	uint64_t checked = 0;
+	for (size_t level = 1; level < chain.levels.size(); level++) {
+		for (uint32_t i = 0; i < chain.levels[level].indexCount; i += 3) {
+			const uint32_t* pTriangle = &chain.indices[chain.levels[level].firstIndex + i];
+			const glm::vec3& normal = box.vertices[pTriangle[0]].normal;
+			if (box.vertices[pTriangle[1]].normal != normal || box.vertices[pTriangle[2]].normal != normal) {
+				throw std::runtime_error("LOD seam check failed: level " + std::to_string(level) + " triangle " + std::to_string(i / 3)
+					+ " mixes vertices of different faces");
+			}
+			checked++;
+		}
+	}
+	return checked;
+}
+
+//Offline half: builds the placeholder sphere's LOD chain and selects levels for the generated scene as seen from the
+//default camera at several pixel thresholds. Rendered half: draws that scene with LOD selection off and at the default
+//threshold, so the triangle reduction can be read against frame times.
+void Benchmark::runLodBenchmark(const BenchmarkOptions& options, uint32_t objectCount, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+
+	ImportedMesh sphere = Primitives::icosphere(SCENE_MESH_SUBDIVISIONS, 0.1f, 1234);
+	Clock::time_point start = Clock::now();
+	LodChain chain = MeshLod::buildChain(sphere.vertices, sphere.indices);
+	double buildMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	Mesh mesh{ sphere.vertices, chain.indices, chain.levels, VertexLayout{} };
+	uint64_t seamTriangles = checkLodSeams();
+
+	//Same distribution as Renderer::createScene
+	Scene scene;
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> posDist{ -SCENE_EXTENT, SCENE_EXTENT };
+	for (uint32_t i = 0; i < objectCount; i++) {
+		glm::mat4 transform{ 1.0f };
+		transform[0][0] = SCENE_OBJECT_SCALE;
+		transform[1][1] = SCENE_OBJECT_SCALE;
+		transform[2][2] = SCENE_OBJECT_SCALE;
+		transform[3] = glm::vec4(posDist(rng), posDist(rng), posDist(rng), 1.0f);
+		scene.addObject(transform, &mesh);
+	}
+	Camera camera{};
+	JobSystem jobs{};
+	FrustumCuller culler{ jobs };
+	std::span<const uint32_t> visible = culler.cull(Culling::extractFrustum(camera.fetchGPUData(static_cast<float>(WIDTH), static_cast<float>(HEIGHT))),
+		scene.getBounds(), CullShape::Sphere);
+
+	out << "{\n"
+		<< "  \"benchmark\": \"lod\",\n"
+		<< "  \"objects\": " << objectCount << ",\n"
+		<< "  \"visible\": " << visible.size() << ",\n"
+		<< "  \"chainBuildMs\": " << buildMs << ",\n"
+		<< "  \"seamCheckedTriangles\": " << seamTriangles << ",\n"
+		<< "  \"levels\": [";
+	for (size_t i = 0; i < chain.levels.size(); i++) {
+		out << (i > 0 ? ", " : "") << "{ \"triangles\": " << chain.levels[i].indexCount / 3 << ", \"error\": " << chain.levels[i].error << " }";
+	}
+	out << "],\n"
+		<< "  \"selection\": [\n";
+
+	std::span<const MeshLodLevel> lods = mesh.getLods();
+	std::span<const ObjectBounds> bounds = scene.getBounds();
+	std::span<const glm::mat4> transforms = scene.getTransforms();
+	uint64_t fullTriangles = static_cast<uint64_t>(visible.size()) * (lods[0].indexCount / 3);
+	const float thresholds[] = { 0.5f, 1.0f, 2.0f, 4.0f };
+	for (size_t t = 0; t < std::size(thresholds); t++) {
+		float projectionScale = MeshLod::projectionScale(camera.m_FOV, static_cast<float>(HEIGHT), thresholds[t]);
+		std::vector<uint32_t> histogram(lods.size(), 0);
+		uint64_t triangles = 0;
+		start = Clock::now();
+		for (uint32_t object : visible) {
+			float distance = std::max(glm::length(bounds[object].center - camera.m_pos) - bounds[object].radius, 0.0f);
+			uint32_t lod = MeshLod::selectLod(lods, MeshLod::transformScale(transforms[object]), distance, projectionScale);
+			histogram[lod]++;
+			triangles += lods[lod].indexCount / 3;
+		}
+		double selectNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / std::max<size_t>(visible.size(), 1);
+
+		out << "    { \"thresholdPixels\": " << thresholds[t] << ", \"triangles\": " << triangles << ", \"fullDetailTriangles\": " << fullTriangles
+			<< ", \"reduction\": " << static_cast<double>(fullTriangles) / static_cast<double>(std::max<uint64_t>(triangles, 1))
+			<< ", \"selectNsPerObject\": " << selectNs << ", \"objectsPerLod\": [";
+		for (size_t i = 0; i < histogram.size(); i++) {
+			out << (i > 0 ? ", " : "") << histogram[i];
+		}
+		out << "] }" << (t + 1 < std::size(thresholds) ? "," : "") << "\n";
+	}
+	out << "  ],\n";
+
+	const std::pair<float, const char*> runs[] = { { 0.0f, "lodOff" }, { DEFAULT_LOD_THRESHOLD_PIXELS, "lodOn" } };
+	for (size_t r = 0; r < std::size(runs); r++) {
+		RendererConfig config{ options.rendererConfig };
+		config.headless = true;
+		config.collectFrameTimes = true;
+		config.syntheticDrawCount = 0;
+		config.sceneObjectCount = objectCount;
+		config.lodThresholdPixels = runs[r].first;
+
+		Renderer renderer{ config };
+		renderer.init();
+		renderer.renderFrames(options.warmupFrames);
+		FrameStats warmupStats{ renderer.getFrameStats() };
+		renderer.renderFrames(options.frameCount);
+		renderer.finishFrames();
+
+		const FrameTimeSamples& samples{ renderer.getFrameTimeSamples() };
+		std::vector<double> cpuMs(samples.cpuMs.begin() + std::min<size_t>(options.warmupFrames, samples.cpuMs.size()), samples.cpuMs.end());
+		std::vector<double> gpuMs(samples.gpuMs.begin() + std::min<size_t>(options.warmupFrames, samples.gpuMs.size()), samples.gpuMs.end());
+		const FrameStats& stats{ renderer.getFrameStats() };
+		uint64_t culledFrames = std::max<uint64_t>(stats.culledFrames - warmupStats.culledFrames, 1);
+
+		out << "  \"" << runs[r].second << "\": { \"avgTriangles\": " << (stats.submittedTriangles - warmupStats.submittedTriangles) / culledFrames << ", ";
+		writeSummaryJson(out, "cpuFrameMs", summarize(cpuMs));
+		out << ", ";
+		writeSummaryJson(out, "gpuFrameMs", summarize(gpuMs));
+		out << " }" << (r + 1 < std::size(runs) ? "," : "") << "\n";
+	}
+	out << "}\n";
+}
+
+void Benchmark::runMeshletBenchmark(const BenchmarkOptions& options, uint32_t objectCount, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+
+	ImportedMesh sphere = Primitives::icosphere(SCENE_MESH_SUBDIVISIONS, 0.1f, 1234);
+	LodChain chain = MeshLod::buildChain(sphere.vertices, sphere.indices);
+	uint32_t vertexCount = static_cast<uint32_t>(sphere.vertices.size());
+	std::span<const uint32_t> lod0{ chain.indices.data(), chain.levels[0].indexCount };
+	float missRatioBefore = Meshlets::averageCacheMissRatio(lod0, vertexCount);
+	Clock::time_point start = Clock::now();
+	MeshletSet meshlets = Meshlets::build(sphere.vertices, chain.indices, chain.levels);
+	double buildMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	float missRatioAfter = Meshlets::averageCacheMissRatio(lod0, vertexCount);
+	Mesh mesh{ sphere.vertices, chain.indices, chain.levels, VertexLayout{} };
+
+	out << "{\n"
+		<< "  \"benchmark\": \"meshlets\",\n"
+		<< "  \"objects\": " << objectCount << ",\n"
+		<< "  \"buildMs\": " << buildMs << ",\n"
+		<< "  \"lod0CacheMissRatio\": { \"before\": " << missRatioBefore << ", \"after\": " << missRatioAfter << " },\n"
+		<< "  \"levels\": [";
+	for (size_t lod = 0; lod < chain.levels.size(); lod++) {
+		uint32_t first = meshlets.lodFirstMeshlet[lod];
+		uint32_t count = meshlets.lodFirstMeshlet[lod + 1] - first;
+		uint64_t vertices = 0;
+		for (uint32_t m = first; m < first + count; m++) {
+			vertices += meshlets.meshlets[m].vertexCount;
+		}
+		out << (lod > 0 ? ", " : "") << "{ \"triangles\": " << chain.levels[lod].indexCount / 3 << ", \"meshlets\": " << count
+			<< ", \"avgVertices\": " << static_cast<double>(vertices) / std::max<uint32_t>(count, 1)
+			<< ", \"avgTriangles\": " << static_cast<double>(chain.levels[lod].indexCount / 3) / std::max<uint32_t>(count, 1) << " }";
+	}
+	out << "],\n";
+
+	//Same distribution as Renderer::createScene, visible objects are tested at the LOD the renderer would pick and
+	//skipped like it does when that level has too few meshlets
+	Scene scene;
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> posDist{ -SCENE_EXTENT, SCENE_EXTENT };
+	for (uint32_t i = 0; i < objectCount; i++) {
+		glm::mat4 transform{ 1.0f };
+		transform[0][0] = SCENE_OBJECT_SCALE;
+		transform[1][1] = SCENE_OBJECT_SCALE;
+		transform[2][2] = SCENE_OBJECT_SCALE;
+		transform[3] = glm::vec4(posDist(rng), posDist(rng), posDist(rng), 1.0f);
+		scene.addObject(transform, &mesh);
+	}
+	Camera camera{};
+	Frustum frustum{ Culling::extractFrustum(camera.fetchGPUData(static_cast<float>(WIDTH), static_cast<float>(HEIGHT))) };
+	JobSystem jobs{};
+	FrustumCuller culler{ jobs };
+	std::span<const uint32_t> visible = culler.cull(frustum, scene.getBounds(), CullShape::Sphere);
+	std::span<const MeshLodLevel> lods = mesh.getLods();
+	std::span<const ObjectBounds> bounds = scene.getBounds();
+	std::span<const glm::mat4> transforms = scene.getTransforms();
+	float projectionScale = MeshLod::projectionScale(camera.m_FOV, static_cast<float>(HEIGHT), DEFAULT_LOD_THRESHOLD_PIXELS);
+	std::vector<uint32_t> objectLods;
+	for (uint32_t object : visible) {
+		float distance = std::max(glm::length(bounds[object].center - camera.m_pos) - bounds[object].radius, 0.0f);
+		objectLods.push_back(distance > 0.0f ? MeshLod::selectLod(lods, MeshLod::transformScale(transforms[object]), distance, projectionScale) : ~0u);
+	}
+
+	std::vector<uint32_t> survivors(meshlets.meshlets.size());
+	const std::pair<CullPath, const char*> paths[] = { { CullPath::Scalar, "scalar" }, { CullPath::Sse, "sse" }, { CullPath::Avx2, "avx2" } };
+	out << "  \"visible\": " << visible.size() << ",\n"
+		<< "  \"cpuCull\": [\n";
+	for (size_t p = 0; p < std::size(paths); p++) {
+		uint64_t tested = 0;
+		uint64_t rejected = 0;
+		uint64_t trianglesTested = 0;
+		uint64_t trianglesRejected = 0;
+		start = Clock::now();
+		for (size_t v = 0; v < visible.size(); v++) {
+			if (objectLods[v] == ~0u) {
+				continue;
+			}
+			uint32_t first = meshlets.lodFirstMeshlet[objectLods[v]];
+			uint32_t count = meshlets.lodFirstMeshlet[objectLods[v] + 1] - first;
+			if (count < MESHLET_CULL_MIN_MESHLETS) {
+				continue;
+			}
+			MeshletCullView view{ Meshlets::makeView(frustum, camera.m_pos, transforms[visible[v]]) };
+			uint32_t survivorCount = Meshlets::cull(paths[p].first, view, meshlets.bounds, first, count, survivors.data());
+			uint32_t survivingTriangles = 0;
+			for (uint32_t s = 0; s < survivorCount; s++) {
+				survivingTriangles += meshlets.meshlets[survivors[s]].triangleCount;
+			}
+			tested += count;
+			rejected += count - survivorCount;
+			trianglesTested += lods[objectLods[v]].indexCount / 3;
+			trianglesRejected += lods[objectLods[v]].indexCount / 3 - survivingTriangles;
+		}
+		double cullMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		out << "    { \"path\": \"" << paths[p].second << "\", \"resolved\": " << (Culling::resolvePath(paths[p].first) == paths[p].first ? "true" : "false")
+			<< ", \"ms\": " << cullMs << ", \"nsPerMeshlet\": " << cullMs * 1e6 / static_cast<double>(std::max<uint64_t>(tested, 1))
+			<< ", \"meshletsTested\": " << tested << ", \"meshletsRejected\": " << rejected
+			<< ", \"trianglesTested\": " << trianglesTested << ", \"trianglesRejected\": " << trianglesRejected << " }"
+			<< (p + 1 < std::size(paths) ? "," : "") << "\n";
+	}
+	out << "  ],\n";
+
+	const std::pair<bool, const char*> runs[] = { { false, "meshletsOff" }, { true, "meshletsOn" } };
+	for (size_t r = 0; r < std::size(runs); r++) {
+		RendererConfig config{ options.rendererConfig };
+		config.headless = true;
+		config.collectFrameTimes = true;
+		config.syntheticDrawCount = 0;
+		config.sceneObjectCount = objectCount;
+		config.meshletCulling = runs[r].first;
+
+		Renderer renderer{ config };
+		renderer.init();
+		renderer.renderFrames(options.warmupFrames);
+		FrameStats warmupStats{ renderer.getFrameStats() };
+		renderer.renderFrames(options.frameCount);
+		renderer.finishFrames();
+
+		const FrameTimeSamples& samples{ renderer.getFrameTimeSamples() };
+		std::vector<double> cpuMs(samples.cpuMs.begin() + std::min<size_t>(options.warmupFrames, samples.cpuMs.size()), samples.cpuMs.end());
+		std::vector<double> gpuMs(samples.gpuMs.begin() + std::min<size_t>(options.warmupFrames, samples.gpuMs.size()), samples.gpuMs.end());
+		const FrameStats& stats{ renderer.getFrameStats() };
+		uint64_t culledFrames = std::max<uint64_t>(stats.culledFrames - warmupStats.culledFrames, 1);
+
+		out << "  \"" << runs[r].second << "\": { \"avgTriangles\": " << (stats.submittedTriangles - warmupStats.submittedTriangles) / culledFrames
+			<< ", \"avgMeshletsTested\": " << (stats.meshletsTested - warmupStats.meshletsTested) / culledFrames
+			<< ", \"avgMeshletsRejected\": " << (stats.meshletsRejected - warmupStats.meshletsRejected) / culledFrames
+			<< ", \"avgTrianglesRejected\": " << (stats.meshletTrianglesRejected - warmupStats.meshletTrianglesRejected) / culledFrames << ", ";
+		writeSummaryJson(out, "cpuFrameMs", summarize(cpuMs));
+		out << ", ";
+		writeSummaryJson(out, "gpuFrameMs", summarize(gpuMs));
+		out << " }" << (r + 1 < std::size(runs) ? "," : "") << "\n";
+	}
+	out << "}\n";
+}
+
+static void writeRenderGraphJson(std::ostream& out, const char* name, const RenderGraphStats& stats, double planMs) {
+	out << "  \"" << name << "\": { \"planMs\": " << planMs
+		<< ", \"passes\": " << stats.passCount << ", \"culledPasses\": " << stats.culledPassCount
+		<< ", \"images\": " << stats.imageCount << ", \"aliasSlots\": " << stats.aliasSlotCount
+		<< ", \"imageBytes\": " << stats.imageBytes << ", \"allocatedBytes\": " << stats.allocatedBytes << ", \"savedBytes\": " << stats.savedBytes()
+		<< ", \"pipelineBarriers\": " << stats.pipelineBarriers << ", \"imageBarriers\": " << stats.imageBarriers
+		<< ", \"subpassDependencies\": " << stats.subpassDependencies << " }";
+}
+
+//Plans the renderer's windowed frame and a deferred frame with a bloom chain and an unused debug view on the
+//renderer's device, nothing is recorded. Planning is timed over several compiles of fresh graphs.
+void Benchmark::runRenderGraphBenchmark(const BenchmarkOptions& options, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+	constexpr uint32_t PLAN_ITERATIONS = 100;
+
+	RendererConfig config{ options.rendererConfig };
+	config.headless = true;
+	Renderer renderer{ config };
+	renderer.init();
+	VkExtent2D extent{ .width = config.width, .height = config.height };
+
+	VkClearColorValue clearColor{ .float32 = { 0.0f, 0.0f, 0.0f, 1.0f } };
+	VkClearDepthStencilValue clearDepth{ .depth = 1.0f, .stencil = 0 };
+	auto buildWindowed = [&](RenderGraph& graph) {
+		RenderGraphImage color = graph.createImage("sceneColor", COLOR_ATTACHMENT_FORMAT);
+		RenderGraphImage depth = graph.createImage("sceneDepth", DEPTH_ATTACHMENT_FORMAT);
+		RenderGraphImage swapchain = graph.importImage("swapchain", VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+		RenderGraphPass scene = graph.addPass("scene", RenderGraphPassType::Graphics, nullptr);
+		graph.addColorAttachment(scene, color, &clearColor);
+		graph.addDepthAttachment(scene, depth, &clearDepth);
+		RenderGraphPass present = graph.addPass("presentBlit", RenderGraphPassType::Transfer, nullptr);
+		graph.addRead(present, color, RenderGraphAccess::TransferSrc);
+		graph.addWrite(present, swapchain, RenderGraphAccess::TransferDst);
+	};
+	auto buildDeferred = [&](RenderGraph& graph) {
+		RenderGraphImage albedo = graph.createImage("albedo", VK_FORMAT_R8G8B8A8_UNORM);
+		RenderGraphImage normal = graph.createImage("normal", VK_FORMAT_R16G16B16A16_SFLOAT);
+		RenderGraphImage depth = graph.createImage("depth", DEPTH_ATTACHMENT_FORMAT);
+		RenderGraphImage hdr = graph.createImage("hdr", VK_FORMAT_R16G16B16A16_SFLOAT);
+		RenderGraphImage bloom[]{
+			graph.createImage("bloomHalf", VK_FORMAT_R16G16B16A16_SFLOAT, 0.5f),
+			graph.createImage("bloomQuarter", VK_FORMAT_R16G16B16A16_SFLOAT, 0.25f),
+			graph.createImage("bloomEighth", VK_FORMAT_R16G16B16A16_SFLOAT, 0.125f)
+		};
+		RenderGraphImage ldr = graph.createImage("ldr", VK_FORMAT_R8G8B8A8_UNORM);
+		RenderGraphImage debugView = graph.createImage("normalDebug", VK_FORMAT_R8G8B8A8_UNORM);
+		RenderGraphImage swapchain = graph.importImage("swapchain", VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+		RenderGraphPass gbuffer = graph.addPass("gbuffer", RenderGraphPassType::Graphics, nullptr);
+		graph.addColorAttachment(gbuffer, albedo, &clearColor);
+		graph.addColorAttachment(gbuffer, normal, &clearColor);
+		graph.addDepthAttachment(gbuffer, depth, &clearDepth);
+		RenderGraphPass lighting = graph.addPass("lighting", RenderGraphPassType::Graphics, nullptr);
+		graph.addRead(lighting, albedo, RenderGraphAccess::Sampled);
+		graph.addRead(lighting, normal, RenderGraphAccess::Sampled);
+		graph.addRead(lighting, depth, RenderGraphAccess::Sampled);
+		graph.addColorAttachment(lighting, hdr, &clearColor);
+		RenderGraphImage source = hdr;
+		for (RenderGraphImage target : bloom) {
+			RenderGraphPass downsample = graph.addPass("bloomDownsample", RenderGraphPassType::Graphics, nullptr);
+			graph.addRead(downsample, source, RenderGraphAccess::Sampled);
+			graph.addColorAttachment(downsample, target);
+			source = target;
+		}
+		RenderGraphPass tonemap = graph.addPass("tonemap", RenderGraphPassType::Graphics, nullptr);
+		graph.addRead(tonemap, hdr, RenderGraphAccess::Sampled);
+		graph.addRead(tonemap, source, RenderGraphAccess::Sampled);
+		graph.addColorAttachment(tonemap, ldr);
+		RenderGraphPass debug = graph.addPass("normalDebug", RenderGraphPassType::Graphics, nullptr);
+		graph.addRead(debug, normal, RenderGraphAccess::Sampled);
+		graph.addColorAttachment(debug, debugView);
+		RenderGraphPass present = graph.addPass("presentBlit", RenderGraphPassType::Transfer, nullptr);
+		graph.addRead(present, ldr, RenderGraphAccess::TransferSrc);
+		graph.addWrite(present, swapchain, RenderGraphAccess::TransferDst);
+	};
+
+	out << "{\n"
+		<< "  \"benchmark\": \"renderGraph\",\n"
+		<< "  \"width\": " << extent.width << ",\n"
+		<< "  \"height\": " << extent.height << ",\n";
+	writeRenderGraphJson(out, "headlessFrame", renderer.getRenderGraph().getStats(), 0.0);
+	out << ",\n";
+
+	const std::pair<std::function<void(RenderGraph&)>, const char*> graphs[] = { { buildWindowed, "windowedFrame" }, { buildDeferred, "deferredFrame" } };
+	for (size_t g = 0; g < std::size(graphs); g++) {
+		//Only declaring and compiling is timed, creating the images mostly measures the driver's allocator
+		RenderGraphStats stats{};
+		double planMs = 0.0;
+		for (uint32_t i = 0; i < PLAN_ITERATIONS; i++) {
+			RenderGraph graph;
+			Clock::time_point start = Clock::now();
+			graphs[g].first(graph);
+			graph.compile(renderer.getDevice(), renderer.getAllocator());
+			planMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count() / PLAN_ITERATIONS;
+			graph.resize(extent);
+			stats = graph.getStats();
+			graph.destroy();
+		}
+		writeRenderGraphJson(out, graphs[g].second, stats, planMs);
+		out << (g + 1 < std::size(graphs) ? "," : "") << "\n";
+	}
+	out << "}\n";
+}
+//Builds over the culling benchmark's random boxes on one thread and on the job system, then moves a hundredth of the
+//objects every frame and keeps one tree up to date with refits only and another with refits and partial rebuilds.
+//Queries are timed on the rebuilt tree afterwards and a sample of each is checked against a linear scan.
+void Benchmark::runBvhBenchmark(uint32_t objectCount, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+	constexpr uint32_t moveFrames = 30;
+	constexpr uint32_t queryCount = 10000;
+	constexpr uint32_t checkedQueries = 100;
+	constexpr uint32_t frustumPasses = 20;
+	constexpr uint32_t neighborCount = 16;
+	constexpr float sphereRadius = 50.0f;
+	constexpr float rayLength = 5000.0f;
+
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> posDist{ -1000.0f, 1000.0f };
+	std::uniform_real_distribution<float> sizeDist{ 0.5f, 20.0f };
+	std::uniform_real_distribution<float> moveDist{ -100.0f, 100.0f };
+	std::vector<ObjectBounds> bounds(objectCount);
+	for (ObjectBounds& object : bounds) {
+		object.center = glm::vec3(posDist(rng), posDist(rng), posDist(rng));
+		object.extents = glm::vec3(sizeDist(rng), sizeDist(rng), sizeDist(rng));
+		object.radius = glm::length(object.extents);
+	}
+
+	JobSystem jobs{};
+	Bvh serial;
+	serial.build(bounds);
+	Bvh refitOnly;
+	refitOnly.build(bounds, &jobs);
+	Bvh bvh;
+	bvh.build(bounds, &jobs);
+	BvhStats serialStats{ serial.getStats() };
+	BvhStats builtStats{ bvh.getStats() };
+
+	out << "{\n"
+		<< "  \"benchmark\": \"bvh\",\n"
+		<< "  \"objects\": " << objectCount << ",\n"
+		<< "  \"threads\": " << jobs.getWorkerCount() << ",\n"
+		<< "  \"build\": { \"serialMs\": " << serialStats.buildMs << ", \"parallelMs\": " << builtStats.buildMs
+		<< ", \"nodes\": " << builtStats.nodeCount << ", \"leaves\": " << builtStats.leafCount << ", \"maxDepth\": " << builtStats.maxDepth
+		<< ", \"sahCost\": " << builtStats.sahCost << ", \"sameTree\": " << (serialStats.sahCost == builtStats.sahCost && serialStats.nodeCount == builtStats.nodeCount ? "true" : "false") << " },\n";
+
+	uint32_t movedCount = std::max(objectCount / 100, 1u);
+	std::uniform_int_distribution<uint32_t> objectDist{ 0, std::max(objectCount, 1u) - 1 };
+	std::vector<uint32_t> moved(movedCount);
+	std::vector<double> refitMs;
+	std::vector<double> rebuildMs;
+	uint64_t rebuiltObjects = 0;
+	for (uint32_t frame = 0; frame < moveFrames && objectCount > 0; frame++) {
+		for (uint32_t& object : moved) {
+			object = objectDist(rng);
+			bounds[object].center += glm::vec3(moveDist(rng), moveDist(rng), moveDist(rng));
+		}
+		refitOnly.refit(bounds, moved);
+		bvh.refit(bounds, moved);
+		refitMs.push_back(bvh.getStats().refitMs);
+		rebuiltObjects += bvh.rebuildDegraded(std::max(objectCount / 16, 1u));
+		rebuildMs.push_back(bvh.getStats().rebuildMs);
+	}
+	refitOnly.rebuildDegraded(0);
+	Bvh fullRefit;
+	fullRefit.build(bounds);
+	fullRefit.refit(bounds);
+	Bvh rebuilt;
+	rebuilt.build(bounds, &jobs);
+
+	out << "  \"update\": { \"frames\": " << moveFrames << ", \"movedPerFrame\": " << movedCount << ", ";
+	writeSummaryJson(out, "refitMs", summarize(refitMs));
+	out << ", \"fullRefitMs\": " << fullRefit.getStats().refitMs << ", ";
+	writeSummaryJson(out, "partialRebuildMs", summarize(rebuildMs));
+	out << ", \"rebuiltObjects\": " << rebuiltObjects << ", \"freeNodes\": " << bvh.getStats().freeNodeCount
+		<< ", \"refitOnlySahCost\": " << refitOnly.getStats().sahCost << ", \"partialRebuildSahCost\": " << bvh.getStats().sahCost
+		<< ", \"fullRebuildSahCost\": " << rebuilt.getStats().sahCost << ", \"fullRebuildMs\": " << rebuilt.getStats().buildMs << " },\n";
+
+	//Queries spread over the scene, the same ones are answered by a linear scan for the checked sample
+	std::uniform_real_distribution<float> directionDist{ -1.0f, 1.0f };
+	std::vector<glm::vec3> points(queryCount);
+	std::vector<glm::vec3> directions(queryCount);
+	for (uint32_t i = 0; i < queryCount; i++) {
+		points[i] = glm::vec3(posDist(rng), posDist(rng), posDist(rng));
+		directions[i] = glm::normalize(glm::vec3(directionDist(rng), directionDist(rng), directionDist(rng)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+	}
+	auto queriesPerSecond = [](uint32_t count, Clock::time_point start) {
+		return static_cast<double>(count) / std::max(std::chrono::duration<double>(Clock::now() - start).count(), 1e-9);
+	};
+	auto boxDistance = [&](uint32_t object, const glm::vec3& point) {
+		glm::vec3 offset = point - glm::clamp(point, bounds[object].center - bounds[object].extents, bounds[object].center + bounds[object].extents);
+		return glm::length(offset);
+	};
+
+	uint32_t rayHits = 0;
+	Clock::time_point start = Clock::now();
+	for (uint32_t i = 0; i < queryCount; i++) {
+		rayHits += bvh.raycast(points[i], directions[i], rayLength).object != BVH_NO_NODE;
+	}
+	double raysPerSecond = queriesPerSecond(queryCount, start);
+	uint32_t rayMismatches = 0;
+	for (uint32_t i = 0; i < std::min(checkedQueries, queryCount); i++) {
+		//The nearest entry point of a linear scan, with the same slab test
+		glm::vec3 inverseDirection = glm::vec3(1.0f) / directions[i];
+		float nearest = rayLength;
+		bool hit = false;
+		for (const ObjectBounds& object : bounds) {
+			glm::vec3 t0 = (object.center - object.extents - points[i]) * inverseDirection;
+			glm::vec3 t1 = (object.center + object.extents - points[i]) * inverseDirection;
+			glm::vec3 near = glm::min(t0, t1);
+			glm::vec3 far = glm::max(t0, t1);
+			float entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+			float exit = std::min(std::min(far.x, far.y), std::min(far.z, nearest));
+			if (entry <= exit) {
+				nearest = entry;
+				hit = true;
+			}
+		}
+		BvhRayHit result = bvh.raycast(points[i], directions[i], rayLength);
+		rayMismatches += hit != (result.object != BVH_NO_NODE) || (hit && std::fabs(result.distance - nearest) > 1e-3f);
+	}
+	out << "  \"raycast\": { \"perSecond\": " << raysPerSecond << ", \"hits\": " << rayHits << ", \"mismatches\": " << rayMismatches << " },\n";
+
+	Camera camera{};
+	Frustum frustum = Culling::extractFrustum(camera.fetchGPUData(static_cast<float>(WIDTH), static_cast<float>(HEIGHT)));
+	std::vector<uint32_t> results;
+	start = Clock::now();
+	for (uint32_t pass = 0; pass < frustumPasses; pass++) {
+		bvh.queryFrustum(frustum, results);
+	}
+	double frustumMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frustumPasses;
+	FrustumCuller culler{ jobs };
+	start = Clock::now();
+	std::span<const uint32_t> culled;
+	for (uint32_t pass = 0; pass < frustumPasses; pass++) {
+		culled = culler.cull(frustum, bounds, CullShape::Aabb);
+	}
+	double cullMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frustumPasses;
+	std::sort(results.begin(), results.end());
+	bool frustumMatches = std::equal(results.begin(), results.end(), culled.begin(), culled.end());
+	out << "  \"frustum\": { \"ms\": " << frustumMs << ", \"visible\": " << results.size() << ", \"threadedCullMs\": " << cullMs
+		<< ", \"matchesCull\": " << (frustumMatches ? "true" : "false") << " },\n";
+
+	uint64_t sphereResults = 0;
+	start = Clock::now();
+	for (uint32_t i = 0; i < queryCount; i++) {
+		bvh.querySphere(points[i], sphereRadius, results);
+		sphereResults += results.size();
+	}
+	double spheresPerSecond = queriesPerSecond(queryCount, start);
+	uint32_t sphereMismatches = 0;
+	for (uint32_t i = 0; i < std::min(checkedQueries, queryCount); i++) {
+		bvh.querySphere(points[i], sphereRadius, results);
+		uint32_t expected = 0;
+		for (uint32_t object = 0; object < objectCount; object++) {
+			expected += boxDistance(object, points[i]) <= sphereRadius;
+		}
+		sphereMismatches += results.size() != expected;
+	}
+	out << "  \"sphere\": { \"perSecond\": " << spheresPerSecond << ", \"radius\": " << sphereRadius
+		<< ", \"avgResults\": " << static_cast<double>(sphereResults) / queryCount << ", \"mismatches\": " << sphereMismatches << " },\n";
+
+	std::vector<BvhNeighbor> neighbors;
+	start = Clock::now();
+	for (uint32_t i = 0; i < queryCount; i++) {
+		bvh.queryNearest(points[i], neighborCount, neighbors);
+	}
+	double nearestPerSecond = queriesPerSecond(queryCount, start);
+	uint32_t nearestMismatches = 0;
+	std::vector<float> distances(objectCount);
+	for (uint32_t i = 0; i < std::min(checkedQueries, queryCount); i++) {
+		bvh.queryNearest(points[i], neighborCount, neighbors);
+		for (uint32_t object = 0; object < objectCount; object++) {
+			distances[object] = boxDistance(object, points[i]);
+		}
+		uint32_t expected = std::min(neighborCount, objectCount);
+		std::partial_sort(distances.begin(), distances.begin() + expected, distances.end());
+		bool matches = neighbors.size() == expected;
+		for (uint32_t n = 0; matches && n < expected; n++) {
+			matches = std::fabs(neighbors[n].distance - distances[n]) <= 1e-3f;
+		}
+		nearestMismatches += !matches;
+	}
+	out << "  \"nearest\": { \"perSecond\": " << nearestPerSecond << ", \"k\": " << neighborCount << ", \"mismatches\": " << nearestMismatches << " }\n";
+	out << "}\n";
+}
+
+//Layered sine waves with a little noise, roughly as smooth as painted albedo. Normal maps encode the slopes of the same
+//kind of height field in red and green.
+static std::vector<std::byte> generateTexture(uint32_t size, uint32_t seed, bool normalMap) {
+	std::mt19937 rng{ seed };
+	std::uniform_real_distribution<float> frequencyDist{ 1.0f, 12.0f };
+	std::uniform_real_distribution<float> phaseDist{ 0.0f, 6.2831853f };
+	std::uniform_int_distribution<int> noiseDist{ -6, 6 };
+	float frequencies[4][2];
+	float phases[4];
+	for (uint32_t wave = 0; wave < 4; wave++) {
+		frequencies[wave][0] = frequencyDist(rng);
+		frequencies[wave][1] = frequencyDist(rng);
+		phases[wave] = phaseDist(rng);
+	}
+
+	std::vector<std::byte> texels(static_cast<size_t>(size) * size * 4);
+	for (uint32_t y = 0; y < size; y++) {
+		for (uint32_t x = 0; x < size; x++) {
+			float u = static_cast<float>(x) / static_cast<float>(size) * 6.2831853f;
+			float v = static_cast<float>(y) / static_cast<float>(size) * 6.2831853f;
+			float channels[4]{ 0.0f, 0.0f, 0.0f, 1.0f };
+			for (uint32_t wave = 0; wave < 4; wave++) {
+				float angle = frequencies[wave][0] * u + frequencies[wave][1] * v + phases[wave];
+				if (normalMap) {
+					channels[0] += 0.2f * frequencies[wave][0] / 12.0f * std::cos(angle);
+					channels[1] += 0.2f * frequencies[wave][1] / 12.0f * std::cos(angle);
+				} else {
+					channels[wave % 3] += 0.25f * std::sin(angle);
+				}
+			}
+			uint8_t* pTexel = reinterpret_cast<uint8_t*>(texels.data()) + (static_cast<size_t>(y) * size + x) * 4;
+			for (uint32_t c = 0; c < 4; c++) {
+				float value = c < 3 ? channels[c] * 0.5f + 0.5f : channels[c];
+				int noise = c < 3 && !normalMap ? noiseDist(rng) : 0;
+				pTexel[c] = static_cast<uint8_t>(std::clamp(static_cast<int>(value * 255.0f) + noise, 0, 255));
+			}
+		}
+	}
+	return texels;
+}
+
+static void writeStreamingJson(std::ostream& out, const char* name, const TextureStreamerStats& stats, uint32_t frames, uint32_t framesToFirstMips,
+	uint32_t framesToWanted) {
+	double savedRatio = stats.residentRgba8Bytes > 0 ? 1.0 - static_cast<double>(stats.residentBytes) / static_cast<double>(stats.residentRgba8Bytes) : 0.0;
+	out << "\"" << name << "\": { \"frames\": " << frames << ", \"framesToFirstMips\": " << framesToFirstMips << ", \"framesToWanted\": " << framesToWanted
+		<< ", \"avgFirstMipMs\": " << stats.firstMipMs / std::max(stats.firstMipCount, 1u) << ", \"maxFirstMipMs\": " << stats.maxFirstMipMs
+		<< ", \"avgWantedLevelMs\": " << stats.wantedLevelMs / std::max(stats.wantedLevelCount, 1u) << ", \"maxWantedLevelMs\": " << stats.maxWantedLevelMs
+		<< ", \"residentTextures\": " << stats.residentTextures << ", \"residentBytes\": " << stats.residentBytes
+		<< ", \"residentRgba8Bytes\": " << stats.residentRgba8Bytes << ", \"savedRatio\": " << savedRatio << ", \"peakResidentBytes\": " << stats.peakResidentBytes
+		<< ", \"uploadedBytes\": " << stats.uploadedBytes << ", \"upgrades\": " << stats.upgrades << ", \"evictions\": " << stats.evictions
+		<< ", \"deferrals\": " << stats.deferrals << ", \"transcodedLevels\": " << stats.transcodedLevels << ", \"transcodeMs\": " << stats.transcodeMs
+		<< ", \"updateMs\": " << stats.updateMs << " }";
+}
+
+//Offline half: encodes one generated texture into every supported format and decodes it back, which gives the size,
+//error and transcode rate of each. Streamed half: cooks a set of BC1, BC5 and BC7 textures and streams them into a
+//headless renderer coarse to fine, as whole chains, transcoded, and through a budget a quarter of their size while the
+//visible set moves, which is what evicts.
+void Benchmark::runTextureBenchmark(const BenchmarkOptions& options, uint32_t textureCount, std::ostream& out) {
+	using Clock = std::chrono::steady_clock;
+	constexpr uint32_t textureSize = 1024;
+	constexpr uint32_t maxFrames = 2000;
+	constexpr uint32_t framesPerView = 20; //of the budgeted run, before the visible set moves on
+	constexpr VkFormat formats[]{ VK_FORMAT_BC1_RGB_SRGB_BLOCK, VK_FORMAT_BC5_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK, VK_FORMAT_R8G8B8A8_SRGB };
+	constexpr const char* formatNames[]{ "bc1", "bc5", "bc7", "rgba8" };
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path() / "texture_bench";
+	std::filesystem::create_directories(directory);
+	out << "{\n"
+		<< "  \"benchmark\": \"textures\",\n"
+		<< "  \"textureSize\": " << textureSize << ",\n"
+		<< "  \"formats\": {\n";
+	uint64_t rgba8FileBytes = 0;
+	for (size_t i = std::size(formats); i-- > 0;) { //RGBA8 first, the others are compared against it
+		VkFormat format = formats[i];
+		bool normalMap = format == VK_FORMAT_BC5_UNORM_BLOCK;
+		std::vector<std::byte> source = generateTexture(textureSize, 1, normalMap);
+		Clock::time_point start = Clock::now();
+		std::vector<std::byte> encoded = BlockCompression::encode(format, source, textureSize, textureSize);
+		double encodeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		std::vector<std::byte> decoded;
+		start = Clock::now();
+		BlockCompression::decode(format, encoded, textureSize, textureSize, decoded);
+		double decodeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		//Over the channels the format keeps
+		uint32_t channels = normalMap ? 2 : format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ? 3 : 4;
+		uint32_t decodedStride = BlockCompression::getBlockBytes(BlockCompression::getTranscodeFormat(format));
+		double squaredError = 0.0;
+		for (size_t texel = 0; texel < static_cast<size_t>(textureSize) * textureSize; texel++) {
+			for (uint32_t c = 0; c < channels; c++) {
+				double difference = std::to_integer<int>(source[texel * 4 + c]) - std::to_integer<int>(decoded[texel * decodedStride + c]);
+				squaredError += difference * difference;
+			}
+		}
+		double meanSquaredError = squaredError / (static_cast<double>(textureSize) * textureSize * channels);
+		double psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+
+		uint64_t fileBytes = TextureFile::write(directory / (std::string(formatNames[i]) + ".ktx2"), format, textureSize, textureSize, source);
+		if (format == VK_FORMAT_R8G8B8A8_SRGB) {
+			rgba8FileBytes = fileBytes;
+		}
+		out << "    \"" << formatNames[i] << "\": { \"levelBytes\": " << encoded.size() << ", \"fileBytes\": " << fileBytes
+			<< ", \"sizeVsRgba8\": " << static_cast<double>(fileBytes) / static_cast<double>(rgba8FileBytes)
+			<< ", \"psnr\": " << psnr << ", \"encodeMs\": " << encodeMs << ", \"transcodeMs\": " << decodeMs
+			<< ", \"transcodeMBps\": " << static_cast<double>(decoded.size()) / (1024.0 * 1024.0) / std::max(decodeMs / 1000.0, 1e-9) << " }"
+			<< (i > 0 ? ",\n" : "\n");
+	}
+	out << "  },\n";
+
+	//Albedo in BC1 and BC7, normal maps in BC5
+	std::vector<std::filesystem::path> paths;
+	uint64_t cookedBytes = 0;
+	Clock::time_point cookStart = Clock::now();
+	for (uint32_t i = 0; i < textureCount; i++) {
+		VkFormat format = formats[i % 3];
+		paths.push_back(directory / ("texture" + std::to_string(i) + ".ktx2"));
+		cookedBytes += TextureFile::write(paths.back(), format, textureSize, textureSize,
+			generateTexture(textureSize, i + 2, format == VK_FORMAT_BC5_UNORM_BLOCK));
+	}
+	double cookMs = std::chrono::duration<double, std::milli>(Clock::now() - cookStart).count();
+	out << "  \"textures\": " << textureCount << ",\n"
+		<< "  \"cookedBytes\": " << cookedBytes << ",\n"
+		<< "  \"cookMs\": " << cookMs << ",\n";
+
+	//Every texture is wanted at full resolution from the first frame, or a moving window of an eighth of them when the
+	//budget is limited. Frame counts are until every texture had its first mip and its wanted level, 0 when that never happened.
+	auto stream = [&](const char* name, const TextureStreamerConfig& config, bool moving, bool last) {
+		RendererConfig rendererConfig = options.rendererConfig;
+		rendererConfig.textures = config;
+		Renderer renderer{ rendererConfig };
+		renderer.init();
+		TextureStreamer& textures = renderer.getTextures();
+		std::vector<TextureHandle> handles;
+		for (const std::filesystem::path& path : paths) {
+			handles.push_back(textures.addTexture(path));
+		}
+
+		uint32_t windowSize = std::max(textureCount / 8, 1u);
+		uint32_t framesToFirstMips = 0;
+		uint32_t framesToWanted = 0;
+		uint32_t frame = 0;
+		for (; frame < maxFrames; frame++) {
+			uint32_t first = moving ? frame / framesPerView * windowSize / 2 : 0;
+			uint32_t count = moving ? windowSize : textureCount;
+			for (uint32_t i = 0; i < count; i++) {
+				textures.markVisible(handles[(first + i) % textureCount], 0);
+			}
+			renderer.renderFrames(1);
+
+			bool allFirstMips = true;
+			bool allWanted = true;
+			for (TextureHandle handle : handles) {
+				allFirstMips = allFirstMips && textures.getView(handle) != VK_NULL_HANDLE;
+				allWanted = allWanted && textures.getResidentLevel(handle) == 0;
+			}
+			if (allFirstMips && framesToFirstMips == 0) {
+				framesToFirstMips = frame + 1;
+			}
+			if (allWanted && framesToWanted == 0) {
+				framesToWanted = frame + 1;
+			}
+			if (!moving && allWanted) {
+				break;
+			}
+		}
+		renderer.finishFrames();
+		out << "  ";
+		writeStreamingJson(out, name, textures.getStats(), std::min(frame + 1, maxFrames), framesToFirstMips, framesToWanted);
+		out << (last ? "\n" : ",\n");
+	};
+
+	TextureStreamerConfig unlimited{ .budgetBytes = ~0ull };
+	stream("coarseToFine", unlimited, false, false);
+	stream("wholeChain", TextureStreamerConfig{ .budgetBytes = ~0ull, .coarseToFine = false }, false, false);
+	stream("transcoded", TextureStreamerConfig{ .budgetBytes = ~0ull, .forceTranscode = true }, false, false);
+	stream("budgeted", TextureStreamerConfig{ .budgetBytes = std::max<VkDeviceSize>(cookedBytes / 4, 1) }, true, true);
+	out << "}\n";
+	std::filesystem::remove_all(directory);
+}
\ No newline at end of file
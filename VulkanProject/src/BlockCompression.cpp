@@ -0,0 +1,625 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+struct Bc7Mode {
+	uint8_t subsets;
+	uint8_t partitionBits;
+	uint8_t rotationBits;
+	uint8_t indexSelectionBits;
+	uint8_t colorBits;
+	uint8_t alphaBits; //0 when the mode is opaque
+	uint8_t endpointPBits; //one p-bit per endpoint
+	uint8_t sharedPBits; //one p-bit per subset
+	uint8_t indexBits;
+	uint8_t secondaryIndexBits; //separate alpha indices, 0 when colour and alpha share them
+};
+
+static constexpr Bc7Mode BC7_MODES[8]{
+	{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+	{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+	{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+	{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+	{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+	{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+	{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+	{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+};
+
+//Subset of every texel, one bit per texel for two subsets and two bits for three, texel 0 in the lowest bits
+static constexpr uint16_t BC7_PARTITIONS_2[64]{
+	0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+	0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+	0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+	0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+};
+
+static constexpr uint32_t BC7_PARTITIONS_3[64]{
+	0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+	0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+	0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+	0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+	0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+	0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+	0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+	0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254
+};
+
+//Texels whose index drops its top bit, subset 0's anchor is always texel 0
+static constexpr uint8_t BC7_ANCHORS_2[64]{
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+	15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6, 6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+};
+
+static constexpr uint8_t BC7_ANCHORS_3_SECOND[64]{
+	3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3, 3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+	8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15, 3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3
+};
+
+static constexpr uint8_t BC7_ANCHORS_3_THIRD[64]{
+	15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8, 15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+	15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8, 15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8
+};
+
+static constexpr uint8_t BC7_WEIGHTS_2[4]{ 0, 21, 43, 64 };
+static constexpr uint8_t BC7_WEIGHTS_3[8]{ 0, 9, 18, 27, 37, 46, 55, 64 };
+static constexpr uint8_t BC7_WEIGHTS_4[16]{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static const uint8_t* bc7Weights(uint32_t indexBits) {
+	return indexBits == 2 ? BC7_WEIGHTS_2 : indexBits == 3 ? BC7_WEIGHTS_3 : BC7_WEIGHTS_4;
+}
+
+static uint8_t bc7Interpolate(uint32_t low, uint32_t high, uint32_t weight) {
+	return static_cast<uint8_t>(((64 - weight) * low + weight * high + 32) >> 6);
+}
+
+//Blocks are little endian bit streams, the first field starts at bit 0 of byte 0
+static uint32_t readBits(const uint8_t* pBlock, uint32_t& position, uint32_t count) {
+	uint32_t value = 0;
+	for (uint32_t i = 0; i < count; i++, position++) {
+		value |= ((pBlock[position >> 3] >> (position & 7)) & 1u) << i;
+	}
+	return value;
+}
+
+static void writeBits(uint8_t* pBlock, uint32_t& position, uint32_t count, uint32_t value) {
+	for (uint32_t i = 0; i < count; i++, position++) {
+		pBlock[position >> 3] |= static_cast<uint8_t>(((value >> i) & 1u) << (position & 7));
+	}
+}
+
+//Line through the mean of the texels along their principal axis, from the lowest to the highest projection. The axis
+//comes out of a few power iterations on the covariance, started from the column of the channel that varies most.
+template<uint32_t Channels>
+static void fitLine(const uint8_t* pTexels, std::array<float, Channels>& low, std::array<float, Channels>& high) {
+	std::array<float, Channels> mean{};
+	for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+		for (uint32_t c = 0; c < Channels; c++) {
+			mean[c] += pTexels[i * 4 + c];
+		}
+	}
+	for (float& value : mean) {
+		value /= static_cast<float>(BC_BLOCK_TEXELS);
+	}
+
+	std::array<std::array<float, Channels>, Channels> covariance{};
+	for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+		for (uint32_t a = 0; a < Channels; a++) {
+			for (uint32_t b = 0; b < Channels; b++) {
+				covariance[a][b] += (pTexels[i * 4 + a] - mean[a]) * (pTexels[i * 4 + b] - mean[b]);
+			}
+		}
+	}
+	uint32_t widest = 0;
+	for (uint32_t c = 1; c < Channels; c++) {
+		if (covariance[c][c] > covariance[widest][widest]) {
+			widest = c;
+		}
+	}
+	std::array<float, Channels> axis = covariance[widest];
+	for (uint32_t iteration = 0; iteration < 8; iteration++) {
+		std::array<float, Channels> next{};
+		float length = 0.0f;
+		for (uint32_t a = 0; a < Channels; a++) {
+			for (uint32_t b = 0; b < Channels; b++) {
+				next[a] += covariance[a][b] * axis[b];
+			}
+			length += next[a] * next[a];
+		}
+		if (length < 1e-12f) {
+			break;
+		}
+		length = std::sqrt(length);
+		for (uint32_t c = 0; c < Channels; c++) {
+			axis[c] = next[c] / length;
+		}
+	}
+	float axisLength = 0.0f;
+	for (float value : axis) {
+		axisLength += value * value;
+	}
+	if (axisLength < 1e-12f) {
+		low = mean;
+		high = mean;
+		return;
+	}
+	axisLength = std::sqrt(axisLength);
+	for (float& value : axis) {
+		value /= axisLength;
+	}
+
+	float minProjection = 0.0f;
+	float maxProjection = 0.0f;
+	for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+		float projection = 0.0f;
+		for (uint32_t c = 0; c < Channels; c++) {
+			projection += (pTexels[i * 4 + c] - mean[c]) * axis[c];
+		}
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+	for (uint32_t c = 0; c < Channels; c++) {
+		low[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+		high[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+	}
+}
+
+template<uint32_t Channels, size_t PaletteSize>
+static uint32_t nearestIndex(const uint8_t* pTexel, const std::array<std::array<uint8_t, 4>, PaletteSize>& palette, uint32_t paletteSize) {
+	uint32_t best = 0;
+	int32_t bestError = INT32_MAX;
+	for (uint32_t i = 0; i < paletteSize; i++) {
+		int32_t error = 0;
+		for (uint32_t c = 0; c < Channels; c++) {
+			int32_t difference = static_cast<int32_t>(pTexel[c]) - palette[i][c];
+			error += difference * difference;
+		}
+		if (error < bestError) {
+			bestError = error;
+			best = i;
+		}
+	}
+	return best;
+}
+
+static uint16_t pack565(const std::array<float, 3>& color) {
+	uint32_t r = static_cast<uint32_t>(std::lround(color[0] * 31.0f / 255.0f));
+	uint32_t g = static_cast<uint32_t>(std::lround(color[1] * 63.0f / 255.0f));
+	uint32_t b = static_cast<uint32_t>(std::lround(color[2] * 31.0f / 255.0f));
+	return static_cast<uint16_t>(r << 11 | g << 5 | b);
+}
+
+static std::array<uint8_t, 4> unpack565(uint16_t color) {
+	uint32_t r = color >> 11;
+	uint32_t g = (color >> 5) & 63;
+	uint32_t b = color & 31;
+	return { static_cast<uint8_t>(r << 3 | r >> 2), static_cast<uint8_t>(g << 2 | g >> 4), static_cast<uint8_t>(b << 3 | b >> 2), 255 };
+}
+
+static std::array<std::array<uint8_t, 4>, 4> bc1Palette(uint16_t color0, uint16_t color1) {
+	std::array<std::array<uint8_t, 4>, 4> palette{};
+	palette[0] = unpack565(color0);
+	palette[1] = unpack565(color1);
+	for (uint32_t c = 0; c < 3; c++) {
+		uint32_t a = palette[0][c];
+		uint32_t b = palette[1][c];
+		if (color0 > color1) {
+			palette[2][c] = static_cast<uint8_t>((2 * a + b + 1) / 3);
+			palette[3][c] = static_cast<uint8_t>((a + 2 * b + 1) / 3);
+		} else {
+			palette[2][c] = static_cast<uint8_t>((a + b + 1) / 2);
+			palette[3][c] = 0; //black in the opaque variant
+		}
+	}
+	palette[2][3] = 255;
+	palette[3][3] = 255;
+	return palette;
+}
+
+static std::array<std::array<uint8_t, 4>, 8> bc4Palette(uint32_t value0, uint32_t value1) {
+	std::array<std::array<uint8_t, 4>, 8> palette{};
+	palette[0][0] = static_cast<uint8_t>(value0);
+	palette[1][0] = static_cast<uint8_t>(value1);
+	if (value0 > value1) {
+		for (uint32_t i = 1; i < 7; i++) {
+			palette[i + 1][0] = static_cast<uint8_t>(((7 - i) * value0 + i * value1 + 3) / 7);
+		}
+	} else {
+		for (uint32_t i = 1; i < 5; i++) {
+			palette[i + 1][0] = static_cast<uint8_t>(((5 - i) * value0 + i * value1 + 2) / 5);
+		}
+		palette[6][0] = 0;
+		palette[7][0] = 255;
+	}
+	return palette;
+}
+
+//value0 > value1 selects the eight value mode, equal endpoints leave every index at 0
+static void encodeBc4(const uint8_t* pTexels, uint32_t channel, uint8_t* pBlock) {
+	uint32_t low = 255;
+	uint32_t high = 0;
+	for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+		low = std::min<uint32_t>(low, pTexels[i * 4 + channel]);
+		high = std::max<uint32_t>(high, pTexels[i * 4 + channel]);
+	}
+	std::array<std::array<uint8_t, 4>, 8> palette = bc4Palette(high, low);
+	uint64_t indices = 0;
+	if (high != low) {
+		for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+			indices |= static_cast<uint64_t>(nearestIndex<1>(pTexels + i * 4 + channel, palette, 8)) << (3 * i);
+		}
+	}
+	pBlock[0] = static_cast<uint8_t>(high);
+	pBlock[1] = static_cast<uint8_t>(low);
+	for (uint32_t i = 0; i < 6; i++) {
+		pBlock[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+	}
+}
+
+static void decodeBc4(const uint8_t* pBlock, uint32_t channel, uint8_t* pTexels) {
+	std::array<std::array<uint8_t, 4>, 8> palette = bc4Palette(pBlock[0], pBlock[1]);
+	uint64_t indices = 0;
+	for (uint32_t i = 0; i < 6; i++) {
+		indices |= static_cast<uint64_t>(pBlock[2 + i]) << (8 * i);
+	}
+	for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+		pTexels[i * 4 + channel] = palette[(indices >> (3 * i)) & 7][0];
+	}
+}
+
+//Mode 6 endpoints are 7 bits plus a p-bit per endpoint, so every channel of an endpoint shares the lowest bit
+static std::array<uint32_t, 4> quantizeMode6(const std::array<float, 4>& endpoint, uint32_t& pBit) {
+	std::array<uint32_t, 4> best{};
+	float bestError = std::numeric_limits<float>::max();
+	for (uint32_t p = 0; p < 2; p++) {
+		std::array<uint32_t, 4> quantized{};
+		float error = 0.0f;
+		for (uint32_t c = 0; c < 4; c++) {
+			quantized[c] = static_cast<uint32_t>(std::clamp(std::lround((endpoint[c] - static_cast<float>(p)) * 0.5f), 0l, 127l));
+			float difference = static_cast<float>(quantized[c] << 1 | p) - endpoint[c];
+			error += difference * difference;
+		}
+		if (error < bestError) {
+			bestError = error;
+			best = quantized;
+			pBit = p;
+		}
+	}
+	return best;
+}
+
+bool BlockCompression::isSupported(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool BlockCompression::isCompressed(VkFormat format) {
+	return getTranscodeFormat(format) != format;
+}
+
+uint32_t BlockCompression::getBlockBytes(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		return 8;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return 16;
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		return 4;
+	case VK_FORMAT_R8G8_UNORM:
+		return 2;
+	default:
+		throw std::runtime_error("Unsupported texture format " + std::to_string(format));
+	}
+}
+
+VkDeviceSize BlockCompression::getLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+	if (!isCompressed(format)) {
+		return static_cast<VkDeviceSize>(width) * height * getBlockBytes(format);
+	}
+	VkDeviceSize blocksX = (width + BC_BLOCK_EXTENT - 1) / BC_BLOCK_EXTENT;
+	VkDeviceSize blocksY = (height + BC_BLOCK_EXTENT - 1) / BC_BLOCK_EXTENT;
+	return blocksX * blocksY * getBlockBytes(format);
+}
+
+VkFormat BlockCompression::getTranscodeFormat(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+		return VK_FORMAT_R8G8B8A8_UNORM;
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return VK_FORMAT_R8G8B8A8_SRGB;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		return VK_FORMAT_R8G8_UNORM;
+	default:
+		return format;
+	}
+}
+
+//Color 0 is kept above color 1 so the block decodes in four color mode
+void BlockCompression::encodeBc1Block(const uint8_t* pTexels, uint8_t* pBlock) {
+	std::array<float, 3> low;
+	std::array<float, 3> high;
+	fitLine<3>(pTexels, low, high);
+	uint16_t color0 = pack565(high);
+	uint16_t color1 = pack565(low);
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1) {
+		std::array<std::array<uint8_t, 4>, 4> palette = bc1Palette(color0, color1);
+		for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+			indices |= nearestIndex<3>(pTexels + i * 4, palette, 4) << (2 * i);
+		}
+	}
+	pBlock[0] = static_cast<uint8_t>(color0);
+	pBlock[1] = static_cast<uint8_t>(color0 >> 8);
+	pBlock[2] = static_cast<uint8_t>(color1);
+	pBlock[3] = static_cast<uint8_t>(color1 >> 8);
+	for (uint32_t i = 0; i < 4; i++) {
+		pBlock[4 + i] = static_cast<uint8_t>(indices >> (8 * i));
+	}
+}
+
+void BlockCompression::encodeBc5Block(const uint8_t* pTexels, uint8_t* pBlock) {
+	encodeBc4(pTexels, 0, pBlock);
+	encodeBc4(pTexels, 1, pBlock + 8);
+}
+
+//Mode 6: one subset, RGBA endpoints and 4 bit indices shared by colour and alpha. Texel 0's index loses its top bit,
+//so the endpoints are swapped whenever it would need it.
+void BlockCompression::encodeBc7Block(const uint8_t* pTexels, uint8_t* pBlock) {
+	std::array<float, 4> low;
+	std::array<float, 4> high;
+	fitLine<4>(pTexels, low, high);
+	uint32_t pBits[2]{};
+	std::array<uint32_t, 4> endpoints[2]{ quantizeMode6(low, pBits[0]), quantizeMode6(high, pBits[1]) };
+
+	std::array<std::array<uint8_t, 4>, 16> palette{};
+	for (uint32_t i = 0; i < 16; i++) {
+		for (uint32_t c = 0; c < 4; c++) {
+			palette[i][c] = bc7Interpolate(endpoints[0][c] << 1 | pBits[0], endpoints[1][c] << 1 | pBits[1], BC7_WEIGHTS_4[i]);
+		}
+	}
+	uint32_t indices[BC_BLOCK_TEXELS];
+	for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+		indices[i] = nearestIndex<4>(pTexels + i * 4, palette, 16);
+	}
+	if (indices[0] >= 8) {
+		std::swap(endpoints[0], endpoints[1]);
+		std::swap(pBits[0], pBits[1]);
+		for (uint32_t& index : indices) {
+			index = 15 - index;
+		}
+	}
+
+	std::memset(pBlock, 0, 16);
+	uint32_t position = 0;
+	writeBits(pBlock, position, 7, 1u << 6);
+	for (uint32_t c = 0; c < 4; c++) {
+		writeBits(pBlock, position, 7, endpoints[0][c]);
+		writeBits(pBlock, position, 7, endpoints[1][c]);
+	}
+	writeBits(pBlock, position, 1, pBits[0]);
+	writeBits(pBlock, position, 1, pBits[1]);
+	for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+		writeBits(pBlock, position, i == 0 ? 3 : 4, indices[i]);
+	}
+}
+
+void BlockCompression::decodeBc1Block(const uint8_t* pBlock, uint8_t* pTexels) {
+	uint16_t color0 = static_cast<uint16_t>(pBlock[0] | pBlock[1] << 8);
+	uint16_t color1 = static_cast<uint16_t>(pBlock[2] | pBlock[3] << 8);
+	uint32_t indices = pBlock[4] | pBlock[5] << 8 | pBlock[6] << 16 | static_cast<uint32_t>(pBlock[7]) << 24;
+	std::array<std::array<uint8_t, 4>, 4> palette = bc1Palette(color0, color1);
+	for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+		std::memcpy(pTexels + i * 4, palette[(indices >> (2 * i)) & 3].data(), 4);
+	}
+}
+
+void BlockCompression::decodeBc5Block(const uint8_t* pBlock, uint8_t* pTexels) {
+	decodeBc4(pBlock, 0, pTexels);
+	decodeBc4(pBlock + 8, 1, pTexels);
+	for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+		pTexels[i * 4 + 2] = 0;
+		pTexels[i * 4 + 3] = 255;
+	}
+}
+
+//Fields in stream order: mode, partition, rotation, index selection, every endpoint's red, then green, blue and alpha,
+//p-bits, the primary indices and the secondary indices of the modes that have them
+void BlockCompression::decodeBc7Block(const uint8_t* pBlock, uint8_t* pTexels) {
+	uint32_t modeIndex = 0;
+	while (modeIndex < 8 && (pBlock[0] & (1u << modeIndex)) == 0) {
+		modeIndex++;
+	}
+	if (modeIndex == 8) {
+		std::memset(pTexels, 0, BC_BLOCK_TEXELS * 4);
+		return;
+	}
+
+	const Bc7Mode& mode = BC7_MODES[modeIndex];
+	uint32_t position = modeIndex + 1;
+	uint32_t partition = readBits(pBlock, position, mode.partitionBits);
+	uint32_t rotation = readBits(pBlock, position, mode.rotationBits);
+	uint32_t indexSelection = readBits(pBlock, position, mode.indexSelectionBits);
+
+	uint32_t endpointCount = mode.subsets * 2u;
+	uint32_t endpoints[6][4]{};
+	for (uint32_t c = 0; c < 3; c++) {
+		for (uint32_t e = 0; e < endpointCount; e++) {
+			endpoints[e][c] = readBits(pBlock, position, mode.colorBits);
+		}
+	}
+	for (uint32_t e = 0; e < endpointCount; e++) {
+		endpoints[e][3] = mode.alphaBits != 0 ? readBits(pBlock, position, mode.alphaBits) : 255;
+	}
+
+	uint32_t colorBits = mode.colorBits;
+	uint32_t alphaBits = mode.alphaBits;
+	if (mode.endpointPBits != 0 || mode.sharedPBits != 0) {
+		uint32_t pBits[6]{};
+		if (mode.endpointPBits != 0) {
+			for (uint32_t e = 0; e < endpointCount; e++) {
+				pBits[e] = readBits(pBlock, position, 1);
+			}
+		} else {
+			for (uint32_t s = 0; s < mode.subsets; s++) {
+				pBits[s * 2] = pBits[s * 2 + 1] = readBits(pBlock, position, 1);
+			}
+		}
+		for (uint32_t e = 0; e < endpointCount; e++) {
+			for (uint32_t c = 0; c < (alphaBits != 0 ? 4u : 3u); c++) {
+				endpoints[e][c] = endpoints[e][c] << 1 | pBits[e];
+			}
+		}
+		colorBits++;
+		alphaBits += alphaBits != 0 ? 1 : 0;
+	}
+	//Fields narrower than a byte repeat their top bits below themselves
+	for (uint32_t e = 0; e < endpointCount; e++) {
+		for (uint32_t c = 0; c < 4; c++) {
+			uint32_t bits = c < 3 ? colorBits : alphaBits;
+			if (bits != 0 && bits < 8) {
+				endpoints[e][c] = (endpoints[e][c] << (8 - bits)) | (endpoints[e][c] >> (2 * bits - 8));
+			}
+		}
+	}
+
+	uint32_t subsets[BC_BLOCK_TEXELS]{};
+	bool anchors[BC_BLOCK_TEXELS]{ true };
+	for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+		if (mode.subsets == 2) {
+			subsets[i] = (BC7_PARTITIONS_2[partition] >> i) & 1;
+		} else if (mode.subsets == 3) {
+			subsets[i] = (BC7_PARTITIONS_3[partition] >> (2 * i)) & 3;
+		}
+	}
+	if (mode.subsets == 2) {
+		anchors[BC7_ANCHORS_2[partition]] = true;
+	} else if (mode.subsets == 3) {
+		anchors[BC7_ANCHORS_3_SECOND[partition]] = true;
+		anchors[BC7_ANCHORS_3_THIRD[partition]] = true;
+	}
+
+	uint32_t indices[BC_BLOCK_TEXELS];
+	for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+		indices[i] = readBits(pBlock, position, mode.indexBits - (anchors[i] ? 1 : 0));
+	}
+	uint32_t secondaryIndices[BC_BLOCK_TEXELS]{};
+	if (mode.secondaryIndexBits != 0) {
+		for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+			secondaryIndices[i] = readBits(pBlock, position, mode.secondaryIndexBits - (i == 0 ? 1 : 0));
+		}
+	}
+
+	for (uint32_t i = 0; i < BC_BLOCK_TEXELS; i++) {
+		const uint32_t* pLow = endpoints[subsets[i] * 2];
+		const uint32_t* pHigh = endpoints[subsets[i] * 2 + 1];
+		uint32_t colorWeight = bc7Weights(mode.indexBits)[indices[i]];
+		uint32_t alphaWeight = colorWeight;
+		if (mode.secondaryIndexBits != 0) {
+			uint32_t secondaryWeight = bc7Weights(mode.secondaryIndexBits)[secondaryIndices[i]];
+			alphaWeight = indexSelection != 0 ? colorWeight : secondaryWeight;
+			colorWeight = indexSelection != 0 ? secondaryWeight : colorWeight;
+		}
+		uint8_t* pTexel = pTexels + i * 4;
+		for (uint32_t c = 0; c < 3; c++) {
+			pTexel[c] = bc7Interpolate(pLow[c], pHigh[c], colorWeight);
+		}
+		pTexel[3] = mode.alphaBits != 0 ? bc7Interpolate(pLow[3], pHigh[3], alphaWeight) : 255;
+		if (rotation != 0) {
+			std::swap(pTexel[3], pTexel[rotation - 1]);
+		}
+	}
+}
+
+std::vector<std::byte> BlockCompression::encode(VkFormat format, std::span<const std::byte> rgba8, uint32_t width, uint32_t height) {
+	if (!isCompressed(format)) {
+		return std::vector<std::byte>(rgba8.begin(), rgba8.end());
+	}
+
+	uint32_t blocksX = (width + BC_BLOCK_EXTENT - 1) / BC_BLOCK_EXTENT;
+	uint32_t blocksY = (height + BC_BLOCK_EXTENT - 1) / BC_BLOCK_EXTENT;
+	uint32_t blockBytes = getBlockBytes(format);
+	std::vector<std::byte> encoded(static_cast<size_t>(blocksX) * blocksY * blockBytes);
+	const uint8_t* pSource = reinterpret_cast<const uint8_t*>(rgba8.data());
+	uint8_t texels[BC_BLOCK_TEXELS * 4];
+	for (uint32_t blockY = 0; blockY < blocksY; blockY++) {
+		for (uint32_t blockX = 0; blockX < blocksX; blockX++) {
+			for (uint32_t y = 0; y < BC_BLOCK_EXTENT; y++) {
+				for (uint32_t x = 0; x < BC_BLOCK_EXTENT; x++) {
+					uint32_t sourceX = std::min(blockX * BC_BLOCK_EXTENT + x, width - 1);
+					uint32_t sourceY = std::min(blockY * BC_BLOCK_EXTENT + y, height - 1);
+					std::memcpy(texels + (y * BC_BLOCK_EXTENT + x) * 4, pSource + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+				}
+			}
+			uint8_t* pBlock = reinterpret_cast<uint8_t*>(encoded.data()) + (static_cast<size_t>(blockY) * blocksX + blockX) * blockBytes;
+			if (format == VK_FORMAT_BC5_UNORM_BLOCK) {
+				encodeBc5Block(texels, pBlock);
+			} else if (format == VK_FORMAT_BC7_UNORM_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK) {
+				encodeBc7Block(texels, pBlock);
+			} else {
+				encodeBc1Block(texels, pBlock);
+			}
+		}
+	}
+	return encoded;
+}
+
+void BlockCompression::decode(VkFormat format, std::span<const std::byte> data, uint32_t width, uint32_t height, std::vector<std::byte>& out) {
+	VkFormat transcodeFormat = getTranscodeFormat(format);
+	out.resize(static_cast<size_t>(getLevelSize(transcodeFormat, width, height)));
+	if (transcodeFormat == format) {
+		std::copy(data.begin(), data.begin() + out.size(), out.begin());
+		return;
+	}
+
+	uint32_t blocksX = (width + BC_BLOCK_EXTENT - 1) / BC_BLOCK_EXTENT;
+	uint32_t blocksY = (height + BC_BLOCK_EXTENT - 1) / BC_BLOCK_EXTENT;
+	uint32_t blockBytes = getBlockBytes(format);
+	uint32_t texelBytes = getBlockBytes(transcodeFormat);
+	uint8_t* pOut = reinterpret_cast<uint8_t*>(out.data());
+	uint8_t texels[BC_BLOCK_TEXELS * 4];
+	for (uint32_t blockY = 0; blockY < blocksY; blockY++) {
+		for (uint32_t blockX = 0; blockX < blocksX; blockX++) {
+			const uint8_t* pBlock = reinterpret_cast<const uint8_t*>(data.data()) + (static_cast<size_t>(blockY) * blocksX + blockX) * blockBytes;
+			if (format == VK_FORMAT_BC5_UNORM_BLOCK) {
+				decodeBc5Block(pBlock, texels);
+			} else if (format == VK_FORMAT_BC7_UNORM_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK) {
+				decodeBc7Block(pBlock, texels);
+			} else {
+				decodeBc1Block(pBlock, texels);
+			}
+			//Texels past the edge of the level are dropped
+			for (uint32_t y = 0; y < BC_BLOCK_EXTENT && blockY * BC_BLOCK_EXTENT + y < height; y++) {
+				for (uint32_t x = 0; x < BC_BLOCK_EXTENT && blockX * BC_BLOCK_EXTENT + x < width; x++) {
+					size_t target = (static_cast<size_t>(blockY * BC_BLOCK_EXTENT + y) * width + blockX * BC_BLOCK_EXTENT + x) * texelBytes;
+					std::memcpy(pOut + target, texels + (y * BC_BLOCK_EXTENT + x) * 4, texelBytes);
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
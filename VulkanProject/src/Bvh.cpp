@@ -0,0 +1,718 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+constexpr uint32_t BVH_BIN_BATCH = 8192; //primitives binned per worker task
+
+//A bin keeps the centroid box next to the box, so the children's ranges fall out of the binning that chose the split
+struct BvhBin {
+	glm::vec3 min{ std::numeric_limits<float>::max() };
+	glm::vec3 max{ -std::numeric_limits<float>::max() };
+	glm::vec3 centroidMin{ std::numeric_limits<float>::max() };
+	glm::vec3 centroidMax{ -std::numeric_limits<float>::max() };
+	uint32_t count{ 0 };
+};
+
+using BvhBins = std::array<std::array<BvhBin, BVH_BIN_COUNT>, 3>;
+
+static BvhRange emptyRange() {
+	return BvhRange{
+		.min = glm::vec3(std::numeric_limits<float>::max()),
+		.max = glm::vec3(-std::numeric_limits<float>::max()),
+		.centroidMin = glm::vec3(std::numeric_limits<float>::max()),
+		.centroidMax = glm::vec3(-std::numeric_limits<float>::max())
+	};
+}
+
+static void growRange(BvhRange& range, const glm::vec3& min, const glm::vec3& max, const glm::vec3& centroidMin, const glm::vec3& centroidMax) {
+	range.min = glm::min(range.min, min);
+	range.max = glm::max(range.max, max);
+	range.centroidMin = glm::min(range.centroidMin, centroidMin);
+	range.centroidMax = glm::max(range.centroidMax, centroidMax);
+}
+
+static void growBin(BvhBin& bin, const BvhBin& other) {
+	bin.min = glm::min(bin.min, other.min);
+	bin.max = glm::max(bin.max, other.max);
+	bin.centroidMin = glm::min(bin.centroidMin, other.centroidMin);
+	bin.centroidMax = glm::max(bin.centroidMax, other.centroidMax);
+	bin.count += other.count;
+}
+
+//Twice the area would only scale every cost, SAH only compares them
+static float halfArea(const glm::vec3& min, const glm::vec3& max) {
+	glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+//Cost in area units divided by the root's area, the expected number of tests of a query that reaches the root
+static float relativeToRoot(float cost, const BvhNode& root) {
+	return cost / std::max(halfArea(root.min, root.max), std::numeric_limits<float>::min());
+}
+
+static glm::vec3 centroid(const BvhPrimitive& primitive) {
+	return (primitive.min + primitive.max) * 0.5f;
+}
+
+static uint32_t binIndex(float value, float origin, float scale) {
+	return std::min(static_cast<uint32_t>(std::max((value - origin) * scale, 0.0f)), BVH_BIN_COUNT - 1);
+}
+
+static void binRange(const BvhPrimitive* pPrimitives, uint32_t count, const BvhRange& range, const glm::vec3& scale, BvhBins& bins) {
+	for (uint32_t i = 0; i < count; i++) {
+		const BvhPrimitive& primitive = pPrimitives[i];
+		glm::vec3 center = centroid(primitive);
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			BvhBin& bin = bins[axis][binIndex(center[axis], range.centroidMin[axis], scale[axis])];
+			bin.min = glm::min(bin.min, primitive.min);
+			bin.max = glm::max(bin.max, primitive.max);
+			bin.centroidMin = glm::min(bin.centroidMin, center);
+			bin.centroidMax = glm::max(bin.centroidMax, center);
+			bin.count++;
+		}
+	}
+}
+
+static bool isLeaf(const BvhNode& node) {
+	return node.count != 0;
+}
+
+static bool isDead(const BvhNode& node) {
+	return node.count == BVH_DEAD_NODE;
+}
+
+//Distance along the ray to where it enters the box, or a negative value when it misses it within maxDistance
+static float intersectRay(const glm::vec3& min, const glm::vec3& max, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+	glm::vec3 t0 = (min - origin) * inverseDirection;
+	glm::vec3 t1 = (max - origin) * inverseDirection;
+	glm::vec3 near = glm::min(t0, t1);
+	glm::vec3 far = glm::max(t0, t1);
+	float entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+	float exit = std::min(std::min(far.x, far.y), std::min(far.z, maxDistance));
+	return entry <= exit ? entry : -1.0f;
+}
+
+static float distanceSquared(const glm::vec3& min, const glm::vec3& max, const glm::vec3& point) {
+	glm::vec3 offset = point - glm::clamp(point, min, max);
+	return glm::dot(offset, offset);
+}
+
+enum class FrustumOverlap {
+	Outside,
+	Intersecting,
+	Inside
+};
+
+//Same plane test as Culling::testAabb, but also tells boxes entirely inside apart so their subtrees skip the tests
+static FrustumOverlap classify(const Frustum& frustum, const glm::vec3& min, const glm::vec3& max) {
+	glm::vec3 center = (min + max) * 0.5f;
+	glm::vec3 extents = (max - min) * 0.5f;
+	FrustumOverlap overlap = FrustumOverlap::Inside;
+	for (const glm::vec4& plane : frustum.planes) {
+		float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float projectedExtent = std::fabs(plane.x) * extents.x + std::fabs(plane.y) * extents.y + std::fabs(plane.z) * extents.z;
+		if (distance < -projectedExtent) {
+			return FrustumOverlap::Outside;
+		}
+		if (distance < projectedExtent) {
+			overlap = FrustumOverlap::Intersecting;
+		}
+	}
+	return overlap;
+}
+
+void Bvh::build(std::span<const ObjectBounds> bounds, JobSystem* pJobs) {
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point start = Clock::now();
+
+	uint32_t objectCount = static_cast<uint32_t>(bounds.size());
+	m_primitives.resize(objectCount);
+	for (uint32_t i = 0; i < objectCount; i++) {
+		m_primitives[i] = BvhPrimitive{
+			.min = bounds[i].center - bounds[i].extents,
+			.object = i,
+			.max = bounds[i].center + bounds[i].extents,
+			.padding = 0
+		};
+	}
+	m_primitiveLeaves.resize(objectCount);
+	m_objectPrimitives.resize(objectCount);
+	m_freePairs.clear();
+	m_pairPool.clear();
+	m_stats = {};
+
+	if (objectCount == 0) {
+		m_nodes.clear();
+		m_parents.clear();
+		m_costs.clear();
+		m_builtCosts.clear();
+		m_nodeCount = 0;
+		m_stats.buildMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		return;
+	}
+
+	//A binary tree over n leaves has at most 2n - 1 nodes, pairs start at 1
+	m_nodes.resize(2 * static_cast<size_t>(objectCount));
+	m_parents.resize(m_nodes.size());
+	m_parents[0] = BVH_NO_NODE;
+	m_nodeCount = 1;
+	BvhRange range = computeRange(0, objectCount, pJobs);
+	m_stats.maxDepth = buildNode(0, 0, objectCount, range, 0, pJobs);
+
+	m_nodes.resize(m_nodeCount);
+	m_parents.resize(m_nodeCount);
+	for (uint32_t i = 0; i < objectCount; i++) {
+		m_objectPrimitives[m_primitives[i].object] = i;
+	}
+	m_stats.sahCost = updateCosts();
+	m_builtCosts = m_costs;
+	m_stats.builtSahCost = m_stats.sahCost;
+	m_stats.nodeCount = m_nodeCount;
+	m_stats.buildMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void Bvh::refit(std::span<const ObjectBounds> bounds, std::span<const uint32_t> movedObjects) {
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point start = Clock::now();
+
+	//Every primitive first, so no climb sees a sibling leaf that is about to change and stops too early
+	for (uint32_t object : movedObjects) {
+		BvhPrimitive& primitive = m_primitives[m_objectPrimitives[object]];
+		primitive.min = bounds[object].center - bounds[object].extents;
+		primitive.max = bounds[object].center + bounds[object].extents;
+	}
+	for (uint32_t object : movedObjects) {
+		uint32_t node = m_primitiveLeaves[m_objectPrimitives[object]];
+		while (node != BVH_NO_NODE) {
+			glm::vec3 oldMin = m_nodes[node].min;
+			glm::vec3 oldMax = m_nodes[node].max;
+			refitNode(node);
+			if (m_nodes[node].min == oldMin && m_nodes[node].max == oldMax) {
+				break;
+			}
+			node = m_parents[node];
+		}
+	}
+	m_stats.refitMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void Bvh::refit(std::span<const ObjectBounds> bounds) {
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point start = Clock::now();
+
+	for (BvhPrimitive& primitive : m_primitives) {
+		primitive.min = bounds[primitive.object].center - bounds[primitive.object].extents;
+		primitive.max = bounds[primitive.object].center + bounds[primitive.object].extents;
+	}
+	//Children always sit after their parent
+	for (uint32_t node = m_nodeCount; node-- > 0;) {
+		if (!isDead(m_nodes[node])) {
+			refitNode(node);
+		}
+	}
+	m_stats.refitMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+//Follows the child that lost the most against its built cost down to a subtree small enough to rebuild, so the work per
+//call is bounded however much of the tree has degraded. Its children pairs and the free pairs after it are rebuilt into,
+//which keeps every child after its parent.
+uint32_t Bvh::rebuildDegraded(uint32_t maxObjects) {
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point start = Clock::now();
+	m_stats.rebuiltObjects = 0;
+	if (m_primitives.empty()) {
+		return 0;
+	}
+
+	m_stats.sahCost = updateCosts();
+	m_stats.builtSahCost = relativeToRoot(m_builtCosts[0], m_nodes[0]);
+	if (maxObjects == 0 || m_costs[0] < m_builtCosts[0] * BVH_REBUILD_RATIO) {
+		m_stats.rebuildMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		return 0;
+	}
+
+	uint32_t node = 0;
+	uint32_t depth = 0;
+	uint32_t first = 0;
+	uint32_t objectCount = getSubtreeObjects(node, first);
+	while (objectCount > maxObjects && !isLeaf(m_nodes[node])) {
+		uint32_t left = m_nodes[node].first;
+		float leftLoss = m_costs[left] - m_builtCosts[left];
+		float rightLoss = m_costs[left + 1] - m_builtCosts[left + 1];
+		node = leftLoss >= rightLoss ? left : left + 1;
+		depth++;
+		objectCount = getSubtreeObjects(node, first);
+	}
+
+	m_pairPool.clear();
+	releaseSubtree(node);
+	std::erase_if(m_freePairs, [&](uint32_t pair) {
+		if (pair > node) {
+			m_pairPool.push_back(pair);
+			return true;
+		}
+		return false;
+	});
+	std::sort(m_pairPool.begin(), m_pairPool.end(), std::greater<uint32_t>());
+
+	//The rebuild may need more pairs than the old subtree had, those are appended
+	uint32_t oldNodeCount = m_nodeCount;
+	m_nodes.resize(oldNodeCount + 2 * static_cast<size_t>(objectCount));
+	m_parents.resize(m_nodes.size());
+	BvhRange range = computeRange(first, objectCount, nullptr);
+	m_stats.maxDepth = std::max(m_stats.maxDepth, buildNode(node, first, objectCount, range, depth, nullptr));
+	m_freePairs.insert(m_freePairs.end(), m_pairPool.begin(), m_pairPool.end());
+	m_pairPool.clear();
+	m_nodes.resize(m_nodeCount);
+	m_parents.resize(m_nodeCount);
+	for (uint32_t i = first; i < first + objectCount; i++) {
+		m_objectPrimitives[m_primitives[i].object] = i;
+	}
+	for (uint32_t ancestor = m_parents[node]; ancestor != BVH_NO_NODE; ancestor = m_parents[ancestor]) {
+		refitNode(ancestor);
+	}
+
+	//The new subtree is as good as built, its ancestors only gain what it changed
+	float oldBuiltCost = m_builtCosts[node];
+	m_stats.sahCost = updateCosts();
+	m_builtCosts.resize(m_nodeCount);
+	static thread_local std::vector<uint32_t> stack;
+	stack.assign(1, node);
+	while (!stack.empty()) {
+		uint32_t current = stack.back();
+		stack.pop_back();
+		m_builtCosts[current] = m_costs[current];
+		if (!isLeaf(m_nodes[current])) {
+			stack.push_back(m_nodes[current].first);
+			stack.push_back(m_nodes[current].first + 1);
+		}
+	}
+	float delta = m_costs[node] - oldBuiltCost;
+	for (uint32_t ancestor = m_parents[node]; ancestor != BVH_NO_NODE; ancestor = m_parents[ancestor]) {
+		m_builtCosts[ancestor] += delta;
+	}
+
+	m_stats.builtSahCost = relativeToRoot(m_builtCosts[0], m_nodes[0]);
+	m_stats.nodeCount = m_nodeCount;
+	m_stats.freeNodeCount = static_cast<uint32_t>(m_freePairs.size()) * 2;
+	m_stats.rebuiltObjects = objectCount;
+	m_stats.rebuildMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	return objectCount;
+}
+
+BvhRayHit Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const {
+	BvhRayHit hit{ .object = BVH_NO_NODE, .distance = maxDistance };
+	if (m_primitives.empty()) {
+		return hit;
+	}
+
+	//Axis parallel rays get a huge but finite inverse, so 0 * inverse stays a number inside the slab
+	glm::vec3 inverseDirection;
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		float component = std::fabs(direction[axis]) > 1e-20f ? direction[axis] : std::copysign(1e-20f, direction[axis]);
+		inverseDirection[axis] = 1.0f / component;
+	}
+
+	static thread_local std::vector<uint32_t> stack;
+	stack.assign(1, 0);
+	while (!stack.empty()) {
+		const BvhNode& node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (intersectRay(node.min, node.max, origin, inverseDirection, hit.distance) < 0.0f) {
+			continue;
+		}
+		if (isLeaf(node)) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				float distance = intersectRay(m_primitives[i].min, m_primitives[i].max, origin, inverseDirection, hit.distance);
+				if (distance >= 0.0f && (hit.object == BVH_NO_NODE || distance < hit.distance)) {
+					hit = BvhRayHit{ .object = m_primitives[i].object, .distance = distance };
+				}
+			}
+			continue;
+		}
+
+		//The nearer child goes on top, its hits prune the other one
+		const BvhNode& left = m_nodes[node.first];
+		const BvhNode& right = m_nodes[node.first + 1];
+		float leftDistance = intersectRay(left.min, left.max, origin, inverseDirection, hit.distance);
+		float rightDistance = intersectRay(right.min, right.max, origin, inverseDirection, hit.distance);
+		if (leftDistance >= 0.0f && rightDistance >= 0.0f) {
+			bool leftFirst = leftDistance <= rightDistance;
+			stack.push_back(leftFirst ? node.first + 1 : node.first);
+			stack.push_back(leftFirst ? node.first : node.first + 1);
+		} else if (leftDistance >= 0.0f) {
+			stack.push_back(node.first);
+		} else if (rightDistance >= 0.0f) {
+			stack.push_back(node.first + 1);
+		}
+	}
+	if (hit.object == BVH_NO_NODE) {
+		hit.distance = 0.0f;
+	}
+	return hit;
+}
+
+void Bvh::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const {
+	out.clear();
+	if (m_primitives.empty()) {
+		return;
+	}
+
+	static thread_local std::vector<uint32_t> stack;
+	stack.assign(1, 0);
+	while (!stack.empty()) {
+		uint32_t index = stack.back();
+		stack.pop_back();
+		const BvhNode& node = m_nodes[index];
+		FrustumOverlap overlap = classify(frustum, node.min, node.max);
+		if (overlap == FrustumOverlap::Outside) {
+			continue;
+		}
+		if (overlap == FrustumOverlap::Inside) {
+			uint32_t first = 0;
+			uint32_t count = getSubtreeObjects(index, first);
+			for (uint32_t i = first; i < first + count; i++) {
+				out.push_back(m_primitives[i].object);
+			}
+			continue;
+		}
+		if (isLeaf(node)) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				if (classify(frustum, m_primitives[i].min, m_primitives[i].max) != FrustumOverlap::Outside) {
+					out.push_back(m_primitives[i].object);
+				}
+			}
+			continue;
+		}
+		stack.push_back(node.first);
+		stack.push_back(node.first + 1);
+	}
+}
+
+void Bvh::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const {
+	out.clear();
+	if (m_primitives.empty()) {
+		return;
+	}
+
+	float radiusSquared = radius * radius;
+	static thread_local std::vector<uint32_t> stack;
+	stack.assign(1, 0);
+	while (!stack.empty()) {
+		const BvhNode& node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (distanceSquared(node.min, node.max, center) > radiusSquared) {
+			continue;
+		}
+		if (isLeaf(node)) {
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				if (distanceSquared(m_primitives[i].min, m_primitives[i].max, center) <= radiusSquared) {
+					out.push_back(m_primitives[i].object);
+				}
+			}
+			continue;
+		}
+		stack.push_back(node.first);
+		stack.push_back(node.first + 1);
+	}
+}
+
+//Best first: nodes come off a min heap by distance, and once the nearest remaining node is further than the k-th best
+//object found so far nothing left can improve the result
+void Bvh::queryNearest(const glm::vec3& point, uint32_t k, std::vector<BvhNeighbor>& out) const {
+	out.clear();
+	if (m_primitives.empty() || k == 0) {
+		return;
+	}
+
+	//Squared distances until the end
+	auto nearer = [](const BvhNeighbor& a, const BvhNeighbor& b) { return a.distance < b.distance; };
+	auto further = [](const BvhNeighbor& a, const BvhNeighbor& b) { return a.distance > b.distance; };
+	static thread_local std::vector<BvhNeighbor> nodes;
+	nodes.assign(1, BvhNeighbor{ .object = 0, .distance = distanceSquared(m_nodes[0].min, m_nodes[0].max, point) });
+	while (!nodes.empty()) {
+		std::pop_heap(nodes.begin(), nodes.end(), further);
+		BvhNeighbor candidate = nodes.back();
+		nodes.pop_back();
+		if (out.size() == k && candidate.distance >= out.front().distance) {
+			break;
+		}
+
+		const BvhNode& node = m_nodes[candidate.object];
+		if (!isLeaf(node)) {
+			for (uint32_t child = node.first; child < node.first + 2; child++) {
+				nodes.push_back(BvhNeighbor{ .object = child, .distance = distanceSquared(m_nodes[child].min, m_nodes[child].max, point) });
+				std::push_heap(nodes.begin(), nodes.end(), further);
+			}
+			continue;
+		}
+		for (uint32_t i = node.first; i < node.first + node.count; i++) {
+			float distance = distanceSquared(m_primitives[i].min, m_primitives[i].max, point);
+			if (out.size() < k) {
+				out.push_back(BvhNeighbor{ .object = m_primitives[i].object, .distance = distance });
+				std::push_heap(out.begin(), out.end(), nearer);
+			} else if (distance < out.front().distance) {
+				std::pop_heap(out.begin(), out.end(), nearer);
+				out.back() = BvhNeighbor{ .object = m_primitives[i].object, .distance = distance };
+				std::push_heap(out.begin(), out.end(), nearer);
+			}
+		}
+	}
+
+	std::sort_heap(out.begin(), out.end(), nearer);
+	for (BvhNeighbor& neighbor : out) {
+		neighbor.distance = std::sqrt(neighbor.distance);
+	}
+}
+
+std::span<const BvhNode> Bvh::getNodes() const {
+	return m_nodes;
+}
+
+const BvhStats& Bvh::getStats() const {
+	return m_stats;
+}
+
+//Only partial rebuilds hand out reused pairs, and they run on one thread
+uint32_t Bvh::allocatePair() {
+	if (!m_pairPool.empty()) {
+		uint32_t pair = m_pairPool.back();
+		m_pairPool.pop_back();
+		return pair;
+	}
+	return m_nodeCount.fetch_add(2, std::memory_order_relaxed);
+}
+
+BvhRange Bvh::computeRange(uint32_t first, uint32_t count, JobSystem* pJobs) const {
+	auto computeChunk = [this](uint32_t begin, uint32_t end) {
+		BvhRange range = emptyRange();
+		for (uint32_t i = begin; i < end; i++) {
+			glm::vec3 center = centroid(m_primitives[i]);
+			growRange(range, m_primitives[i].min, m_primitives[i].max, center, center);
+		}
+		return range;
+	};
+	if (pJobs == nullptr || count < BVH_PARALLEL_OBJECTS) {
+		return computeChunk(first, first + count);
+	}
+
+	std::vector<BvhRange> chunks((count + BVH_BIN_BATCH - 1) / BVH_BIN_BATCH);
+	JobCounter counter;
+	pJobs->parallelFor(count, BVH_BIN_BATCH, [&](uint32_t begin, uint32_t end, uint32_t) {
+		chunks[begin / BVH_BIN_BATCH] = computeChunk(first + begin, first + end);
+	}, counter);
+	pJobs->wait(counter);
+	BvhRange range = emptyRange();
+	for (const BvhRange& chunk : chunks) {
+		growRange(range, chunk.min, chunk.max, chunk.centroidMin, chunk.centroidMax);
+	}
+	return range;
+}
+
+//Bins every axis in one pass over the primitives and sweeps each for the cheapest split. Large ranges bin in parallel
+//and hand their left child to another worker, so the top levels spread over the job system and the rest recurse in
+//place.
+uint32_t Bvh::buildNode(uint32_t node, uint32_t first, uint32_t count, const BvhRange& range, uint32_t depth, JobSystem* pJobs) {
+	m_nodes[node].min = range.min;
+	m_nodes[node].max = range.max;
+	auto makeLeaf = [&]() {
+		m_nodes[node].first = first;
+		m_nodes[node].count = count;
+		for (uint32_t i = first; i < first + count; i++) {
+			m_primitiveLeaves[i] = node;
+		}
+		return depth;
+	};
+	if (count == 1) {
+		return makeLeaf();
+	}
+
+	bool parallel = pJobs != nullptr && count >= BVH_PARALLEL_OBJECTS;
+	glm::vec3 centroidExtent = range.centroidMax - range.centroidMin;
+	glm::vec3 scale;
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		scale[axis] = centroidExtent[axis] > 0.0f ? static_cast<float>(BVH_BIN_COUNT) / centroidExtent[axis] : 0.0f;
+	}
+
+	uint32_t bestAxis = 0;
+	uint32_t bestSplit = BVH_BIN_COUNT; //last bin of the left side
+	float bestCost = std::numeric_limits<float>::max();
+	BvhRange leftRange = emptyRange();
+	BvhRange rightRange = emptyRange();
+	uint32_t leftCount = 0;
+	if (centroidExtent.x > 0.0f || centroidExtent.y > 0.0f || centroidExtent.z > 0.0f) {
+		BvhBins bins{};
+		if (parallel) {
+			std::vector<BvhBins> chunks((count + BVH_BIN_BATCH - 1) / BVH_BIN_BATCH);
+			JobCounter counter;
+			pJobs->parallelFor(count, BVH_BIN_BATCH, [&](uint32_t begin, uint32_t end, uint32_t) {
+				binRange(m_primitives.data() + first + begin, end - begin, range, scale, chunks[begin / BVH_BIN_BATCH]);
+			}, counter);
+			pJobs->wait(counter);
+			for (const BvhBins& chunk : chunks) {
+				for (uint32_t axis = 0; axis < 3; axis++) {
+					for (uint32_t bin = 0; bin < BVH_BIN_COUNT; bin++) {
+						growBin(bins[axis][bin], chunk[axis][bin]);
+					}
+				}
+			}
+		} else {
+			binRange(m_primitives.data() + first, count, range, scale, bins);
+		}
+
+		float parentArea = std::max(halfArea(range.min, range.max), std::numeric_limits<float>::min());
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			if (scale[axis] == 0.0f) {
+				continue;
+			}
+			//Right to left sweep first, the left to right one then prices every split
+			std::array<float, BVH_BIN_COUNT> rightAreas{};
+			std::array<uint32_t, BVH_BIN_COUNT> rightCounts{};
+			BvhBin right{};
+			for (uint32_t bin = BVH_BIN_COUNT - 1; bin > 0; bin--) {
+				growBin(right, bins[axis][bin]);
+				rightAreas[bin] = halfArea(right.min, right.max);
+				rightCounts[bin] = right.count;
+			}
+			BvhBin left{};
+			for (uint32_t bin = 0; bin < BVH_BIN_COUNT - 1; bin++) {
+				growBin(left, bins[axis][bin]);
+				if (left.count == 0 || rightCounts[bin + 1] == 0) {
+					continue;
+				}
+				float cost = BVH_TRAVERSAL_COST + (halfArea(left.min, left.max) * static_cast<float>(left.count)
+					+ rightAreas[bin + 1] * static_cast<float>(rightCounts[bin + 1])) / parentArea;
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = bin;
+				}
+			}
+		}
+
+		if (bestSplit != BVH_BIN_COUNT) {
+			for (uint32_t bin = 0; bin < BVH_BIN_COUNT; bin++) {
+				const BvhBin& source = bins[bestAxis][bin];
+				if (source.count != 0) {
+					growRange(bin <= bestSplit ? leftRange : rightRange, source.min, source.max, source.centroidMin, source.centroidMax);
+				}
+			}
+			leftCount = 0;
+			for (uint32_t bin = 0; bin <= bestSplit; bin++) {
+				leftCount += bins[bestAxis][bin].count;
+			}
+		}
+	}
+
+	if (bestSplit == BVH_BIN_COUNT) {
+		//Every centroid in the same spot, no plane separates them and any split is as good as another
+		if (count <= BVH_MAX_LEAF_OBJECTS) {
+			return makeLeaf();
+		}
+		leftCount = count / 2;
+		leftRange = computeRange(first, leftCount, pJobs);
+		rightRange = computeRange(first + leftCount, count - leftCount, pJobs);
+	} else {
+		if (bestCost >= static_cast<float>(count) && count <= BVH_MAX_LEAF_OBJECTS) {
+			return makeLeaf();
+		}
+		//Same bin arithmetic as the binning, so exactly leftCount primitives go left
+		float origin = range.centroidMin[bestAxis];
+		float axisScale = scale[bestAxis];
+		std::partition(m_primitives.begin() + first, m_primitives.begin() + first + count, [&](const BvhPrimitive& primitive) {
+			return binIndex(centroid(primitive)[bestAxis], origin, axisScale) <= bestSplit;
+		});
+	}
+
+	uint32_t child = allocatePair();
+	m_nodes[node].first = child;
+	m_nodes[node].count = 0;
+	m_parents[child] = node;
+	m_parents[child + 1] = node;
+
+	if (parallel) {
+		uint32_t leftDepth = 0;
+		JobCounter counter;
+		pJobs->run([&, child](uint32_t) {
+			leftDepth = buildNode(child, first, leftCount, leftRange, depth + 1, pJobs);
+		}, &counter);
+		uint32_t rightDepth = buildNode(child + 1, first + leftCount, count - leftCount, rightRange, depth + 1, pJobs);
+		pJobs->wait(counter);
+		return std::max(leftDepth, rightDepth);
+	}
+	uint32_t leftDepth = buildNode(child, first, leftCount, leftRange, depth + 1, pJobs);
+	uint32_t rightDepth = buildNode(child + 1, first + leftCount, count - leftCount, rightRange, depth + 1, pJobs);
+	return std::max(leftDepth, rightDepth);
+}
+
+//Hands the node's children pairs to the pool and marks them unused, the node itself is about to be rebuilt
+void Bvh::releaseSubtree(uint32_t node) {
+	if (isLeaf(m_nodes[node])) {
+		return;
+	}
+	uint32_t child = m_nodes[node].first;
+	releaseSubtree(child);
+	releaseSubtree(child + 1);
+	m_nodes[child].count = BVH_DEAD_NODE;
+	m_nodes[child + 1].count = BVH_DEAD_NODE;
+	m_pairPool.push_back(child);
+}
+
+void Bvh::refitNode(uint32_t node) {
+	BvhNode& target = m_nodes[node];
+	if (isLeaf(target)) {
+		glm::vec3 min = m_primitives[target.first].min;
+		glm::vec3 max = m_primitives[target.first].max;
+		for (uint32_t i = target.first + 1; i < target.first + target.count; i++) {
+			min = glm::min(min, m_primitives[i].min);
+			max = glm::max(max, m_primitives[i].max);
+		}
+		target.min = min;
+		target.max = max;
+		return;
+	}
+	const BvhNode& left = m_nodes[target.first];
+	const BvhNode& right = m_nodes[target.first + 1];
+	target.min = glm::min(left.min, right.min);
+	target.max = glm::max(left.max, right.max);
+}
+
+//Cost of a subtree in area units: a leaf tests its objects, an internal node adds one traversal step to its children
+float Bvh::updateCosts() {
+	m_costs.resize(m_nodeCount);
+	uint32_t leafCount = 0;
+	for (uint32_t node = m_nodeCount; node-- > 0;) {
+		const BvhNode& current = m_nodes[node];
+		if (isDead(current)) {
+			continue;
+		}
+		float area = halfArea(current.min, current.max);
+		if (isLeaf(current)) {
+			m_costs[node] = area * static_cast<float>(current.count);
+			leafCount++;
+		} else {
+			m_costs[node] = area * BVH_TRAVERSAL_COST + m_costs[current.first] + m_costs[current.first + 1];
+		}
+	}
+	m_stats.leafCount = leafCount;
+	return relativeToRoot(m_costs[0], m_nodes[0]);
+}
+
+//A subtree owns a contiguous range of primitives, from its leftmost leaf's first to its rightmost leaf's last
+uint32_t Bvh::getSubtreeObjects(uint32_t node, uint32_t& first) const {
+	uint32_t leftmost = node;
+	while (!isLeaf(m_nodes[leftmost])) {
+		leftmost = m_nodes[leftmost].first;
+	}
+	uint32_t rightmost = node;
+	while (!isLeaf(m_nodes[rightmost])) {
+		rightmost = m_nodes[rightmost].first + 1;
+	}
+	first = m_nodes[leftmost].first;
+	return m_nodes[rightmost].first + m_nodes[rightmost].count - first;
+}
\ No newline at end of file
@@ -1,11 +1,12 @@
 #include "Camera.h"
+#include "TransformHierarchy.h"
 
+//The camera only rotates and translates, so its inverse is the transposed rotation applied to the negated position
 glm::mat4 Camera::getViewMatrix() {
-	glm::mat4 transpose = glm::translate(glm::mat4(1.0), m_pos);
-	glm::mat4 pitchRotate = glm::rotate(glm::mat4(1.0), m_pitch, glm::vec3(1,0,0));
-	glm::mat4 yawRotate = glm::rotate(glm::mat4(1.0), m_yaw, glm::vec3(0, 1, 0));
+	glm::mat4 cameraToWorld = glm::rotate(glm::rotate(glm::mat4(1.0f), m_pitch, glm::vec3(1.0f, 0.0f, 0.0f)), m_yaw, glm::vec3(0.0f, 1.0f, 0.0f));
+	cameraToWorld[3] = glm::vec4(m_pos, 1.0f);
 
-	return glm::inverse(transpose * pitchRotate * yawRotate);
+	return Transforms::rigidInverse(cameraToWorld);
 }
 
 CameraProjectionData Camera::fetchGPUData(float viewPortWidth, float viewPortHeight) {
@@ -0,0 +1,325 @@
+#include "Culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CULLING_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CULLING_TARGET_AVX2
+#else
+#define CULLING_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+//The SIMD paths read ObjectBounds as a flat float array: center.xyz and radius in the first four floats, extents in the
+//next three
+static_assert(sizeof(ObjectBounds) == 7 * sizeof(float), "ObjectBounds must stay tightly packed for the SIMD culling paths");
+constexpr size_t BOUNDS_FLOATS = sizeof(ObjectBounds) / sizeof(float);
+
+Frustum Culling::extractFrustum(const glm::mat4& viewProjection) {
+	//Gribb-Hartmann: each plane is a sum or difference of the w row and one other row of the matrix
+	auto row = [&viewProjection](int i) {
+		return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	};
+	glm::vec4 r0 = row(0);
+	glm::vec4 r1 = row(1);
+	glm::vec4 r2 = row(2);
+	glm::vec4 r3 = row(3);
+
+	Frustum frustum{};
+	frustum.planes[0] = r3 + r0; //left
+	frustum.planes[1] = r3 - r0; //right
+	frustum.planes[2] = r3 + r1; //bottom
+	frustum.planes[3] = r3 - r1; //top
+#ifdef GLM_FORCE_DEPTH_ZERO_TO_ONE
+	frustum.planes[4] = r2; //near
+#else
+	frustum.planes[4] = r3 + r2; //near, glm defaults to a [-1, 1] clip depth
+#endif
+	frustum.planes[5] = r3 - r2; //far
+
+	for (glm::vec4& plane : frustum.planes) {
+		float length = glm::length(glm::vec3(plane));
+		if (length > 0.0f) {
+			plane /= length;
+		}
+	}
+	return frustum;
+}
+
+Frustum Culling::extractFrustum(const CameraProjectionData& data) {
+	return extractFrustum(data.projectionMatrix * data.viewMatrix);
+}
+
+//The scalar tests spell out the same operation order as the SIMD paths so all paths agree bit for bit
+bool Culling::testSphere(const Frustum& frustum, const ObjectBounds& bounds) {
+	for (const glm::vec4& plane : frustum.planes) {
+		float distance = plane.x * bounds.center.x + plane.y * bounds.center.y + plane.z * bounds.center.z + plane.w;
+		if (distance < -bounds.radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Culling::testAabb(const Frustum& frustum, const ObjectBounds& bounds) {
+	for (const glm::vec4& plane : frustum.planes) {
+		float distance = plane.x * bounds.center.x + plane.y * bounds.center.y + plane.z * bounds.center.z + plane.w;
+		float projectedExtent = std::fabs(plane.x) * bounds.extents.x + std::fabs(plane.y) * bounds.extents.y + std::fabs(plane.z) * bounds.extents.z;
+		if (distance < -projectedExtent) {
+			return false;
+		}
+	}
+	return true;
+}
+
+uint32_t Culling::cullScalar(const Frustum& frustum, std::span<const ObjectBounds> bounds, CullShape shape, uint32_t firstIndex, uint32_t* pOut) {
+	uint32_t visibleCount = 0;
+	for (size_t i = 0; i < bounds.size(); i++) {
+		bool visible = shape == CullShape::Sphere ? testSphere(frustum, bounds[i]) : testAabb(frustum, bounds[i]);
+		//Write unconditionally and advance on visibility, avoids a hard to predict branch
+		pOut[visibleCount] = firstIndex + static_cast<uint32_t>(i);
+		visibleCount += visible;
+	}
+	return visibleCount;
+}
+
+#ifdef CULLING_X86
+static uint32_t writeVisibleIndices(uint32_t mask, uint32_t baseIndex, uint32_t* pOut) {
+	uint32_t written = 0;
+	while (mask != 0) {
+#ifdef _MSC_VER
+		unsigned long bit;
+		_BitScanForward(&bit, mask);
+#else
+		uint32_t bit = static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+		pOut[written++] = baseIndex + bit;
+		mask &= mask - 1;
+	}
+	return written;
+}
+
+uint32_t Culling::cullSse(const Frustum& frustum, std::span<const ObjectBounds> bounds, CullShape shape, uint32_t firstIndex, uint32_t* pOut) {
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++) {
+		planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+		absX[p] = _mm_set1_ps(std::fabs(frustum.planes[p].x));
+		absY[p] = _mm_set1_ps(std::fabs(frustum.planes[p].y));
+		absZ[p] = _mm_set1_ps(std::fabs(frustum.planes[p].z));
+	}
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	const float* pBase = reinterpret_cast<const float*>(bounds.data());
+	size_t count = bounds.size();
+	uint32_t visibleCount = 0;
+	size_t i = 0;
+	//The extents load reads one float past the object, so the last object is always left to the scalar tail
+	for (; i + 4 < count; i += 4) {
+		const float* pBatch = pBase + i * BOUNDS_FLOATS;
+		__m128 centerX = _mm_loadu_ps(pBatch);
+		__m128 centerY = _mm_loadu_ps(pBatch + BOUNDS_FLOATS);
+		__m128 centerZ = _mm_loadu_ps(pBatch + 2 * BOUNDS_FLOATS);
+		__m128 radius = _mm_loadu_ps(pBatch + 3 * BOUNDS_FLOATS);
+		_MM_TRANSPOSE4_PS(centerX, centerY, centerZ, radius);
+
+		__m128 extentX, extentY, extentZ;
+		__m128 negRadius = _mm_xor_ps(radius, signMask);
+		if (shape == CullShape::Aabb) {
+			extentX = _mm_loadu_ps(pBatch + 4);
+			extentY = _mm_loadu_ps(pBatch + BOUNDS_FLOATS + 4);
+			extentZ = _mm_loadu_ps(pBatch + 2 * BOUNDS_FLOATS + 4);
+			__m128 unused = _mm_loadu_ps(pBatch + 3 * BOUNDS_FLOATS + 4);
+			_MM_TRANSPOSE4_PS(extentX, extentY, extentZ, unused);
+		}
+
+		__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], centerX), _mm_mul_ps(planeY[p], centerY)), _mm_mul_ps(planeZ[p], centerZ)), planeW[p]);
+			__m128 threshold = negRadius;
+			if (shape == CullShape::Aabb) {
+				__m128 projectedExtent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], extentX), _mm_mul_ps(absY[p], extentY)), _mm_mul_ps(absZ[p], extentZ));
+				threshold = _mm_xor_ps(projectedExtent, signMask);
+			}
+			visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, threshold));
+		}
+		visibleCount += writeVisibleIndices(static_cast<uint32_t>(_mm_movemask_ps(visible)), firstIndex + static_cast<uint32_t>(i), pOut + visibleCount);
+	}
+	return visibleCount + cullScalar(frustum, bounds.subspan(i), shape, firstIndex + static_cast<uint32_t>(i), pOut + visibleCount);
+}
+
+//Loads four consecutive floats of objects a..a+3 into the low lane and b..b+3 into the high lane, then transposes
+//within each lane so that element j of each output belongs to object j of the batch
+CULLING_TARGET_AVX2 static __m256 loadPair(const float* pBatch, size_t offset, size_t low, size_t high) {
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pBatch + low * BOUNDS_FLOATS + offset)), _mm_loadu_ps(pBatch + high * BOUNDS_FLOATS + offset), 1);
+}
+
+CULLING_TARGET_AVX2 static void loadTransposed8(const float* pBatch, size_t offset, __m256& x, __m256& y, __m256& z, __m256& w) {
+	__m256 t0 = loadPair(pBatch, offset, 0, 4);
+	__m256 t1 = loadPair(pBatch, offset, 1, 5);
+	__m256 t2 = loadPair(pBatch, offset, 2, 6);
+	__m256 t3 = loadPair(pBatch, offset, 3, 7);
+	__m256 u0 = _mm256_unpacklo_ps(t0, t1);
+	__m256 u1 = _mm256_unpackhi_ps(t0, t1);
+	__m256 u2 = _mm256_unpacklo_ps(t2, t3);
+	__m256 u3 = _mm256_unpackhi_ps(t2, t3);
+	x = _mm256_shuffle_ps(u0, u2, _MM_SHUFFLE(1, 0, 1, 0));
+	y = _mm256_shuffle_ps(u0, u2, _MM_SHUFFLE(3, 2, 3, 2));
+	z = _mm256_shuffle_ps(u1, u3, _MM_SHUFFLE(1, 0, 1, 0));
+	w = _mm256_shuffle_ps(u1, u3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+CULLING_TARGET_AVX2 static uint32_t cullAvx2Impl(const Frustum& frustum, std::span<const ObjectBounds> bounds, CullShape shape, uint32_t firstIndex, uint32_t* pOut) {
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++) {
+		planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+		absX[p] = _mm256_set1_ps(std::fabs(frustum.planes[p].x));
+		absY[p] = _mm256_set1_ps(std::fabs(frustum.planes[p].y));
+		absZ[p] = _mm256_set1_ps(std::fabs(frustum.planes[p].z));
+	}
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+	const float* pBase = reinterpret_cast<const float*>(bounds.data());
+	size_t count = bounds.size();
+	uint32_t visibleCount = 0;
+	size_t i = 0;
+	for (; i + 8 < count; i += 8) {
+		const float* pBatch = pBase + i * BOUNDS_FLOATS;
+		__m256 centerX, centerY, centerZ, radius;
+		loadTransposed8(pBatch, 0, centerX, centerY, centerZ, radius);
+
+		__m256 extentX, extentY, extentZ, unused;
+		__m256 negRadius = _mm256_xor_ps(radius, signMask);
+		if (shape == CullShape::Aabb) {
+			loadTransposed8(pBatch, 4, extentX, extentY, extentZ, unused);
+		}
+
+		__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], centerX), _mm256_mul_ps(planeY[p], centerY)), _mm256_mul_ps(planeZ[p], centerZ)), planeW[p]);
+			__m256 threshold = negRadius;
+			if (shape == CullShape::Aabb) {
+				__m256 projectedExtent = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], extentX), _mm256_mul_ps(absY[p], extentY)), _mm256_mul_ps(absZ[p], extentZ));
+				threshold = _mm256_xor_ps(projectedExtent, signMask);
+			}
+			visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, threshold, _CMP_GE_OQ));
+		}
+		visibleCount += writeVisibleIndices(static_cast<uint32_t>(_mm256_movemask_ps(visible)), firstIndex + static_cast<uint32_t>(i), pOut + visibleCount);
+	}
+	return visibleCount + Culling::cullScalar(frustum, bounds.subspan(i), shape, firstIndex + static_cast<uint32_t>(i), pOut + visibleCount);
+}
+
+uint32_t Culling::cullAvx2(const Frustum& frustum, std::span<const ObjectBounds> bounds, CullShape shape, uint32_t firstIndex, uint32_t* pOut) {
+	if (!hasAvx2()) {
+		return cullSse(frustum, bounds, shape, firstIndex, pOut);
+	}
+	return cullAvx2Impl(frustum, bounds, shape, firstIndex, pOut);
+}
+
+bool Culling::hasSse() {
+	return true; //baseline on every x86-64 target
+}
+
+bool Culling::hasAvx2() {
+	static const bool supported = [] {
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2") != 0;
+#endif
+	}();
+	return supported;
+}
+#else
+uint32_t Culling::cullSse(const Frustum& frustum, std::span<const ObjectBounds> bounds, CullShape shape, uint32_t firstIndex, uint32_t* pOut) {
+	return cullScalar(frustum, bounds, shape, firstIndex, pOut);
+}
+
+uint32_t Culling::cullAvx2(const Frustum& frustum, std::span<const ObjectBounds> bounds, CullShape shape, uint32_t firstIndex, uint32_t* pOut) {
+	return cullScalar(frustum, bounds, shape, firstIndex, pOut);
+}
+
+bool Culling::hasSse() {
+	return false;
+}
+
+bool Culling::hasAvx2() {
+	return false;
+}
+#endif
+
+CullPath Culling::resolvePath(CullPath path) {
+	if (path == CullPath::Auto) {
+		path = CullPath::Avx2;
+	}
+	if (path == CullPath::Avx2 && !hasAvx2()) {
+		path = CullPath::Sse;
+	}
+	if (path == CullPath::Sse && !hasSse()) {
+		path = CullPath::Scalar;
+	}
+	return path;
+}
+
+FrustumCuller::FrustumCuller(JobSystem& jobs) : m_jobs{ jobs } {}
+
+std::span<const uint32_t> FrustumCuller::cull(const Frustum& frustum, std::span<const ObjectBounds> bounds, CullShape shape, CullPath path) {
+	using CullFunction = uint32_t(*)(const Frustum&, std::span<const ObjectBounds>, CullShape, uint32_t, uint32_t*);
+	CullFunction cullChunk = Culling::cullScalar;
+	switch (Culling::resolvePath(path)) {
+	case CullPath::Avx2: cullChunk = Culling::cullAvx2; break;
+	case CullPath::Sse: cullChunk = Culling::cullSse; break;
+	default: break;
+	}
+
+	uint32_t objectCount = static_cast<uint32_t>(bounds.size());
+	m_visible.resize(objectCount);
+	if (objectCount <= CULL_CHUNK_SIZE || m_jobs.getWorkerCount() == 1) {
+		uint32_t visibleCount = cullChunk(frustum, bounds, shape, 0, m_visible.data());
+		return std::span<const uint32_t>{ m_visible.data(), visibleCount };
+	}
+
+	//Pass 1: every chunk culls into its own region of the scratch buffer
+	uint32_t chunkCount = (objectCount + CULL_CHUNK_SIZE - 1) / CULL_CHUNK_SIZE;
+	m_scratch.resize(objectCount);
+	m_chunkCounts.resize(chunkCount);
+	m_chunkOffsets.resize(chunkCount);
+	JobCounter cullDone;
+	m_jobs.parallelFor(chunkCount, 1, [&](uint32_t chunk, uint32_t, uint32_t) {
+		uint32_t first = chunk * CULL_CHUNK_SIZE;
+		uint32_t count = std::min(CULL_CHUNK_SIZE, objectCount - first);
+		m_chunkCounts[chunk] = cullChunk(frustum, bounds.subspan(first, count), shape, first, m_scratch.data() + first);
+	}, cullDone);
+	m_jobs.wait(cullDone);
+
+	//Pass 2: prefix sum the chunk counts and pack the chunks into one ascending list
+	uint32_t visibleCount = 0;
+	for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+		m_chunkOffsets[chunk] = visibleCount;
+		visibleCount += m_chunkCounts[chunk];
+	}
+	JobCounter packDone;
+	m_jobs.parallelFor(chunkCount, 1, [&](uint32_t chunk, uint32_t, uint32_t) {
+		const uint32_t* pSource = m_scratch.data() + static_cast<size_t>(chunk) * CULL_CHUNK_SIZE;
+		std::copy(pSource, pSource + m_chunkCounts[chunk], m_visible.data() + m_chunkOffsets[chunk]);
+	}, packDone);
+	m_jobs.wait(packDone);
+	return std::span<const uint32_t>{ m_visible.data(), visibleCount };
+}
\ No newline at end of file
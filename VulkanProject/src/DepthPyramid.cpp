@@ -0,0 +1,134 @@
+#include "DepthPyramid.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+constexpr uint32_t BINDING_PYRAMID_SOURCE = 0;
+constexpr uint32_t BINDING_PYRAMID_DESTINATION = 1;
+
+void DepthPyramid::init(VkDevice device, DescriptorAllocator& descriptors) {
+	m_device = device;
+	m_pDescriptors = &descriptors;
+
+	VkDescriptorSetLayoutBinding bindings[]{
+		{ .binding = BINDING_PYRAMID_SOURCE, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+		{ .binding = BINDING_PYRAMID_DESTINATION, .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT }
+	};
+	m_setLayout = m_pDescriptors->getLayout(bindings);
+
+	VkPushConstantRange pushConstantRange{
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = sizeof(DepthPyramidPushConstants)
+	};
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 1,
+		.pSetLayouts = &m_setLayout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &pushConstantRange
+	};
+	if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create depth pyramid Pipeline Layout");
+	}
+
+	VkSamplerCreateInfo samplerInfo{
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter = VK_FILTER_NEAREST,
+		.minFilter = VK_FILTER_NEAREST,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+		.minLod = 0.0f,
+		.maxLod = VK_LOD_CLAMP_NONE
+	};
+	if (vkCreateSampler(m_device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create depth pyramid Sampler");
+	}
+}
+
+void DepthPyramid::createPipeline(VkShaderModule pyramidModule, VkPipelineCache pipelineCache) {
+	VkComputePipelineCreateInfo pipelineInfo{
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.stage = VkPipelineShaderStageCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module = pyramidModule,
+			.pName = "main"
+		},
+		.layout = m_pipelineLayout
+	};
+	if (vkCreateComputePipelines(m_device, pipelineCache, 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create depth pyramid Pipeline");
+	}
+}
+
+void DepthPyramid::destroy() {
+	if (m_pipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(m_device, m_pipeline, nullptr);
+	}
+	if (m_pipelineLayout != VK_NULL_HANDLE) {
+		vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+	}
+	if (m_sampler != VK_NULL_HANDLE) {
+		vkDestroySampler(m_device, m_sampler, nullptr);
+	}
+}
+
+void DepthPyramid::record(VkCommandBuffer cmdBuffer, const RenderGraph& graph, RenderGraphImage depth, RenderGraphImage pyramid) {
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+
+	VkExtent2D sourceExtent = graph.getExtent(depth);
+	VkExtent2D levelExtent = graph.getExtent(pyramid);
+	uint32_t levelCount = graph.getMipLevels(pyramid);
+	for (uint32_t level = 0; level < levelCount; level++) {
+		//Each level reads the one before it, which the previous dispatch has to have finished writing
+		if (level > 0) {
+			VkMemoryBarrier levelBarrier{
+				.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+				.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+				.dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+			};
+			vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+				1, &levelBarrier, 0, nullptr, 0, nullptr);
+		}
+
+		VkDescriptorImageInfo sourceInfo{
+			.sampler = m_sampler,
+			.imageView = level == 0 ? graph.getView(depth) : graph.getMipView(pyramid, level - 1),
+			.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL
+		};
+		VkDescriptorImageInfo destinationInfo{
+			.sampler = VK_NULL_HANDLE,
+			.imageView = graph.getMipView(pyramid, level),
+			.imageLayout = VK_IMAGE_LAYOUT_GENERAL
+		};
+		VkDescriptorSet descSet = m_pDescriptors->allocateTransient(m_setLayout);
+		VkWriteDescriptorSet writes[]{
+			{ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = descSet, .dstBinding = BINDING_PYRAMID_SOURCE, .descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .pImageInfo = &sourceInfo },
+			{ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = descSet, .dstBinding = BINDING_PYRAMID_DESTINATION, .descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .pImageInfo = &destinationInfo }
+		};
+		vkUpdateDescriptorSets(m_device, 2, writes, 0, nullptr);
+
+		DepthPyramidPushConstants constants{
+			.sourceSize = glm::uvec2(sourceExtent.width, sourceExtent.height),
+			.destinationSize = glm::uvec2(levelExtent.width, levelExtent.height)
+		};
+		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &descSet, 0, nullptr);
+		vkCmdPushConstants(cmdBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthPyramidPushConstants), &constants);
+		vkCmdDispatch(cmdBuffer, (levelExtent.width + DEPTH_PYRAMID_WORKGROUP_SIZE - 1) / DEPTH_PYRAMID_WORKGROUP_SIZE,
+			(levelExtent.height + DEPTH_PYRAMID_WORKGROUP_SIZE - 1) / DEPTH_PYRAMID_WORKGROUP_SIZE, 1);
+
+		sourceExtent = levelExtent;
+		levelExtent = VkExtent2D{ .width = std::max(levelExtent.width / 2, 1u), .height = std::max(levelExtent.height / 2, 1u) };
+	}
+}
+
+VkSampler DepthPyramid::getSampler() const {
+	return m_sampler;
+}
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	//Non-dispatchable handles are pointers on 64 bit targets and integers on 32 bit ones
+	template<typename Handle>
+	uint64_t handleBits(Handle handle) {
+		uint64_t bits = 0;
+		std::memcpy(&bits, &handle, sizeof(handle));
+		return bits;
+	}
+
+	bool sameLayoutBinding(const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+		return a.binding == b.binding && a.descriptorType == b.descriptorType && a.descriptorCount == b.descriptorCount
+			&& a.stageFlags == b.stageFlags && a.pImmutableSamplers == b.pImmutableSamplers;
+	}
+
+	bool isImageDescriptor(VkDescriptorType type) {
+		return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE
+			|| type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE || type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+	}
+
+	bool sameBinding(const DescriptorBinding& a, const DescriptorBinding& b) {
+		return a.binding == b.binding && a.type == b.type
+			&& a.bufferInfo.buffer == b.bufferInfo.buffer && a.bufferInfo.offset == b.bufferInfo.offset && a.bufferInfo.range == b.bufferInfo.range
+			&& a.imageInfo.sampler == b.imageInfo.sampler && a.imageInfo.imageView == b.imageInfo.imageView && a.imageInfo.imageLayout == b.imageInfo.imageLayout;
+	}
+
+	uint64_t hashBinding(const DescriptorBinding& binding, uint64_t hash) {
+		hash = hashCombine(hash, (static_cast<uint64_t>(binding.binding) << 32) | static_cast<uint64_t>(binding.type));
+		hash = hashCombine(hash, handleBits(binding.bufferInfo.buffer));
+		hash = hashCombine(hash, binding.bufferInfo.offset);
+		hash = hashCombine(hash, binding.bufferInfo.range);
+		hash = hashCombine(hash, handleBits(binding.imageInfo.sampler));
+		hash = hashCombine(hash, handleBits(binding.imageInfo.imageView));
+		return hashCombine(hash, static_cast<uint64_t>(binding.imageInfo.imageLayout));
+	}
+}
+
+void DescriptorAllocator::init(VkDevice device, uint32_t frameCount) {
+	m_device = device;
+	m_transientChains = std::vector<PoolChain>(frameCount);
+	m_persistentChain.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+}
+
+void DescriptorAllocator::destroy() {
+	for (PoolChain& chain : m_transientChains) {
+		for (VkDescriptorPool pool : chain.pools) {
+			vkDestroyDescriptorPool(m_device, pool, nullptr);
+		}
+	}
+	for (VkDescriptorPool pool : m_persistentChain.pools) {
+		vkDestroyDescriptorPool(m_device, pool, nullptr);
+	}
+	for (const auto& [hash, layouts] : m_layouts) {
+		for (const CachedLayout& cached : layouts) {
+			vkDestroyDescriptorSetLayout(m_device, cached.layout, nullptr);
+		}
+	}
+	m_transientChains.clear();
+	m_persistentChain.pools.clear();
+	m_persistentChain.partial.clear();
+	m_layouts.clear();
+	m_persistentSets.clear();
+}
+
+VkDescriptorSetLayout DescriptorAllocator::getLayout(std::span<const VkDescriptorSetLayoutBinding> bindings) {
+	//Binding order does not change the layout, so hash and compare in binding index order
+	std::vector<VkDescriptorSetLayoutBinding> sorted(bindings.begin(), bindings.end());
+	std::sort(sorted.begin(), sorted.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+		return a.binding < b.binding;
+	});
+
+	uint64_t hash = FNV_OFFSET_BASIS;
+	for (const VkDescriptorSetLayoutBinding& binding : sorted) {
+		hash = hashCombine(hash, (static_cast<uint64_t>(binding.binding) << 32) | static_cast<uint64_t>(binding.descriptorType));
+		hash = hashCombine(hash, (static_cast<uint64_t>(binding.descriptorCount) << 32) | static_cast<uint64_t>(binding.stageFlags));
+		hash = hashCombine(hash, handleBits(binding.pImmutableSamplers));
+	}
+
+	std::vector<CachedLayout>& candidates = m_layouts[hash];
+	for (const CachedLayout& cached : candidates) {
+		if (std::equal(cached.bindings.begin(), cached.bindings.end(), sorted.begin(), sorted.end(), sameLayoutBinding)) {
+			m_stats.layoutCacheHits++;
+			return cached.layout;
+		}
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.bindingCount = static_cast<uint32_t>(sorted.size()),
+		.pBindings = sorted.data()
+	};
+	VkDescriptorSetLayout layout;
+	if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Descriptor Set Layout");
+	}
+	candidates.push_back(CachedLayout{ std::move(sorted), layout });
+	m_stats.layoutsCreated++;
+	return layout;
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(const PoolChain& chain) {
+	uint32_t maxSets = std::min(DESCRIPTOR_POOL_INITIAL_SETS << std::min<size_t>(chain.pools.size(), 31), DESCRIPTOR_POOL_MAX_SETS);
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (const DescriptorPoolRatio& ratio : DESCRIPTOR_POOL_RATIOS) {
+		poolSizes.push_back(VkDescriptorPoolSize{
+			.type = ratio.type,
+			.descriptorCount = static_cast<uint32_t>(ratio.perSet * static_cast<float>(maxSets))
+		});
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.flags = chain.flags,
+		.maxSets = maxSets,
+		.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+		.pPoolSizes = poolSizes.data()
+	};
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Descriptor Pool");
+	}
+	m_stats.poolsCreated++;
+	return pool;
+}
+
+VkResult DescriptorAllocator::tryAllocate(VkDescriptorPool pool, VkDescriptorSetLayout layout, VkDescriptorSet& outSet) {
+	VkDescriptorSetAllocateInfo setInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.descriptorPool = pool,
+		.descriptorSetCount = 1,
+		.pSetLayouts = &layout
+	};
+	VkResult result = vkAllocateDescriptorSets(m_device, &setInfo, &outSet);
+	if (result != VK_SUCCESS && result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+		throw std::runtime_error("Failed to allocate Descriptor Set");
+	}
+	return result;
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(PoolChain& chain, VkDescriptorSetLayout layout, VkDescriptorPool& outPool) {
+	VkDescriptorSet set;
+	for (;;) {
+		bool freshPool = chain.current == chain.pools.size();
+		if (freshPool) {
+			chain.pools.push_back(createPool(chain));
+		}
+
+		if (tryAllocate(chain.pools[chain.current], layout, set) == VK_SUCCESS) {
+			outPool = chain.pools[chain.current];
+			return set;
+		}
+		if (freshPool) {
+			throw std::runtime_error("Failed to allocate Descriptor Set");
+		}
+
+		//Refill pools that regained space before moving on, the ones that are full again leave the list
+		while (!chain.partial.empty()) {
+			VkDescriptorPool pool = chain.partial.back();
+			if (tryAllocate(pool, layout, set) == VK_SUCCESS) {
+				m_stats.poolReuses++;
+				outPool = pool;
+				return set;
+			}
+			chain.partial.pop_back();
+		}
+		chain.current++;
+		m_stats.poolGrowthEvents++;
+	}
+}
+
+void DescriptorAllocator::beginFrame(uint32_t frameIndex) {
+	m_currentFrame = frameIndex;
+	PoolChain& chain = m_transientChains.at(frameIndex);
+	for (VkDescriptorPool pool : chain.pools) {
+		vkResetDescriptorPool(m_device, pool, 0);
+	}
+	chain.current = 0;
+	m_stats.transientResets++;
+}
+
+VkDescriptorSet DescriptorAllocator::allocateTransient(VkDescriptorSetLayout layout) {
+	VkDescriptorPool pool;
+	m_stats.transientAllocations++;
+	return allocate(m_transientChains.at(m_currentFrame), layout, pool);
+}
+
+VkDescriptorSet DescriptorAllocator::getPersistentSet(VkDescriptorSetLayout layout, std::span<const DescriptorBinding> bindings) {
+	uint64_t hash = hashCombine(FNV_OFFSET_BASIS, handleBits(layout));
+	for (const DescriptorBinding& binding : bindings) {
+		hash = hashBinding(binding, hash);
+	}
+
+	std::vector<CachedSet>& candidates = m_persistentSets[hash];
+	for (const CachedSet& cached : candidates) {
+		if (cached.layout == layout && std::equal(cached.bindings.begin(), cached.bindings.end(), bindings.begin(), bindings.end(), sameBinding)) {
+			m_stats.persistentCacheHits++;
+			return cached.set;
+		}
+	}
+
+	CachedSet cached{ .layout = layout, .bindings = std::vector<DescriptorBinding>(bindings.begin(), bindings.end()) };
+	cached.set = allocate(m_persistentChain, layout, cached.pool);
+	m_stats.persistentAllocations++;
+
+	std::vector<VkWriteDescriptorSet> writes;
+	for (const DescriptorBinding& binding : cached.bindings) {
+		bool image = isImageDescriptor(binding.type);
+		writes.push_back(VkWriteDescriptorSet{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = cached.set,
+			.dstBinding = binding.binding,
+			.descriptorCount = 1,
+			.descriptorType = binding.type,
+			.pImageInfo = image ? &binding.imageInfo : nullptr,
+			.pBufferInfo = image ? nullptr : &binding.bufferInfo
+		});
+	}
+	vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+	candidates.push_back(std::move(cached));
+	return candidates.back().set;
+}
+
+template<typename Predicate>
+void DescriptorAllocator::releaseSets(Predicate references) {
+	for (auto& [hash, candidates] : m_persistentSets) {
+		auto released = std::remove_if(candidates.begin(), candidates.end(), [&](const CachedSet& cached) {
+			if (std::none_of(cached.bindings.begin(), cached.bindings.end(), references)) {
+				return false;
+			}
+			vkFreeDescriptorSets(m_device, cached.pool, 1, &cached.set);
+			m_stats.persistentReleases++;
+			PoolChain& chain = m_persistentChain;
+			bool currentPool = chain.current < chain.pools.size() && cached.pool == chain.pools[chain.current];
+			if (!currentPool && std::find(chain.partial.begin(), chain.partial.end(), cached.pool) == chain.partial.end()) {
+				chain.partial.push_back(cached.pool);
+			}
+			return true;
+		});
+		candidates.erase(released, candidates.end());
+	}
+}
+
+void DescriptorAllocator::releaseSetsUsing(VkBuffer buffer) {
+	releaseSets([buffer](const DescriptorBinding& binding) { return binding.bufferInfo.buffer == buffer; });
+}
+
+void DescriptorAllocator::releaseSetsUsing(VkImageView imageView) {
+	releaseSets([imageView](const DescriptorBinding& binding) { return binding.imageInfo.imageView == imageView; });
+}
+
+const DescriptorStats& DescriptorAllocator::getStats() const {
+	return m_stats;
+}
\ No newline at end of file
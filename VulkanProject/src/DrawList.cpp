@@ -0,0 +1,142 @@
+#include "DrawList.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+constexpr uint32_t DRAW_KEY_MESH_SHIFT = DRAW_KEY_DEPTH_BITS;
+constexpr uint32_t DRAW_KEY_SET_SHIFT = DRAW_KEY_MESH_SHIFT + DRAW_KEY_MESH_BITS;
+constexpr uint32_t DRAW_KEY_PIPELINE_SHIFT = DRAW_KEY_SET_SHIFT + DRAW_KEY_SET_BITS;
+constexpr uint32_t DRAW_SORT_BUCKETS = 1u << DRAW_SORT_RADIX_BITS;
+constexpr uint32_t DRAW_SORT_DIGITS = 64 / DRAW_SORT_RADIX_BITS;
+
+static_assert(DRAW_KEY_PIPELINE_SHIFT + DRAW_KEY_PIPELINE_BITS == 64, "Draw key fields must fill 64 bits");
+
+uint64_t DrawKeys::encode(uint32_t pipeline, uint32_t descriptorSet, uint32_t mesh, uint32_t depthBucket) {
+	return static_cast<uint64_t>(pipeline & ((1u << DRAW_KEY_PIPELINE_BITS) - 1)) << DRAW_KEY_PIPELINE_SHIFT
+		| static_cast<uint64_t>(descriptorSet & ((1u << DRAW_KEY_SET_BITS) - 1)) << DRAW_KEY_SET_SHIFT
+		| static_cast<uint64_t>(mesh & DRAW_KEY_MAX_MESH) << DRAW_KEY_MESH_SHIFT
+		| static_cast<uint64_t>(depthBucket & ((1u << DRAW_KEY_DEPTH_BITS) - 1));
+}
+
+uint32_t DrawKeys::pipeline(uint64_t key) {
+	return static_cast<uint32_t>(key >> DRAW_KEY_PIPELINE_SHIFT);
+}
+
+uint32_t DrawKeys::descriptorSet(uint64_t key) {
+	return static_cast<uint32_t>(key >> DRAW_KEY_SET_SHIFT) & ((1u << DRAW_KEY_SET_BITS) - 1);
+}
+
+uint32_t DrawKeys::mesh(uint64_t key) {
+	return static_cast<uint32_t>(key >> DRAW_KEY_MESH_SHIFT) & DRAW_KEY_MAX_MESH;
+}
+
+uint64_t DrawKeys::state(uint64_t key) {
+	return key >> DRAW_KEY_DEPTH_BITS;
+}
+
+uint32_t DrawKeys::depthBucket(float distance, float maxDistance) {
+	constexpr uint32_t maxBucket = (1u << DRAW_KEY_DEPTH_BITS) - 1;
+	float normalized = std::clamp(distance / maxDistance, 0.0f, 1.0f);
+	return static_cast<uint32_t>(normalized * static_cast<float>(maxBucket));
+}
+
+//Every digit's histogram comes out of one read of the keys. A digit all keys share would move nothing, so its pass is
+//skipped. With a single pipeline and descriptor set only the depth digits and the low mesh digit are sorted.
+uint32_t DrawKeys::radixSort(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch) {
+	size_t count = items.size();
+	scratch.resize(count);
+	if (count < 2) {
+		return 0;
+	}
+
+	std::array<uint32_t, DRAW_SORT_DIGITS * DRAW_SORT_BUCKETS> histograms{};
+	for (const DrawItem& item : items) {
+		for (uint32_t digit = 0; digit < DRAW_SORT_DIGITS; digit++) {
+			histograms[digit * DRAW_SORT_BUCKETS + ((item.key >> (digit * DRAW_SORT_RADIX_BITS)) & (DRAW_SORT_BUCKETS - 1))]++;
+		}
+	}
+
+	DrawItem* pSource = items.data();
+	DrawItem* pDestination = scratch.data();
+	uint32_t passes = 0;
+	for (uint32_t digit = 0; digit < DRAW_SORT_DIGITS; digit++) {
+		uint32_t* pCounts = histograms.data() + digit * DRAW_SORT_BUCKETS;
+		uint32_t shift = digit * DRAW_SORT_RADIX_BITS;
+		if (pCounts[(pSource[0].key >> shift) & (DRAW_SORT_BUCKETS - 1)] == count) {
+			continue;
+		}
+
+		//Counts become the first output slot of each bucket
+		uint32_t offset = 0;
+		for (uint32_t bucket = 0; bucket < DRAW_SORT_BUCKETS; bucket++) {
+			uint32_t bucketCount = pCounts[bucket];
+			pCounts[bucket] = offset;
+			offset += bucketCount;
+		}
+		for (size_t i = 0; i < count; i++) {
+			pDestination[pCounts[(pSource[i].key >> shift) & (DRAW_SORT_BUCKETS - 1)]++] = pSource[i];
+		}
+		std::swap(pSource, pDestination);
+		passes++;
+	}
+
+	if (pSource != items.data()) {
+		items.swap(scratch);
+	}
+	return passes;
+}
+
+std::span<DrawItem> DrawList::reset(uint32_t itemCount) {
+	m_items.resize(itemCount);
+	return m_items;
+}
+
+//Items only merge when they draw the same index range, draws of compacted indices stay single instances. Items
+//without indices are dropped here, so the ones filled in parallel can leave holes.
+void DrawList::sortAndMerge() {
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point start = Clock::now();
+	m_stats.items = static_cast<uint32_t>(m_items.size());
+	m_stats.sortPasses = DrawKeys::radixSort(m_items, m_scratch);
+
+	m_draws.clear();
+	m_instances.resize(m_items.size());
+	uint32_t instanceCount = 0;
+	for (const DrawItem& item : m_items) {
+		if (item.indexCount == 0) {
+			continue;
+		}
+		m_instances[instanceCount] = item.object;
+		if (!m_draws.empty()) {
+			InstancedDraw& last = m_draws.back();
+			if (DrawKeys::state(last.key) == DrawKeys::state(item.key) && last.firstIndex == item.firstIndex && last.indexCount == item.indexCount) {
+				last.instanceCount++;
+				instanceCount++;
+				continue;
+			}
+		}
+		m_draws.push_back(InstancedDraw{
+			.key = item.key,
+			.firstIndex = item.firstIndex,
+			.indexCount = item.indexCount,
+			.firstInstance = instanceCount++,
+			.instanceCount = 1
+		});
+	}
+	m_instances.resize(instanceCount);
+	m_stats.draws = static_cast<uint32_t>(m_draws.size());
+	m_stats.sortMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+std::span<const InstancedDraw> DrawList::getDraws() const {
+	return m_draws;
+}
+
+std::span<const uint32_t> DrawList::getInstances() const {
+	return m_instances;
+}
+
+const DrawListStats& DrawList::getStats() const {
+	return m_stats;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "FramePacer.h"
+
+#include <thread>
+#include <algorithm>
+
+void FramePacer::init(uint32_t frameSlots, uint32_t targetFrameRate, bool collectSamples) {
+	m_slots.assign(frameSlots, Slot{});
+	m_frameInterval = targetFrameRate > 0
+		? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFrameRate))
+		: Clock::duration{ 0 };
+	m_nextFrameStart = Clock::now();
+	m_collectSamples = collectSamples;
+}
+
+void FramePacer::waitForFrameStart() {
+	if (m_frameInterval == Clock::duration{ 0 }) {
+		return;
+	}
+
+	Clock::time_point now = Clock::now();
+	if (now < m_nextFrameStart) {
+		std::this_thread::sleep_until(m_nextFrameStart);
+		Clock::time_point woken = Clock::now();
+		m_stats.delayedFrames++;
+		m_stats.delayMs += std::chrono::duration<double, std::milli>(woken - now).count();
+		now = woken;
+	}
+	//A frame that ran late starts the schedule over instead of rushing the following frames to catch up
+	m_nextFrameStart = std::max(m_nextFrameStart + m_frameInterval, now);
+}
+
+void FramePacer::inputSampled(uint32_t slot) {
+	m_slots[slot].inputTime = Clock::now();
+}
+
+void FramePacer::presented(uint32_t slot) {
+	Slot& frame = m_slots[slot];
+	frame.pending = true;
+	m_stats.frames++;
+	m_stats.inputToSubmitMs += std::chrono::duration<double, std::milli>(Clock::now() - frame.inputTime).count();
+}
+
+void FramePacer::retired(uint32_t slot) {
+	Slot& frame = m_slots[slot];
+	if (!frame.pending) {
+		return;
+	}
+	frame.pending = false;
+
+	double latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - frame.inputTime).count();
+	m_stats.retiredFrames++;
+	m_stats.inputToRetireMs += latencyMs;
+	if (m_collectSamples) {
+		m_latencySamples.push_back(latencyMs);
+	}
+}
+
+bool FramePacer::isPending(uint32_t slot) const {
+	return m_slots[slot].pending;
+}
+
+const FramePacingStats& FramePacer::getStats() const {
+	return m_stats;
+}
+
+const std::vector<double>& FramePacer::getLatencySamples() const {
+	return m_latencySamples;
+}
\ No newline at end of file
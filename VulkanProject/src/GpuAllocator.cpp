@@ -0,0 +1,464 @@
+#include "GpuAllocator.h"
+
+#include <algorithm>
+#include <bit>
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+//True when the last byte of one resource and the first byte of the next fall in the same bufferImageGranularity page
+static bool onSamePage(VkDeviceSize lastByte, VkDeviceSize firstByte, VkDeviceSize granularity) {
+	return lastByte / granularity == firstByte / granularity;
+}
+
+FreeListBlock::FreeListBlock(VkDeviceSize size, VkDeviceSize granularity) : m_size{ size }, m_granularity{ granularity } {
+	insertFree(0, size);
+}
+
+void FreeListBlock::insertFree(VkDeviceSize offset, VkDeviceSize size) {
+	m_ranges[offset] = Range{ .size = size, .free = true, .linear = false };
+	m_freeBySize.emplace(size, offset);
+}
+
+void FreeListBlock::eraseFree(VkDeviceSize offset, VkDeviceSize size) {
+	auto [first, last] = m_freeBySize.equal_range(size);
+	for (auto it = first; it != last; ++it) {
+		if (it->second == offset) {
+			m_freeBySize.erase(it);
+			return;
+		}
+	}
+}
+
+bool FreeListBlock::allocate(VkDeviceSize size, VkDeviceSize alignment, bool linear, VkDeviceSize& outOffset) {
+	//Best fit: walk free ranges from the smallest that could hold the request until one survives alignment and granularity padding
+	for (auto candidate = m_freeBySize.lower_bound(size); candidate != m_freeBySize.end(); ++candidate) {
+		auto it = m_ranges.find(candidate->second);
+		VkDeviceSize rangeOffset = it->first;
+		VkDeviceSize rangeEnd = it->first + it->second.size;
+		VkDeviceSize offset = alignUp(rangeOffset, alignment);
+
+		if (it != m_ranges.begin()) {
+			auto prev = std::prev(it);
+			if (prev->second.linear != linear && onSamePage(prev->first + prev->second.size - 1, offset, m_granularity)) {
+				offset = alignUp(offset, m_granularity);
+			}
+		}
+		if (offset + size > rangeEnd) {
+			continue;
+		}
+
+		auto next = std::next(it);
+		if (next != m_ranges.end() && next->second.linear != linear && onSamePage(offset + size - 1, next->first, m_granularity)) {
+			continue;
+		}
+
+		m_freeBySize.erase(candidate);
+		m_ranges.erase(it);
+		if (offset > rangeOffset) {
+			insertFree(rangeOffset, offset - rangeOffset); //leading padding stays free
+		}
+		m_ranges[offset] = Range{ .size = size, .free = false, .linear = linear };
+		if (offset + size < rangeEnd) {
+			insertFree(offset + size, rangeEnd - offset - size);
+		}
+
+		m_usedBytes += size;
+		m_allocationCount++;
+		outOffset = offset;
+		return true;
+	}
+	return false;
+}
+
+void FreeListBlock::free(VkDeviceSize offset) {
+	auto it = m_ranges.find(offset);
+	if (it == m_ranges.end() || it->second.free) {
+		throw std::runtime_error("Freed an offset that is not allocated in this block");
+	}
+
+	m_usedBytes -= it->second.size;
+	m_allocationCount--;
+
+	VkDeviceSize mergedOffset = it->first;
+	VkDeviceSize mergedSize = it->second.size;
+
+	auto next = std::next(it);
+	if (next != m_ranges.end() && next->second.free) {
+		mergedSize += next->second.size;
+		eraseFree(next->first, next->second.size);
+		m_ranges.erase(next);
+	}
+	if (it != m_ranges.begin()) {
+		auto prev = std::prev(it);
+		if (prev->second.free) {
+			mergedOffset = prev->first;
+			mergedSize += prev->second.size;
+			eraseFree(prev->first, prev->second.size);
+			m_ranges.erase(prev);
+		}
+	}
+	m_ranges.erase(it);
+	insertFree(mergedOffset, mergedSize);
+}
+
+VkDeviceSize FreeListBlock::getSize() const {
+	return m_size;
+}
+
+VkDeviceSize FreeListBlock::getUsedBytes() const {
+	return m_usedBytes;
+}
+
+VkDeviceSize FreeListBlock::getLargestFreeRange() const {
+	return m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first;
+}
+
+uint32_t FreeListBlock::getFreeRangeCount() const {
+	return static_cast<uint32_t>(m_freeBySize.size());
+}
+
+uint32_t FreeListBlock::getAllocationCount() const {
+	return m_allocationCount;
+}
+
+LinearBlock::LinearBlock(VkDeviceSize size, VkDeviceSize granularity) : m_size{ size }, m_granularity{ granularity } {}
+
+bool LinearBlock::allocate(VkDeviceSize size, VkDeviceSize alignment, bool linear, VkDeviceSize& outOffset) {
+	VkDeviceSize offset = alignUp(m_head, alignment);
+	if (m_allocationCount > 0 && m_lastLinear != linear && onSamePage(m_head - 1, offset, m_granularity)) {
+		offset = alignUp(offset, m_granularity);
+	}
+	if (offset + size > m_size) {
+		return false;
+	}
+
+	m_head = offset + size;
+	m_lastLinear = linear;
+	m_allocationCount++;
+	outOffset = offset;
+	return true;
+}
+
+void LinearBlock::reset() {
+	m_head = 0;
+	m_allocationCount = 0;
+}
+
+VkDeviceSize LinearBlock::getSize() const {
+	return m_size;
+}
+
+VkDeviceSize LinearBlock::getUsedBytes() const {
+	return m_head;
+}
+
+uint32_t LinearBlock::getAllocationCount() const {
+	return m_allocationCount;
+}
+
+void GpuAllocator::init(VkPhysicalDevice physDevice, VkDevice device, uint32_t frameCount, VkDeviceSize blockSize) {
+	m_physDevice = physDevice;
+	m_device = device;
+	m_blockSize = blockSize;
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(m_physDevice, &props);
+	m_granularity = std::max<VkDeviceSize>(props.limits.bufferImageGranularity, 1);
+	m_maxAllocationCount = props.limits.maxMemoryAllocationCount;
+
+	vkGetPhysicalDeviceMemoryProperties(m_physDevice, &m_memProps);
+	m_pools = std::vector<MemoryTypePool>(m_memProps.memoryTypeCount);
+	for (MemoryTypePool& pool : m_pools) {
+		pool.linearBlocks = std::vector<std::vector<MemoryBlock>>(frameCount);
+		pool.linearDedicatedBlocks = std::vector<std::vector<MemoryBlock>>(frameCount);
+	}
+}
+
+void GpuAllocator::destroy() {
+	for (MemoryTypePool& pool : m_pools) {
+		for (MemoryBlock& block : pool.freeListBlocks) {
+			destroyBlock(block);
+		}
+		for (std::vector<MemoryBlock>& frameBlocks : pool.linearBlocks) {
+			for (MemoryBlock& block : frameBlocks) {
+				destroyBlock(block);
+			}
+		}
+		for (MemoryBlock& block : pool.dedicatedBlocks) {
+			destroyBlock(block);
+		}
+		for (std::vector<MemoryBlock>& frameBlocks : pool.linearDedicatedBlocks) {
+			for (MemoryBlock& block : frameBlocks) {
+				destroyBlock(block);
+			}
+		}
+	}
+	m_pools.clear();
+}
+
+void GpuAllocator::beginFrame(uint32_t frameIndex) {
+	m_currentFrame = frameIndex;
+	for (MemoryTypePool& pool : m_pools) {
+		for (MemoryBlock& block : pool.linearBlocks.at(frameIndex)) {
+			block.linear->reset();
+		}
+		std::vector<MemoryBlock>& dedicatedBlocks = pool.linearDedicatedBlocks.at(frameIndex);
+		for (MemoryBlock& block : dedicatedBlocks) {
+			destroyBlock(block);
+		}
+		dedicatedBlocks.clear();
+	}
+}
+
+uint32_t GpuAllocator::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const {
+	uint32_t bestType = INVALID_MEMORY_TYPE;
+	int bestScore = -1;
+
+	for (uint32_t i = 0; i < m_memProps.memoryTypeCount; i++) {
+		VkMemoryPropertyFlags flags = m_memProps.memoryTypes[i].propertyFlags;
+		if (!(typeBits & (1u << i)) || (flags & required) != required) {
+			continue;
+		}
+
+		int score = std::popcount(flags & preferred);
+		if (score > bestScore) {
+			bestScore = score;
+			bestType = i;
+		}
+	}
+	return bestType;
+}
+
+GpuAllocator::MemoryBlock GpuAllocator::createBlock(uint32_t memoryTypeIndex, VkDeviceSize size) {
+	MemoryBlock block{ .memory = VK_NULL_HANDLE, .size = size, .pMapped = nullptr };
+	if (m_deviceAllocationCount >= m_maxAllocationCount) {
+		return block;
+	}
+
+	VkMemoryAllocateInfo allocInfo{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.allocationSize = size,
+		.memoryTypeIndex = memoryTypeIndex
+	};
+
+	if (vkAllocateMemory(m_device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+		block.memory = VK_NULL_HANDLE;
+		return block;
+	}
+	m_deviceAllocationCount++;
+
+	if (m_memProps.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		if (vkMapMemory(m_device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.pMapped) != VK_SUCCESS) {
+			block.pMapped = nullptr;
+			destroyBlock(block);
+		}
+	}
+	return block;
+}
+
+void GpuAllocator::destroyBlock(MemoryBlock& block) {
+	if (block.memory == VK_NULL_HANDLE) {
+		return;
+	}
+	if (block.pMapped != nullptr) {
+		vkUnmapMemory(m_device, block.memory);
+	}
+	vkFreeMemory(m_device, block.memory, nullptr);
+	block.memory = VK_NULL_HANDLE;
+	m_deviceAllocationCount--;
+}
+
+bool GpuAllocator::tryAllocate(uint32_t memoryTypeIndex, const VkMemoryRequirements& reqs, AllocationStrategy strategy, bool linear, Allocation& outAllocation) {
+	MemoryTypePool& pool = m_pools.at(memoryTypeIndex);
+	outAllocation = Allocation{
+		.size = reqs.size,
+		.memoryTypeIndex = memoryTypeIndex,
+		.frameIndex = m_currentFrame,
+		.strategy = strategy
+	};
+
+	auto finish = [&outAllocation](const MemoryBlock& block, VkDeviceSize offset) {
+		outAllocation.memory = block.memory;
+		outAllocation.offset = offset;
+		outAllocation.pMapped = block.pMapped != nullptr ? static_cast<char*>(block.pMapped) + offset : nullptr;
+		return true;
+	};
+
+	//Requests that would take up most of a block get their own VkDeviceMemory, per-frame ones live until their frame slot comes around
+	if (reqs.size > m_blockSize / 2) {
+		MemoryBlock block = createBlock(memoryTypeIndex, reqs.size);
+		if (block.memory == VK_NULL_HANDLE) {
+			return false;
+		}
+		std::vector<MemoryBlock>& blocks = strategy == AllocationStrategy::Linear ? pool.linearDedicatedBlocks.at(m_currentFrame) : pool.dedicatedBlocks;
+		blocks.push_back(std::move(block));
+		outAllocation.dedicated = true;
+		return finish(blocks.back(), 0);
+	}
+
+	VkDeviceSize offset;
+	if (strategy == AllocationStrategy::Linear) {
+		std::vector<MemoryBlock>& frameBlocks = pool.linearBlocks.at(m_currentFrame);
+		for (MemoryBlock& block : frameBlocks) {
+			if (block.linear->allocate(reqs.size, reqs.alignment, linear, offset)) {
+				return finish(block, offset);
+			}
+		}
+
+		MemoryBlock block = createBlock(memoryTypeIndex, m_blockSize);
+		if (block.memory == VK_NULL_HANDLE) {
+			return false;
+		}
+		block.linear = std::make_unique<LinearBlock>(m_blockSize, m_granularity);
+		block.linear->allocate(reqs.size, reqs.alignment, linear, offset);
+		frameBlocks.push_back(std::move(block));
+		return finish(frameBlocks.back(), offset);
+	}
+
+	for (MemoryBlock& block : pool.freeListBlocks) {
+		if (block.freeList->allocate(reqs.size, reqs.alignment, linear, offset)) {
+			return finish(block, offset);
+		}
+	}
+
+	MemoryBlock block = createBlock(memoryTypeIndex, m_blockSize);
+	if (block.memory == VK_NULL_HANDLE) {
+		return false;
+	}
+	block.freeList = std::make_unique<FreeListBlock>(m_blockSize, m_granularity);
+	block.freeList->allocate(reqs.size, reqs.alignment, linear, offset);
+	pool.freeListBlocks.push_back(std::move(block));
+	return finish(pool.freeListBlocks.back(), offset);
+}
+
+Allocation GpuAllocator::allocate(const VkMemoryRequirements& reqs, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred,
+	AllocationStrategy strategy, bool linear) {
+	uint32_t typeBits = reqs.memoryTypeBits;
+	Allocation allocation;
+
+	//Fall back to the next best memory type if the preferred heap is exhausted
+	for (uint32_t typeIndex = findMemoryType(typeBits, required, preferred); typeIndex != INVALID_MEMORY_TYPE;
+		typeIndex = findMemoryType(typeBits, required, preferred)) {
+		if (tryAllocate(typeIndex, reqs, strategy, linear, allocation)) {
+			return allocation;
+		}
+		typeBits &= ~(1u << typeIndex);
+	}
+	throw std::runtime_error("Failed to allocate device memory");
+}
+
+void GpuAllocator::free(const Allocation& allocation) {
+	if (allocation.memory == VK_NULL_HANDLE) {
+		return;
+	}
+	if (allocation.strategy == AllocationStrategy::Linear) {
+		return; //released with the rest of its frame by beginFrame()
+	}
+	MemoryTypePool& pool = m_pools.at(allocation.memoryTypeIndex);
+
+	if (allocation.dedicated) {
+		auto it = std::find_if(pool.dedicatedBlocks.begin(), pool.dedicatedBlocks.end(),
+			[&allocation](const MemoryBlock& block) { return block.memory == allocation.memory; });
+		if (it != pool.dedicatedBlocks.end()) {
+			destroyBlock(*it);
+			pool.dedicatedBlocks.erase(it);
+		}
+		return;
+	}
+
+	auto it = std::find_if(pool.freeListBlocks.begin(), pool.freeListBlocks.end(),
+		[&allocation](const MemoryBlock& block) { return block.memory == allocation.memory; });
+	if (it == pool.freeListBlocks.end()) {
+		throw std::runtime_error("Freed an allocation that does not belong to this allocator");
+	}
+	it->freeList->free(allocation.offset);
+
+	//Keep one empty block per memory type around to avoid allocation churn
+	if (it->freeList->getAllocationCount() == 0 && pool.freeListBlocks.size() > 1) {
+		destroyBlock(*it);
+		pool.freeListBlocks.erase(it);
+	}
+}
+
+Allocation GpuAllocator::createBuffer(const VkBufferCreateInfo& info, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred,
+	AllocationStrategy strategy, VkBuffer& outBuffer) {
+	if (vkCreateBuffer(m_device, &info, nullptr, &outBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create buffer");
+	}
+
+	VkMemoryRequirements reqs;
+	vkGetBufferMemoryRequirements(m_device, outBuffer, &reqs);
+	Allocation allocation = allocate(reqs, required, preferred, strategy, true);
+	vkBindBufferMemory(m_device, outBuffer, allocation.memory, allocation.offset);
+	return allocation;
+}
+
+Allocation GpuAllocator::createImage(const VkImageCreateInfo& info, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkImage& outImage) {
+	if (vkCreateImage(m_device, &info, nullptr, &outImage) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create image");
+	}
+
+	VkMemoryRequirements reqs;
+	vkGetImageMemoryRequirements(m_device, outImage, &reqs);
+	Allocation allocation = allocate(reqs, required, preferred, AllocationStrategy::FreeList, info.tiling == VK_IMAGE_TILING_LINEAR);
+	vkBindImageMemory(m_device, outImage, allocation.memory, allocation.offset);
+	return allocation;
+}
+
+void GpuAllocator::destroyBuffer(VkBuffer buffer, const Allocation& allocation) {
+	vkDestroyBuffer(m_device, buffer, nullptr);
+	free(allocation);
+}
+
+void GpuAllocator::destroyImage(VkImage image, const Allocation& allocation) {
+	vkDestroyImage(m_device, image, nullptr);
+	free(allocation);
+}
+
+std::vector<HeapStats> GpuAllocator::getHeapStats() const {
+	std::vector<HeapStats> stats(m_memProps.memoryHeapCount);
+	for (uint32_t i = 0; i < m_memProps.memoryHeapCount; i++) {
+		stats.at(i).heapSize = m_memProps.memoryHeaps[i].size;
+	}
+
+	for (uint32_t typeIndex = 0; typeIndex < m_pools.size(); typeIndex++) {
+		const MemoryTypePool& pool = m_pools.at(typeIndex);
+		HeapStats& heap = stats.at(m_memProps.memoryTypes[typeIndex].heapIndex);
+
+		for (const MemoryBlock& block : pool.freeListBlocks) {
+			heap.blockCount++;
+			heap.blockBytes += block.freeList->getSize();
+			heap.usedBytes += block.freeList->getUsedBytes();
+			heap.allocationCount += block.freeList->getAllocationCount();
+		}
+		for (const std::vector<MemoryBlock>& frameBlocks : pool.linearBlocks) {
+			for (const MemoryBlock& block : frameBlocks) {
+				heap.blockCount++;
+				heap.blockBytes += block.linear->getSize();
+				heap.usedBytes += block.linear->getUsedBytes();
+				heap.allocationCount += block.linear->getAllocationCount();
+			}
+		}
+		for (const MemoryBlock& block : pool.dedicatedBlocks) {
+			heap.blockCount++;
+			heap.blockBytes += block.size;
+			heap.usedBytes += block.size;
+			heap.allocationCount++;
+		}
+		for (const std::vector<MemoryBlock>& frameBlocks : pool.linearDedicatedBlocks) {
+			for (const MemoryBlock& block : frameBlocks) {
+				heap.blockCount++;
+				heap.blockBytes += block.size;
+				heap.usedBytes += block.size;
+				heap.allocationCount++;
+			}
+		}
+	}
+	return stats;
+}
+
+uint32_t GpuAllocator::getDeviceAllocationCount() const {
+	return m_deviceAllocationCount;
+}
\ No newline at end of file
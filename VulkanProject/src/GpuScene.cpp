@@ -0,0 +1,505 @@
+#include "GpuScene.h"
+#include "MeshLod.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static_assert(sizeof(GpuObject) == 96, "GpuObject must match the std430 layout of SceneObject");
+static_assert(sizeof(GpuDrawCommand) == 32, "GpuDrawCommand must match the std430 layout of DrawCommand");
+static_assert(sizeof(CullPushConstants) <= 128, "CullPushConstants must fit the guaranteed push constant size");
+static_assert(sizeof(GpuCullStats) == 16, "GpuCullStats must match the std430 layout of CullStats");
+static_assert(sizeof(OcclusionCullData) == 96, "OcclusionCullData must match the std140 layout of OcclusionCullData");
+
+constexpr VkDeviceSize MAX_UPDATE_BUFFER_SIZE = 65536; //vkCmdUpdateBuffer limit, caps the draw (mesh LOD) count
+
+void GpuScene::init(VkDevice device, GpuAllocator& allocator, DescriptorAllocator& descriptors, uint32_t graphicsFamily, uint32_t computeFamily,
+	VkQueue computeQueue, uint32_t frameCount, bool occlusionCulling) {
+	m_device = device;
+	m_twoPhase = occlusionCulling;
+	m_pAllocator = &allocator;
+	m_pDescriptors = &descriptors;
+	m_computeQueue = computeQueue;
+	m_queueFamilies = { graphicsFamily };
+	if (computeFamily != ~0u && computeFamily != graphicsFamily) {
+		m_queueFamilies.push_back(computeFamily);
+	}
+
+	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	for (uint32_t binding : { BINDING_SCENE_OBJECTS, BINDING_VISIBLE_INSTANCES, BINDING_DRAW_COMMANDS }) {
+		bindings.push_back(VkDescriptorSetLayoutBinding{
+			.binding = binding,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT
+		});
+	}
+	for (uint32_t binding : { BINDING_CULL_STATS, BINDING_OBJECT_VISIBILITY }) {
+		bindings.push_back(VkDescriptorSetLayoutBinding{
+			.binding = binding,
+			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			.descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+		});
+	}
+
+	m_setLayout = m_pDescriptors->getLayout(bindings);
+
+	VkDescriptorSetLayoutBinding occlusionBindings[]{
+		{ .binding = BINDING_OCCLUSION_PYRAMID, .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT },
+		{ .binding = BINDING_OCCLUSION_CAMERA, .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1,
+			.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT }
+	};
+	m_occlusionSetLayout = m_pDescriptors->getLayout(occlusionBindings);
+
+	VkCommandPoolCreateInfo cmdPoolInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		.queueFamilyIndex = m_queueFamilies.back()
+	};
+	VkSemaphoreCreateInfo semaphoreInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
+	};
+
+	m_frames = std::vector<GpuSceneFrame>(frameCount);
+	for (GpuSceneFrame& frame : m_frames) {
+		frame.drawBuf = VK_NULL_HANDLE;
+		frame.instanceBuf = VK_NULL_HANDLE;
+		frame.statsBuf = VK_NULL_HANDLE;
+		frame.descSet = VK_NULL_HANDLE;
+		if (vkCreateCommandPool(m_device, &cmdPoolInfo, nullptr, &frame.cmdPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create GPU scene Command Pool");
+		}
+		VkCommandBufferAllocateInfo cmdBufferInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = frame.cmdPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1
+		};
+		if (vkAllocateCommandBuffers(m_device, &cmdBufferInfo, &frame.cmdBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate GPU scene command buffer");
+		}
+		if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &frame.cullCompleteSem) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create GPU scene Semaphore");
+		}
+	}
+
+	VkPushConstantRange pushConstantRange{
+		.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+		.offset = 0,
+		.size = sizeof(CullPushConstants)
+	};
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = 1,
+		.pSetLayouts = &m_setLayout,
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &pushConstantRange
+	};
+	if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create cull Pipeline Layout");
+	}
+
+	//The early phase only uses set 0, sharing the layout keeps it bound for the late phase
+	VkDescriptorSetLayout occlusionSetLayouts[]{ m_setLayout, m_occlusionSetLayout };
+	pipelineLayoutInfo.setLayoutCount = 2;
+	pipelineLayoutInfo.pSetLayouts = occlusionSetLayouts;
+	if (m_twoPhase && vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_occlusionPipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create occlusion cull Pipeline Layout");
+	}
+}
+
+void GpuScene::createPipeline(VkShaderModule cullModule, VkPipelineCache pipelineCache) {
+	VkComputePipelineCreateInfo pipelineInfo{
+		.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+		.stage = VkPipelineShaderStageCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+			.module = cullModule,
+			.pName = "main"
+		},
+		.layout = m_pipelineLayout
+	};
+	if (vkCreateComputePipelines(m_device, pipelineCache, 1, &pipelineInfo, nullptr, &m_pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create cull Pipeline");
+	}
+}
+
+void GpuScene::createOcclusionPipelines(VkShaderModule earlyModule, VkShaderModule lateModule, VkPipelineCache pipelineCache) {
+	if (!m_twoPhase) {
+		throw std::runtime_error("GPU scene was not initialized for occlusion culling");
+	}
+	VkComputePipelineCreateInfo pipelineInfos[2];
+	VkShaderModule modules[]{ earlyModule, lateModule };
+	for (uint32_t i = 0; i < 2; i++) {
+		pipelineInfos[i] = VkComputePipelineCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.stage = VkPipelineShaderStageCreateInfo{
+				.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.stage = VK_SHADER_STAGE_COMPUTE_BIT,
+				.module = modules[i],
+				.pName = "main"
+			},
+			.layout = m_occlusionPipelineLayout
+		};
+	}
+	VkPipeline pipelines[2];
+	if (vkCreateComputePipelines(m_device, pipelineCache, 2, pipelineInfos, nullptr, pipelines) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create occlusion cull Pipelines");
+	}
+	m_earlyPipeline = pipelines[0];
+	m_latePipeline = pipelines[1];
+}
+
+void GpuScene::destroy() {
+	destroyBuffers();
+	for (GpuSceneFrame& frame : m_frames) {
+		vkDestroySemaphore(m_device, frame.cullCompleteSem, nullptr);
+		vkDestroyCommandPool(m_device, frame.cmdPool, nullptr);
+	}
+	m_frames.clear();
+	for (VkPipeline pipeline : { m_pipeline, m_earlyPipeline, m_latePipeline }) {
+		if (pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(m_device, pipeline, nullptr);
+		}
+	}
+	if (m_occlusionPipelineLayout != VK_NULL_HANDLE) {
+		vkDestroyPipelineLayout(m_device, m_occlusionPipelineLayout, nullptr);
+	}
+	if (m_pipelineLayout != VK_NULL_HANDLE) {
+		vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+	}
+}
+
+void GpuScene::destroyBuffers() {
+	for (GpuSceneFrame& frame : m_frames) {
+		if (frame.drawBuf != VK_NULL_HANDLE) {
+			m_pDescriptors->releaseSetsUsing(frame.drawBuf);
+			m_pDescriptors->releaseSetsUsing(frame.instanceBuf);
+			m_pDescriptors->releaseSetsUsing(frame.statsBuf);
+			m_pAllocator->destroyBuffer(frame.drawBuf, frame.drawAlloc);
+			m_pAllocator->destroyBuffer(frame.instanceBuf, frame.instanceAlloc);
+			m_pAllocator->destroyBuffer(frame.statsBuf, frame.statsAlloc);
+			frame.drawBuf = VK_NULL_HANDLE;
+			frame.instanceBuf = VK_NULL_HANDLE;
+			frame.statsBuf = VK_NULL_HANDLE;
+		}
+	}
+	if (m_visibilityBuf != VK_NULL_HANDLE) {
+		m_pDescriptors->releaseSetsUsing(m_visibilityBuf);
+		m_pAllocator->destroyBuffer(m_visibilityBuf, m_visibilityAlloc);
+		m_visibilityBuf = VK_NULL_HANDLE;
+	}
+	if (m_objectBuf != VK_NULL_HANDLE) {
+		m_pDescriptors->releaseSetsUsing(m_objectBuf);
+		m_pAllocator->destroyBuffer(m_objectBuf, m_objectAlloc);
+		m_objectBuf = VK_NULL_HANDLE;
+	}
+}
+
+VkBufferCreateInfo GpuScene::getSharedBufferInfo(VkDeviceSize size, VkBufferUsageFlags usage) const {
+	bool concurrent = m_queueFamilies.size() > 1;
+	return VkBufferCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = size,
+		.usage = usage,
+		.sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = concurrent ? static_cast<uint32_t>(m_queueFamilies.size()) : 0u,
+		.pQueueFamilyIndices = concurrent ? m_queueFamilies.data() : nullptr
+	};
+}
+
+void GpuScene::setObjects(const Scene& scene, std::span<const Mesh* const> meshes) {
+	size_t lodCount = 0;
+	for (const Mesh* pMesh : meshes) {
+		lodCount += pMesh->getLods().size();
+	}
+	if (lodCount * sizeof(GpuDrawCommand) * (m_twoPhase ? 2 : 1) > MAX_UPDATE_BUFFER_SIZE) {
+		throw std::runtime_error("Too many meshes for GPU culling");
+	}
+	destroyBuffers();
+
+	std::span<const glm::mat4> transforms{ scene.getTransforms() };
+	std::span<const ObjectBounds> bounds{ scene.getBounds() };
+	std::span<const Mesh* const> objectMeshes{ scene.getMeshes() };
+	m_objectCount = scene.getObjectCount();
+
+	std::vector<uint32_t> meshFirstDraws(meshes.size());
+	uint32_t drawCount = 0;
+	for (size_t i = 0; i < meshes.size(); i++) {
+		meshFirstDraws[i] = drawCount;
+		drawCount += static_cast<uint32_t>(meshes[i]->getLods().size());
+	}
+
+	//Every LOD of a mesh gets a contiguous run of instance slots large enough for all of the mesh's objects
+	std::vector<GpuObject> objects(m_objectCount);
+	std::vector<uint32_t> meshObjectCounts(meshes.size(), 0);
+	for (uint32_t i = 0; i < m_objectCount; i++) {
+		auto it = std::find(meshes.begin(), meshes.end(), objectMeshes[i]);
+		if (it == meshes.end()) {
+			throw std::runtime_error("Scene object references a mesh that was not passed to the GPU scene");
+		}
+		uint32_t meshIndex = static_cast<uint32_t>(it - meshes.begin());
+		objects[i] = GpuObject{
+			.transform = transforms[i],
+			.boundingSphere = glm::vec4(bounds[i].center, bounds[i].radius),
+			.firstDraw = meshFirstDraws[meshIndex],
+			.lodCount = static_cast<uint32_t>(meshes[meshIndex]->getLods().size()),
+			.lodErrorScale = MeshLod::transformScale(transforms[i])
+		};
+		meshObjectCounts[meshIndex]++;
+	}
+
+	m_drawTemplates.clear();
+	uint32_t instanceBase = 0;
+	for (size_t i = 0; i < meshes.size(); i++) {
+		for (const MeshLodLevel& lod : meshes[i]->getLods()) {
+			m_drawTemplates.push_back(GpuDrawCommand{
+				.command = VkDrawIndexedIndirectCommand{
+					.indexCount = lod.indexCount,
+					.instanceCount = 0,
+					.firstIndex = lod.firstIndex,
+					.vertexOffset = 0,
+					.firstInstance = 0
+				},
+				.instanceBase = instanceBase,
+				.lodError = lod.error
+			});
+			instanceBase += meshObjectCounts[i];
+		}
+	}
+	m_drawCount = static_cast<uint32_t>(m_drawTemplates.size());
+
+	//An object is drawn by at most one phase, but both phases fill their instance lists at the same time
+	if (m_twoPhase) {
+		for (uint32_t i = 0; i < m_drawCount; i++) {
+			GpuDrawCommand lateDraw = m_drawTemplates[i];
+			lateDraw.instanceBase += instanceBase;
+			m_drawTemplates.push_back(lateDraw);
+		}
+		instanceBase *= 2;
+	}
+
+	//Written once from the host, the shaders only ever read it
+	VkDeviceSize objectSize = std::max<VkDeviceSize>(objects.size() * sizeof(GpuObject), sizeof(GpuObject));
+	m_objectAlloc = m_pAllocator->createBuffer(getSharedBufferInfo(objectSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT),
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		AllocationStrategy::FreeList, m_objectBuf);
+	if (!objects.empty()) {
+		std::memcpy(m_objectAlloc.pMapped, objects.data(), objects.size() * sizeof(GpuObject));
+	}
+
+	//Nothing counts as visible last frame until the first late phase ran, cleared on the GPU timeline by the next cull
+	VkDeviceSize visibilitySize = std::max<VkDeviceSize>(static_cast<VkDeviceSize>(m_objectCount) * sizeof(uint32_t), sizeof(uint32_t));
+	m_visibilityAlloc = m_pAllocator->createBuffer(getSharedBufferInfo(visibilitySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT),
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, AllocationStrategy::FreeList, m_visibilityBuf);
+	m_visibilityResetPending = true;
+
+	VkDeviceSize drawSize = std::max<VkDeviceSize>(m_drawTemplates.size() * sizeof(GpuDrawCommand), sizeof(GpuDrawCommand));
+	VkDeviceSize instanceSize = std::max<VkDeviceSize>(static_cast<VkDeviceSize>(instanceBase) * sizeof(uint32_t), sizeof(uint32_t));
+	for (GpuSceneFrame& frame : m_frames) {
+		frame.drawAlloc = m_pAllocator->createBuffer(getSharedBufferInfo(drawSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT),
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			AllocationStrategy::FreeList, frame.drawBuf);
+		frame.instanceAlloc = m_pAllocator->createBuffer(getSharedBufferInfo(instanceSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT),
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, AllocationStrategy::FreeList, frame.instanceBuf);
+		frame.statsAlloc = m_pAllocator->createBuffer(getSharedBufferInfo(sizeof(GpuCullStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT),
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0, AllocationStrategy::FreeList, frame.statsBuf);
+		std::memset(frame.drawAlloc.pMapped, 0, drawSize);
+		std::memset(frame.statsAlloc.pMapped, 0, sizeof(GpuCullStats));
+
+		DescriptorBinding bindings[]{
+			{ .binding = BINDING_SCENE_OBJECTS, .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .bufferInfo = { m_objectBuf, 0, VK_WHOLE_SIZE } },
+			{ .binding = BINDING_VISIBLE_INSTANCES, .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .bufferInfo = { frame.instanceBuf, 0, VK_WHOLE_SIZE } },
+			{ .binding = BINDING_DRAW_COMMANDS, .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .bufferInfo = { frame.drawBuf, 0, VK_WHOLE_SIZE } },
+			{ .binding = BINDING_CULL_STATS, .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .bufferInfo = { frame.statsBuf, 0, VK_WHOLE_SIZE } },
+			{ .binding = BINDING_OBJECT_VISIBILITY, .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .bufferInfo = { m_visibilityBuf, 0, VK_WHOLE_SIZE } }
+		};
+		frame.descSet = m_pDescriptors->getPersistentSet(m_setLayout, bindings);
+	}
+}
+
+VkSemaphore GpuScene::cull(uint32_t frameIndex, const Frustum& frustum, const glm::vec4& lodCamera) {
+	GpuSceneFrame& frame = m_frames.at(frameIndex);
+	vkResetCommandPool(m_device, frame.cmdPool, 0);
+
+	VkCommandBufferBeginInfo beginInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	};
+	vkBeginCommandBuffer(frame.cmdBuffer, &beginInfo);
+
+	recordReset(frame.cmdBuffer, frame);
+	vkCmdBindPipeline(frame.cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+	vkCmdBindDescriptorSets(frame.cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &frame.descSet, 0, nullptr);
+	recordDispatch(frame.cmdBuffer, frustum, lodCamera, 0);
+
+	//The semaphore covers the indirect and vertex reads on the graphics queue, this only makes the counts host readable
+	VkMemoryBarrier readbackBarrier{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_HOST_READ_BIT
+	};
+	vkCmdPipelineBarrier(frame.cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+		1, &readbackBarrier, 0, nullptr, 0, nullptr);
+	vkEndCommandBuffer(frame.cmdBuffer);
+
+	VkSubmitInfo submitInfo{
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &frame.cmdBuffer,
+		.signalSemaphoreCount = 1,
+		.pSignalSemaphores = &frame.cullCompleteSem
+	};
+	if (vkQueueSubmit(m_computeQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit cull command buffer");
+	}
+	return frame.cullCompleteSem;
+}
+
+void GpuScene::recordEarlyCull(VkCommandBuffer cmdBuffer, uint32_t frameIndex, const Frustum& frustum, const glm::vec4& lodCamera) {
+	GpuSceneFrame& frame = m_frames.at(frameIndex);
+	recordReset(cmdBuffer, frame);
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_earlyPipeline);
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_occlusionPipelineLayout, 0, 1, &frame.descSet, 0, nullptr);
+	recordDispatch(cmdBuffer, frustum, lodCamera, 0);
+
+	VkMemoryBarrier drawBarrier{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT
+	};
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0,
+		1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuScene::recordLateCull(VkCommandBuffer cmdBuffer, uint32_t frameIndex, const Frustum& frustum, const glm::vec4& lodCamera,
+	const OcclusionCullInputs& inputs) {
+	GpuSceneFrame& frame = m_frames.at(frameIndex);
+
+	//The pyramid view changes whenever the render graph is resized, so the set is rewritten every frame
+	VkDescriptorSet occlusionSet = m_pDescriptors->allocateTransient(m_occlusionSetLayout);
+	VkDescriptorImageInfo pyramidInfo{
+		.sampler = inputs.pyramidSampler,
+		.imageView = inputs.pyramidView,
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	};
+	VkWriteDescriptorSet writes[]{
+		{ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = occlusionSet, .dstBinding = BINDING_OCCLUSION_PYRAMID, .descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .pImageInfo = &pyramidInfo },
+		{ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, .dstSet = occlusionSet, .dstBinding = BINDING_OCCLUSION_CAMERA, .descriptorCount = 1,
+			.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .pBufferInfo = &inputs.cameraData }
+	};
+	vkUpdateDescriptorSets(m_device, 2, writes, 0, nullptr);
+
+	//The early phase's reads of the visibility buffer have to finish before this phase rewrites it
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	VkDescriptorSet sets[]{ frame.descSet, occlusionSet };
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_latePipeline);
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_occlusionPipelineLayout, 0, 2, sets, 0, nullptr);
+	recordDispatch(cmdBuffer, frustum, lodCamera, m_drawCount);
+
+	//Also makes the counts host readable once the frame's fence signals
+	VkMemoryBarrier drawBarrier{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT
+	};
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+}
+
+//Reset the instance counts and stats on the GPU timeline, the host must not touch the buffers while the last frame's
+//draws may still read them. The barrier also orders the previous frame's late phase before this frame's reads of
+//the visibility buffer.
+void GpuScene::recordReset(VkCommandBuffer cmdBuffer, const GpuSceneFrame& frame) {
+	if (!m_drawTemplates.empty()) {
+		vkCmdUpdateBuffer(cmdBuffer, frame.drawBuf, 0, m_drawTemplates.size() * sizeof(GpuDrawCommand), m_drawTemplates.data());
+	}
+	vkCmdFillBuffer(cmdBuffer, frame.statsBuf, 0, sizeof(GpuCullStats), 0);
+	if (m_visibilityResetPending) {
+		vkCmdFillBuffer(cmdBuffer, m_visibilityBuf, 0, VK_WHOLE_SIZE, 0);
+		m_visibilityResetPending = false;
+	}
+
+	VkMemoryBarrier resetBarrier{
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+		.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT
+	};
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		1, &resetBarrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuScene::recordDispatch(VkCommandBuffer cmdBuffer, const Frustum& frustum, const glm::vec4& lodCamera,
+	uint32_t drawOffset) {
+	CullPushConstants constants{ .lodCamera = lodCamera, .objectCount = m_objectCount, .drawOffset = drawOffset };
+	std::copy(std::begin(frustum.planes), std::end(frustum.planes), constants.frustumPlanes);
+
+	VkPipelineLayout layout = m_twoPhase ? m_occlusionPipelineLayout : m_pipelineLayout;
+	vkCmdPushConstants(cmdBuffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &constants);
+	if (m_objectCount > 0) {
+		vkCmdDispatch(cmdBuffer, (m_objectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+	}
+}
+
+bool GpuScene::isTwoPhase() const {
+	return m_twoPhase;
+}
+
+uint32_t GpuScene::readVisibleCount(uint32_t frameIndex) const {
+	const GpuSceneFrame& frame = m_frames.at(frameIndex);
+	const GpuDrawCommand* pDraws = static_cast<const GpuDrawCommand*>(frame.drawAlloc.pMapped);
+	uint32_t visibleCount = 0;
+	for (size_t i = 0; i < m_drawTemplates.size(); i++) {
+		visibleCount += pDraws[i].command.instanceCount;
+	}
+	return visibleCount;
+}
+
+GpuCullStats GpuScene::readCullStats(uint32_t frameIndex) const {
+	GpuCullStats stats;
+	std::memcpy(&stats, m_frames.at(frameIndex).statsAlloc.pMapped, sizeof(GpuCullStats));
+	return stats;
+}
+
+uint64_t GpuScene::readTriangleCount(uint32_t frameIndex) const {
+	const GpuSceneFrame& frame = m_frames.at(frameIndex);
+	const GpuDrawCommand* pDraws = static_cast<const GpuDrawCommand*>(frame.drawAlloc.pMapped);
+	uint64_t triangleCount = 0;
+	for (size_t i = 0; i < m_drawTemplates.size(); i++) {
+		triangleCount += static_cast<uint64_t>(pDraws[i].command.instanceCount) * (m_drawTemplates[i].command.indexCount / 3);
+	}
+	return triangleCount;
+}
+
+VkDescriptorSetLayout GpuScene::getSetLayout() const {
+	return m_setLayout;
+}
+
+VkDescriptorSet GpuScene::getDescriptorSet(uint32_t frameIndex) const {
+	return m_frames.at(frameIndex).descSet;
+}
+
+VkBuffer GpuScene::getObjectBuffer() const {
+	return m_objectBuf;
+}
+
+VkBuffer GpuScene::getDrawBuffer(uint32_t frameIndex) const {
+	return m_frames.at(frameIndex).drawBuf;
+}
+
+uint32_t GpuScene::getInstanceBase(uint32_t drawIndex) const {
+	return m_drawTemplates.at(drawIndex).instanceBase;
+}
+
+uint32_t GpuScene::getObjectCount() const {
+	return m_objectCount;
+}
+
+uint32_t GpuScene::getDrawCount() const {
+	return m_drawCount;
+}
\ No newline at end of file
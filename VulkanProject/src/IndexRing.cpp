@@ -0,0 +1,52 @@
+#include "IndexRing.h"
+
+#include <stdexcept>
+
+void IndexRing::init(GpuAllocator& allocator, uint32_t frameCount, VkDeviceSize frameSize) {
+	m_pAllocator = &allocator;
+	m_frameSize = (frameSize + sizeof(uint32_t) - 1) / sizeof(uint32_t) * sizeof(uint32_t);
+
+	VkBufferCreateInfo bufferInfo{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = m_frameSize * frameCount,
+		.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+	};
+	//Written once and read once per frame, so host visible VRAM is preferred but system memory is fine
+	m_allocation = m_pAllocator->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationStrategy::FreeList, m_buffer);
+	if (m_allocation.pMapped == nullptr) {
+		throw std::runtime_error("Failed to map index ring");
+	}
+	beginFrame(0);
+}
+
+void IndexRing::destroy() {
+	if (m_buffer != VK_NULL_HANDLE) {
+		m_pAllocator->destroyBuffer(m_buffer, m_allocation);
+		m_buffer = VK_NULL_HANDLE;
+	}
+}
+
+void IndexRing::beginFrame(uint32_t frameIndex) {
+	m_frameBegin = frameIndex * m_frameSize;
+	m_head.store(m_frameBegin, std::memory_order_relaxed);
+}
+
+IndexAllocation IndexRing::allocate(uint32_t indexCount, VkIndexType indexType) {
+	//Sizes are kept multiples of four bytes so both index types stay aligned to their own size
+	VkDeviceSize indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	VkDeviceSize size = (indexCount * indexSize + 3) & ~VkDeviceSize{ 3 };
+	VkDeviceSize offset = m_head.fetch_add(size, std::memory_order_relaxed);
+	if (offset + size > m_frameBegin + m_frameSize) {
+		return IndexAllocation{ .pData = nullptr, .firstIndex = 0 };
+	}
+	return IndexAllocation{
+		.pData = static_cast<std::byte*>(m_allocation.pMapped) + offset,
+		.firstIndex = static_cast<uint32_t>(offset / indexSize)
+	};
+}
+
+VkBuffer IndexRing::getBuffer() const {
+	return m_buffer;
+}
\ No newline at end of file
@@ -0,0 +1,208 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+//Lets a job find out which worker of which system it runs on without passing the system around
+thread_local const JobSystem* t_pJobSystem = nullptr;
+thread_local uint32_t t_workerIndex = 0;
+
+bool JobCounter::isDone() const {
+	return m_pending.load(std::memory_order_acquire) == 0;
+}
+
+JobSystem::JobSystem(uint32_t threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	for (uint32_t i = 0; i < threadCount; i++) {
+		m_workers.push_back(std::make_unique<Worker>());
+	}
+	m_statsStart = std::chrono::steady_clock::now();
+
+	t_pJobSystem = this;
+	t_workerIndex = 0;
+	for (uint32_t i = 1; i < threadCount; i++) {
+		m_threads.emplace_back(&JobSystem::threadLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock{ m_sleepMutex };
+		m_quit = true;
+	}
+	m_wakeCondition.notify_all();
+	for (std::thread& thread : m_threads) {
+		thread.join();
+	}
+	if (t_pJobSystem == this) {
+		t_pJobSystem = nullptr;
+	}
+}
+
+void JobSystem::run(Job job, JobCounter* pSignal, JobCounter* pDependency) {
+	if (pSignal != nullptr) {
+		pSignal->m_pending.fetch_add(1, std::memory_order_relaxed);
+	}
+	Job wrapped = [this, job = std::move(job), pSignal](uint32_t workerIndex) {
+		job(workerIndex);
+		finishJob(pSignal);
+	};
+
+	if (pDependency != nullptr) {
+		std::lock_guard<std::mutex> lock{ pDependency->m_mutex };
+		if (!pDependency->isDone()) {
+			pDependency->m_continuations.push_back(std::move(wrapped));
+			return;
+		}
+	}
+	push(getCurrentWorkerIndex(), std::move(wrapped));
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t, uint32_t, uint32_t)>& function, JobCounter& signal) {
+	batchSize = std::max(batchSize, 1u);
+	auto pFunction = std::make_shared<std::function<void(uint32_t, uint32_t, uint32_t)>>(function);
+	for (uint32_t begin = 0; begin < count; begin += batchSize) {
+		uint32_t end = std::min(count, begin + batchSize);
+		run([pFunction, begin, end](uint32_t workerIndex) { (*pFunction)(begin, end, workerIndex); }, &signal);
+	}
+}
+
+void JobSystem::wait(JobCounter& counter) {
+	uint32_t workerIndex = getCurrentWorkerIndex();
+	while (!counter.isDone()) {
+		if (!tryRunJob(workerIndex)) {
+			std::this_thread::yield();
+		}
+	}
+	//The last finishJob() still holds the counter's mutex when the count hits zero, the counter may only die once it let go
+	std::lock_guard<std::mutex> lock{ counter.m_mutex };
+}
+
+uint32_t JobSystem::getWorkerCount() const {
+	return static_cast<uint32_t>(m_workers.size());
+}
+
+uint32_t JobSystem::getCurrentWorkerIndex() const {
+	return t_pJobSystem == this ? t_workerIndex : 0;
+}
+
+JobSystemStats JobSystem::getStats() const {
+	JobSystemStats stats{};
+	stats.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_statsStart).count();
+	for (const std::unique_ptr<Worker>& pWorker : m_workers) {
+		stats.workers.push_back(JobWorkerStats{
+			.jobsExecuted = pWorker->jobsExecuted.load(std::memory_order_relaxed),
+			.jobsStolen = pWorker->jobsStolen.load(std::memory_order_relaxed),
+			.busyMs = static_cast<double>(pWorker->busyNs.load(std::memory_order_relaxed)) * 1e-6
+		});
+	}
+	return stats;
+}
+
+void JobSystem::resetStats() {
+	for (std::unique_ptr<Worker>& pWorker : m_workers) {
+		pWorker->jobsExecuted.store(0, std::memory_order_relaxed);
+		pWorker->jobsStolen.store(0, std::memory_order_relaxed);
+		pWorker->busyNs.store(0, std::memory_order_relaxed);
+	}
+	m_statsStart = std::chrono::steady_clock::now();
+}
+
+void JobSystem::push(uint32_t workerIndex, Job job) {
+	Worker& worker = *m_workers.at(workerIndex);
+	{
+		std::lock_guard<std::mutex> lock{ worker.mutex };
+		worker.jobs.push_back(std::move(job));
+	}
+	m_queuedJobs.fetch_add(1);
+
+	//Pairs with the sleeping counter increment in threadLoop(), one side always sees the other
+	if (m_sleepingThreads.load() > 0) {
+		{
+			std::lock_guard<std::mutex> lock{ m_sleepMutex };
+		}
+		m_wakeCondition.notify_one();
+	}
+}
+
+bool JobSystem::tryRunJob(uint32_t workerIndex) {
+	Job job;
+	bool stolen = false;
+	{
+		Worker& own = *m_workers[workerIndex];
+		std::lock_guard<std::mutex> lock{ own.mutex };
+		if (!own.jobs.empty()) {
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+		}
+	}
+
+	uint32_t workerCount = getWorkerCount();
+	for (uint32_t i = 1; !job && i < workerCount; i++) {
+		Worker& victim = *m_workers[(workerIndex + i) % workerCount];
+		std::lock_guard<std::mutex> lock{ victim.mutex };
+		if (!victim.jobs.empty()) {
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			stolen = true;
+		}
+	}
+
+	if (!job) {
+		return false;
+	}
+	m_queuedJobs.fetch_sub(1);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	job(workerIndex);
+	uint64_t busyNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+	Worker& own = *m_workers[workerIndex];
+	own.busyNs.fetch_add(busyNs, std::memory_order_relaxed);
+	own.jobsExecuted.fetch_add(1, std::memory_order_relaxed);
+	if (stolen) {
+		own.jobsStolen.fetch_add(1, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+void JobSystem::finishJob(JobCounter* pSignal) {
+	if (pSignal == nullptr) {
+		return;
+	}
+
+	std::vector<Job> continuations;
+	{
+		//Decrementing under the lock keeps run() from parking a dependent job after the continuations were taken
+		std::lock_guard<std::mutex> lock{ pSignal->m_mutex };
+		if (pSignal->m_pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+			return;
+		}
+		continuations.swap(pSignal->m_continuations);
+	}
+
+	uint32_t workerIndex = getCurrentWorkerIndex();
+	for (Job& continuation : continuations) {
+		push(workerIndex, std::move(continuation));
+	}
+}
+
+void JobSystem::threadLoop(uint32_t workerIndex) {
+	t_pJobSystem = this;
+	t_workerIndex = workerIndex;
+
+	while (true) {
+		if (tryRunJob(workerIndex)) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock{ m_sleepMutex };
+		m_sleepingThreads.fetch_add(1);
+		m_wakeCondition.wait(lock, [this] { return m_quit || m_queuedJobs.load() > 0; });
+		m_sleepingThreads.fetch_sub(1);
+		if (m_quit) {
+			return;
+		}
+	}
+}
\ No newline at end of file
@@ -1,7 +1,285 @@
-#include "App.h"
+#include "Renderer.h"
+#include "Benchmark.h"
+#include "MeshFile.h"
+#include "MeshImport.h"
+#include "MeshLod.h"
 
-int main() {
-	Renderer app;
-	app.run();
+#include <cstring>
+#include <string>
+
+//Usage: VulkanProject [--headless] [--benchmark <frames>] [--frames-in-flight <n>] [--draws <n>] [--threads <n>] [--width <px>] [--height <px>]
+//                     [--objects <n>] [--gpu-culling] [--occlusion-culling] [--city] [--low-latency] [--target-fps <n>] [--frames <n>]
+//                     [--trace <file>] [--lod-threshold <px>] [--no-meshlet-culling] [--no-instancing]
+//                     [--bench-allocator <operations>] [--bench-vertex <vertices>]
+//                     [--bench-upload <megabytes>] [--bench-scene <objects>] [--bench-cull <objects>] [--bench-gpu-cull <objects>]
+//                     [--bench-mesh-load <megabytes>] [--bench-lod <objects>] [--bench-meshlets <objects>] [--bench-render-graph]
+//                     [--bench-occlusion <objects>] [--bench-transforms <nodes>] [--bench-draw-list <objects>]
+//                     [--bench-bvh <objects>] [--bench-textures <textures>]
+//                     [--cook-mesh <input.obj> <output.mesh>]
+int main(int argc, char** argv) {
+	RendererConfig config{};
+	bool benchmark = false;
+	BenchmarkOptions benchOptions{};
+	uint32_t allocatorBenchOps = 0;
+	uint32_t vertexBenchCount = 0;
+	uint32_t uploadBenchMegabytes = 0;
+	uint32_t sceneBenchObjects = 0;
+	uint32_t cullBenchObjects = 0;
+	uint32_t gpuCullBenchObjects = 0;
+	uint32_t meshLoadBenchMegabytes = 0;
+	uint32_t lodBenchObjects = 0;
+	uint32_t meshletBenchObjects = 0;
+	bool renderGraphBench = false;
+	uint32_t occlusionBenchObjects = 0;
+	uint32_t transformBenchNodes = 0;
+	uint32_t drawListBenchObjects = 0;
+	uint32_t bvhBenchObjects = 0;
+	uint32_t textureBenchCount = 0;
+	std::string cookInput;
+	std::string cookOutput;
+
+	for (int i = 1; i < argc; i++) {
+		bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--headless") == 0) {
+			config.headless = true;
+		}
+		else if (std::strcmp(argv[i], "--benchmark") == 0 && hasValue) {
+			benchmark = true;
+			benchOptions.frameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-allocator") == 0 && hasValue) {
+			allocatorBenchOps = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-vertex") == 0 && hasValue) {
+			vertexBenchCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-upload") == 0 && hasValue) {
+			uploadBenchMegabytes = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-scene") == 0 && hasValue) {
+			sceneBenchObjects = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-cull") == 0 && hasValue) {
+			cullBenchObjects = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-gpu-cull") == 0 && hasValue) {
+			gpuCullBenchObjects = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-mesh-load") == 0 && hasValue) {
+			meshLoadBenchMegabytes = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-lod") == 0 && hasValue) {
+			lodBenchObjects = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-meshlets") == 0 && hasValue) {
+			meshletBenchObjects = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-render-graph") == 0) {
+			renderGraphBench = true;
+		}
+		else if (std::strcmp(argv[i], "--bench-occlusion") == 0 && hasValue) {
+			occlusionBenchObjects = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-transforms") == 0 && hasValue) {
+			transformBenchNodes = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-draw-list") == 0 && hasValue) {
+			drawListBenchObjects = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-bvh") == 0 && hasValue) {
+			bvhBenchObjects = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--bench-textures") == 0 && hasValue) {
+			textureBenchCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--cook-mesh") == 0 && i + 2 < argc) {
+			cookInput = argv[++i];
+			cookOutput = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--objects") == 0 && hasValue) {
+			config.sceneObjectCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--gpu-culling") == 0) {
+			config.gpuCulling = true;
+		}
+		else if (std::strcmp(argv[i], "--occlusion-culling") == 0) {
+			config.occlusionCulling = true;
+		}
+		else if (std::strcmp(argv[i], "--city") == 0) {
+			config.sceneLayout = SceneLayout::City;
+		}
+		else if (std::strcmp(argv[i], "--low-latency") == 0) {
+			config.presentPolicy = PresentPolicy::LowLatency;
+		}
+		else if (std::strcmp(argv[i], "--target-fps") == 0 && hasValue) {
+			config.targetFrameRate = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--frames") == 0 && hasValue) {
+			config.frameLimit = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--lod-threshold") == 0 && hasValue) {
+			config.lodThresholdPixels = std::stof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--no-meshlet-culling") == 0) {
+			config.meshletCulling = false;
+		}
+		else if (std::strcmp(argv[i], "--no-instancing") == 0) {
+			config.instancing = false;
+		}
+		else if (std::strcmp(argv[i], "--trace") == 0 && hasValue) {
+			config.tracePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && hasValue) {
+			config.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--draws") == 0 && hasValue) {
+			config.syntheticDrawCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+			config.workerThreads = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--width") == 0 && hasValue) {
+			config.width = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--height") == 0 && hasValue) {
+			config.height = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+	}
+
+	try {
+		if (!cookInput.empty()) {
+			ImportedMesh imported = MeshImport::loadObj(cookInput);
+			LodChain chain = MeshLod::buildChain(imported.vertices, imported.indices);
+			Mesh mesh{ imported.vertices, chain.indices, std::move(chain.levels), VertexLayout{} };
+			uint64_t size = MeshFile::write(cookOutput, mesh);
+			std::cout << cookOutput << ": " << mesh.getVertexCount() << " vertices, " << mesh.getLods().size() << " LODs, " << mesh.getIndexCount()
+				<< " indices, " << size << " bytes\n";
+			return 0;
+		}
+		if (allocatorBenchOps > 0) {
+			Benchmark::runAllocatorBenchmark(allocatorBenchOps, std::cout);
+			return 0;
+		}
+		if (vertexBenchCount > 0) {
+			Benchmark::runVertexBenchmark(vertexBenchCount, std::cout);
+			return 0;
+		}
+		if (sceneBenchObjects > 0) {
+			Benchmark::runSceneBenchmark(sceneBenchObjects, std::cout);
+			return 0;
+		}
+		if (bvhBenchObjects > 0) {
+			Benchmark::runBvhBenchmark(bvhBenchObjects, std::cout);
+			return 0;
+		}
+		if (transformBenchNodes > 0) {
+			Benchmark::runTransformBenchmark(transformBenchNodes, std::cout);
+			return 0;
+		}
+		if (cullBenchObjects > 0) {
+			Benchmark::runCullingBenchmark(cullBenchObjects, std::cout);
+			return 0;
+		}
+		if (gpuCullBenchObjects > 0) {
+			benchOptions.rendererConfig.width = config.width;
+			benchOptions.rendererConfig.height = config.height;
+			benchOptions.rendererConfig.framesInFlight = config.framesInFlight;
+			benchOptions.rendererConfig.workerThreads = config.workerThreads;
+			benchOptions.rendererConfig.lodThresholdPixels = config.lodThresholdPixels;
+			Benchmark::runGpuCullingBenchmark(benchOptions, gpuCullBenchObjects, std::cout);
+			return 0;
+		}
+		if (lodBenchObjects > 0) {
+			benchOptions.rendererConfig.width = config.width;
+			benchOptions.rendererConfig.height = config.height;
+			benchOptions.rendererConfig.framesInFlight = config.framesInFlight;
+			benchOptions.rendererConfig.workerThreads = config.workerThreads;
+			Benchmark::runLodBenchmark(benchOptions, lodBenchObjects, std::cout);
+			return 0;
+		}
+		if (meshletBenchObjects > 0) {
+			benchOptions.rendererConfig.width = config.width;
+			benchOptions.rendererConfig.height = config.height;
+			benchOptions.rendererConfig.framesInFlight = config.framesInFlight;
+			benchOptions.rendererConfig.workerThreads = config.workerThreads;
+			benchOptions.rendererConfig.lodThresholdPixels = config.lodThresholdPixels;
+			Benchmark::runMeshletBenchmark(benchOptions, meshletBenchObjects, std::cout);
+			return 0;
+		}
+		if (renderGraphBench) {
+			benchOptions.rendererConfig.width = config.width;
+			benchOptions.rendererConfig.height = config.height;
+			benchOptions.rendererConfig.framesInFlight = config.framesInFlight;
+			Benchmark::runRenderGraphBenchmark(benchOptions, std::cout);
+			return 0;
+		}
+		if (occlusionBenchObjects > 0) {
+			benchOptions.rendererConfig.width = config.width;
+			benchOptions.rendererConfig.height = config.height;
+			benchOptions.rendererConfig.framesInFlight = config.framesInFlight;
+			benchOptions.rendererConfig.lodThresholdPixels = config.lodThresholdPixels;
+			Benchmark::runOcclusionBenchmark(benchOptions, occlusionBenchObjects, std::cout);
+			return 0;
+		}
+		if (drawListBenchObjects > 0) {
+			benchOptions.rendererConfig.width = config.width;
+			benchOptions.rendererConfig.height = config.height;
+			benchOptions.rendererConfig.framesInFlight = config.framesInFlight;
+			benchOptions.rendererConfig.workerThreads = config.workerThreads;
+			benchOptions.rendererConfig.lodThresholdPixels = config.lodThresholdPixels;
+			benchOptions.rendererConfig.meshletCulling = config.meshletCulling;
+			Benchmark::runDrawListBenchmark(benchOptions, drawListBenchObjects, std::cout);
+			return 0;
+		}
+		if (meshLoadBenchMegabytes > 0) {
+			benchOptions.rendererConfig.framesInFlight = config.framesInFlight;
+			Benchmark::runMeshLoadBenchmark(benchOptions, meshLoadBenchMegabytes, std::cout);
+			return 0;
+		}
+		if (textureBenchCount > 0) {
+			benchOptions.rendererConfig.framesInFlight = config.framesInFlight;
+			Benchmark::runTextureBenchmark(benchOptions, textureBenchCount, std::cout);
+			return 0;
+		}
+		if (uploadBenchMegabytes > 0) {
+			benchOptions.rendererConfig.framesInFlight = config.framesInFlight;
+			Benchmark::runUploadBenchmark(benchOptions, uploadBenchMegabytes, std::cout);
+			return 0;
+		}
+		if (benchmark) {
+			benchOptions.rendererConfig.width = config.width;
+			benchOptions.rendererConfig.height = config.height;
+			benchOptions.rendererConfig.framesInFlight = config.framesInFlight;
+			benchOptions.rendererConfig.workerThreads = config.workerThreads;
+			benchOptions.rendererConfig.sceneObjectCount = config.sceneObjectCount;
+			benchOptions.rendererConfig.gpuCulling = config.gpuCulling;
+			benchOptions.rendererConfig.occlusionCulling = config.occlusionCulling;
+			benchOptions.rendererConfig.sceneLayout = config.sceneLayout;
+			benchOptions.rendererConfig.targetFrameRate = config.targetFrameRate;
+			benchOptions.rendererConfig.tracePath = config.tracePath;
+			benchOptions.rendererConfig.lodThresholdPixels = config.lodThresholdPixels;
+			benchOptions.rendererConfig.meshletCulling = config.meshletCulling;
+			benchOptions.rendererConfig.instancing = config.instancing;
+			if (config.syntheticDrawCount > 0) {
+				benchOptions.rendererConfig.syntheticDrawCount = config.syntheticDrawCount;
+			}
+			Benchmark::runFrameBenchmark(benchOptions, std::cout);
+			return 0;
+		}
+
+		Renderer app{ config };
+		if (config.headless) {
+			app.init();
+			app.renderFrames(1);
+			app.finishFrames();
+		}
+		else {
+			app.run();
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << "\n";
+		return 1;
+	}
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <utility>
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open file " + path.string());
+	}
+	m_fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+	if (m_size == 0) {
+		return; //empty files cannot be mapped
+	}
+
+	m_mappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mappingHandle == nullptr) {
+		close();
+		throw std::runtime_error("Failed to map file " + path.string());
+	}
+	m_pData = static_cast<const std::byte*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+#else
+	m_fd = open(path.c_str(), O_RDONLY);
+	if (m_fd < 0) {
+		throw std::runtime_error("Failed to open file " + path.string());
+	}
+
+	struct stat fileStat;
+	fstat(m_fd, &fileStat);
+	m_size = static_cast<size_t>(fileStat.st_size);
+	if (m_size == 0) {
+		return;
+	}
+
+	void* pView = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+	m_pData = pView == MAP_FAILED ? nullptr : static_cast<const std::byte*>(pView);
+#endif
+
+	if (m_pData == nullptr) {
+		close();
+		throw std::runtime_error("Failed to map file " + path.string());
+	}
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		m_pData = std::exchange(other.m_pData, nullptr);
+		m_size = std::exchange(other.m_size, 0);
+#ifdef _WIN32
+		m_fileHandle = std::exchange(other.m_fileHandle, nullptr);
+		m_mappingHandle = std::exchange(other.m_mappingHandle, nullptr);
+#else
+		m_fd = std::exchange(other.m_fd, -1);
+#endif
+	}
+	return *this;
+}
+
+const std::byte* MappedFile::data() const {
+	return m_pData;
+}
+
+size_t MappedFile::size() const {
+	return m_size;
+}
+
+bool MappedFile::isOpen() const {
+#ifdef _WIN32
+	return m_fileHandle != nullptr;
+#else
+	return m_fd >= 0;
+#endif
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if (m_pData != nullptr) {
+		UnmapViewOfFile(m_pData);
+	}
+	if (m_mappingHandle != nullptr) {
+		CloseHandle(m_mappingHandle);
+	}
+	if (m_fileHandle != nullptr) {
+		CloseHandle(m_fileHandle);
+	}
+	m_mappingHandle = nullptr;
+	m_fileHandle = nullptr;
+#else
+	if (m_pData != nullptr) {
+		munmap(const_cast<std::byte*>(m_pData), m_size);
+	}
+	if (m_fd >= 0) {
+		::close(m_fd);
+	}
+	m_fd = -1;
+#endif
+	m_pData = nullptr;
+	m_size = 0;
+}
\ No newline at end of file
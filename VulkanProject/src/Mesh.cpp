@@ -0,0 +1,160 @@
+#include "Mesh.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+Mesh::Mesh(const std::vector<Vertex>& vertices, const VertexLayout& layout) : m_layout{ layout } {
+	build(vertices, nullptr);
+}
+
+Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const VertexLayout& layout) : m_layout{ layout } {
+	build(vertices, &indices);
+}
+
+Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<MeshLodLevel> lods, const VertexLayout& layout)
+	: m_layout{ layout }, m_lods{ std::move(lods) } {
+	for (const MeshLodLevel& lod : m_lods) {
+		if (lod.firstIndex > indices.size() || lod.indexCount > indices.size() - lod.firstIndex) {
+			throw std::runtime_error("Mesh LOD out of range");
+		}
+	}
+	build(vertices, &indices);
+}
+
+void Mesh::build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>* pIndices) {
+	if (vertices.empty()) {
+		return;
+	}
+
+	m_boundsMin = vertices.front().pos;
+	m_boundsMax = vertices.front().pos;
+	for (const Vertex& vertex : vertices) {
+		m_boundsMin = glm::min(m_boundsMin, vertex.pos);
+		m_boundsMax = glm::max(m_boundsMax, vertex.pos);
+	}
+
+	if (m_layout.position == PositionFormat::Snorm16) {
+		m_positionDecode.offset = (m_boundsMin + m_boundsMax) * 0.5f;
+		for (int i = 0; i < 3; i++) {
+			m_positionDecode.scale[i] = std::max((m_boundsMax[i] - m_boundsMin[i]) * 0.5f, 1e-6f); //flat axes still need a valid divisor
+		}
+	}
+
+	uint32_t stride = m_layout.getStride();
+	m_vertexData.resize(vertices.size() * stride);
+	for (size_t i = 0; i < vertices.size(); i++) {
+		m_layout.encode(vertices[i], m_positionDecode, m_vertexData.data() + i * stride);
+	}
+
+	//Open addressing over the encoded bytes. Unique vertices are compacted in place, which is safe because a vertex
+	//is only ever moved to a slot at or before its own.
+	std::vector<uint32_t> table(std::bit_ceil(vertices.size() * 2), UINT32_MAX);
+	std::vector<uint32_t> remap(vertices.size());
+	size_t mask = table.size() - 1;
+	uint32_t uniqueCount = 0;
+	for (size_t i = 0; i < vertices.size(); i++) {
+		const std::byte* pVertex = m_vertexData.data() + i * stride;
+		size_t slot = fnv1a64(pVertex, stride) & mask;
+		while (table[slot] != UINT32_MAX && std::memcmp(m_vertexData.data() + static_cast<size_t>(table[slot]) * stride, pVertex, stride) != 0) {
+			slot = (slot + 1) & mask;
+		}
+		if (table[slot] == UINT32_MAX) {
+			if (uniqueCount != i) {
+				std::memcpy(m_vertexData.data() + static_cast<size_t>(uniqueCount) * stride, pVertex, stride);
+			}
+			table[slot] = uniqueCount++;
+		}
+		remap[i] = table[slot];
+	}
+	m_vertexCount = uniqueCount;
+	m_vertexData.resize(static_cast<size_t>(uniqueCount) * stride);
+	m_vertexData.shrink_to_fit();
+
+	m_indexCount = static_cast<uint32_t>(pIndices != nullptr ? pIndices->size() : vertices.size());
+	m_indexType = m_vertexCount <= 0xffff ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	size_t indexSize = m_indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	m_indexData.resize(m_indexCount * indexSize);
+	for (uint32_t i = 0; i < m_indexCount; i++) {
+		uint32_t source = pIndices != nullptr ? (*pIndices)[i] : i;
+		if (source >= vertices.size()) {
+			throw std::runtime_error("Mesh index out of range");
+		}
+		if (m_indexType == VK_INDEX_TYPE_UINT16) {
+			uint16_t index = static_cast<uint16_t>(remap[source]);
+			std::memcpy(m_indexData.data() + i * indexSize, &index, indexSize);
+		}
+		else {
+			std::memcpy(m_indexData.data() + i * indexSize, &remap[source], indexSize);
+		}
+	}
+
+	//Deduplication only renames indices, so level ranges stay valid
+	if (m_lods.empty()) {
+		m_lods.push_back(MeshLodLevel{ .firstIndex = 0, .indexCount = m_indexCount, .error = 0.0f });
+	}
+}
+
+const VertexLayout& Mesh::getLayout() const {
+	return m_layout;
+}
+
+const PositionDecode& Mesh::getPositionDecode() const {
+	return m_positionDecode;
+}
+
+glm::vec3 Mesh::getBoundsMin() const {
+	return m_boundsMin;
+}
+
+glm::vec3 Mesh::getBoundsMax() const {
+	return m_boundsMax;
+}
+
+uint32_t Mesh::getVertexCount() const {
+	return m_vertexCount;
+}
+
+uint32_t Mesh::getIndexCount() const {
+	return m_indexCount;
+}
+
+VkIndexType Mesh::getIndexType() const {
+	return m_indexType;
+}
+
+uint32_t Mesh::getIndex(uint32_t i) const {
+	if (m_indexType == VK_INDEX_TYPE_UINT16) {
+		uint16_t index;
+		std::memcpy(&index, m_indexData.data() + i * sizeof(uint16_t), sizeof(uint16_t));
+		return index;
+	}
+	uint32_t index;
+	std::memcpy(&index, m_indexData.data() + i * sizeof(uint32_t), sizeof(uint32_t));
+	return index;
+}
+
+std::span<const MeshLodLevel> Mesh::getLods() const {
+	return m_lods;
+}
+
+const std::vector<std::byte>& Mesh::getVertexData() const {
+	return m_vertexData;
+}
+
+const std::vector<std::byte>& Mesh::getIndexData() const {
+	return m_indexData;
+}
+
+Vertex Mesh::getVertex(uint32_t index) const {
+	return m_layout.decode(m_vertexData.data() + static_cast<size_t>(index) * m_layout.getStride(), m_positionDecode);
+}
+
+std::vector<Vertex> Mesh::decodeVertices() const {
+	std::vector<Vertex> vertices(m_vertexCount);
+	for (uint32_t i = 0; i < m_vertexCount; i++) {
+		vertices[i] = getVertex(i);
+	}
+	return vertices;
+}
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "MeshFile.h"
+
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+static uint64_t alignSection(uint64_t offset) {
+	return (offset + MESH_FILE_SECTION_ALIGNMENT - 1) & ~(MESH_FILE_SECTION_ALIGNMENT - 1);
+}
+
+static uint32_t indexSize(VkIndexType indexType) {
+	return indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+}
+
+MeshFile::MeshFile(const std::filesystem::path& path) : m_file{ path } {
+	std::string name = path.string();
+	if (m_file.size() < sizeof(MeshFileHeader)) {
+		throw std::runtime_error("Failed to load mesh file " + name + ", it is too small for a header");
+	}
+	m_pHeader = reinterpret_cast<const MeshFileHeader*>(m_file.data());
+	if (m_pHeader->magic != MESH_FILE_MAGIC) {
+		throw std::runtime_error("Failed to load mesh file " + name + ", it is not a cooked mesh");
+	}
+	if (m_pHeader->version != MESH_FILE_VERSION) {
+		throw std::runtime_error("Failed to load mesh file " + name + ", version " + std::to_string(m_pHeader->version)
+			+ " does not match " + std::to_string(MESH_FILE_VERSION) + ", cook it again");
+	}
+	if (m_pHeader->fileSize != m_file.size()) {
+		throw std::runtime_error("Failed to load mesh file " + name + ", it is truncated");
+	}
+	if (m_pHeader->positionFormat > static_cast<uint32_t>(PositionFormat::Snorm16) || m_pHeader->normalFormat > static_cast<uint32_t>(NormalFormat::Oct16)
+		|| (m_pHeader->indexType != VK_INDEX_TYPE_UINT16 && m_pHeader->indexType != VK_INDEX_TYPE_UINT32)) {
+		throw std::runtime_error("Failed to load mesh file " + name + ", unknown vertex or index format");
+	}
+
+	uint64_t tableEnd = sizeof(MeshFileHeader) + static_cast<uint64_t>(m_pHeader->sectionCount) * sizeof(MeshFileSectionEntry);
+	if (tableEnd > m_file.size()) {
+		throw std::runtime_error("Failed to load mesh file " + name + ", the section table is out of bounds");
+	}
+	const MeshFileSectionEntry* pEntries = reinterpret_cast<const MeshFileSectionEntry*>(m_file.data() + sizeof(MeshFileHeader));
+	for (uint32_t i = 0; i < m_pHeader->sectionCount; i++) {
+		const MeshFileSectionEntry& entry = pEntries[i];
+		if (entry.offset % MESH_FILE_SECTION_ALIGNMENT != 0 || entry.offset < tableEnd || entry.offset > m_file.size()
+			|| entry.size > m_file.size() - entry.offset) {
+			throw std::runtime_error("Failed to load mesh file " + name + ", section " + std::to_string(i) + " is out of bounds");
+		}
+		if (entry.type < std::size(m_sections)) { //newer optional sections are skipped
+			m_sections[entry.type] = std::span<const std::byte>(m_file.data() + entry.offset, static_cast<size_t>(entry.size));
+		}
+	}
+
+	uint64_t lodCount = getSection(MeshSection::Lods).size() / sizeof(MeshFileLod);
+	if (getSection(MeshSection::Vertices).size() != static_cast<uint64_t>(m_pHeader->vertexCount) * getLayout().getStride()
+		|| getSection(MeshSection::Indices).size() != static_cast<uint64_t>(m_pHeader->indexCount) * indexSize(getIndexType())
+		|| getSection(MeshSection::Bounds).size() != sizeof(MeshFileBounds)
+		|| lodCount == 0 || getSection(MeshSection::Lods).size() != lodCount * sizeof(MeshFileLod)) {
+		throw std::runtime_error("Failed to load mesh file " + name + ", section sizes do not match the header");
+	}
+	for (const MeshFileLod& lod : getLods()) {
+		if (lod.firstIndex > m_pHeader->indexCount || lod.indexCount > m_pHeader->indexCount - lod.firstIndex) {
+			throw std::runtime_error("Failed to load mesh file " + name + ", a LOD is out of the index range");
+		}
+	}
+}
+
+uint64_t MeshFile::write(const std::filesystem::path& path, const Mesh& mesh) {
+	//Bounding sphere around the box center, tighter than the box's own sphere for most shapes
+	glm::vec3 boundsMin = mesh.getBoundsMin();
+	glm::vec3 boundsMax = mesh.getBoundsMax();
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	float radius = 0.0f;
+	for (const Vertex& vertex : mesh.decodeVertices()) {
+		radius = std::max(radius, glm::length(vertex.pos - center));
+	}
+	MeshFileBounds bounds{
+		.min = { boundsMin.x, boundsMin.y, boundsMin.z },
+		.max = { boundsMax.x, boundsMax.y, boundsMax.z },
+		.sphereCenter = { center.x, center.y, center.z },
+		.sphereRadius = radius
+	};
+	std::vector<MeshFileLod> lods;
+	for (const MeshLodLevel& level : mesh.getLods()) {
+		lods.push_back(MeshFileLod{ .firstIndex = level.firstIndex, .indexCount = level.indexCount, .error = level.error });
+	}
+
+	struct Payload {
+		MeshSection type;
+		const void* pData;
+		uint64_t size;
+	};
+	Payload payloads[]{
+		{ MeshSection::Vertices, mesh.getVertexData().data(), mesh.getVertexData().size() },
+		{ MeshSection::Indices, mesh.getIndexData().data(), mesh.getIndexData().size() },
+		{ MeshSection::Bounds, &bounds, sizeof(bounds) },
+		{ MeshSection::Lods, lods.data(), lods.size() * sizeof(MeshFileLod) }
+	};
+
+	std::vector<MeshFileSectionEntry> entries;
+	uint64_t offset = alignSection(sizeof(MeshFileHeader) + std::size(payloads) * sizeof(MeshFileSectionEntry));
+	for (const Payload& payload : payloads) {
+		entries.push_back(MeshFileSectionEntry{ .type = static_cast<uint32_t>(payload.type), .offset = offset, .size = payload.size });
+		offset = alignSection(offset + payload.size);
+	}
+
+	const PositionDecode& decode = mesh.getPositionDecode();
+	MeshFileHeader header{
+		.magic = MESH_FILE_MAGIC,
+		.version = MESH_FILE_VERSION,
+		.fileSize = offset,
+		.positionFormat = static_cast<uint32_t>(mesh.getLayout().position),
+		.normalFormat = static_cast<uint32_t>(mesh.getLayout().normal),
+		.indexType = static_cast<uint32_t>(mesh.getIndexType()),
+		.vertexCount = mesh.getVertexCount(),
+		.indexCount = mesh.getIndexCount(),
+		.sectionCount = static_cast<uint32_t>(entries.size()),
+		.decodeScale = { decode.scale.x, decode.scale.y, decode.scale.z },
+		.decodeOffset = { decode.offset.x, decode.offset.y, decode.offset.z }
+	};
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(MeshFileSectionEntry));
+	const char padding[MESH_FILE_SECTION_ALIGNMENT]{};
+	uint64_t written = sizeof(header) + entries.size() * sizeof(MeshFileSectionEntry);
+	for (size_t i = 0; i < entries.size(); i++) {
+		out.write(padding, static_cast<std::streamsize>(entries[i].offset - written));
+		out.write(static_cast<const char*>(payloads[i].pData), static_cast<std::streamsize>(payloads[i].size));
+		written = entries[i].offset + payloads[i].size;
+	}
+	out.write(padding, static_cast<std::streamsize>(offset - written));
+	if (!out) {
+		throw std::runtime_error("Failed to write mesh file " + path.string());
+	}
+	return offset;
+}
+
+VertexLayout MeshFile::getLayout() const {
+	return VertexLayout{
+		.position = static_cast<PositionFormat>(m_pHeader->positionFormat),
+		.normal = static_cast<NormalFormat>(m_pHeader->normalFormat)
+	};
+}
+
+PositionDecode MeshFile::getPositionDecode() const {
+	return PositionDecode{
+		.scale = glm::vec3(m_pHeader->decodeScale[0], m_pHeader->decodeScale[1], m_pHeader->decodeScale[2]),
+		.offset = glm::vec3(m_pHeader->decodeOffset[0], m_pHeader->decodeOffset[1], m_pHeader->decodeOffset[2])
+	};
+}
+
+VkIndexType MeshFile::getIndexType() const {
+	return static_cast<VkIndexType>(m_pHeader->indexType);
+}
+
+uint32_t MeshFile::getVertexCount() const {
+	return m_pHeader->vertexCount;
+}
+
+uint32_t MeshFile::getIndexCount() const {
+	return m_pHeader->indexCount;
+}
+
+const MeshFileBounds& MeshFile::getBounds() const {
+	return *reinterpret_cast<const MeshFileBounds*>(getSection(MeshSection::Bounds).data());
+}
+
+std::span<const MeshFileLod> MeshFile::getLods() const {
+	std::span<const std::byte> lods = getSection(MeshSection::Lods);
+	return std::span<const MeshFileLod>(reinterpret_cast<const MeshFileLod*>(lods.data()), lods.size() / sizeof(MeshFileLod));
+}
+
+std::span<const std::byte> MeshFile::getVertexData() const {
+	return getSection(MeshSection::Vertices);
+}
+
+std::span<const std::byte> MeshFile::getIndexData() const {
+	return getSection(MeshSection::Indices);
+}
+
+size_t MeshFile::getFileSize() const {
+	return m_file.size();
+}
+
+std::span<const std::byte> MeshFile::getSection(MeshSection section) const {
+	return m_sections[static_cast<uint32_t>(section)];
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "MeshImport.h"
+
+#include <unordered_map>
+#include <charconv>
+#include <stdexcept>
+#include <cmath>
+#include <algorithm>
+
+static std::string_view nextToken(std::string_view& line) {
+	size_t start = line.find_first_not_of(" \t\r");
+	if (start == std::string_view::npos) {
+		line = {};
+		return {};
+	}
+	size_t end = line.find_first_of(" \t\r", start);
+	std::string_view token = line.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+	line = end == std::string_view::npos ? std::string_view{} : line.substr(end);
+	return token;
+}
+
+static float parseFloat(std::string_view token, size_t lineNumber) {
+	float value = 0.0f;
+	auto [ptr, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+	if (error != std::errc{}) {
+		throw std::runtime_error("Failed to parse OBJ number on line " + std::to_string(lineNumber));
+	}
+	return value;
+}
+
+//OBJ indices are 1-based, negative ones count back from the latest element. Returns -1 for an empty field.
+static int64_t parseIndex(std::string_view field, size_t elementCount, size_t lineNumber) {
+	if (field.empty()) {
+		return -1;
+	}
+	int64_t index = 0;
+	auto [ptr, error] = std::from_chars(field.data(), field.data() + field.size(), index);
+	if (error != std::errc{} || index == 0) {
+		throw std::runtime_error("Failed to parse OBJ index on line " + std::to_string(lineNumber));
+	}
+	index = index > 0 ? index - 1 : static_cast<int64_t>(elementCount) + index;
+	if (index < 0 || index >= static_cast<int64_t>(elementCount)) {
+		throw std::runtime_error("OBJ index out of range on line " + std::to_string(lineNumber));
+	}
+	return index;
+}
+
+ImportedMesh MeshImport::parseObj(std::string_view text) {
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::unordered_map<uint64_t, uint32_t> vertexIndices; //(position, normal + 1) -> output vertex
+	std::vector<int64_t> vertexPositions; //source position of each output vertex without a normal, -1 otherwise
+	ImportedMesh mesh;
+
+	std::vector<uint32_t> polygon;
+	size_t lineNumber = 0;
+	while (!text.empty()) {
+		size_t lineEnd = text.find('\n');
+		std::string_view line = text.substr(0, lineEnd);
+		text = lineEnd == std::string_view::npos ? std::string_view{} : text.substr(lineEnd + 1);
+		lineNumber++;
+
+		std::string_view keyword = nextToken(line);
+		if (keyword == "v" || keyword == "vn") {
+			glm::vec3 value;
+			for (int i = 0; i < 3; i++) {
+				value[i] = parseFloat(nextToken(line), lineNumber);
+			}
+			(keyword == "v" ? positions : normals).push_back(value);
+		}
+		else if (keyword == "f") {
+			polygon.clear();
+			for (std::string_view corner = nextToken(line); !corner.empty(); corner = nextToken(line)) {
+				size_t firstSlash = corner.find('/');
+				size_t lastSlash = corner.rfind('/');
+				int64_t position = parseIndex(corner.substr(0, firstSlash), positions.size(), lineNumber);
+				int64_t normal = firstSlash != std::string_view::npos && lastSlash != firstSlash
+					? parseIndex(corner.substr(lastSlash + 1), normals.size(), lineNumber)
+					: -1;
+				if (position < 0) {
+					throw std::runtime_error("OBJ face without a position on line " + std::to_string(lineNumber));
+				}
+
+				uint64_t key = (static_cast<uint64_t>(position) << 32) | static_cast<uint64_t>(normal + 1);
+				auto [it, inserted] = vertexIndices.try_emplace(key, static_cast<uint32_t>(mesh.vertices.size()));
+				if (inserted) {
+					mesh.vertices.push_back(Vertex{ .pos = positions[position], .normal = normal >= 0 ? normals[normal] : glm::vec3(0.0f) });
+					vertexPositions.push_back(normal >= 0 ? -1 : position);
+				}
+				polygon.push_back(it->second);
+			}
+			if (polygon.size() < 3) {
+				throw std::runtime_error("OBJ face with fewer than three corners on line " + std::to_string(lineNumber));
+			}
+			for (size_t i = 1; i + 1 < polygon.size(); i++) {
+				mesh.indices.insert(mesh.indices.end(), { polygon[0], polygon[i], polygon[i + 1] });
+			}
+		}
+		//Comments, texture coordinates, groups and materials are not needed for geometry
+	}
+
+	//Area weighted smooth normals for the vertices that came without one, shared across every vertex of the same position
+	bool missingNormals = std::find_if(vertexPositions.begin(), vertexPositions.end(), [](int64_t p) { return p >= 0; }) != vertexPositions.end();
+	if (missingNormals) {
+		std::vector<glm::vec3> accumulated(positions.size(), glm::vec3(0.0f));
+		for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+			const glm::vec3& a = mesh.vertices[mesh.indices[i]].pos;
+			const glm::vec3& b = mesh.vertices[mesh.indices[i + 1]].pos;
+			const glm::vec3& c = mesh.vertices[mesh.indices[i + 2]].pos;
+			glm::vec3 faceNormal = glm::cross(b - a, c - a);
+			for (size_t corner = 0; corner < 3; corner++) {
+				int64_t position = vertexPositions[mesh.indices[i + corner]];
+				if (position >= 0) {
+					accumulated[position] += faceNormal;
+				}
+			}
+		}
+		for (size_t i = 0; i < mesh.vertices.size(); i++) {
+			if (vertexPositions[i] >= 0) {
+				glm::vec3 normal = accumulated[vertexPositions[i]];
+				float length = glm::length(normal);
+				mesh.vertices[i].normal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+			}
+		}
+	}
+	return mesh;
+}
+
+ImportedMesh MeshImport::loadObj(const std::filesystem::path& path) {
+	MappedFile file{ path };
+	return parseObj(std::string_view(reinterpret_cast<const char*>(file.data()), file.size()));
+}
+
+void MeshImport::writeObj(std::ostream& out, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+	for (const Vertex& vertex : vertices) {
+		out << "v " << vertex.pos.x << " " << vertex.pos.y << " " << vertex.pos.z << "\n";
+	}
+	for (const Vertex& vertex : vertices) {
+		out << "vn " << vertex.normal.x << " " << vertex.normal.y << " " << vertex.normal.z << "\n";
+	}
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		out << "f";
+		for (size_t corner = 0; corner < 3; corner++) {
+			uint32_t index = indices[i + corner] + 1;
+			out << " " << index << "//" << index;
+		}
+		out << "\n";
+	}
+}
\ No newline at end of file
@@ -0,0 +1,323 @@
+#include "MeshLod.h"
+
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cmath>
+
+//Symmetric 4x4 error matrix of a set of planes. Evaluating it at a point gives the area weighted sum of squared
+//distances to the planes, dividing by the weight turns that into a mean squared distance.
+struct Quadric {
+	double a00, a01, a02, a11, a12, a22;
+	double b0, b1, b2;
+	double c;
+	double weight;
+};
+
+struct EdgeCollapse {
+	uint32_t from;
+	uint32_t to;
+	double cost;
+};
+
+static Quadric planeQuadric(const glm::dvec3& normal, double distance, double weight) {
+	return Quadric{
+		.a00 = normal.x * normal.x * weight, .a01 = normal.x * normal.y * weight, .a02 = normal.x * normal.z * weight,
+		.a11 = normal.y * normal.y * weight, .a12 = normal.y * normal.z * weight, .a22 = normal.z * normal.z * weight,
+		.b0 = normal.x * distance * weight, .b1 = normal.y * distance * weight, .b2 = normal.z * distance * weight,
+		.c = distance * distance * weight,
+		.weight = weight
+	};
+}
+
+static Quadric addQuadrics(const Quadric& a, const Quadric& b) {
+	return Quadric{
+		.a00 = a.a00 + b.a00, .a01 = a.a01 + b.a01, .a02 = a.a02 + b.a02,
+		.a11 = a.a11 + b.a11, .a12 = a.a12 + b.a12, .a22 = a.a22 + b.a22,
+		.b0 = a.b0 + b.b0, .b1 = a.b1 + b.b1, .b2 = a.b2 + b.b2,
+		.c = a.c + b.c,
+		.weight = a.weight + b.weight
+	};
+}
+
+static double quadricError(const Quadric& q, const glm::dvec3& p) {
+	double error = q.a00 * p.x * p.x + q.a11 * p.y * p.y + q.a22 * p.z * p.z
+		+ 2.0 * (q.a01 * p.x * p.y + q.a02 * p.x * p.z + q.a12 * p.y * p.z)
+		+ 2.0 * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z) + q.c;
+	return q.weight > 0.0 ? std::max(error, 0.0) / q.weight : 0.0;
+}
+
+//Moving a corner of a triangle must not turn it over or collapse it into a sliver
+static bool collapseFlips(const glm::dvec3& moved, const glm::dvec3& target, const glm::dvec3& b, const glm::dvec3& c) {
+	glm::dvec3 before = glm::cross(b - moved, c - moved);
+	glm::dvec3 after = glm::cross(b - target, c - target);
+	return glm::dot(before, after) < 0.25 * glm::length(before) * glm::length(after) || glm::dot(after, after) == 0.0;
+}
+
+//Simplifies towards each target in turn, descending, and snapshots the indices and error as every one is reached.
+//Quadrics keep accumulating across targets, so coarser levels are still measured against the original surface.
+static void simplifyLevels(std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::span<const uint32_t> targetIndexCounts,
+	float targetError, std::vector<std::vector<uint32_t>>& levels, std::vector<float>& errors) {
+	std::vector<uint32_t> result(indices.begin(), indices.end());
+	uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+	std::vector<glm::dvec3> positions(vertexCount);
+	for (uint32_t i = 0; i < vertexCount; i++) {
+		positions[i] = glm::dvec3(vertices[i].pos);
+	}
+
+	//Collapses work on positions, vertices split only by their normal map to the first vertex of their position.
+	//positionOrder lists the vertices grouped by position, the group of a position id starts at positionGroups[id].
+	std::vector<uint32_t> positionIds(vertexCount);
+	std::vector<uint32_t> positionOrder(vertexCount);
+	std::vector<uint32_t> positionGroups(vertexCount);
+	std::vector<uint8_t> locked(vertexCount, 0);
+	{
+		std::iota(positionOrder.begin(), positionOrder.end(), 0);
+		auto less = [&vertices](uint32_t a, uint32_t b) {
+			const glm::vec3& pa = vertices[a].pos;
+			const glm::vec3& pb = vertices[b].pos;
+			return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+		};
+		std::sort(positionOrder.begin(), positionOrder.end(), [&less](uint32_t a, uint32_t b) { return less(a, b) || (!less(b, a) && a < b); });
+		for (size_t i = 0; i < positionOrder.size();) {
+			size_t end = i + 1;
+			while (end < positionOrder.size() && !less(positionOrder[i], positionOrder[end])) {
+				end++;
+			}
+			positionGroups[positionOrder[i]] = static_cast<uint32_t>(i);
+			for (size_t j = i; j < end; j++) {
+				positionIds[positionOrder[j]] = positionOrder[i];
+				locked[positionOrder[j]] = end - i > 1;
+			}
+			i = end;
+		}
+	}
+	//Each corner keeps the vertex it indexes next to its position id, the levels are written from the corners
+	std::vector<uint32_t> corners(indices.begin(), indices.end());
+	for (uint32_t& index : result) {
+		index = positionIds[index];
+	}
+	//Only unlocked positions collapse, and those hold a single vertex. When the target is a seam the corners move to
+	//the vertex there whose normal matches theirs, so hard edges stay hard.
+	auto matchVertex = [&](uint32_t position, uint32_t vertex) {
+		uint32_t best = position;
+		float bestDot = -std::numeric_limits<float>::max();
+		for (uint32_t i = positionGroups[position]; i < vertexCount && positionIds[positionOrder[i]] == position; i++) {
+			float d = glm::dot(vertices[positionOrder[i]].normal, vertices[vertex].normal);
+			if (d > bestDot) {
+				best = positionOrder[i];
+				bestDot = d;
+			}
+		}
+		return best;
+	};
+
+	//Edges used by exactly two triangles are interior, anything else is a border or non-manifold
+	{
+		std::vector<uint64_t> edges;
+		edges.reserve(result.size());
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (uint32_t e = 0; e < 3; e++) {
+				uint32_t a = result[i + e];
+				uint32_t b = result[i + (e + 1) % 3];
+				edges.push_back((static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for (size_t i = 0; i < edges.size();) {
+			size_t end = i + 1;
+			while (end < edges.size() && edges[end] == edges[i]) {
+				end++;
+			}
+			if (end - i != 2) {
+				locked[static_cast<uint32_t>(edges[i] >> 32)] = 1;
+				locked[static_cast<uint32_t>(edges[i])] = 1;
+			}
+			i = end;
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t i = 0; i < result.size(); i += 3) {
+		const glm::dvec3& p0 = positions[result[i]];
+		glm::dvec3 normal = glm::cross(positions[result[i + 1]] - p0, positions[result[i + 2]] - p0);
+		double doubleArea = glm::length(normal);
+		if (doubleArea == 0.0) {
+			continue;
+		}
+		normal /= doubleArea;
+		Quadric plane = planeQuadric(normal, -glm::dot(normal, p0), doubleArea * 0.5);
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			quadrics[result[i + corner]] = addQuadrics(quadrics[result[i + corner]], plane);
+		}
+	}
+
+	//Each pass ranks the cheapest collapse of every vertex and applies those whose neighbourhoods do not overlap,
+	//so the triangles a collapse inspects cannot change under it within the pass
+	double maxCost = static_cast<double>(targetError) * targetError;
+	double resultCost = 0.0;
+	std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<uint32_t> collapseTargets(vertexCount);
+	std::vector<uint32_t> collapseVertices(vertexCount);
+	std::vector<uint8_t> touched(vertexCount);
+	std::vector<EdgeCollapse> bestCollapses(vertexCount);
+	std::vector<EdgeCollapse> candidates;
+	for (uint32_t targetIndexCount : targetIndexCounts) {
+		size_t targetTriangles = targetIndexCount / 3;
+		while (result.size() / 3 > targetTriangles) {
+			size_t triangleCount = result.size() / 3;
+			std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+			for (uint32_t index : result) {
+				triangleOffsets[index + 1]++;
+			}
+			std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+			vertexTriangles.resize(result.size());
+			std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++) {
+				vertexTriangles[cursor[result[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+
+			//Interior edges show up once per direction across their two triangles, so each triangle edge only offers a -> b
+			std::fill(bestCollapses.begin(), bestCollapses.end(), EdgeCollapse{ 0, 0, std::numeric_limits<double>::max() });
+			for (size_t i = 0; i < result.size(); i += 3) {
+				for (uint32_t e = 0; e < 3; e++) {
+					uint32_t a = result[i + e];
+					uint32_t b = result[i + (e + 1) % 3];
+					if (!locked[a]) {
+						double cost = quadricError(addQuadrics(quadrics[a], quadrics[b]), positions[b]);
+						if (cost < bestCollapses[a].cost) {
+							bestCollapses[a] = EdgeCollapse{ a, b, cost };
+						}
+					}
+				}
+			}
+			candidates.clear();
+			for (const EdgeCollapse& collapse : bestCollapses) {
+				if (collapse.cost <= maxCost) {
+					candidates.push_back(collapse);
+				}
+			}
+			std::sort(candidates.begin(), candidates.end(), [](const EdgeCollapse& a, const EdgeCollapse& b) { return a.cost < b.cost; });
+
+			std::iota(collapseTargets.begin(), collapseTargets.end(), 0);
+			std::fill(touched.begin(), touched.end(), 0);
+			size_t removed = 0;
+			size_t removeBudget = triangleCount - targetTriangles;
+			for (const EdgeCollapse& collapse : candidates) {
+				if (removed >= removeBudget || collapse.cost > maxCost) {
+					break;
+				}
+				if (touched[collapse.from] || touched[collapse.to]) {
+					continue;
+				}
+
+				bool flips = false;
+				uint32_t sharedTriangles = 0;
+				for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && !flips; t++) {
+					const uint32_t* pTriangle = &result[static_cast<size_t>(vertexTriangles[t]) * 3];
+					if (pTriangle[0] == collapse.to || pTriangle[1] == collapse.to || pTriangle[2] == collapse.to) {
+						sharedTriangles++;
+						continue;
+					}
+					uint32_t corner = pTriangle[0] == collapse.from ? 0 : pTriangle[1] == collapse.from ? 1 : 2;
+					flips = collapseFlips(positions[collapse.from], positions[collapse.to], positions[pTriangle[(corner + 1) % 3]],
+						positions[pTriangle[(corner + 2) % 3]]);
+				}
+				if (flips) {
+					continue;
+				}
+
+				for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; t++) {
+					const uint32_t* pTriangle = &result[static_cast<size_t>(vertexTriangles[t]) * 3];
+					touched[pTriangle[0]] = touched[pTriangle[1]] = touched[pTriangle[2]] = 1;
+				}
+				collapseTargets[collapse.from] = collapse.to;
+				collapseVertices[collapse.from] = matchVertex(collapse.to, collapse.from);
+				quadrics[collapse.to] = addQuadrics(quadrics[collapse.to], quadrics[collapse.from]);
+				resultCost = std::max(resultCost, collapse.cost);
+				removed += sharedTriangles;
+			}
+			if (removed == 0) {
+				break;
+			}
+
+			size_t write = 0;
+			for (size_t i = 0; i < result.size(); i += 3) {
+				uint32_t a = collapseTargets[result[i]];
+				uint32_t b = collapseTargets[result[i + 1]];
+				uint32_t c = collapseTargets[result[i + 2]];
+				if (a != b && b != c && c != a) {
+					for (uint32_t corner = 0; corner < 3; corner++) {
+						uint32_t position = result[i + corner];
+						corners[write] = collapseTargets[position] != position ? collapseVertices[position] : corners[i + corner];
+						result[write++] = collapseTargets[position];
+					}
+				}
+			}
+			result.resize(write);
+			corners.resize(write);
+		}
+		levels.push_back(corners);
+		errors.push_back(static_cast<float>(std::sqrt(resultCost)));
+	}
+}
+
+std::vector<uint32_t> MeshLod::simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices, uint32_t targetIndexCount,
+	float targetError, float* pResultError) {
+	std::vector<std::vector<uint32_t>> levels;
+	std::vector<float> errors;
+	simplifyLevels(vertices, indices, { &targetIndexCount, 1 }, targetError, levels, errors);
+	if (pResultError != nullptr) {
+		*pResultError = errors.front();
+	}
+	return std::move(levels.front());
+}
+
+LodChain MeshLod::buildChain(std::span<const Vertex> vertices, std::span<const uint32_t> indices) {
+	std::vector<uint32_t> targetIndexCounts;
+	float targetTriangles = static_cast<float>(indices.size() / 3) * LOD_REDUCTION_RATIO;
+	while (targetIndexCounts.size() + 1 < MAX_MESH_LODS && targetTriangles >= LOD_MIN_TRIANGLES) {
+		targetIndexCounts.push_back(static_cast<uint32_t>(targetTriangles) * 3);
+		targetTriangles *= LOD_REDUCTION_RATIO;
+	}
+	std::vector<std::vector<uint32_t>> levels;
+	std::vector<float> errors;
+	simplifyLevels(vertices, indices, targetIndexCounts, std::numeric_limits<float>::max(), levels, errors);
+
+	LodChain chain{ .indices = std::vector<uint32_t>(indices.begin(), indices.end()) };
+	chain.levels.push_back(MeshLodLevel{ .firstIndex = 0, .indexCount = static_cast<uint32_t>(indices.size()), .error = 0.0f });
+	for (size_t i = 0; i < levels.size(); i++) {
+		//Locked borders and seams can stall the simplifier, a level that barely shrinks is not worth its memory
+		const MeshLodLevel& previous = chain.levels.back();
+		if (levels[i].size() * 10 > static_cast<size_t>(previous.indexCount) * 9) {
+			break;
+		}
+		chain.levels.push_back(MeshLodLevel{
+			.firstIndex = static_cast<uint32_t>(chain.indices.size()),
+			.indexCount = static_cast<uint32_t>(levels[i].size()),
+			.error = errors[i]
+		});
+		chain.indices.insert(chain.indices.end(), levels[i].begin(), levels[i].end());
+	}
+	return chain;
+}
+
+float MeshLod::projectionScale(float fovY, float viewportHeight, float thresholdPixels) {
+	return viewportHeight / (2.0f * std::tan(fovY * 0.5f)) / thresholdPixels;
+}
+
+float MeshLod::transformScale(const glm::mat4& transform) {
+	float scaleSq = std::max({ glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])), glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+		glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2])) });
+	return std::sqrt(scaleSq);
+}
+
+uint32_t MeshLod::selectLod(std::span<const MeshLodLevel> lods, float errorScale, float distance, float projectionScale) {
+	for (uint32_t i = static_cast<uint32_t>(lods.size()); i-- > 1;) {
+		if (lods[i].error * errorScale * projectionScale <= distance) {
+			return i;
+		}
+	}
+	return 0;
+}
\ No newline at end of file
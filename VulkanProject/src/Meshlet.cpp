@@ -0,0 +1,494 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MESHLET_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define MESHLET_TARGET_AVX2
+#else
+#define MESHLET_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+//Normals closer than this to perpendicular to the average make the cone too wide to ever reject anything
+constexpr float MIN_CONE_SPREAD = 0.1f;
+
+//Vertex to triangle adjacency in compressed rows, the triangles of vertex v are adjacency[offsets[v]..offsets[v + 1])
+static void buildAdjacency(std::span<const uint32_t> indices, uint32_t vertexCount, std::vector<uint32_t>& offsets, std::vector<uint32_t>& adjacency) {
+	size_t indexCount = indices.size() / 3 * 3;
+	offsets.assign(vertexCount + 1, 0);
+	for (size_t i = 0; i < indexCount; i++) {
+		offsets[indices[i] + 1]++;
+	}
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		offsets[v + 1] += offsets[v];
+	}
+	adjacency.resize(indexCount);
+	std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < indexCount; i++) {
+		adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+}
+
+void Meshlets::optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	//liveCount tracks the triangles of each vertex not yet emitted
+	std::vector<uint32_t> adjacencyOffsets;
+	std::vector<uint32_t> adjacency;
+	buildAdjacency(indices, vertexCount, adjacencyOffsets, adjacency);
+	std::vector<uint32_t> liveCount(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; v++) {
+		liveCount[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+	}
+
+	//A vertex is in the simulated FIFO cache while fewer than cacheSize misses happened since its own
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+	uint32_t cursor = 0;
+
+	uint32_t fanning = indices[0];
+	while (fanning != ~0u) {
+		//Emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+			uint32_t triangle = adjacency[a];
+			if (emitted[triangle]) {
+				continue;
+			}
+			emitted[triangle] = 1;
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t v = indices[triangle * 3 + k];
+				result.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				liveCount[v]--;
+				if (time - cacheTime[v] > cacheSize) {
+					cacheTime[v] = time++;
+				}
+			}
+		}
+
+		//Next fan is the candidate that stays cached longest while its remaining triangles are emitted
+		fanning = ~0u;
+		int64_t bestPriority = -1;
+		for (uint32_t v : candidates) {
+			if (liveCount[v] == 0) {
+				continue;
+			}
+			int64_t priority = 0;
+			if (time - cacheTime[v] + 2 * liveCount[v] <= cacheSize) {
+				priority = time - cacheTime[v];
+			}
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				fanning = v;
+			}
+		}
+
+		//Dead end: back up through recently used vertices, then scan for any vertex with triangles left
+		while (fanning == ~0u && !deadEnds.empty()) {
+			uint32_t v = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveCount[v] > 0) {
+				fanning = v;
+			}
+		}
+		while (fanning == ~0u && cursor < vertexCount) {
+			if (liveCount[cursor] > 0) {
+				fanning = cursor;
+			}
+			cursor++;
+		}
+	}
+	std::copy(result.begin(), result.end(), indices.begin());
+}
+
+float Meshlets::averageCacheMissRatio(std::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize) {
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return 0.0f;
+	}
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+	uint64_t misses = 0;
+	for (size_t i = 0; i < triangleCount * 3; i++) {
+		if (time - cacheTime[indices[i]] > cacheSize) {
+			cacheTime[indices[i]] = time++;
+			misses++;
+		}
+	}
+	return static_cast<float>(static_cast<double>(misses) / static_cast<double>(triangleCount));
+}
+
+static void pushBounds(MeshletBounds& bounds, const glm::vec3& center, float radius, const glm::vec3& coneApex, const glm::vec3& coneAxis,
+	float coneCutoff) {
+	bounds.centerX.push_back(center.x);
+	bounds.centerY.push_back(center.y);
+	bounds.centerZ.push_back(center.z);
+	bounds.radius.push_back(radius);
+	bounds.coneApexX.push_back(coneApex.x);
+	bounds.coneApexY.push_back(coneApex.y);
+	bounds.coneApexZ.push_back(coneApex.z);
+	bounds.coneAxisX.push_back(coneAxis.x);
+	bounds.coneAxisY.push_back(coneAxis.y);
+	bounds.coneAxisZ.push_back(coneAxis.z);
+	bounds.coneCutoff.push_back(coneCutoff);
+}
+
+//Bounding sphere around the box of the meshlet's vertices, and a cone (apex, axis, cutoff) containing every triangle
+//normal, with the apex placed so that each triangle's plane lies on or behind it
+static void computeBounds(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const Meshlet& meshlet, MeshletBounds& bounds) {
+	std::span<const uint32_t> triangles = indices.subspan(meshlet.firstIndex, meshlet.triangleCount * 3);
+	glm::vec3 boxMin = vertices[triangles[0]].pos;
+	glm::vec3 boxMax = boxMin;
+	for (uint32_t index : triangles) {
+		boxMin = glm::min(boxMin, vertices[index].pos);
+		boxMax = glm::max(boxMax, vertices[index].pos);
+	}
+	glm::vec3 center = (boxMin + boxMax) * 0.5f;
+	float radius = 0.0f;
+	for (uint32_t index : triangles) {
+		radius = std::max(radius, glm::length(vertices[index].pos - center));
+	}
+
+	//Degenerate triangles keep a zero normal and are skipped, they face nowhere
+	std::vector<glm::vec3> normals(meshlet.triangleCount, glm::vec3(0.0f));
+	glm::vec3 axis{ 0.0f };
+	for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+		glm::vec3 p0 = vertices[triangles[t * 3]].pos;
+		glm::vec3 normal = glm::cross(vertices[triangles[t * 3 + 1]].pos - p0, vertices[triangles[t * 3 + 2]].pos - p0);
+		float length = glm::length(normal);
+		if (length > 0.0f) {
+			normals[t] = normal / length;
+			axis += normals[t];
+		}
+	}
+	float axisLength = glm::length(axis);
+	if (axisLength == 0.0f) {
+		pushBounds(bounds, center, radius, center, glm::vec3(0.0f), MESHLET_NO_CONE_CUTOFF);
+		return;
+	}
+	axis /= axisLength;
+
+	float minDot = 1.0f;
+	for (const glm::vec3& normal : normals) {
+		if (glm::dot(normal, normal) > 0.0f) {
+			minDot = std::min(minDot, glm::dot(normal, axis));
+		}
+	}
+	if (minDot <= MIN_CONE_SPREAD) {
+		pushBounds(bounds, center, radius, center, axis, MESHLET_NO_CONE_CUTOFF);
+		return;
+	}
+
+	//Move the apex back along the axis until it is behind every triangle's plane
+	float apexDistance = 0.0f;
+	for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+		if (glm::dot(normals[t], normals[t]) > 0.0f) {
+			apexDistance = std::max(apexDistance, glm::dot(center - vertices[triangles[t * 3]].pos, normals[t]) / glm::dot(axis, normals[t]));
+		}
+	}
+	pushBounds(bounds, center, radius, center - axis * apexDistance, axis, std::sqrt(1.0f - minDot * minDot));
+}
+
+MeshletSet Meshlets::build(std::span<const Vertex> vertices, std::span<uint32_t> indices, std::span<const MeshLodLevel> lods) {
+	MeshletSet set{};
+	uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+	//Vertices are tagged with the meshlet that last used them, so starting a new meshlet needs no clearing
+	std::vector<uint32_t> meshletOfVertex(vertexCount, ~0u);
+	std::vector<uint32_t> adjacencyOffsets;
+	std::vector<uint32_t> adjacency;
+	std::vector<uint32_t> ordered;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> localMeshlet(vertexCount, ~0u);
+	std::vector<uint32_t> localIndex(vertexCount);
+	std::vector<uint32_t> localVertices;
+
+	for (const MeshLodLevel& lod : lods) {
+		set.lodFirstMeshlet.push_back(static_cast<uint32_t>(set.meshlets.size()));
+		std::span<uint32_t> levelIndices = indices.subspan(lod.firstIndex, lod.indexCount / 3 * 3);
+		uint32_t triangleCount = static_cast<uint32_t>(levelIndices.size() / 3);
+		optimizeVertexCache(levelIndices, vertexCount);
+		buildAdjacency(levelIndices, vertexCount, adjacencyOffsets, adjacency);
+
+		std::vector<glm::vec3> centroids(triangleCount);
+		for (uint32_t t = 0; t < triangleCount; t++) {
+			centroids[t] = (vertices[levelIndices[t * 3]].pos + vertices[levelIndices[t * 3 + 1]].pos + vertices[levelIndices[t * 3 + 2]].pos) / 3.0f;
+		}
+		std::vector<uint8_t> assigned(triangleCount, 0);
+		ordered.clear();
+		size_t levelFirstMeshlet = set.meshlets.size();
+
+		//Each meshlet is seeded with the first unassigned triangle in cache order and grows over shared vertices,
+		//taking the neighbour that adds the fewest vertices and then the one closest to the meshlet's centre. Growing
+		//by adjacency instead of cutting the cache ordered list keeps meshlets round, which tightens their spheres
+		//and normal cones.
+		uint32_t seed = 0;
+		while (true) {
+			while (seed < triangleCount && assigned[seed]) {
+				seed++;
+			}
+			if (seed == triangleCount) {
+				break;
+			}
+			uint32_t id = static_cast<uint32_t>(set.meshlets.size());
+			Meshlet meshlet{ .firstIndex = lod.firstIndex + static_cast<uint32_t>(ordered.size()), .triangleCount = 0, .vertexCount = 0 };
+			glm::vec3 centroidSum{ 0.0f };
+			candidates.clear();
+
+			auto newVertices = [&](uint32_t triangle) {
+				const uint32_t* pTriangle = levelIndices.data() + triangle * 3;
+				uint32_t count = 0;
+				for (uint32_t k = 0; k < 3; k++) {
+					bool repeated = (k > 0 && pTriangle[k] == pTriangle[0]) || (k > 1 && pTriangle[k] == pTriangle[1]);
+					count += meshletOfVertex[pTriangle[k]] != id && !repeated;
+				}
+				return count;
+			};
+			auto addTriangle = [&](uint32_t triangle) {
+				const uint32_t* pTriangle = levelIndices.data() + triangle * 3;
+				meshlet.vertexCount += newVertices(triangle);
+				for (uint32_t k = 0; k < 3; k++) {
+					if (meshletOfVertex[pTriangle[k]] != id) {
+						meshletOfVertex[pTriangle[k]] = id;
+						uint32_t v = pTriangle[k];
+						candidates.insert(candidates.end(), adjacency.begin() + adjacencyOffsets[v], adjacency.begin() + adjacencyOffsets[v + 1]);
+					}
+					ordered.push_back(pTriangle[k]);
+				}
+				assigned[triangle] = 1;
+				centroidSum += centroids[triangle];
+				meshlet.triangleCount++;
+			};
+
+			addTriangle(seed);
+			while (meshlet.triangleCount < MESHLET_MAX_TRIANGLES) {
+				glm::vec3 center = centroidSum / static_cast<float>(meshlet.triangleCount);
+				uint32_t best = ~0u;
+				uint32_t bestAdded = 4;
+				float bestDistance = 0.0f;
+				//Candidates are the triangles around the meshlet's vertices, assigned ones are dropped as they are found
+				size_t kept = 0;
+				for (uint32_t triangle : candidates) {
+					if (assigned[triangle]) {
+						continue;
+					}
+					candidates[kept++] = triangle;
+					uint32_t added = newVertices(triangle);
+					if (meshlet.vertexCount + added > MESHLET_MAX_VERTICES || added > bestAdded) {
+						continue;
+					}
+					glm::vec3 offset = centroids[triangle] - center;
+					float distance = glm::dot(offset, offset);
+					if (added < bestAdded || distance < bestDistance) {
+						best = triangle;
+						bestAdded = added;
+						bestDistance = distance;
+					}
+				}
+				candidates.resize(kept);
+				if (best == ~0u) {
+					break;
+				}
+				addTriangle(best);
+			}
+			set.meshlets.push_back(meshlet);
+		}
+
+		//Meshlets are drawn as one range each, so the cache order only has to hold within them. Each is optimized on
+		//meshlet local indices, which keeps the optimizer's tables at MESHLET_MAX_VERTICES entries.
+		std::copy(ordered.begin(), ordered.end(), levelIndices.begin());
+		for (size_t m = levelFirstMeshlet; m < set.meshlets.size(); m++) {
+			const Meshlet& meshlet = set.meshlets[m];
+			std::span<uint32_t> meshletIndices = indices.subspan(meshlet.firstIndex, meshlet.triangleCount * 3);
+			localVertices.clear();
+			for (uint32_t& index : meshletIndices) {
+				if (localMeshlet[index] != m) {
+					localMeshlet[index] = static_cast<uint32_t>(m);
+					localIndex[index] = static_cast<uint32_t>(localVertices.size());
+					localVertices.push_back(index);
+				}
+				index = localIndex[index];
+			}
+			optimizeVertexCache(meshletIndices, static_cast<uint32_t>(localVertices.size()));
+			for (uint32_t& index : meshletIndices) {
+				index = localVertices[index];
+			}
+			computeBounds(vertices, indices, meshlet, set.bounds);
+		}
+	}
+	set.lodFirstMeshlet.push_back(static_cast<uint32_t>(set.meshlets.size()));
+
+	for (uint32_t i = 0; i < MESHLET_BOUNDS_PADDING; i++) {
+		pushBounds(set.bounds, glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), glm::vec3(0.0f), MESHLET_NO_CONE_CUTOFF);
+	}
+	return set;
+}
+
+MeshletCullView Meshlets::makeView(const Frustum& frustum, const glm::vec3& eye, const glm::mat4& transform) {
+	//A mesh space point q is inside a world plane p when dot(p, transform * q) >= 0, which is dot(transpose(transform) * p, q)
+	MeshletCullView view{};
+	for (int p = 0; p < 6; p++) {
+		const glm::vec4& plane = frustum.planes[p];
+		glm::vec4 meshPlane(glm::dot(transform[0], plane), glm::dot(transform[1], plane), glm::dot(transform[2], plane), glm::dot(transform[3], plane));
+		float length = glm::length(glm::vec3(meshPlane));
+		view.frustum.planes[p] = length > 0.0f ? meshPlane / length : meshPlane;
+	}
+	view.eye = glm::vec3(glm::inverse(transform) * glm::vec4(eye, 1.0f));
+	return view;
+}
+
+//Same operation order as the SIMD paths so all paths agree bit for bit
+uint32_t Meshlets::cullScalar(const MeshletCullView& view, const MeshletBounds& bounds, uint32_t first, uint32_t count, uint32_t* pOut) {
+	uint32_t visibleCount = 0;
+	for (uint32_t i = first; i < first + count; i++) {
+		bool inside = true;
+		for (const glm::vec4& plane : view.frustum.planes) {
+			float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w;
+			inside = inside && distance >= -bounds.radius[i];
+		}
+		float dx = bounds.coneApexX[i] - view.eye.x;
+		float dy = bounds.coneApexY[i] - view.eye.y;
+		float dz = bounds.coneApexZ[i] - view.eye.z;
+		float coneDot = dx * bounds.coneAxisX[i] + dy * bounds.coneAxisY[i] + dz * bounds.coneAxisZ[i];
+		bool backFacing = coneDot >= bounds.coneCutoff[i] * std::sqrt(dx * dx + dy * dy + dz * dz);
+		pOut[visibleCount] = i;
+		visibleCount += inside && !backFacing;
+	}
+	return visibleCount;
+}
+
+#ifdef MESHLET_X86
+static uint32_t writeVisibleIndices(uint32_t mask, uint32_t baseIndex, uint32_t* pOut) {
+	uint32_t written = 0;
+	while (mask != 0) {
+#ifdef _MSC_VER
+		unsigned long bit;
+		_BitScanForward(&bit, mask);
+#else
+		uint32_t bit = static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+		pOut[written++] = baseIndex + bit;
+		mask &= mask - 1;
+	}
+	return written;
+}
+
+//Batches run past the end of the range into the next level's meshlets or the padding, the lane mask drops them
+uint32_t Meshlets::cullSse(const MeshletCullView& view, const MeshletBounds& bounds, uint32_t first, uint32_t count, uint32_t* pOut) {
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++) {
+		planeX[p] = _mm_set1_ps(view.frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(view.frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(view.frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(view.frustum.planes[p].w);
+	}
+	const __m128 eyeX = _mm_set1_ps(view.eye.x);
+	const __m128 eyeY = _mm_set1_ps(view.eye.y);
+	const __m128 eyeZ = _mm_set1_ps(view.eye.z);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	uint32_t visibleCount = 0;
+	for (uint32_t i = first; i < first + count; i += 4) {
+		__m128 centerX = _mm_loadu_ps(bounds.centerX.data() + i);
+		__m128 centerY = _mm_loadu_ps(bounds.centerY.data() + i);
+		__m128 centerZ = _mm_loadu_ps(bounds.centerZ.data() + i);
+		__m128 negRadius = _mm_xor_ps(_mm_loadu_ps(bounds.radius.data() + i), signMask);
+		__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], centerX), _mm_mul_ps(planeY[p], centerY)), _mm_mul_ps(planeZ[p], centerZ)), planeW[p]);
+			visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negRadius));
+		}
+
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(bounds.coneApexX.data() + i), eyeX);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(bounds.coneApexY.data() + i), eyeY);
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(bounds.coneApexZ.data() + i), eyeZ);
+		__m128 coneDot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(bounds.coneAxisX.data() + i)), _mm_mul_ps(dy, _mm_loadu_ps(bounds.coneAxisY.data() + i))),
+			_mm_mul_ps(dz, _mm_loadu_ps(bounds.coneAxisZ.data() + i)));
+		__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+		__m128 backFacing = _mm_cmpge_ps(coneDot, _mm_mul_ps(_mm_loadu_ps(bounds.coneCutoff.data() + i), distance));
+		visible = _mm_andnot_ps(backFacing, visible);
+
+		uint32_t remaining = first + count - i;
+		uint32_t laneMask = remaining < 4 ? (1u << remaining) - 1 : 0xfu;
+		visibleCount += writeVisibleIndices(static_cast<uint32_t>(_mm_movemask_ps(visible)) & laneMask, i, pOut + visibleCount);
+	}
+	return visibleCount;
+}
+
+MESHLET_TARGET_AVX2 static uint32_t cullAvx2Impl(const MeshletCullView& view, const MeshletBounds& bounds, uint32_t first, uint32_t count, uint32_t* pOut) {
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++) {
+		planeX[p] = _mm256_set1_ps(view.frustum.planes[p].x);
+		planeY[p] = _mm256_set1_ps(view.frustum.planes[p].y);
+		planeZ[p] = _mm256_set1_ps(view.frustum.planes[p].z);
+		planeW[p] = _mm256_set1_ps(view.frustum.planes[p].w);
+	}
+	const __m256 eyeX = _mm256_set1_ps(view.eye.x);
+	const __m256 eyeY = _mm256_set1_ps(view.eye.y);
+	const __m256 eyeZ = _mm256_set1_ps(view.eye.z);
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+	uint32_t visibleCount = 0;
+	for (uint32_t i = first; i < first + count; i += 8) {
+		__m256 centerX = _mm256_loadu_ps(bounds.centerX.data() + i);
+		__m256 centerY = _mm256_loadu_ps(bounds.centerY.data() + i);
+		__m256 centerZ = _mm256_loadu_ps(bounds.centerZ.data() + i);
+		__m256 negRadius = _mm256_xor_ps(_mm256_loadu_ps(bounds.radius.data() + i), signMask);
+		__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], centerX), _mm256_mul_ps(planeY[p], centerY)), _mm256_mul_ps(planeZ[p], centerZ)), planeW[p]);
+			visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+		}
+
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(bounds.coneApexX.data() + i), eyeX);
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(bounds.coneApexY.data() + i), eyeY);
+		__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(bounds.coneApexZ.data() + i), eyeZ);
+		__m256 coneDot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, _mm256_loadu_ps(bounds.coneAxisX.data() + i)), _mm256_mul_ps(dy, _mm256_loadu_ps(bounds.coneAxisY.data() + i))),
+			_mm256_mul_ps(dz, _mm256_loadu_ps(bounds.coneAxisZ.data() + i)));
+		__m256 distance = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+		__m256 backFacing = _mm256_cmp_ps(coneDot, _mm256_mul_ps(_mm256_loadu_ps(bounds.coneCutoff.data() + i), distance), _CMP_GE_OQ);
+		visible = _mm256_andnot_ps(backFacing, visible);
+
+		uint32_t remaining = first + count - i;
+		uint32_t laneMask = remaining < 8 ? (1u << remaining) - 1 : 0xffu;
+		visibleCount += writeVisibleIndices(static_cast<uint32_t>(_mm256_movemask_ps(visible)) & laneMask, i, pOut + visibleCount);
+	}
+	return visibleCount;
+}
+
+uint32_t Meshlets::cullAvx2(const MeshletCullView& view, const MeshletBounds& bounds, uint32_t first, uint32_t count, uint32_t* pOut) {
+	if (!Culling::hasAvx2()) {
+		return cullSse(view, bounds, first, count, pOut);
+	}
+	return cullAvx2Impl(view, bounds, first, count, pOut);
+}
+#else
+uint32_t Meshlets::cullSse(const MeshletCullView& view, const MeshletBounds& bounds, uint32_t first, uint32_t count, uint32_t* pOut) {
+	return cullScalar(view, bounds, first, count, pOut);
+}
+
+uint32_t Meshlets::cullAvx2(const MeshletCullView& view, const MeshletBounds& bounds, uint32_t first, uint32_t count, uint32_t* pOut) {
+	return cullScalar(view, bounds, first, count, pOut);
+}
+#endif
+
+uint32_t Meshlets::cull(CullPath path, const MeshletCullView& view, const MeshletBounds& bounds, uint32_t first, uint32_t count, uint32_t* pOut) {
+	switch (Culling::resolvePath(path)) {
+	case CullPath::Avx2: return cullAvx2(view, bounds, first, count, pOut);
+	case CullPath::Sse: return cullSse(view, bounds, first, count, pOut);
+	default: return cullScalar(view, bounds, first, count, pOut);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "PipelineDiskCache.h"
+#include "Hash.h"
+
+#include <cstring>
+
+void PipelineDiskCache::init(VkPhysicalDevice physDevice, VkDevice device, const std::filesystem::path& path) {
+	m_device = device;
+	m_path = path;
+	vkGetPhysicalDeviceProperties(physDevice, &m_deviceProps);
+
+	std::vector<char> initialData{ loadValidated() };
+	m_warm = !initialData.empty();
+	m_savedSize = initialData.size();
+
+	VkPipelineCacheCreateInfo cacheInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = initialData.size(),
+		.pInitialData = initialData.empty() ? nullptr : initialData.data()
+	};
+
+	if (vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_cache) != VK_SUCCESS) {
+		//The driver can still reject data that passed our checks, start from an empty cache in that case
+		cacheInfo.initialDataSize = 0;
+		cacheInfo.pInitialData = nullptr;
+		m_warm = false;
+		m_savedSize = 0;
+		if (vkCreatePipelineCache(m_device, &cacheInfo, nullptr, &m_cache) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Pipeline Cache");
+		}
+	}
+	m_lastSave = std::chrono::steady_clock::now();
+}
+
+void PipelineDiskCache::destroy() {
+	if (m_cache == VK_NULL_HANDLE) {
+		return;
+	}
+	save();
+	vkDestroyPipelineCache(m_device, m_cache, nullptr);
+	m_cache = VK_NULL_HANDLE;
+}
+
+PipelineCacheFileHeader PipelineDiskCache::makeHeader(const std::vector<char>& data) const {
+	//The header is written to disk as raw bytes, start from all zeroes so nothing uninitialized ends up in the file
+	PipelineCacheFileHeader header{};
+	header.magic = PIPELINE_CACHE_FILE_MAGIC;
+	header.version = PIPELINE_CACHE_FILE_VERSION;
+	header.vendorID = m_deviceProps.vendorID;
+	header.deviceID = m_deviceProps.deviceID;
+	header.driverVersion = m_deviceProps.driverVersion;
+	header.dataSize = data.size();
+	header.dataHash = fnv1a64(data.data(), data.size());
+	std::memcpy(header.pipelineCacheUUID, m_deviceProps.pipelineCacheUUID, VK_UUID_SIZE);
+	return header;
+}
+
+std::vector<char> PipelineDiskCache::loadValidated() const {
+	std::ifstream file(m_path, std::ios::ate | std::ios::binary);
+	if (!file.is_open()) {
+		return {};
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	if (fileSize < sizeof(PipelineCacheFileHeader)) {
+		return {};
+	}
+
+	PipelineCacheFileHeader header{};
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (header.magic != PIPELINE_CACHE_FILE_MAGIC || header.version != PIPELINE_CACHE_FILE_VERSION ||
+		header.vendorID != m_deviceProps.vendorID || header.deviceID != m_deviceProps.deviceID ||
+		header.driverVersion != m_deviceProps.driverVersion ||
+		std::memcmp(header.pipelineCacheUUID, m_deviceProps.pipelineCacheUUID, VK_UUID_SIZE) != 0 ||
+		header.dataSize != fileSize - sizeof(PipelineCacheFileHeader)) {
+		return {};
+	}
+
+	std::vector<char> data(static_cast<size_t>(header.dataSize));
+	file.read(data.data(), static_cast<std::streamsize>(data.size()));
+	if (!file || fnv1a64(data.data(), data.size()) != header.dataHash) {
+		return {};
+	}
+
+	//The blob starts with the driver's own header, check it agrees with ours before handing it back to the driver
+	VkPipelineCacheHeaderVersionOne driverHeader;
+	if (data.size() < sizeof(driverHeader)) {
+		return {};
+	}
+	std::memcpy(&driverHeader, data.data(), sizeof(driverHeader));
+	if (driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+		driverHeader.vendorID != m_deviceProps.vendorID || driverHeader.deviceID != m_deviceProps.deviceID ||
+		std::memcmp(driverHeader.pipelineCacheUUID, m_deviceProps.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+		return {};
+	}
+
+	return data;
+}
+
+void PipelineDiskCache::save() {
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(m_device, m_cache, &dataSize, nullptr);
+	std::vector<char> data(dataSize);
+	if (dataSize == 0 || vkGetPipelineCacheData(m_device, m_cache, &dataSize, data.data()) != VK_SUCCESS) {
+		return;
+	}
+	data.resize(dataSize);
+
+	PipelineCacheFileHeader header{ makeHeader(data) };
+	std::filesystem::path tempPath{ m_path };
+	tempPath += ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			return;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), static_cast<std::streamsize>(data.size()));
+		if (!file) {
+			return;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, m_path, error);
+	if (error) {
+		std::filesystem::remove(tempPath, error);
+		return;
+	}
+	m_savedSize = data.size();
+	m_lastSave = std::chrono::steady_clock::now();
+}
+
+void PipelineDiskCache::saveIfDue(std::chrono::seconds interval) {
+	if (std::chrono::steady_clock::now() - m_lastSave < interval) {
+		return;
+	}
+	m_lastSave = std::chrono::steady_clock::now();
+
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(m_device, m_cache, &dataSize, nullptr);
+	if (dataSize > m_savedSize) {
+		save();
+	}
+}
+
+VkPipelineCache PipelineDiskCache::get() const {
+	return m_cache;
+}
+
+bool PipelineDiskCache::isWarm() const {
+	return m_warm;
+}
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "PipelineLibrary.h"
+
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	template<typename Handle>
+	uint64_t handleBits(Handle handle) {
+		uint64_t bits = 0;
+		std::memcpy(&bits, &handle, sizeof(handle));
+		return bits;
+	}
+}
+
+uint64_t GraphicsPipelineKey::hash() const {
+	uint64_t hash = FNV_OFFSET_BASIS;
+	hash = hashCombine(hash, handleBits(vertexModule));
+	hash = hashCombine(hash, handleBits(fragmentModule));
+	hash = hashCombine(hash, (static_cast<uint64_t>(vertexLayout.position) << 32) | static_cast<uint64_t>(vertexLayout.normal));
+	hash = hashCombine(hash, (static_cast<uint64_t>(vertexBinding) << 32) | static_cast<uint64_t>(topology));
+	hash = hashCombine(hash, (static_cast<uint64_t>(polygonMode) << 32) | static_cast<uint64_t>(cullMode));
+	hash = hashCombine(hash, (static_cast<uint64_t>(frontFace) << 32) | static_cast<uint64_t>(depthCompare));
+	hash = hashCombine(hash, (depthTest ? 1u : 0u) | (depthWrite ? 2u : 0u) | (blendEnable ? 4u : 0u));
+	hash = hashCombine(hash, handleBits(layout));
+	hash = hashCombine(hash, handleBits(renderPass));
+	return hashCombine(hash, subpass);
+}
+
+bool GraphicsPipelineKey::operator==(const GraphicsPipelineKey& other) const {
+	return vertexModule == other.vertexModule && fragmentModule == other.fragmentModule
+		&& vertexLayout.position == other.vertexLayout.position && vertexLayout.normal == other.vertexLayout.normal
+		&& vertexBinding == other.vertexBinding && topology == other.topology && polygonMode == other.polygonMode
+		&& cullMode == other.cullMode && frontFace == other.frontFace && depthTest == other.depthTest && depthWrite == other.depthWrite
+		&& depthCompare == other.depthCompare && blendEnable == other.blendEnable && layout == other.layout
+		&& renderPass == other.renderPass && subpass == other.subpass;
+}
+
+void PipelineLibrary::init(VkDevice device, VkPipelineCache pipelineCache) {
+	m_device = device;
+	m_pipelineCache = pipelineCache;
+}
+
+void PipelineLibrary::destroy() {
+	std::unique_lock lock(m_mutex);
+	for (const auto& [hash, entries] : m_entries) {
+		for (const std::shared_ptr<Entry>& entry : entries) {
+			vkDestroyPipeline(m_device, entry->pipeline.get(), nullptr);
+		}
+	}
+	m_entries.clear();
+}
+
+std::shared_ptr<PipelineLibrary::Entry> PipelineLibrary::find(uint64_t hash, const GraphicsPipelineKey& key) const {
+	auto it = m_entries.find(hash);
+	if (it == m_entries.end()) {
+		return nullptr;
+	}
+	for (const std::shared_ptr<Entry>& entry : it->second) {
+		if (entry->key == key) {
+			return entry;
+		}
+	}
+	return nullptr;
+}
+
+VkPipeline PipelineLibrary::getGraphicsPipeline(const GraphicsPipelineKey& key) {
+	uint64_t hash = key.hash();
+	std::shared_ptr<Entry> entry;
+	{
+		std::shared_lock lock(m_mutex);
+		entry = find(hash, key);
+	}
+
+	//Not there yet: publish a pending entry so concurrent requests for the same key wait on it instead of creating their own
+	std::promise<VkPipeline> promise;
+	bool creator = false;
+	if (entry == nullptr) {
+		std::unique_lock lock(m_mutex);
+		entry = find(hash, key);
+		if (entry == nullptr) {
+			entry = std::make_shared<Entry>(Entry{ key, promise.get_future().share() });
+			m_entries[hash].push_back(entry);
+			creator = true;
+		}
+	}
+
+	if (!creator) {
+		bool ready = entry->pipeline.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		{
+			std::lock_guard lock(m_statsMutex);
+			m_stats.requests++;
+			ready ? m_stats.hits++ : m_stats.deduplicatedWaits++;
+		}
+		return entry->pipeline.get(); //rethrows if the creating thread failed
+	}
+
+	try {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		VkPipeline pipeline = createGraphicsPipeline(key);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		promise.set_value(pipeline);
+
+		std::lock_guard lock(m_statsMutex);
+		m_stats.requests++;
+		m_stats.created++;
+		m_stats.creationMs += ms;
+		return pipeline;
+	}
+	catch (...) {
+		//Waiters see the failure, later requests try again
+		promise.set_exception(std::current_exception());
+		std::unique_lock lock(m_mutex);
+		std::vector<std::shared_ptr<Entry>>& entries = m_entries[hash];
+		entries.erase(std::find(entries.begin(), entries.end(), entry));
+		throw;
+	}
+}
+
+PipelineLibraryStats PipelineLibrary::getStats() const {
+	std::lock_guard lock(m_statsMutex);
+	return m_stats;
+}
+
+VkPipeline PipelineLibrary::createGraphicsPipeline(const GraphicsPipelineKey& key) {
+	std::vector<VkPipelineShaderStageCreateInfo> shaderStageInfos{
+		VkPipelineShaderStageCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_VERTEX_BIT,
+			.module = key.vertexModule,
+			.pName = "main"
+		}
+	};
+	if (key.fragmentModule != VK_NULL_HANDLE) {
+		shaderStageInfos.push_back(VkPipelineShaderStageCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.module = key.fragmentModule,
+			.pName = "main"
+		});
+	}
+
+	VkVertexInputBindingDescription vertexInputBindingInfo{ key.vertexLayout.getBindingDescription(key.vertexBinding) };
+	std::vector<VkVertexInputAttributeDescription> vertexAttributeInfos{ key.vertexLayout.getAttributeDescriptions(key.vertexBinding) };
+
+	VkPipelineVertexInputStateCreateInfo vertexInputStateInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+		.vertexBindingDescriptionCount = 1,
+		.pVertexBindingDescriptions = &vertexInputBindingInfo,
+		.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexAttributeInfos.size()),
+		.pVertexAttributeDescriptions = vertexAttributeInfos.data()
+	};
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+		.topology = key.topology,
+		.primitiveRestartEnable = VK_FALSE
+	};
+
+	//Counts only, the viewport and scissor are recorded into each command buffer
+	VkPipelineViewportStateCreateInfo viewportStateInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+		.viewportCount = 1,
+		.scissorCount = 1
+	};
+
+	VkDynamicState dynamicStates[]{ VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+	VkPipelineDynamicStateCreateInfo dynamicStateInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+		.dynamicStateCount = static_cast<uint32_t>(std::size(dynamicStates)),
+		.pDynamicStates = dynamicStates
+	};
+
+	VkPipelineRasterizationStateCreateInfo rasterizationStateInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+		.depthClampEnable = VK_FALSE, //depthClamp is an optional feature that is not enabled on the device
+		.rasterizerDiscardEnable = VK_FALSE,
+		.polygonMode = key.polygonMode,
+		.cullMode = key.cullMode,
+		.frontFace = key.frontFace,
+		.depthBiasEnable = VK_FALSE,
+		.lineWidth = 1.0f
+	};
+
+	VkPipelineMultisampleStateCreateInfo multisampleStateInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+		.sampleShadingEnable = VK_FALSE,
+		.pSampleMask = nullptr
+	};
+
+	VkPipelineDepthStencilStateCreateInfo depthStencilStateInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+		.depthTestEnable = key.depthTest ? VK_TRUE : VK_FALSE,
+		.depthWriteEnable = key.depthWrite ? VK_TRUE : VK_FALSE,
+		.depthCompareOp = key.depthCompare,
+		.depthBoundsTestEnable = VK_FALSE,
+		.stencilTestEnable = VK_FALSE
+	};
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{
+		.blendEnable = key.blendEnable ? VK_TRUE : VK_FALSE,
+		.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.colorBlendOp = VK_BLEND_OP_ADD,
+		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+		.alphaBlendOp = VK_BLEND_OP_ADD,
+		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+	};
+
+	VkPipelineColorBlendStateCreateInfo colorBlendStateInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+		.attachmentCount = 1, //must match the subpass color attachment count
+		.pAttachments = &colorBlendAttachment
+	};
+
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+		.stageCount = static_cast<uint32_t>(shaderStageInfos.size()),
+		.pStages = shaderStageInfos.data(),
+		.pVertexInputState = &vertexInputStateInfo,
+		.pInputAssemblyState = &inputAssemblyStateInfo,
+		.pViewportState = &viewportStateInfo,
+		.pRasterizationState = &rasterizationStateInfo,
+		.pMultisampleState = &multisampleStateInfo,
+		.pDepthStencilState = &depthStencilStateInfo,
+		.pColorBlendState = &colorBlendStateInfo,
+		.pDynamicState = &dynamicStateInfo,
+		.layout = key.layout,
+		.renderPass = key.renderPass,
+		.subpass = key.subpass
+	};
+
+	//VkPipelineCache is internally synchronized, concurrent creations may share it
+	VkPipeline pipeline;
+	if (vkCreateGraphicsPipelines(m_device, m_pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create graphics Pipeline");
+	}
+	return pipeline;
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "Primitives.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <random>
+#include <cmath>
+
+static void computeSmoothNormals(ImportedMesh& mesh) {
+	for (Vertex& vertex : mesh.vertices) {
+		vertex.normal = glm::vec3(0.0f);
+	}
+	//The unnormalized cross product weighs each face by its area
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		Vertex& v0 = mesh.vertices[mesh.indices[i]];
+		Vertex& v1 = mesh.vertices[mesh.indices[i + 1]];
+		Vertex& v2 = mesh.vertices[mesh.indices[i + 2]];
+		glm::vec3 faceNormal = glm::cross(v1.pos - v0.pos, v2.pos - v0.pos);
+		v0.normal += faceNormal;
+		v1.normal += faceNormal;
+		v2.normal += faceNormal;
+	}
+	for (Vertex& vertex : mesh.vertices) {
+		float length = glm::length(vertex.normal);
+		vertex.normal = length > 0.0f ? vertex.normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+}
+
+ImportedMesh Primitives::icosphere(uint32_t subdivisions, float displacement, uint32_t seed) {
+	const float t = (1.0f + std::sqrt(5.0f)) * 0.5f;
+	std::vector<glm::vec3> positions{
+		{ -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+		{ 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+		{ t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 }
+	};
+	std::vector<uint32_t> indices{
+		0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+		1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+		3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+		4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1
+	};
+	for (glm::vec3& position : positions) {
+		position = glm::normalize(position);
+	}
+
+	//Edge midpoints are shared between the two triangles of an edge, keyed by the ordered vertex pair
+	for (uint32_t level = 0; level < subdivisions; level++) {
+		std::unordered_map<uint64_t, uint32_t> midpoints;
+		auto midpoint = [&](uint32_t a, uint32_t b) {
+			uint64_t key = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+			auto [it, inserted] = midpoints.try_emplace(key, static_cast<uint32_t>(positions.size()));
+			if (inserted) {
+				positions.push_back(glm::normalize(positions[a] + positions[b]));
+			}
+			return it->second;
+		};
+		std::vector<uint32_t> subdivided;
+		subdivided.reserve(indices.size() * 4);
+		for (size_t i = 0; i < indices.size(); i += 3) {
+			uint32_t a = indices[i];
+			uint32_t b = indices[i + 1];
+			uint32_t c = indices[i + 2];
+			uint32_t ab = midpoint(a, b);
+			uint32_t bc = midpoint(b, c);
+			uint32_t ca = midpoint(c, a);
+			subdivided.insert(subdivided.end(), { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca });
+		}
+		indices = std::move(subdivided);
+	}
+
+	std::mt19937 rng{ seed };
+	std::uniform_real_distribution<float> noiseDist{ -1.0f, 1.0f };
+	ImportedMesh mesh;
+	mesh.vertices.reserve(positions.size());
+	for (const glm::vec3& position : positions) {
+		float bumps = std::sin(3.0f * position.x) * std::sin(4.0f * position.y) * std::sin(5.0f * position.z);
+		float radius = 1.0f + displacement * (bumps + 0.1f * noiseDist(rng));
+		mesh.vertices.push_back(Vertex{ .pos = position * radius, .normal = position });
+	}
+	mesh.indices = std::move(indices);
+	computeSmoothNormals(mesh);
+	return mesh;
+}
+
+ImportedMesh Primitives::grid(uint32_t gridSize, float heightNoise, uint32_t seed) {
+	std::mt19937 rng{ seed };
+	std::uniform_real_distribution<float> heightDist{ -heightNoise, heightNoise };
+	ImportedMesh mesh;
+	mesh.vertices.reserve(static_cast<size_t>(gridSize) * gridSize);
+	for (uint32_t y = 0; y < gridSize; y++) {
+		for (uint32_t x = 0; x < gridSize; x++) {
+			glm::vec3 pos(static_cast<float>(x) / (gridSize - 1) - 0.5f, heightDist(rng), static_cast<float>(y) / (gridSize - 1) - 0.5f);
+			mesh.vertices.push_back(Vertex{ .pos = pos, .normal = glm::vec3(0.0f, 1.0f, 0.0f) });
+		}
+	}
+	mesh.indices.reserve(static_cast<size_t>(gridSize - 1) * (gridSize - 1) * 6);
+	for (uint32_t y = 0; y + 1 < gridSize; y++) {
+		for (uint32_t x = 0; x + 1 < gridSize; x++) {
+			uint32_t i = y * gridSize + x;
+			mesh.indices.insert(mesh.indices.end(), { i, i + gridSize, i + 1, i + 1, i + gridSize, i + gridSize + 1 });
+		}
+	}
+	computeSmoothNormals(mesh);
+	return mesh;
+}
\ No newline at end of file
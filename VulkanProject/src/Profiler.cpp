@@ -0,0 +1,200 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <iomanip>
+
+void Profiler::init([[maybe_unused]] VkPhysicalDevice physDevice, VkDevice device, [[maybe_unused]] uint32_t queueFamily, [[maybe_unused]] uint32_t frameCount) {
+	m_device = device;
+#ifdef PROFILER_ENABLED
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> familyProps(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physDevice, &familyCount, familyProps.data());
+	uint32_t validBits = familyProps.at(queueFamily).timestampValidBits;
+	if (validBits == 0) {
+		return; //CPU zones only
+	}
+	m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkPhysicalDeviceProperties deviceProps;
+	vkGetPhysicalDeviceProperties(physDevice, &deviceProps);
+	m_timestampPeriod = deviceProps.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo queryPoolInfo{
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = PROFILER_MAX_GPU_ZONES * 2
+	};
+
+	m_frames = std::vector<FrameQueries>(frameCount);
+	for (FrameQueries& frame : m_frames) {
+		frame.zones.resize(PROFILER_MAX_GPU_ZONES);
+		frame.zoneCount = 0;
+		frame.pending = false;
+		if (vkCreateQueryPool(m_device, &queryPoolInfo, nullptr, &frame.pool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create profiler Query Pool");
+		}
+	}
+#endif
+}
+
+void Profiler::destroy() {
+	for (FrameQueries& frame : m_frames) {
+		vkDestroyQueryPool(m_device, frame.pool, nullptr);
+	}
+	m_frames.clear();
+}
+
+void Profiler::beginFrame(uint32_t frameIndex, VkCommandBuffer cmdBuffer) {
+	if (m_frames.empty()) {
+		return;
+	}
+	resolveFrame(frameIndex);
+
+	FrameQueries& frame = m_frames.at(frameIndex);
+	vkCmdResetQueryPool(cmdBuffer, frame.pool, 0, PROFILER_MAX_GPU_ZONES * 2);
+	frame.zoneCount.store(0, std::memory_order_relaxed);
+	m_currentFrame = frameIndex;
+}
+
+void Profiler::frameSubmitted(uint32_t frameIndex) {
+	if (m_frames.empty()) {
+		return;
+	}
+	FrameQueries& frame = m_frames.at(frameIndex);
+	frame.submitTime = Clock::now();
+	frame.pending = true;
+}
+
+void Profiler::resolveFrame(uint32_t frameIndex) {
+	if (m_frames.empty() || !m_frames.at(frameIndex).pending) {
+		return;
+	}
+	FrameQueries& frame = m_frames.at(frameIndex);
+	frame.pending = false;
+
+	uint32_t zoneCount = std::min(frame.zoneCount.load(std::memory_order_relaxed), PROFILER_MAX_GPU_ZONES);
+	if (zoneCount == 0) {
+		return;
+	}
+
+	//The fence has signaled, so every query written by the frame is available and this does not block
+	std::vector<uint64_t> timestamps(zoneCount * 2);
+	if (vkGetQueryPoolResults(m_device, frame.pool, 0, zoneCount * 2, timestamps.size() * sizeof(uint64_t), timestamps.data(),
+		sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+		return;
+	}
+
+	double usPerTick = static_cast<double>(m_timestampPeriod) * 1e-3;
+	if (!m_gpuCalibrated) {
+		m_gpuCalibrated = true;
+		double submitUs = std::chrono::duration<double, std::micro>(frame.submitTime - m_epoch).count();
+		m_gpuOffsetUs = submitUs - static_cast<double>(timestamps[0] & m_timestampMask) * usPerTick;
+	}
+
+	std::lock_guard lock(m_mutex);
+	for (uint32_t i = 0; i < zoneCount; i++) {
+		uint64_t begin = timestamps[i * 2] & m_timestampMask;
+		uint64_t end = timestamps[i * 2 + 1] & m_timestampMask;
+		double durationUs = static_cast<double>((end - begin) & m_timestampMask) * usPerTick;
+		addSample(frame.zones[i].name, true, PROFILER_GPU_TRACK, static_cast<double>(begin) * usPerTick + m_gpuOffsetUs, durationUs);
+	}
+}
+
+uint32_t Profiler::beginGpuZone(VkCommandBuffer cmdBuffer, const char* name) {
+	if (m_frames.empty()) {
+		return ~0u;
+	}
+	FrameQueries& frame = m_frames[m_currentFrame];
+	uint32_t zone = frame.zoneCount.fetch_add(1, std::memory_order_relaxed);
+	if (zone >= PROFILER_MAX_GPU_ZONES) {
+		return ~0u;
+	}
+	frame.zones[zone].name = name;
+	vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, zone * 2);
+	return zone;
+}
+
+void Profiler::endGpuZone(VkCommandBuffer cmdBuffer, uint32_t zone) {
+	if (zone == ~0u) {
+		return;
+	}
+	vkCmdWriteTimestamp(cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_frames[m_currentFrame].pool, zone * 2 + 1);
+}
+
+void Profiler::recordCpuZone(const char* name, Clock::time_point start, Clock::time_point end) {
+	double startUs = std::chrono::duration<double, std::micro>(start - m_epoch).count();
+	double durationUs = std::chrono::duration<double, std::micro>(end - start).count();
+
+	std::lock_guard lock(m_mutex);
+	auto [it, inserted] = m_threadTracks.try_emplace(std::this_thread::get_id(), static_cast<uint32_t>(m_threadTracks.size()));
+	addSample(name, false, it->second, startUs, durationUs);
+}
+
+//Callers hold m_mutex
+void Profiler::addSample(const char* name, bool gpu, uint32_t track, double startUs, double durationUs) {
+	double ms = durationUs * 1e-3;
+	ZoneStats& stats = m_stats[ZoneKey{ name, gpu }];
+	stats.calls++;
+	stats.totalMs += ms;
+	if (stats.window.size() < PROFILER_STATS_WINDOW) {
+		stats.window.push_back(ms);
+	}
+	else {
+		stats.window[stats.windowNext] = ms;
+		stats.windowNext = (stats.windowNext + 1) % PROFILER_STATS_WINDOW;
+	}
+
+	if (m_events.size() < PROFILER_MAX_TRACE_EVENTS) {
+		m_events.push_back(ProfileEvent{ name, track, startUs, durationUs });
+	}
+}
+
+std::vector<ProfileZoneSummary> Profiler::getSummary() const {
+	std::lock_guard lock(m_mutex);
+	std::vector<ProfileZoneSummary> summary;
+	summary.reserve(m_stats.size());
+	for (const auto& [key, stats] : m_stats) {
+		double windowTotal = 0.0;
+		double windowMax = 0.0;
+		for (double ms : stats.window) {
+			windowTotal += ms;
+			windowMax = std::max(windowMax, ms);
+		}
+		summary.push_back(ProfileZoneSummary{
+			.name = key.name,
+			.gpu = key.gpu,
+			.calls = stats.calls,
+			.totalMs = stats.totalMs,
+			.windowAvgMs = stats.window.empty() ? 0.0 : windowTotal / static_cast<double>(stats.window.size()),
+			.windowMaxMs = windowMax
+		});
+	}
+	std::sort(summary.begin(), summary.end(), [](const ProfileZoneSummary& a, const ProfileZoneSummary& b) { return a.totalMs > b.totalMs; });
+	return summary;
+}
+
+//Chrome trace event format, loads in chrome://tracing and Perfetto. CPU threads and the GPU queue are separate processes
+//so the GPU track is not interleaved with the thread tracks.
+void Profiler::writeChromeTrace(std::ostream& out) const {
+	std::lock_guard lock(m_mutex);
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, \"args\": {\"name\": \"CPU\"}},\n";
+	out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"GPU\"}}";
+	for (const auto& [id, track] : m_threadTracks) {
+		out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << track
+			<< ", \"args\": {\"name\": \"" << (track == 0 ? "main" : "thread " + std::to_string(track)) << "\"}}";
+	}
+	for (const ProfileEvent& event : m_events) {
+		bool gpu = event.track == PROFILER_GPU_TRACK;
+		out << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"" << (gpu ? "gpu" : "cpu") << "\", \"ph\": \"X\", \"pid\": " << (gpu ? 1 : 0)
+			<< ", \"tid\": " << (gpu ? 0 : event.track) << ", \"ts\": " << event.startUs << ", \"dur\": " << event.durationUs << "}";
+	}
+	out << "\n]}\n";
+	out.flags(flags);
+	out.precision(precision);
+}
\ No newline at end of file
@@ -0,0 +1,823 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+constexpr VkAccessFlags WRITE_ACCESS_MASK = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+	VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+struct AccessInfo {
+	VkImageLayout layout;
+	VkPipelineStageFlags stages;
+	VkAccessFlags access;
+	VkImageUsageFlags usage;
+};
+
+static AccessInfo getAccessInfo(RenderGraphAccess access) {
+	switch (access) {
+	case RenderGraphAccess::ColorAttachment:
+		return AccessInfo{ VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+	case RenderGraphAccess::DepthAttachment:
+		return AccessInfo{ VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+	case RenderGraphAccess::Sampled:
+		return AccessInfo{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_USAGE_SAMPLED_BIT };
+	case RenderGraphAccess::ComputeSampled:
+		return AccessInfo{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_USAGE_SAMPLED_BIT };
+	case RenderGraphAccess::ComputeStorage:
+		//Levels written by the pass are read back through samplers to build the next ones, so storage images are sampled too
+		return AccessInfo{ VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT };
+	case RenderGraphAccess::TransferSrc:
+		return AccessInfo{ VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_USAGE_TRANSFER_SRC_BIT };
+	case RenderGraphAccess::TransferDst:
+		return AccessInfo{ VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_USAGE_TRANSFER_DST_BIT };
+	}
+	throw std::runtime_error("Unknown render graph access");
+}
+
+static bool isAttachment(RenderGraphAccess access) {
+	return access == RenderGraphAccess::ColorAttachment || access == RenderGraphAccess::DepthAttachment;
+}
+
+static bool hasDepth(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool hasStencil(VkFormat format) {
+	return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+static VkImageAspectFlags aspectOf(VkFormat format) {
+	if (!hasDepth(format)) {
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+	return hasStencil(format) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+//Only used to pair images with slots of a similar size, the real sizes come from the driver once the extent is known
+static float texelSize(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_R8_UNORM:
+		return 1.0f;
+	case VK_FORMAT_R16_SFLOAT:
+	case VK_FORMAT_D16_UNORM:
+		return 2.0f;
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+	case VK_FORMAT_R32G32_SFLOAT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return 8.0f;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+		return 16.0f;
+	default:
+		return 4.0f;
+	}
+}
+
+//Updates the state for an access and returns whether a barrier has to precede it. Writes and layout transitions wait
+//for every earlier access, reads only for the last write and only if it has not been made visible to them yet.
+static bool syncAccess(RenderGraphImageState& state, const AccessInfo& info, bool write, VkImageLayout& outOldLayout,
+	VkPipelineStageFlags& outSrcStages, VkAccessFlags& outSrcAccess) {
+	bool transition = info.layout != state.layout;
+	VkPipelineStageFlags priorStages = state.writeStages | state.readStages;
+	outOldLayout = state.layout;
+	outSrcStages = priorStages != 0 ? priorStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	outSrcAccess = state.writeAccess;
+
+	if (write) {
+		state = RenderGraphImageState{ info.layout, info.stages, info.access & WRITE_ACCESS_MASK, 0, 0 };
+		return transition || priorStages != 0;
+	}
+	if (transition) {
+		//The transition is ordered after the reads before it and before this one, later writes wait for the new reads
+		state.layout = info.layout;
+		state.readStages = info.stages;
+		state.readAccess = info.access;
+		return true;
+	}
+	bool visible = (info.stages & ~state.readStages) == 0 && (info.access & ~state.readAccess) == 0;
+	state.readStages |= info.stages;
+	state.readAccess |= info.access;
+	return state.writeStages != 0 && !visible;
+}
+
+RenderGraphImage RenderGraph::createImage(const char* name, VkFormat format, float scale, uint32_t mipLevels) {
+	m_images.push_back(ImageResource{
+		.name = name,
+		.format = format,
+		.scale = scale,
+		.mipLevels = mipLevels,
+		.levelCount = 1,
+		.imported = false,
+		.output = false,
+		.importState = {},
+		.finalLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.usage = 0,
+		.firstUse = ~0u,
+		.lastUse = ~0u,
+		.slot = ~0u,
+		.image = VK_NULL_HANDLE,
+		.view = VK_NULL_HANDLE,
+		.mipViews = {},
+		.extent = {},
+		.memoryReqs = {}
+	});
+	return static_cast<RenderGraphImage>(m_images.size() - 1);
+}
+
+RenderGraphImage RenderGraph::importImage(const char* name, VkImageLayout initialLayout, VkPipelineStageFlags initialStage, VkImageLayout finalLayout) {
+	RenderGraphImage image = createImage(name, VK_FORMAT_UNDEFINED);
+	m_images[image].imported = true;
+	m_images[image].output = true;
+	m_images[image].importState = RenderGraphImageState{ initialLayout, initialStage, 0, 0, 0 };
+	m_images[image].finalLayout = finalLayout;
+	return image;
+}
+
+RenderGraphPass RenderGraph::addPass(const char* name, RenderGraphPassType type, RecordFunction record) {
+	m_passes.push_back(PassNode{
+		.name = name,
+		.type = type,
+		.record = std::move(record),
+		.accesses = {},
+		.culled = false,
+		.sideEffects = false,
+		.contents = VK_SUBPASS_CONTENTS_INLINE,
+		.barriers = {},
+		.attachmentImages = {},
+		.attachments = {},
+		.dependencies = {},
+		.clearValues = {},
+		.renderPass = VK_NULL_HANDLE,
+		.framebuffer = VK_NULL_HANDLE,
+		.extent = {}
+	});
+	return static_cast<RenderGraphPass>(m_passes.size() - 1);
+}
+
+void RenderGraph::addColorAttachment(RenderGraphPass pass, RenderGraphImage image, const VkClearColorValue* pClear) {
+	VkClearValue clearValue{};
+	if (pClear != nullptr) {
+		clearValue.color = *pClear;
+	}
+	m_passes.at(pass).accesses.push_back(PassAccess{ image, RenderGraphAccess::ColorAttachment, true, pClear != nullptr, clearValue });
+}
+
+void RenderGraph::addDepthAttachment(RenderGraphPass pass, RenderGraphImage image, const VkClearDepthStencilValue* pClear) {
+	VkClearValue clearValue{};
+	if (pClear != nullptr) {
+		clearValue.depthStencil = *pClear;
+	}
+	m_passes.at(pass).accesses.push_back(PassAccess{ image, RenderGraphAccess::DepthAttachment, true, pClear != nullptr, clearValue });
+}
+
+void RenderGraph::addRead(RenderGraphPass pass, RenderGraphImage image, RenderGraphAccess access) {
+	if (access != RenderGraphAccess::Sampled && access != RenderGraphAccess::ComputeSampled && access != RenderGraphAccess::TransferSrc) {
+		throw std::runtime_error("Render graph reads must be sampled or transfer source accesses");
+	}
+	m_passes.at(pass).accesses.push_back(PassAccess{ image, access, false, false, VkClearValue{} });
+}
+
+void RenderGraph::addWrite(RenderGraphPass pass, RenderGraphImage image, RenderGraphAccess access) {
+	if (access != RenderGraphAccess::ComputeStorage && access != RenderGraphAccess::TransferDst) {
+		throw std::runtime_error("Render graph writes outside of attachments must be storage or transfer destination accesses");
+	}
+	m_passes.at(pass).accesses.push_back(PassAccess{ image, access, true, false, VkClearValue{} });
+}
+
+void RenderGraph::markOutput(RenderGraphImage image) {
+	m_images.at(image).output = true;
+}
+
+void RenderGraph::markSideEffects(RenderGraphPass pass) {
+	m_passes.at(pass).sideEffects = true;
+}
+
+void RenderGraph::compile(VkDevice device, GpuAllocator& allocator) {
+	m_device = device;
+	m_pAllocator = &allocator;
+
+	for (const PassNode& pass : m_passes) {
+		for (size_t a = 0; a < pass.accesses.size(); a++) {
+			const PassAccess& access = pass.accesses[a];
+			if (access.image >= m_images.size()) {
+				throw std::runtime_error(std::string("Render graph pass ") + pass.name + " uses an unknown image");
+			}
+			for (size_t b = 0; b < a; b++) {
+				if (pass.accesses[b].image == access.image) {
+					throw std::runtime_error(std::string("Render graph pass ") + pass.name + " uses " + m_images[access.image].name + " twice");
+				}
+			}
+			if (isAttachment(access.access) && pass.type != RenderGraphPassType::Graphics) {
+				throw std::runtime_error(std::string("Render graph pass ") + pass.name + " has attachments but is not a graphics pass");
+			}
+			if (isAttachment(access.access) && m_images[access.image].imported) {
+				throw std::runtime_error(std::string("Imported render graph image ") + m_images[access.image].name + " cannot be an attachment");
+			}
+			if (isAttachment(access.access) && m_images[access.image].mipLevels != 1) {
+				throw std::runtime_error(std::string("Render graph image ") + m_images[access.image].name + " has mip levels and cannot be an attachment");
+			}
+		}
+	}
+
+	cullPasses();
+	assignSlots();
+	planBarriers();
+	for (uint32_t passIndex : m_order) {
+		if (m_passes[passIndex].type == RenderGraphPassType::Graphics) {
+			createRenderPass(m_passes[passIndex]);
+		}
+	}
+	m_compiled = true;
+}
+
+//Walks the passes backwards from the outputs. A pass is kept if it writes an image a later kept pass or an output
+//needs, or has side effects, and then needs what it reads itself. A cleared attachment overwrites the image, so earlier writers are not needed
+//for it anymore.
+void RenderGraph::cullPasses() {
+	std::vector<bool> needed(m_images.size());
+	for (size_t i = 0; i < m_images.size(); i++) {
+		needed[i] = m_images[i].output;
+	}
+
+	for (size_t p = m_passes.size(); p-- > 0;) {
+		PassNode& pass = m_passes[p];
+		pass.culled = !pass.sideEffects && std::none_of(pass.accesses.begin(), pass.accesses.end(),
+			[&needed](const PassAccess& access) { return access.write && needed[access.image]; });
+		if (pass.culled) {
+			continue;
+		}
+		for (const PassAccess& access : pass.accesses) {
+			if (access.clear) {
+				needed[access.image] = false;
+			}
+		}
+		for (const PassAccess& access : pass.accesses) {
+			if (!access.write || (isAttachment(access.access) && !access.clear)) {
+				needed[access.image] = true;
+			}
+		}
+	}
+
+	m_order.clear();
+	for (uint32_t p = 0; p < m_passes.size(); p++) {
+		if (!m_passes[p].culled) {
+			m_order.push_back(p);
+		}
+	}
+
+	for (ImageResource& image : m_images) {
+		image.usage = 0;
+		image.firstUse = ~0u;
+		image.lastUse = ~0u;
+	}
+	for (uint32_t position = 0; position < m_order.size(); position++) {
+		for (const PassAccess& access : m_passes[m_order[position]].accesses) {
+			ImageResource& image = m_images[access.image];
+			if (image.firstUse == ~0u) {
+				image.firstUse = position;
+				if (!image.imported && !access.write) {
+					throw std::runtime_error(std::string("Render graph image ") + image.name + " is read before it is written");
+				}
+			}
+			image.lastUse = position;
+			image.usage |= getAccessInfo(access.access).usage;
+		}
+	}
+
+	m_stats = RenderGraphStats{};
+	m_stats.passCount = static_cast<uint32_t>(m_passes.size());
+	m_stats.culledPassCount = static_cast<uint32_t>(m_passes.size() - m_order.size());
+}
+
+//Greedy interval packing. Images are placed in order of first use into the slot of the same aspect that is free by
+//then and closest in size, so a slot grows as little as possible. Outputs keep their contents across frames and get a
+//slot of their own.
+void RenderGraph::assignSlots() {
+	std::vector<RenderGraphImage> transients;
+	std::vector<RenderGraphImage> outputs;
+	for (RenderGraphImage i = 0; i < m_images.size(); i++) {
+		const ImageResource& image = m_images[i];
+		if (image.imported || image.firstUse == ~0u) {
+			continue;
+		}
+		(image.output ? outputs : transients).push_back(i);
+	}
+	std::stable_sort(transients.begin(), transients.end(), [this](RenderGraphImage a, RenderGraphImage b) {
+		return m_images[a].firstUse < m_images[b].firstUse;
+	});
+
+	m_slots.clear();
+	for (RenderGraphImage i : transients) {
+		ImageResource& image = m_images[i];
+		bool depth = hasDepth(image.format);
+		float footprint = texelSize(image.format) * image.scale * image.scale * (image.mipLevels != 1 ? 4.0f / 3.0f : 1.0f);
+
+		uint32_t best = ~0u;
+		for (uint32_t s = 0; s < m_slots.size(); s++) {
+			const AliasSlot& slot = m_slots[s];
+			if (slot.depth != depth || m_images[slot.images.back()].lastUse >= image.firstUse) {
+				continue;
+			}
+			//Prefer the smallest slot that already fits, otherwise the largest one
+			if (best == ~0u) {
+				best = s;
+				continue;
+			}
+			float bestFootprint = m_slots[best].footprint;
+			bool fits = slot.footprint >= footprint;
+			bool bestFits = bestFootprint >= footprint;
+			if ((fits && (!bestFits || slot.footprint < bestFootprint)) || (!fits && !bestFits && slot.footprint > bestFootprint)) {
+				best = s;
+			}
+		}
+		if (best == ~0u) {
+			m_slots.push_back(AliasSlot{ .images = {}, .depth = depth, .footprint = 0.0f, .allocation = {} });
+			best = static_cast<uint32_t>(m_slots.size() - 1);
+		}
+		m_slots[best].images.push_back(i);
+		m_slots[best].footprint = std::max(m_slots[best].footprint, footprint);
+		image.slot = best;
+	}
+	for (RenderGraphImage i : outputs) {
+		m_slots.push_back(AliasSlot{ .images = { i }, .depth = hasDepth(m_images[i].format), .footprint = 0.0f, .allocation = {} });
+		m_images[i].slot = static_cast<uint32_t>(m_slots.size() - 1);
+	}
+
+	m_stats.imageCount = static_cast<uint32_t>(transients.size() + outputs.size());
+	m_stats.aliasSlotCount = static_cast<uint32_t>(m_slots.size());
+}
+
+//The barriers of a frame depend on where the previous frame left every image, which is only known after planning a
+//frame once. Owned images start out undefined, waiting for the last use of their slot's previous occupant.
+void RenderGraph::planBarriers() {
+	std::vector<RenderGraphImageState> initialStates(m_images.size());
+	for (size_t i = 0; i < m_images.size(); i++) {
+		initialStates[i] = m_images[i].imported ? m_images[i].importState : RenderGraphImageState{ VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, 0, 0 };
+	}
+	std::vector<RenderGraphImageState> endStates = simulate(initialStates, false);
+
+	for (const AliasSlot& slot : m_slots) {
+		for (size_t i = 0; i < slot.images.size(); i++) {
+			const RenderGraphImageState& previous = endStates[slot.images[(i + slot.images.size() - 1) % slot.images.size()]];
+			initialStates[slot.images[i]] = RenderGraphImageState{ VK_IMAGE_LAYOUT_UNDEFINED, previous.writeStages | previous.readStages, previous.writeAccess, 0, 0 };
+		}
+	}
+	simulate(initialStates, true);
+}
+
+//Plans one frame from the given image states and returns the states it ends in. When recording, the barriers, render
+//pass attachments and dependencies are stored with the passes.
+std::vector<RenderGraphImageState> RenderGraph::simulate(const std::vector<RenderGraphImageState>& initialStates, bool record) {
+	std::vector<RenderGraphImageState> states{ initialStates };
+	uint32_t pipelineBarriers = 0;
+	uint32_t imageBarriers = 0;
+	uint32_t subpassDependencies = 0;
+
+	for (uint32_t position = 0; position < m_order.size(); position++) {
+		PassNode& pass = m_passes[m_order[position]];
+		std::vector<Barrier> barriers;
+		std::vector<RenderGraphImage> attachmentImages;
+		std::vector<VkAttachmentDescription> attachments;
+		std::vector<VkClearValue> clearValues;
+		VkSubpassDependency dependencyIn{ .srcSubpass = VK_SUBPASS_EXTERNAL, .dstSubpass = 0 };
+		VkSubpassDependency dependencyOut{ .srcSubpass = 0, .dstSubpass = VK_SUBPASS_EXTERNAL };
+
+		for (const PassAccess& access : pass.accesses) {
+			AccessInfo info = getAccessInfo(access.access);
+			RenderGraphImageState& state = states[access.image];
+			VkImageLayout oldLayout;
+			VkPipelineStageFlags srcStages;
+			VkAccessFlags srcAccess;
+			bool needsBarrier = syncAccess(state, info, access.write, oldLayout, srcStages, srcAccess);
+
+			if (!isAttachment(access.access)) {
+				if (needsBarrier) {
+					barriers.push_back(Barrier{ access.image, oldLayout, info.layout, srcStages, info.stages, srcAccess, info.access });
+				}
+				continue;
+			}
+
+			//Attachments are synchronized by the render pass. Its external dependencies wait for earlier uses and
+			//move the attachment into the layout of its next use, which then needs no barrier of its own.
+			if (needsBarrier) {
+				dependencyIn.srcStageMask |= srcStages;
+				dependencyIn.dstStageMask |= info.stages;
+				dependencyIn.srcAccessMask |= srcAccess;
+				dependencyIn.dstAccessMask |= info.access;
+			}
+			const ImageResource& image = m_images[access.image];
+			const PassAccess* pNext = nullptr;
+			for (uint32_t later = position + 1; later < m_order.size() && pNext == nullptr; later++) {
+				for (const PassAccess& laterAccess : m_passes[m_order[later]].accesses) {
+					if (laterAccess.image == access.image) {
+						pNext = &laterAccess;
+					}
+				}
+			}
+
+			VkImageLayout finalLayout = info.layout;
+			if (pNext != nullptr) {
+				AccessInfo nextInfo = getAccessInfo(pNext->access);
+				if (nextInfo.layout != info.layout) {
+					finalLayout = nextInfo.layout;
+					dependencyOut.srcStageMask |= info.stages;
+					dependencyOut.dstStageMask |= nextInfo.stages;
+					dependencyOut.srcAccessMask |= info.access & WRITE_ACCESS_MASK;
+					dependencyOut.dstAccessMask |= nextInfo.access;
+					state = pNext->write ? RenderGraphImageState{ finalLayout, 0, 0, 0, 0 }
+						: RenderGraphImageState{ finalLayout, info.stages, info.access & WRITE_ACCESS_MASK, nextInfo.stages, nextInfo.access };
+				}
+			}
+
+			VkAttachmentLoadOp loadOp = access.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR
+				: oldLayout == VK_IMAGE_LAYOUT_UNDEFINED ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_LOAD;
+			VkAttachmentStoreOp storeOp = pNext != nullptr || image.output ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachmentImages.push_back(access.image);
+			attachments.push_back(VkAttachmentDescription{
+				.format = image.format,
+				.samples = VK_SAMPLE_COUNT_1_BIT,
+				.loadOp = loadOp,
+				.storeOp = storeOp,
+				.stencilLoadOp = hasStencil(image.format) ? loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+				.stencilStoreOp = hasStencil(image.format) ? storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+				.initialLayout = oldLayout,
+				.finalLayout = finalLayout
+			});
+			clearValues.push_back(access.clearValue);
+		}
+
+		if (!barriers.empty()) {
+			pipelineBarriers++;
+			imageBarriers += static_cast<uint32_t>(barriers.size());
+		}
+		subpassDependencies += (dependencyIn.srcStageMask != 0 ? 1 : 0) + (dependencyOut.srcStageMask != 0 ? 1 : 0);
+		if (record) {
+			pass.barriers = std::move(barriers);
+			pass.attachmentImages = std::move(attachmentImages);
+			pass.attachments = std::move(attachments);
+			pass.clearValues = std::move(clearValues);
+			pass.dependencies.clear();
+			for (const VkSubpassDependency& dependency : { dependencyIn, dependencyOut }) {
+				if (dependency.srcStageMask != 0) {
+					pass.dependencies.push_back(dependency);
+				}
+			}
+		}
+	}
+
+	std::vector<Barrier> finalBarriers;
+	for (RenderGraphImage i = 0; i < m_images.size(); i++) {
+		const ImageResource& image = m_images[i];
+		RenderGraphImageState& state = states[i];
+		if (!image.imported || image.firstUse == ~0u || state.layout == image.finalLayout) {
+			continue;
+		}
+		VkPipelineStageFlags priorStages = state.writeStages | state.readStages;
+		finalBarriers.push_back(Barrier{ i, state.layout, image.finalLayout, priorStages != 0 ? priorStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, state.writeAccess, 0 });
+		state = RenderGraphImageState{ image.finalLayout, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, 0 };
+	}
+	if (!finalBarriers.empty()) {
+		pipelineBarriers++;
+		imageBarriers += static_cast<uint32_t>(finalBarriers.size());
+	}
+
+	if (record) {
+		m_finalBarriers = std::move(finalBarriers);
+		m_stats.pipelineBarriers = pipelineBarriers;
+		m_stats.imageBarriers = imageBarriers;
+		m_stats.subpassDependencies = subpassDependencies;
+	}
+	return states;
+}
+
+void RenderGraph::createRenderPass(PassNode& pass) {
+	std::vector<VkAttachmentReference> colorRefs;
+	VkAttachmentReference depthRef{};
+	bool hasDepthAttachment = false;
+	for (uint32_t a = 0; a < pass.attachments.size(); a++) {
+		if (hasDepth(pass.attachments[a].format)) {
+			depthRef = VkAttachmentReference{ .attachment = a, .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+			hasDepthAttachment = true;
+		}
+		else {
+			colorRefs.push_back(VkAttachmentReference{ .attachment = a, .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+		}
+	}
+
+	VkSubpassDescription subpassDesc{
+		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+		.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size()),
+		.pColorAttachments = colorRefs.data(),
+		.pDepthStencilAttachment = hasDepthAttachment ? &depthRef : nullptr
+	};
+
+	VkRenderPassCreateInfo renderPassInfo{
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+		.attachmentCount = static_cast<uint32_t>(pass.attachments.size()),
+		.pAttachments = pass.attachments.data(),
+		.subpassCount = 1,
+		.pSubpasses = &subpassDesc,
+		.dependencyCount = static_cast<uint32_t>(pass.dependencies.size()),
+		.pDependencies = pass.dependencies.data()
+	};
+
+	if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &pass.renderPass) != VK_SUCCESS) {
+		throw std::runtime_error(std::string("Failed to create render pass for ") + pass.name);
+	}
+}
+
+void RenderGraph::resize(VkExtent2D extent) {
+	if (!m_compiled) {
+		throw std::runtime_error("Render graph has to be compiled before it is resized");
+	}
+	destroyResources();
+	m_extent = extent;
+
+	for (ImageResource& image : m_images) {
+		image.extent = VkExtent2D{
+			.width = std::max(static_cast<uint32_t>(static_cast<float>(extent.width) * image.scale), 1u),
+			.height = std::max(static_cast<uint32_t>(static_cast<float>(extent.height) * image.scale), 1u)
+		};
+		uint32_t fullChain = 1;
+		while ((std::max(image.extent.width, image.extent.height) >> fullChain) > 0) {
+			fullChain++;
+		}
+		image.levelCount = image.mipLevels == RENDER_GRAPH_FULL_MIP_CHAIN ? fullChain : std::min(image.mipLevels, fullChain);
+	}
+
+	m_stats.imageBytes = 0;
+	m_stats.allocatedBytes = 0;
+	for (AliasSlot& slot : m_slots) {
+		VkMemoryRequirements slotReqs{ .size = 0, .alignment = 1, .memoryTypeBits = ~0u };
+		for (RenderGraphImage i : slot.images) {
+			ImageResource& image = m_images[i];
+			VkImageCreateInfo imageInfo{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+				.imageType = VK_IMAGE_TYPE_2D,
+				.format = image.format,
+				.extent = VkExtent3D{ .width = image.extent.width, .height = image.extent.height, .depth = 1 },
+				.mipLevels = image.levelCount,
+				.arrayLayers = 1,
+				.samples = VK_SAMPLE_COUNT_1_BIT,
+				.tiling = VK_IMAGE_TILING_OPTIMAL,
+				.usage = image.usage,
+				.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+				.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+			};
+			if (vkCreateImage(m_device, &imageInfo, nullptr, &image.image) != VK_SUCCESS) {
+				throw std::runtime_error(std::string("Failed to create render graph image ") + image.name);
+			}
+			vkGetImageMemoryRequirements(m_device, image.image, &image.memoryReqs);
+			slotReqs.size = std::max(slotReqs.size, image.memoryReqs.size);
+			slotReqs.alignment = std::max(slotReqs.alignment, image.memoryReqs.alignment);
+			slotReqs.memoryTypeBits &= image.memoryReqs.memoryTypeBits;
+			m_stats.imageBytes += image.memoryReqs.size;
+		}
+		if (slotReqs.memoryTypeBits == 0) {
+			throw std::runtime_error(std::string("Failed to find a memory type every image aliased with ") + m_images[slot.images[0]].name + " supports");
+		}
+
+		slot.allocation = m_pAllocator->allocate(slotReqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, AllocationStrategy::FreeList, false);
+		m_stats.allocatedBytes += slotReqs.size;
+		for (RenderGraphImage i : slot.images) {
+			ImageResource& image = m_images[i];
+			vkBindImageMemory(m_device, image.image, slot.allocation.memory, slot.allocation.offset);
+
+			VkImageViewCreateInfo viewInfo{
+				.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+				.image = image.image,
+				.viewType = VK_IMAGE_VIEW_TYPE_2D,
+				.format = image.format,
+				.components = VkComponentMapping{
+					.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+					.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+					.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+					.a = VK_COMPONENT_SWIZZLE_IDENTITY
+				},
+				.subresourceRange = VkImageSubresourceRange{
+					.aspectMask = aspectOf(image.format),
+					.baseMipLevel = 0,
+					.levelCount = image.levelCount,
+					.baseArrayLayer = 0,
+					.layerCount = 1
+				}
+			};
+			if (vkCreateImageView(m_device, &viewInfo, nullptr, &image.view) != VK_SUCCESS) {
+				throw std::runtime_error(std::string("Failed to create view of render graph image ") + image.name);
+			}
+			for (uint32_t level = 0; image.levelCount > 1 && level < image.levelCount; level++) {
+				viewInfo.subresourceRange.baseMipLevel = level;
+				viewInfo.subresourceRange.levelCount = 1;
+				VkImageView mipView;
+				if (vkCreateImageView(m_device, &viewInfo, nullptr, &mipView) != VK_SUCCESS) {
+					throw std::runtime_error(std::string("Failed to create mip view of render graph image ") + image.name);
+				}
+				image.mipViews.push_back(mipView);
+			}
+		}
+	}
+
+	for (uint32_t passIndex : m_order) {
+		PassNode& pass = m_passes[passIndex];
+		if (pass.type != RenderGraphPassType::Graphics) {
+			continue;
+		}
+		if (pass.attachmentImages.empty()) {
+			throw std::runtime_error(std::string("Render graph pass ") + pass.name + " has no attachments");
+		}
+		std::vector<VkImageView> views;
+		pass.extent = m_images[pass.attachmentImages[0]].extent;
+		for (RenderGraphImage i : pass.attachmentImages) {
+			if (m_images[i].extent.width != pass.extent.width || m_images[i].extent.height != pass.extent.height) {
+				throw std::runtime_error(std::string("Attachments of render graph pass ") + pass.name + " differ in size");
+			}
+			views.push_back(m_images[i].view);
+		}
+
+		VkFramebufferCreateInfo framebufferInfo{
+			.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+			.renderPass = pass.renderPass,
+			.attachmentCount = static_cast<uint32_t>(views.size()),
+			.pAttachments = views.data(),
+			.width = pass.extent.width,
+			.height = pass.extent.height,
+			.layers = 1
+		};
+		if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &pass.framebuffer) != VK_SUCCESS) {
+			throw std::runtime_error(std::string("Failed to create framebuffer for ") + pass.name);
+		}
+	}
+}
+
+void RenderGraph::destroyResources() {
+	for (PassNode& pass : m_passes) {
+		if (pass.framebuffer != VK_NULL_HANDLE) {
+			vkDestroyFramebuffer(m_device, pass.framebuffer, nullptr);
+			pass.framebuffer = VK_NULL_HANDLE;
+		}
+	}
+	for (ImageResource& image : m_images) {
+		if (image.imported) {
+			continue;
+		}
+		for (VkImageView mipView : image.mipViews) {
+			vkDestroyImageView(m_device, mipView, nullptr);
+		}
+		image.mipViews.clear();
+		if (image.view != VK_NULL_HANDLE) {
+			vkDestroyImageView(m_device, image.view, nullptr);
+			image.view = VK_NULL_HANDLE;
+		}
+		if (image.image != VK_NULL_HANDLE) {
+			vkDestroyImage(m_device, image.image, nullptr);
+			image.image = VK_NULL_HANDLE;
+		}
+	}
+	for (AliasSlot& slot : m_slots) {
+		m_pAllocator->free(slot.allocation);
+		slot.allocation = Allocation{};
+	}
+}
+
+void RenderGraph::destroy() {
+	if (m_device == VK_NULL_HANDLE) {
+		return;
+	}
+	destroyResources();
+	for (PassNode& pass : m_passes) {
+		if (pass.renderPass != VK_NULL_HANDLE) {
+			vkDestroyRenderPass(m_device, pass.renderPass, nullptr);
+		}
+	}
+	m_images.clear();
+	m_passes.clear();
+	m_order.clear();
+	m_slots.clear();
+	m_finalBarriers.clear();
+	m_stats = RenderGraphStats{};
+	m_compiled = false;
+	m_device = VK_NULL_HANDLE;
+}
+
+void RenderGraph::setImportedImage(RenderGraphImage image, VkImage vkImage) {
+	m_images.at(image).image = vkImage;
+}
+
+void RenderGraph::setSubpassContents(RenderGraphPass pass, VkSubpassContents contents) {
+	m_passes.at(pass).contents = contents;
+}
+
+void RenderGraph::execute(VkCommandBuffer cmdBuffer, [[maybe_unused]] Profiler& profiler) {
+	for (uint32_t passIndex : m_order) {
+		PassNode& pass = m_passes[passIndex];
+		recordBarriers(cmdBuffer, pass.barriers);
+
+		PROFILE_GPU_ZONE(profiler, cmdBuffer, pass.name);
+		if (pass.type == RenderGraphPassType::Graphics) {
+			VkRenderPassBeginInfo passBeginInfo{
+				.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+				.renderPass = pass.renderPass,
+				.framebuffer = pass.framebuffer,
+				.renderArea = VkRect2D{ .offset = VkOffset2D{ .x = 0, .y = 0 }, .extent = pass.extent },
+				.clearValueCount = static_cast<uint32_t>(pass.clearValues.size()),
+				.pClearValues = pass.clearValues.data()
+			};
+			vkCmdBeginRenderPass(cmdBuffer, &passBeginInfo, pass.contents);
+			if (pass.record) {
+				pass.record(cmdBuffer);
+			}
+			vkCmdEndRenderPass(cmdBuffer);
+		}
+		else if (pass.record) {
+			pass.record(cmdBuffer);
+		}
+	}
+	recordBarriers(cmdBuffer, m_finalBarriers);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer cmdBuffer, const std::vector<Barrier>& barriers) {
+	if (barriers.empty()) {
+		return;
+	}
+	VkPipelineStageFlags srcStages = 0;
+	VkPipelineStageFlags dstStages = 0;
+	m_scratchBarriers.clear();
+	for (const Barrier& barrier : barriers) {
+		const ImageResource& image = m_images[barrier.image];
+		if (image.image == VK_NULL_HANDLE) {
+			throw std::runtime_error(std::string("Render graph image ") + image.name + " has no VkImage");
+		}
+		srcStages |= barrier.srcStages;
+		dstStages |= barrier.dstStages;
+		m_scratchBarriers.push_back(VkImageMemoryBarrier{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = barrier.srcAccess,
+			.dstAccessMask = barrier.dstAccess,
+			.oldLayout = barrier.oldLayout,
+			.newLayout = barrier.newLayout,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = image.image,
+			.subresourceRange = VkImageSubresourceRange{
+				.aspectMask = image.imported ? static_cast<VkImageAspectFlags>(VK_IMAGE_ASPECT_COLOR_BIT) : aspectOf(image.format),
+				.baseMipLevel = 0,
+				.levelCount = VK_REMAINING_MIP_LEVELS,
+				.baseArrayLayer = 0,
+				.layerCount = 1
+			}
+		});
+	}
+	vkCmdPipelineBarrier(cmdBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr,
+		static_cast<uint32_t>(m_scratchBarriers.size()), m_scratchBarriers.data());
+}
+
+VkRenderPass RenderGraph::getRenderPass(RenderGraphPass pass) const {
+	return m_passes.at(pass).renderPass;
+}
+
+VkFramebuffer RenderGraph::getFramebuffer(RenderGraphPass pass) const {
+	return m_passes.at(pass).framebuffer;
+}
+
+VkImage RenderGraph::getImage(RenderGraphImage image) const {
+	return m_images.at(image).image;
+}
+
+VkImageView RenderGraph::getView(RenderGraphImage image) const {
+	return m_images.at(image).view;
+}
+
+VkImageView RenderGraph::getMipView(RenderGraphImage image, uint32_t level) const {
+	const ImageResource& resource = m_images.at(image);
+	return resource.mipViews.empty() && level == 0 ? resource.view : resource.mipViews.at(level);
+}
+
+uint32_t RenderGraph::getMipLevels(RenderGraphImage image) const {
+	return m_images.at(image).levelCount;
+}
+
+VkExtent2D RenderGraph::getExtent(RenderGraphImage image) const {
+	return m_images.at(image).imported ? m_extent : m_images.at(image).extent;
+}
+
+bool RenderGraph::isCulled(RenderGraphPass pass) const {
+	return m_passes.at(pass).culled;
+}
+
+const RenderGraphStats& RenderGraph::getStats() const {
+	return m_stats;
+}
\ No newline at end of file
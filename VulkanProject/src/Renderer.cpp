@@ -4,6 +4,21 @@ void windowCloseCallback(GLFWwindow* pWin) {
 	glfwSetWindowShouldClose(pWin, GL_TRUE);
 }
 
+const char* presentModeName(VkPresentModeKHR mode) {
+	switch (mode) {
+	case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+	case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+	case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo relaxed";
+	default: return "other";
+	}
+}
+
+Renderer::Renderer(const RendererConfig& config) :
+	m_config{ config },
+	m_jobs{ config.workerThreads },
+	m_framesInFlight{ std::clamp(config.framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT) } {}
+
 Renderer::~Renderer() {
 	cleanup();
 }
@@ -11,7 +26,72 @@ Renderer::~Renderer() {
 void Renderer::run() {
 	init();
 	loop();
-	cleanup();
+}
+
+const FrameStats& Renderer::getFrameStats() const {
+	return m_frameStats;
+}
+
+const FrameTimeSamples& Renderer::getFrameTimeSamples() const {
+	return m_frameTimeSamples;
+}
+
+const StartupStats& Renderer::getStartupStats() const {
+	return m_startupStats;
+}
+
+const RenderGraph& Renderer::getRenderGraph() const {
+	return m_renderGraph;
+}
+
+VkDevice Renderer::getDevice() const {
+	return m_device;
+}
+
+std::string Renderer::getDeviceName() const {
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(m_physDevice, &props);
+	return props.deviceName;
+}
+
+std::vector<HeapStats> Renderer::getHeapStats() const {
+	return m_allocator.getHeapStats();
+}
+
+GpuAllocator& Renderer::getAllocator() {
+	return m_allocator;
+}
+
+UploadManager& Renderer::getUploads() {
+	return m_uploads;
+}
+
+JobSystem& Renderer::getJobSystem() {
+	return m_jobs;
+}
+
+const FramePacer& Renderer::getFramePacer() const {
+	return m_pacer;
+}
+
+const Profiler& Renderer::getProfiler() const {
+	return m_profiler;
+}
+
+UniformRing& Renderer::getUniforms() {
+	return m_uniforms;
+}
+
+DescriptorAllocator& Renderer::getDescriptors() {
+	return m_descriptors;
+}
+
+PipelineLibrary& Renderer::getPipelines() {
+	return m_pipelines;
+}
+
+TextureStreamer& Renderer::getTextures() {
+	return m_textures;
 }
 
 void Renderer::chooseMostSuitablePhysicalDevice() {
@@ -61,331 +141,654 @@ void Renderer::setQueueIndices() {
 	}
 };
 
-void Renderer::createRenderPass(){
-	VkAttachmentDescription colorAttachmentDesc{
-		.format = VK_FORMAT_R32G32B32_SFLOAT,
-		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.loadOp = VK_ATTACHMENT_LOAD_OP_NONE,
-		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_NONE,
-		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_NONE,
-		.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-	};
+void Renderer::createFrameResources() {
+	PROFILE_ZONE(m_profiler, "createFrameResources");
+	m_frames = std::vector<FrameData>(m_framesInFlight);
 
-	VkAttachmentDescription depthAttachmentDesc{
-		.format = VK_FORMAT_R32_SFLOAT,
-		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
-		.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
-		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_NONE,
-		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_NONE,
-		.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-		.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+	VkCommandPoolCreateInfo cmdPoolInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		.queueFamilyIndex = m_queueIndices.graphicsIndex
 	};
 
-	std::vector<VkAttachmentDescription> attachDescs = { colorAttachmentDesc, depthAttachmentDesc };
-
-	VkAttachmentReference colorAttachmentRef{
-		.attachment = 0,
-		.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+	VkFenceCreateInfo fenceInfo{
+		.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+		.flags = VK_FENCE_CREATE_SIGNALED_BIT //so the first wait on each slot returns immediately
 	};
 
-	VkAttachmentReference depthAttachmentRef{
-		.attachment = 1,
-		.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+	VkSemaphoreCreateInfo semaphoreInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
 	};
 
-	VkSubpassDescription subpassDesc{
-		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
-		.inputAttachmentCount = 0,
-		.colorAttachmentCount = 1,
-		.pColorAttachments = &colorAttachmentRef,
-		.pDepthStencilAttachment = &depthAttachmentRef,
-		.preserveAttachmentCount = 0
-	};
+	uint32_t familyCount;
+	vkGetPhysicalDeviceQueueFamilyProperties(m_physDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> familyProps(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(m_physDevice, &familyCount, familyProps.data());
 
-	VkRenderPassCreateInfo renderPassInfo{
-		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
-		.attachmentCount = static_cast<uint32_t>(attachDescs.size()),
-		.pAttachments = attachDescs.data(),
-		.subpassCount = 1,
-		.pSubpasses = &subpassDesc
-	};
+	VkPhysicalDeviceProperties deviceProps;
+	vkGetPhysicalDeviceProperties(m_physDevice, &deviceProps);
+	m_timestampsSupported = familyProps.at(m_queueIndices.graphicsIndex).timestampValidBits > 0;
+	m_timestampPeriod = deviceProps.limits.timestampPeriod;
 
-	if (vkCreateRenderPass(m_device, &renderPassInfo, P_DEFAULT_ALLOC, &m_renderPass) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create Render Pass");
-	}
-
-	VkImageCreateInfo colorAttachImageInfo{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-		.imageType = VK_IMAGE_TYPE_2D,
-		.format = VK_FORMAT_R32G32B32_SFLOAT,
-		.extent = {
-			.width = m_surfaceExtent.width,
-			.height = m_surfaceExtent.height,
-			.depth = 1
-		},
-		.mipLevels = 1,
-		.arrayLayers = 1,
-		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.tiling = VK_IMAGE_TILING_OPTIMAL,
-		.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-		.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+	VkQueryPoolCreateInfo queryPoolInfo{
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = TIMESTAMPS_PER_FRAME
 	};
 
-	VkImageCreateInfo depthAttachImageInfo{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
-		.imageType = VK_IMAGE_TYPE_2D,
-		.format = VK_FORMAT_R32_SFLOAT,
-		.extent = VkExtent3D{
-			.width = m_surfaceExtent.width,
-			.height = m_surfaceExtent.height,
-			.depth = 1
-		},
-		.mipLevels = 1,
-		.arrayLayers = 1,
-		.samples = VK_SAMPLE_COUNT_1_BIT,
-		.tiling = VK_IMAGE_TILING_OPTIMAL,
-		.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-		.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
-	};
+	for (FrameData& frame : m_frames) {
+		frame.timestampPool = VK_NULL_HANDLE;
+		frame.timestampsPending = false;
+		frame.visibleCountPending = false;
+		frame.cpuFrameMs = 0.0;
+		if (m_timestampsSupported && vkCreateQueryPool(m_device, &queryPoolInfo, P_DEFAULT_ALLOC, &frame.timestampPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create timestamp Query Pool");
+		}
 
-	vkCreateImage(m_device, &colorAttachImageInfo, P_DEFAULT_ALLOC, &m_colorAttachImage);
-	vkCreateImage(m_device, &depthAttachImageInfo, P_DEFAULT_ALLOC, &m_depthAttachImage);
-
-	VkImageViewCreateInfo colorAttachViewInfo{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-		.image = m_colorAttachImage,
-		.viewType = VK_IMAGE_VIEW_TYPE_2D,
-		.format = VK_FORMAT_R32G32B32_SFLOAT,
-		.components = VkComponentMapping{
-			.r = VK_COMPONENT_SWIZZLE_IDENTITY,
-			.g = VK_COMPONENT_SWIZZLE_IDENTITY,
-			.b = VK_COMPONENT_SWIZZLE_IDENTITY,
-			.a = VK_COMPONENT_SWIZZLE_IDENTITY
-		},
-		.subresourceRange = VkImageSubresourceRange{
-			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1
+		if (vkCreateCommandPool(m_device, &cmdPoolInfo, P_DEFAULT_ALLOC, &frame.cmdPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create Command Pool");
 		}
-	};
 
-	VkImageViewCreateInfo depthAttachViewInfo{
-		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-		.image = m_colorAttachImage,
-		.viewType = VK_IMAGE_VIEW_TYPE_2D,
-		.format = VK_FORMAT_R32_SFLOAT,
-		.components = VkComponentMapping{
-			.r = VK_COMPONENT_SWIZZLE_IDENTITY,
-			.g = VK_COMPONENT_SWIZZLE_IDENTITY,
-			.b = VK_COMPONENT_SWIZZLE_IDENTITY,
-			.a = VK_COMPONENT_SWIZZLE_IDENTITY
-		},
-		.subresourceRange = VkImageSubresourceRange{
-			.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
-			.baseMipLevel = 0,
-			.levelCount = 1,
-			.baseArrayLayer = 0,
-			.layerCount = 1
+		VkCommandBufferAllocateInfo cmdBufferInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = frame.cmdPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1
+		};
+
+		if (vkAllocateCommandBuffers(m_device, &cmdBufferInfo, &frame.cmdBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate command buffer");
 		}
-	};
 
-	vkCreateImageView(m_device, &colorAttachViewInfo, P_DEFAULT_ALLOC, &m_colorAttachView);
-	vkCreateImageView(m_device, &depthAttachViewInfo, P_DEFAULT_ALLOC, &m_depthAttachView);
+		frame.workerCommands = std::vector<WorkerCommands>(m_jobs.getWorkerCount());
+		for (WorkerCommands& commands : frame.workerCommands) {
+			commands.usedCount = 0;
+			if (vkCreateCommandPool(m_device, &cmdPoolInfo, P_DEFAULT_ALLOC, &commands.cmdPool) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create worker Command Pool");
+			}
+		}
 
-	std::vector<VkImageView> attachments{ m_colorAttachView, m_depthAttachView };
+		if (vkCreateFence(m_device, &fenceInfo, P_DEFAULT_ALLOC, &frame.inFlightFence) != VK_SUCCESS ||
+			vkCreateSemaphore(m_device, &semaphoreInfo, P_DEFAULT_ALLOC, &frame.imageAvailableSem) != VK_SUCCESS ||
+			vkCreateSemaphore(m_device, &semaphoreInfo, P_DEFAULT_ALLOC, &frame.renderCompleteSem) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create frame synchronization objects");
+		}
+	}
+}
 
-	VkFramebufferCreateInfo framebufferInfo{
-		.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
-		.renderPass = m_renderPass,
-		.attachmentCount = static_cast<uint32_t>(attachments.size()),
-		.pAttachments = attachments.data(),
-		.width = m_surfaceExtent.width,
-		.height = m_surfaceExtent.height,
-		.layers = 1
-	};
+void Renderer::destroyFrameResources() {
+	for (FrameData& frame : m_frames) {
+		if (frame.timestampPool != VK_NULL_HANDLE) {
+			vkDestroyQueryPool(m_device, frame.timestampPool, P_DEFAULT_ALLOC);
+		}
+		vkDestroySemaphore(m_device, frame.renderCompleteSem, P_DEFAULT_ALLOC);
+		vkDestroySemaphore(m_device, frame.imageAvailableSem, P_DEFAULT_ALLOC);
+		vkDestroyFence(m_device, frame.inFlightFence, P_DEFAULT_ALLOC);
+		vkDestroyCommandPool(m_device, frame.cmdPool, P_DEFAULT_ALLOC);
+		for (WorkerCommands& commands : frame.workerCommands) {
+			vkDestroyCommandPool(m_device, commands.cmdPool, P_DEFAULT_ALLOC);
+		}
+	}
+	m_frames.clear();
+}
 
-	vkCreateFramebuffer(m_device, &framebufferInfo, P_DEFAULT_ALLOC, &m_framebuffer);
+//The scene renders offscreen into color and depth attachments. Windowed frames blit the color into the acquired
+//swapchain image, headless frames keep it as the output. Without occlusion culling the depth is never read after the
+//pass, so it is not stored. With it the frame draws what was visible last frame, reduces that depth into a pyramid,
+//culls the rest against it and draws what turned out visible on top.
+void Renderer::createRenderGraph() {
+	PROFILE_ZONE(m_profiler, "createRenderGraph");
+	m_sceneColor = m_renderGraph.createImage("sceneColor", COLOR_ATTACHMENT_FORMAT);
+	m_sceneDepth = m_renderGraph.createImage("sceneDepth", DEPTH_ATTACHMENT_FORMAT);
+	bool occlusion = m_config.occlusionCulling && m_config.gpuCulling && m_config.sceneObjectCount > 0;
+
+	//The cull passes write buffers the graph does not track, GpuScene synchronizes them with the draws itself
+	if (occlusion) {
+		RenderGraphPass earlyCullPass = m_renderGraph.addPass("earlyCull", RenderGraphPassType::Compute, [this](VkCommandBuffer cmdBuffer) {
+			m_gpuScene.recordEarlyCull(cmdBuffer, m_currentFrame, m_viewFrustum, glm::vec4(m_viewEye, m_lodProjectionScale));
+		});
+		m_renderGraph.markSideEffects(earlyCullPass);
+	}
+
+	VkClearColorValue clearColor{ .float32 = { 0.0f, 0.0f, 0.0f, 1.0f } };
+	VkClearDepthStencilValue clearDepth{ .depth = 1.0f, .stencil = 0 };
+	m_scenePass = m_renderGraph.addPass("scene", RenderGraphPassType::Graphics, [this](VkCommandBuffer cmdBuffer) { recordScenePass(cmdBuffer); });
+	m_renderGraph.addColorAttachment(m_scenePass, m_sceneColor, &clearColor);
+	m_renderGraph.addDepthAttachment(m_scenePass, m_sceneDepth, &clearDepth);
+
+	if (occlusion) {
+		m_depthPyramidImage = m_renderGraph.createImage("depthPyramid", DEPTH_PYRAMID_FORMAT, DEPTH_PYRAMID_SCALE, RENDER_GRAPH_FULL_MIP_CHAIN);
+		RenderGraphPass pyramidPass = m_renderGraph.addPass("depthPyramid", RenderGraphPassType::Compute, [this](VkCommandBuffer cmdBuffer) {
+			m_depthPyramid.record(cmdBuffer, m_renderGraph, m_sceneDepth, m_depthPyramidImage);
+		});
+		m_renderGraph.addRead(pyramidPass, m_sceneDepth, RenderGraphAccess::ComputeSampled);
+		m_renderGraph.addWrite(pyramidPass, m_depthPyramidImage, RenderGraphAccess::ComputeStorage);
+
+		RenderGraphPass lateCullPass = m_renderGraph.addPass("lateCull", RenderGraphPassType::Compute, [this](VkCommandBuffer cmdBuffer) {
+			m_occlusionInputs.pyramidView = m_renderGraph.getView(m_depthPyramidImage);
+			m_occlusionInputs.pyramidSampler = m_depthPyramid.getSampler();
+			m_gpuScene.recordLateCull(cmdBuffer, m_currentFrame, m_viewFrustum, glm::vec4(m_viewEye, m_lodProjectionScale), m_occlusionInputs);
+		});
+		m_renderGraph.addRead(lateCullPass, m_depthPyramidImage, RenderGraphAccess::ComputeSampled);
+		m_renderGraph.markSideEffects(lateCullPass);
+
+		RenderGraphPass lateScenePass = m_renderGraph.addPass("lateScene", RenderGraphPassType::Graphics, [this](VkCommandBuffer cmdBuffer) {
+			recordIndirectDraws(cmdBuffer, m_currentFrame, m_gpuScene.getDrawCount());
+		});
+		m_renderGraph.addColorAttachment(lateScenePass, m_sceneColor);
+		m_renderGraph.addDepthAttachment(lateScenePass, m_sceneDepth);
+	}
+
+	if (m_config.headless) {
+		m_renderGraph.markOutput(m_sceneColor);
+	}
+	else {
+		//The acquire semaphore is waited at the color output stage
+		m_swapchainTarget = m_renderGraph.importImage("swapchain", VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+		RenderGraphPass presentPass = m_renderGraph.addPass("presentBlit", RenderGraphPassType::Transfer,
+			[this](VkCommandBuffer cmdBuffer) { recordPresentBlit(cmdBuffer); });
+		m_renderGraph.addRead(presentPass, m_sceneColor, RenderGraphAccess::TransferSrc);
+		m_renderGraph.addWrite(presentPass, m_swapchainTarget, RenderGraphAccess::TransferDst);
+	}
+
+	m_renderGraph.compile(m_device, m_allocator);
+	m_renderGraph.resize(m_surfaceExtent);
 }
 
 void Renderer::preparePipelineData() {
-	VkBufferCreateInfo projectionDataBufferInfo{
-	.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-	.size = sizeof(CameraProjectionData),
-	.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-	.sharingMode = VK_SHARING_MODE_EXCLUSIVE //MAKE SURE TO CHANGE THIS IF CAMERA DATA IS USED FOR NON GRAPHICS GPU STUFF
-	};
-
-	vkCreateBuffer(m_device, &projectionDataBufferInfo, P_DEFAULT_ALLOC, &m_projectionDataBuf);
+	PROFILE_ZONE(m_profiler, "preparePipelineData");
+	//Instanced CPU culled frames also put the objects of their draws into the ring, at most one per scene object
+	VkDeviceSize instanceBytes = usesDrawList() ? static_cast<VkDeviceSize>(m_config.sceneObjectCount) * sizeof(uint32_t) : 0;
+	m_uniforms.init(m_physDevice, m_allocator, m_framesInFlight, DEFAULT_UNIFORM_RING_FRAME_SIZE + instanceBytes);
+	m_descriptors.init(m_device, m_framesInFlight);
 
 	VkDescriptorSetLayoutBinding lowFreqDescSetLayoutBinding{
 		.binding = BINDING_LOW_FREQ,
-		.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+		.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
 		.descriptorCount = 1,
 		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT
 	};
+	m_lowFreqDescSetLayout = m_descriptors.getLayout({ &lowFreqDescSetLayoutBinding, 1 });
+
+	//The range covers one frame's camera data, the dynamic offset moves it through the ring
+	DescriptorBinding cameraBinding{
+		.binding = BINDING_LOW_FREQ,
+		.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+		.bufferInfo = { m_uniforms.getBuffer(), 0, sizeof(CameraProjectionData) }
+	};
+	m_lowFreqDescSet = m_descriptors.getPersistentSet(m_lowFreqDescSetLayout, { &cameraBinding, 1 });
+}
+
+//Placeholder geometry until scenes are loaded. Synthetic draws use the triangle the vertex shader used to hardcode,
+//generated scenes a displaced sphere with a LOD chain so distant objects have something to simplify, split into
+//meshlets so near objects can drop their hidden clusters.
+void Renderer::createMeshBuffers() {
+	PROFILE_ZONE(m_profiler, "createMeshBuffers");
+	if (m_config.sceneObjectCount > 0) {
+		ImportedMesh sphere = Primitives::icosphere(SCENE_MESH_SUBDIVISIONS, 0.1f, 1234);
+		LodChain chain = MeshLod::buildChain(sphere.vertices, sphere.indices);
+		m_meshlets = Meshlets::build(sphere.vertices, chain.indices, chain.levels);
+		m_mesh = Mesh(sphere.vertices, chain.indices, std::move(chain.levels), m_meshLayout);
+		if (m_config.meshletCulling && !m_config.gpuCulling) {
+			m_indexRing.init(m_allocator, m_framesInFlight);
+		}
+	}
+	else {
+		std::vector<Vertex> vertices{
+			{ .pos = glm::vec3(0.0f, -0.5f, 0.0f), .normal = glm::vec3(0.0f, 0.0f, -1.0f) },
+			{ .pos = glm::vec3(0.5f, 0.5f, 0.0f), .normal = glm::vec3(0.0f, 0.0f, -1.0f) },
+			{ .pos = glm::vec3(-0.5f, 0.5f, 0.0f), .normal = glm::vec3(0.0f, 0.0f, -1.0f) }
+		};
+		m_mesh = Mesh(vertices, m_meshLayout);
+	}
 
-	VkDescriptorSetLayoutCreateInfo lowFreqDescSetLayoutInfo{
-		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-		.bindingCount = 1,
-		.pBindings = &lowFreqDescSetLayoutBinding
+	VkBufferCreateInfo vertexBufferInfo{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = m_mesh.getVertexData().size(),
+		.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+	};
+	VkBufferCreateInfo indexBufferInfo{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = m_mesh.getIndexData().size(),
+		.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE
 	};
 
-	vkCreateDescriptorSetLayout(m_device, &lowFreqDescSetLayoutInfo, P_DEFAULT_ALLOC, &m_lowFreqDescSetLayout);
+	m_meshVertexAlloc = m_allocator.createBuffer(vertexBufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, AllocationStrategy::FreeList, m_meshVertexBuf);
+	m_meshIndexAlloc = m_allocator.createBuffer(indexBufferInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, AllocationStrategy::FreeList, m_meshIndexBuf);
+	m_uploads.uploadBuffer(m_meshVertexBuf, 0, m_mesh.getVertexData().data(), m_mesh.getVertexData().size());
+	m_uploads.wait(m_uploads.uploadBuffer(m_meshIndexBuf, 0, m_mesh.getIndexData().data(), m_mesh.getIndexData().size()));
+}
+
+//Scatters scaled copies of the placeholder mesh around the camera, enough of them fall outside the frustum for culling to matter
+void Renderer::createScene() {
+	PROFILE_ZONE(m_profiler, "createScene");
+	if (m_config.sceneObjectCount == 0) {
+		return;
+	}
+
+	if (m_config.sceneLayout == SceneLayout::City) {
+		createCityScene();
+	}
+	else {
+		std::mt19937 rng{ 1234 };
+		std::uniform_real_distribution<float> posDist{ -SCENE_EXTENT, SCENE_EXTENT };
+		for (uint32_t i = 0; i < m_config.sceneObjectCount; i++) {
+			glm::mat4 transform{ 1.0f };
+			transform[0][0] = SCENE_OBJECT_SCALE;
+			transform[1][1] = SCENE_OBJECT_SCALE;
+			transform[2][2] = SCENE_OBJECT_SCALE;
+			transform[3] = glm::vec4(posDist(rng), posDist(rng), posDist(rng), 1.0f);
+			m_scene.addObject(transform, &m_mesh);
+		}
+	}
+
+	//Without a dedicated compute family the cull runs on the graphics queue, ahead of the frame's draws. The occlusion
+	//cull always does, it depends on the frame's own draws.
+	VkQueue computeQueue = m_computeQueue != VK_NULL_HANDLE ? m_computeQueue : m_graphicsQueue;
+	m_gpuScene.init(m_device, m_allocator, m_descriptors, m_queueIndices.graphicsIndex, m_queueIndices.computeIndex, computeQueue,
+		m_framesInFlight, m_config.occlusionCulling && m_config.gpuCulling);
+	const Mesh* meshes[]{ &m_mesh };
+	m_gpuScene.setObjects(m_scene, meshes);
+
+	//The ring spans every frame slot, so one set serves all of them and instanceBase selects the frame's instances
+	if (usesDrawList()) {
+		DescriptorBinding bindings[]{
+			{ .binding = BINDING_SCENE_OBJECTS, .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .bufferInfo = { m_gpuScene.getObjectBuffer(), 0, VK_WHOLE_SIZE } },
+			{ .binding = BINDING_VISIBLE_INSTANCES, .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .bufferInfo = { m_uniforms.getBuffer(), 0, VK_WHOLE_SIZE } }
+		};
+		m_instanceDescSet = m_descriptors.getPersistentSet(m_gpuScene.getSetLayout(), bindings);
+	}
+}
+
+//Stretched copies of the placeholder mesh stand in for buildings on a square grid, small ones for props scattered
+//over the whole city. The camera stands in a street looking along it, so the buildings on either side hide most of
+//the city while the street stays open to the horizon.
+void Renderer::createCityScene() {
+	uint32_t buildingCount = (m_config.sceneObjectCount + CITY_BUILDING_INTERVAL - 1) / CITY_BUILDING_INTERVAL;
+	uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(buildingCount))));
+	float cityExtent = static_cast<float>(gridSize) * CITY_BLOCK_SIZE * 0.5f;
+
+	std::mt19937 rng{ 1234 };
+	std::uniform_real_distribution<float> heightDist{ 0.4f, 1.2f };
+	std::uniform_real_distribution<float> posDist{ -cityExtent, cityExtent };
+	uint32_t buildingIndex = 0;
+	for (uint32_t i = 0; i < m_config.sceneObjectCount; i++) {
+		glm::mat4 transform{ 1.0f };
+		if (i % CITY_BUILDING_INTERVAL == 0) {
+			float x = (static_cast<float>(buildingIndex % gridSize) + 0.5f) * CITY_BLOCK_SIZE - cityExtent;
+			float z = (static_cast<float>(buildingIndex / gridSize) + 0.5f) * CITY_BLOCK_SIZE - cityExtent;
+			transform[0][0] = CITY_BLOCK_SIZE * 0.4f;
+			transform[1][1] = CITY_BLOCK_SIZE * heightDist(rng);
+			transform[2][2] = CITY_BLOCK_SIZE * 0.4f;
+			transform[3] = glm::vec4(x, 0.0f, z, 1.0f);
+			buildingIndex++;
+		}
+		else {
+			transform[3] = glm::vec4(posDist(rng), 1.0f, posDist(rng), 1.0f);
+		}
+		m_scene.addObject(transform, &m_mesh);
+	}
+
+	//Streets run between the grid columns, the one next to the center column points down the middle of the city
+	float streetX = (static_cast<float>(gridSize / 2) + 1.0f) * CITY_BLOCK_SIZE - cityExtent;
+	m_camera.m_pos = glm::vec3(streetX, CITY_CAMERA_HEIGHT, 0.0f);
+	m_camera.m_pitch = 0.0f;
+	m_camera.m_yaw = 0.0f;
 }
 
 void Renderer::createProjectionPipeline() {
-	ShaderCompile::compileShader("projectionVert.vert");
-	ShaderCompile::compileShader("projectionFrag.frag");
-	std::vector<char> vertCode{ ShaderCompile::readCompiledShader("projectionVert.spv") };
-	std::vector<char> fragCode{ ShaderCompile::readCompiledShader("projectionFrag.spv") };
+	PROFILE_ZONE(m_profiler, "createProjectionPipeline");
+	ShaderVariant vertVariant{ "projectionVert.vert" };
+	if (m_meshLayout.normal == NormalFormat::Oct16) {
+		vertVariant.defines.push_back({ "NORMAL_OCT16", "" });
+	}
+	bool sceneObjects = m_config.sceneObjectCount > 0;
+	if (sceneObjects) {
+		vertVariant.defines.push_back({ "SCENE_OBJECTS", "" });
+		if (m_config.gpuCulling || usesDrawList()) {
+			vertVariant.defines.push_back({ "INSTANCE_LIST", "" });
+		}
+	}
+	ShaderVariant fragVariant{ "projectionFrag.frag" };
+	ShaderVariant cullVariant{ "cullObjects.comp", { { "WORKGROUP_SIZE", std::to_string(CULL_WORKGROUP_SIZE) } } };
+	ShaderVariant earlyCullVariant{ cullVariant };
+	earlyCullVariant.defines.push_back({ "OCCLUSION_EARLY", "" });
+	ShaderVariant lateCullVariant{ cullVariant };
+	lateCullVariant.defines.push_back({ "OCCLUSION_LATE", "" });
+	ShaderVariant pyramidVariant{ "depthPyramid.comp", { { "WORKGROUP_SIZE", std::to_string(DEPTH_PYRAMID_WORKGROUP_SIZE) } } };
+	bool occlusion = sceneObjects && m_gpuScene.isTwoPhase();
+	std::vector<ShaderVariant> variants{ vertVariant, fragVariant };
+	if (occlusion) {
+		variants.insert(variants.end(), { earlyCullVariant, lateCullVariant, pyramidVariant });
+	}
+	else if (sceneObjects) {
+		variants.push_back(cullVariant);
+	}
+	m_startupStats.shaderBuild = ShaderCompile::buildShaders(variants);
+	MappedFile vertCode{ ShaderCompile::mapCompiledShader(ShaderCompile::getOutputName(vertVariant)) };
+	MappedFile fragCode{ ShaderCompile::mapCompiledShader(ShaderCompile::getOutputName(fragVariant)) };
 
 	m_projVertModule = ShaderCompile::createShaderModule(m_device, vertCode);
 	m_projFragModule = ShaderCompile::createShaderModule(m_device, fragCode);
 
-	VkPipelineShaderStageCreateInfo vertInfo{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-		.stage = VK_SHADER_STAGE_VERTEX_BIT,
-		.module = m_projVertModule,
-		.pName = "main"
-	};
-	VkPipelineShaderStageCreateInfo fragInfo{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-		.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-		.module = m_projFragModule,
-		.pName = "main"
+	if (occlusion) {
+		MappedFile earlyCode{ ShaderCompile::mapCompiledShader(ShaderCompile::getOutputName(earlyCullVariant)) };
+		MappedFile lateCode{ ShaderCompile::mapCompiledShader(ShaderCompile::getOutputName(lateCullVariant)) };
+		MappedFile pyramidCode{ ShaderCompile::mapCompiledShader(ShaderCompile::getOutputName(pyramidVariant)) };
+		VkShaderModule earlyModule = ShaderCompile::createShaderModule(m_device, earlyCode);
+		VkShaderModule lateModule = ShaderCompile::createShaderModule(m_device, lateCode);
+		VkShaderModule pyramidModule = ShaderCompile::createShaderModule(m_device, pyramidCode);
+		std::chrono::steady_clock::time_point cullPipelineStart = std::chrono::steady_clock::now();
+		m_gpuScene.createOcclusionPipelines(earlyModule, lateModule, m_pipelineCache.get());
+		m_depthPyramid.init(m_device, m_descriptors);
+		m_depthPyramid.createPipeline(pyramidModule, m_pipelineCache.get());
+		m_startupStats.pipelineCreationMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullPipelineStart).count();
+		vkDestroyShaderModule(m_device, earlyModule, P_DEFAULT_ALLOC);
+		vkDestroyShaderModule(m_device, lateModule, P_DEFAULT_ALLOC);
+		vkDestroyShaderModule(m_device, pyramidModule, P_DEFAULT_ALLOC);
+	}
+	else if (sceneObjects) {
+		MappedFile cullCode{ ShaderCompile::mapCompiledShader(ShaderCompile::getOutputName(cullVariant)) };
+		VkShaderModule cullModule = ShaderCompile::createShaderModule(m_device, cullCode);
+		std::chrono::steady_clock::time_point cullPipelineStart = std::chrono::steady_clock::now();
+		m_gpuScene.createPipeline(cullModule, m_pipelineCache.get());
+		m_startupStats.pipelineCreationMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullPipelineStart).count();
+		vkDestroyShaderModule(m_device, cullModule, P_DEFAULT_ALLOC);
+	}
+
+	VkPushConstantRange meshPushConstantRange{
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+		.offset = 0,
+		.size = sizeof(MeshPushConstants)
 	};
 
-	std::vector<VkPipelineShaderStageCreateInfo> shaderStageInfos{ vertInfo, fragInfo };
+	std::vector<VkDescriptorSetLayout> setLayouts{ m_lowFreqDescSetLayout };
+	if (sceneObjects) {
+		setLayouts.push_back(m_gpuScene.getSetLayout()); //SET_SCENE_OBJECTS
+	}
 
-	VkVertexInputBindingDescription vertexInputBindingInfo{
-		.binding = BINDING_VERTEX_BUFFER,
-		.stride = sizeof(Vertex),
-		.inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.setLayoutCount = static_cast<uint32_t>(setLayouts.size()),
+		.pSetLayouts = setLayouts.data(),
+		.pushConstantRangeCount = 1,
+		.pPushConstantRanges = &meshPushConstantRange
 	};
 
-	VkPipelineVertexInputStateCreateInfo vertexInputStateInfo{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-		.vertexBindingDescriptionCount = 1,
-		.pVertexBindingDescriptions = &vertexInputBindingInfo
-	};
 
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateInfo{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-		.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-		.primitiveRestartEnable = VK_FALSE
-	};
+	vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, P_DEFAULT_ALLOC, &m_pipelineLayout);
 
-	VkPipelineTessellationStateCreateInfo tessellationStateInfo{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_TESSELLATION_STATE_CREATE_INFO,
-		.patchControlPoints = 1
+	//Viewport and scissor are dynamic, so the key does not depend on the surface extent
+	GraphicsPipelineKey pipelineKey{
+		.vertexModule = m_projVertModule,
+		.fragmentModule = m_projFragModule,
+		.vertexLayout = m_meshLayout,
+		.vertexBinding = BINDING_VERTEX_BUFFER,
+		//Imported meshes keep whatever winding their files had, so both faces are drawn. Back facing meshlets are
+		//dropped by cone culling in prepareObjectDraw instead, which only runs while the eye is outside the mesh.
+		.cullMode = VK_CULL_MODE_NONE,
+		.layout = m_pipelineLayout,
+		.renderPass = m_renderGraph.getRenderPass(m_scenePass),
+		.subpass = 0
 	};
 
-	VkViewport viewport{
-		.x=0.0f,
-		.y=0.0f,
-		.width = static_cast<float>(m_surfaceExtent.width),
-		.height = static_cast<float>(m_surfaceExtent.height),
-		.minDepth = 0.0f,
-		.maxDepth = 1.0f
-	};
+	std::chrono::steady_clock::time_point pipelineStart = std::chrono::steady_clock::now();
+	m_pipeline = m_pipelines.getGraphicsPipeline(pipelineKey);
+	m_startupStats.pipelineCreationMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineStart).count();
+}
 
-	VkRect2D scissor{
-		.offset = {
-			.x=0,
-			.y=0
-		},
-		.extent = m_surfaceExtent
-	};
+void Renderer::createDevice() {
+	PROFILE_ZONE(m_profiler, "createDevice");
+	float priority = 1.0f;
 
-	VkPipelineViewportStateCreateInfo viewportStateInfo{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-		.viewportCount = 1,
-		.pViewports = &viewport,
-		.scissorCount = 1,
-		.pScissors = &scissor
-	};
+	//Software implementations such as lavapipe expose a single queue family, so only request the families that exist
+	std::vector<VkDeviceQueueCreateInfo> queueInfos;
+	for (uint32_t familyIndex : { m_queueIndices.graphicsIndex, m_queueIndices.computeIndex, m_queueIndices.transferIndex }) {
+		if (familyIndex == UINT32_MAX) {
+			continue;
+		}
+		queueInfos.push_back(VkDeviceQueueCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+			.queueFamilyIndex = familyIndex,
+			.queueCount = 1,
+			.pQueuePriorities = &priority
+		});
+	}
 
-	VkPipelineRasterizationStateCreateInfo rasterizationStateInfo{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-		.depthClampEnable = VK_TRUE,
-		.rasterizerDiscardEnable = VK_FALSE,
-		.polygonMode = VK_POLYGON_MODE_FILL,
-		.cullMode = VK_CULL_MODE_NONE, //           *******CHANGE THIS LATER!!!!!!!!*******
-		.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
-		.depthBiasEnable = VK_FALSE
+	//Block compressed textures are sampled natively where the device can, the texture streamer transcodes them otherwise
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_physDevice, &supportedFeatures);
+	m_bcTexturesEnabled = supportedFeatures.textureCompressionBC != VK_FALSE;
+	VkPhysicalDeviceFeatures enabledFeatures{
+		.textureCompressionBC = m_bcTexturesEnabled ? VK_TRUE : VK_FALSE
 	};
 
-	VkPipelineMultisampleStateCreateInfo multisampleStateInfo{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-		.sampleShadingEnable = VK_FALSE,
-		.pSampleMask = nullptr
+	VkDeviceCreateInfo deviceInfo{
+		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size()),
+		.pQueueCreateInfos = queueInfos.data(),
+		.enabledExtensionCount = m_config.headless ? 0 : static_cast<uint32_t>(ENABLED_DEVICE_EXTENSIONS.size()),
+		.ppEnabledExtensionNames = m_config.headless ? nullptr : ENABLED_DEVICE_EXTENSIONS.data(),
+		.pEnabledFeatures = &enabledFeatures
 	};
 
-	VkPipelineDepthStencilStateCreateInfo depthStencilStateInfo{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-		.depthTestEnable = VK_TRUE,
-		.depthWriteEnable = VK_TRUE,
-		.depthCompareOp = VK_COMPARE_OP_LESS,
-		.depthBoundsTestEnable = VK_FALSE,
-		.stencilTestEnable = VK_FALSE
-	};
+	if (vkCreateDevice(m_physDevice, &deviceInfo, P_DEFAULT_ALLOC, &m_device) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Vulkan Device");
+	}
 
-	VkPipelineColorBlendStateCreateInfo colorBlendStateInfo{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-		.attachmentCount = 0
-	};
+	vkGetDeviceQueue(m_device, m_queueIndices.graphicsIndex, 0, &m_graphicsQueue);
+	if (m_queueIndices.computeIndex != UINT32_MAX) {
+		vkGetDeviceQueue(m_device, m_queueIndices.computeIndex, 0, &m_computeQueue);
+	}
+	if (m_queueIndices.transferIndex != UINT32_MAX) {
+		vkGetDeviceQueue(m_device, m_queueIndices.transferIndex, 0, &m_transferQueue);
+	}
+	m_allocator.init(m_physDevice, m_device, m_framesInFlight);
+	m_uploads.init(m_device, m_allocator, m_queueIndices.transferIndex, m_transferQueue, m_queueIndices.graphicsIndex, m_graphicsQueue);
+}
 
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-		.setLayoutCount = 1,
-		.pSetLayouts = &m_lowFreqDescSetLayout,
-		.pushConstantRangeCount = 0
+void Renderer::createSwapchain() {
+	PROFILE_ZONE(m_profiler, "createSwapchain");
+	VkSurfaceCapabilitiesKHR surfaceCaps;
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_physDevice, m_surface, &surfaceCaps);
+	if ((surfaceCaps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) == 0) {
+		throw std::runtime_error("Failed to create Vulkan Swapchain, the surface does not support blitting to its images");
+	}
+
+	//Surfaces that let the swapchain pick its size report an extent of 0xFFFFFFFF
+	if (surfaceCaps.currentExtent.width != UINT32_MAX) {
+		m_surfaceExtent = surfaceCaps.currentExtent;
+	}
+	else {
+		int width = 0;
+		int height = 0;
+		glfwGetFramebufferSize(m_pWindow, &width, &height);
+		m_surfaceExtent = VkExtent2D{
+			.width = std::clamp(static_cast<uint32_t>(width), surfaceCaps.minImageExtent.width, surfaceCaps.maxImageExtent.width),
+			.height = std::clamp(static_cast<uint32_t>(height), surfaceCaps.minImageExtent.height, surfaceCaps.maxImageExtent.height)
+		};
+	}
+
+	VkSurfaceFormatKHR surfaceFormat{ chooseSurfaceFormat() };
+	m_presentMode = choosePresentMode();
+
+	//Mailbox needs an image to render into while one is queued and one is on screen
+	uint32_t imageCount = std::max(surfaceCaps.minImageCount, m_presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 3u : 2u);
+	if (surfaceCaps.maxImageCount > 0) {
+		imageCount = std::min(imageCount, surfaceCaps.maxImageCount);
+	}
+
+	//Handing over the old swapchain lets the presentation engine keep showing its images until the new one takes over
+	VkSwapchainKHR oldSwapchain = m_swapchain;
+	VkSwapchainCreateInfoKHR swapchainInfo{
+		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+		.surface = m_surface,
+		.minImageCount = imageCount,
+		.imageFormat = surfaceFormat.format,
+		.imageColorSpace = surfaceFormat.colorSpace,
+		.imageExtent = m_surfaceExtent,
+		.imageArrayLayers = 1,
+		.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+		.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.preTransform = surfaceCaps.currentTransform,
+		.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+		.presentMode = m_presentMode,
+		.clipped = VK_TRUE,
+		.oldSwapchain = oldSwapchain
 	};
 
+	if (vkCreateSwapchainKHR(m_device, &swapchainInfo, P_DEFAULT_ALLOC, &m_swapchain) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create Vulkan Swapchain");
+	}
+	if (oldSwapchain != VK_NULL_HANDLE) {
+		vkDestroySwapchainKHR(m_device, oldSwapchain, P_DEFAULT_ALLOC);
+	}
+	m_swapchainFormat = surfaceFormat.format;
+	glfwGetFramebufferSize(m_pWindow, &m_windowWidth, &m_windowHeight);
 
-	vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, P_DEFAULT_ALLOC, &m_pipelineLayout);
+	vkGetSwapchainImagesKHR(m_device, m_swapchain, &imageCount, nullptr);
+	m_swapchainImages = std::vector<VkImage>(imageCount);
+	vkGetSwapchainImagesKHR(m_device, m_swapchain, &imageCount, m_swapchainImages.data());
+}
 
-	VkGraphicsPipelineCreateInfo pipelineCreateInfo{
-		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-		.stageCount = static_cast<uint32_t>(shaderStageInfos.size()),
-		.pStages = shaderStageInfos.data(),
-		.pVertexInputState = &vertexInputStateInfo,
-		.pInputAssemblyState = &inputAssemblyStateInfo,
-		.pTessellationState = &tessellationStateInfo,
-		.pViewportState = &viewportStateInfo,
-		.pRasterizationState = &rasterizationStateInfo,
-		.pMultisampleState = &multisampleStateInfo,
-		.pDepthStencilState = &depthStencilStateInfo,
-		.pColorBlendState = &colorBlendStateInfo,
-		.pDynamicState = nullptr,
-		.layout = m_pipelineLayout,
-		.renderPass = m_renderPass,
-		.subpass = 0
+//Prefers an 8 bit sRGB format the rendered image can be blitted to, then any blittable format
+VkSurfaceFormatKHR Renderer::chooseSurfaceFormat() const {
+	uint32_t formatCount = 0;
+	vkGetPhysicalDeviceSurfaceFormatsKHR(m_physDevice, m_surface, &formatCount, nullptr);
+	std::vector<VkSurfaceFormatKHR> formats(formatCount);
+	vkGetPhysicalDeviceSurfaceFormatsKHR(m_physDevice, m_surface, &formatCount, formats.data());
+
+	if (formats.size() == 1 && formats.at(0).format == VK_FORMAT_UNDEFINED) {
+		return VkSurfaceFormatKHR{ .format = VK_FORMAT_B8G8R8A8_SRGB, .colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+	}
+
+	auto blittable = [this](VkFormat format) {
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(m_physDevice, format, &props);
+		return (props.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT) != 0;
 	};
 
-	vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, P_DEFAULT_ALLOC, &m_pipeline);
+	for (VkFormat preferred : { VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB }) {
+		for (const VkSurfaceFormatKHR& format : formats) {
+			if (format.format == preferred && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR && blittable(format.format)) {
+				return format;
+			}
+		}
+	}
+	for (const VkSurfaceFormatKHR& format : formats) {
+		if (blittable(format.format)) {
+			return format;
+		}
+	}
+	throw std::runtime_error("Failed to find a Surface Format that can be blitted to");
 }
 
-void Renderer::init() {
+//FIFO is the only mode every surface supports and never renders frames that are not shown, so it saves power.
+//Low latency prefers mailbox, which replaces the queued image without tearing, then immediate, which may tear.
+VkPresentModeKHR Renderer::choosePresentMode() const {
+	if (m_config.presentPolicy == PresentPolicy::PowerSaving) {
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
 
-	if (glfwInit() != GL_TRUE) {
-		throw std::runtime_error("Failed to Initialize GLFW");
+	uint32_t modeCount = 0;
+	vkGetPhysicalDeviceSurfacePresentModesKHR(m_physDevice, m_surface, &modeCount, nullptr);
+	std::vector<VkPresentModeKHR> modes(modeCount);
+	vkGetPhysicalDeviceSurfacePresentModesKHR(m_physDevice, m_surface, &modeCount, modes.data());
+
+	for (VkPresentModeKHR preferred : { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR }) {
+		if (std::find(modes.begin(), modes.end(), preferred) != modes.end()) {
+			return preferred;
+		}
 	}
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
 
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	m_pWindow = glfwCreateWindow(WIDTH, HEIGHT, "Test", nullptr, nullptr);
-	glfwSetWindowCloseCallback(m_pWindow, windowCloseCallback);
+//Called when presentation reports the swapchain out of date or the window size changed. Only the swapchain and the
+//extent sized render targets are rebuilt, pipelines use dynamic viewport and scissor and stay valid.
+void Renderer::recreateSwapchain() {
+	PROFILE_ZONE(m_profiler, "recreateSwapchain");
+	//A minimized window has a zero sized framebuffer and nothing can be presented until it is restored
+	int width = 0;
+	int height = 0;
+	glfwGetFramebufferSize(m_pWindow, &width, &height);
+	while ((width == 0 || height == 0) && !glfwWindowShouldClose(m_pWindow)) {
+		glfwWaitEvents();
+		glfwGetFramebufferSize(m_pWindow, &width, &height);
+	}
+	if (width == 0 || height == 0) {
+		return;
+	}
+
+	//The old images and the render targets may still be read by frames in flight
+	vkDeviceWaitIdle(m_device);
+	retireCompletedFrames();
 
-	uint32_t glfwReqInstanceExtensionCount;
-	const char** glfwReqExtensions{ glfwGetRequiredInstanceExtensions(&glfwReqInstanceExtensionCount) };
+	VkExtent2D previousExtent = m_surfaceExtent;
+	createSwapchain();
+	if (m_surfaceExtent.width != previousExtent.width || m_surfaceExtent.height != previousExtent.height) {
+		m_renderGraph.resize(m_surfaceExtent);
+	}
+	m_frameStats.swapchainRecreations++;
+}
+
+//Compared against the framebuffer size the swapchain was created for, not the swapchain extent, which the surface may
+//clamp or scale
+bool Renderer::windowResized() const {
+	int width = 0;
+	int height = 0;
+	glfwGetFramebufferSize(m_pWindow, &width, &height);
+	return width != m_windowWidth || height != m_windowHeight;
+}
+
+//Polls the fences of presented frames so each is retired soon after the GPU finished it, not only when its slot is reused
+void Renderer::retireCompletedFrames() {
+	for (uint32_t i = 0; i < m_framesInFlight; i++) {
+		if (m_pacer.isPending(i) && vkGetFenceStatus(m_device, m_frames.at(i).inFlightFence) == VK_SUCCESS) {
+			m_pacer.retired(i);
+		}
+	}
+}
+
+//The scene color is scaled and converted into the acquired swapchain image. The render graph moved both images into
+//their transfer layouts and moves the swapchain image on to the present layout.
+void Renderer::recordPresentBlit(VkCommandBuffer cmdBuffer) {
+	VkImageSubresourceLayers colorLayers{
+		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.mipLevel = 0,
+		.baseArrayLayer = 0,
+		.layerCount = 1
+	};
+	VkOffset3D extent{ .x = static_cast<int32_t>(m_surfaceExtent.width), .y = static_cast<int32_t>(m_surfaceExtent.height), .z = 1 };
+	VkImageBlit blit{
+		.srcSubresource = colorLayers,
+		.srcOffsets = { VkOffset3D{ .x = 0, .y = 0, .z = 0 }, extent },
+		.dstSubresource = colorLayers,
+		.dstOffsets = { VkOffset3D{ .x = 0, .y = 0, .z = 0 }, extent }
+	};
+	vkCmdBlitImage(cmdBuffer, m_renderGraph.getImage(m_sceneColor), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_renderGraph.getImage(m_swapchainTarget),
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_NEAREST);
+}
+
+void Renderer::init() {
+	PROFILE_ZONE(m_profiler, "init");
+	std::chrono::steady_clock::time_point initStart = std::chrono::steady_clock::now();
+	uint32_t glfwReqInstanceExtensionCount = 0;
+	const char** glfwReqExtensions = nullptr;
+
+	if (!m_config.headless) {
+		if (glfwInit() != GL_TRUE) {
+			throw std::runtime_error("Failed to Initialize GLFW");
+		}
+
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		m_pWindow = glfwCreateWindow(static_cast<int>(m_config.width), static_cast<int>(m_config.height), "Test", nullptr, nullptr);
+		glfwSetWindowCloseCallback(m_pWindow, windowCloseCallback);
+
+		glfwReqExtensions = glfwGetRequiredInstanceExtensions(&glfwReqInstanceExtensionCount);
+	}
 
 	VkApplicationInfo appInfo{
 		.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
@@ -407,171 +810,728 @@ void Renderer::init() {
 		throw std::runtime_error("Failed to create Vulkan Instance");
 	}
 
-	if (glfwCreateWindowSurface(m_instance, m_pWindow, P_DEFAULT_ALLOC, &m_surface) != VK_SUCCESS) {
+	if (!m_config.headless && glfwCreateWindowSurface(m_instance, m_pWindow, P_DEFAULT_ALLOC, &m_surface) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create Vulkan Surface");
 	}
 	
 	chooseMostSuitablePhysicalDevice();
 	setQueueIndices();
+	createDevice();
+	m_profiler.init(m_physDevice, m_device, m_queueIndices.graphicsIndex, m_framesInFlight);
+	m_pipelineCache.init(m_physDevice, m_device);
+	m_startupStats.warmPipelineCache = m_pipelineCache.isWarm();
+	m_pipelines.init(m_device, m_pipelineCache.get());
+	createFrameResources();
+	m_pacer.init(m_framesInFlight, m_config.targetFrameRate, m_config.collectFrameTimes);
+
+	if (m_config.headless) {
+		m_surfaceExtent = VkExtent2D{ .width = m_config.width, .height = m_config.height };
+	}
+	else {
+		createSwapchain();
+	}
 
-	float priority = 1.0f;
+	createRenderGraph();
+	preparePipelineData();
+	m_textures.init(m_physDevice, m_device, m_allocator, m_uploads, m_descriptors, m_framesInFlight, m_bcTexturesEnabled, m_config.textures);
+	createMeshBuffers();
+	createScene();
+	createProjectionPipeline();
 
-	VkDeviceQueueCreateInfo graphicsQueueInfo{
-		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-		.queueFamilyIndex = m_queueIndices.graphicsIndex,
-		.queueCount = 1,
-		.pQueuePriorities = &priority
-	};
-	VkDeviceQueueCreateInfo computeQueueInfo{
-		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-		.queueFamilyIndex = m_queueIndices.computeIndex,
-		.queueCount = 1,
-		.pQueuePriorities = &priority
-	};
-	VkDeviceQueueCreateInfo transferQueueInfo{
-		.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-		.queueFamilyIndex = m_queueIndices.transferIndex,
-		.queueCount = 1,
-		.pQueuePriorities = &priority
-	};
-	
-	std::vector<VkDeviceQueueCreateInfo> queueInfos{ graphicsQueueInfo, computeQueueInfo, transferQueueInfo };
+	m_startupStats.initMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - initStart).count();
+	std::clog << "Startup: " << m_startupStats.initMs << " ms | Pipeline creation: " << m_startupStats.pipelineCreationMs
+		<< " ms (" << (m_startupStats.warmPipelineCache ? "warm" : "cold") << " pipeline cache) | Shaders: "
+		<< m_startupStats.shaderBuild.compiled << " compiled, " << m_startupStats.shaderBuild.upToDate << " cached in "
+		<< m_startupStats.shaderBuild.ms << " ms\n";
+}
 
-	VkDeviceCreateInfo deviceInfo{
-		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-		.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size()),
-		.pQueueCreateInfos = queueInfos.data(),
-		.enabledExtensionCount = static_cast<uint32_t>(ENABLED_DEVICE_EXTENSIONS.size()),
-		.ppEnabledExtensionNames = ENABLED_DEVICE_EXTENSIONS.data()
-	};
+void Renderer::loop() {
+	if (m_config.headless) {
+		throw std::runtime_error("loop() requires a window, use renderFrames() in headless mode");
+	}
 
-	if (vkCreateDevice(m_physDevice, &deviceInfo, P_DEFAULT_ALLOC, &m_device) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create Vulkan Device");
+	//Events are polled inside drawFrame, right before the frame samples its input
+	while (!glfwWindowShouldClose(m_pWindow) && (m_config.frameLimit == 0 || m_frameStats.frameCount < m_config.frameLimit)) {
+		drawFrame();
 	}
+	finishFrames();
+
+	std::cout << "Frames: " << m_frameStats.frameCount
+		<< " | Frames in flight: " << m_framesInFlight
+		<< " | Avg CPU frame: " << m_frameStats.cpuFrameMs / std::max<uint64_t>(m_frameStats.frameCount, 1) << " ms"
+		<< " | Avg fence wait: " << m_frameStats.fenceWaitMs / std::max<uint64_t>(m_frameStats.frameCount, 1) << " ms"
+		<< " | Avg record: " << m_frameStats.recordMs / std::max<uint64_t>(m_frameStats.frameCount, 1) << " ms on " << m_jobs.getWorkerCount() << " workers"
+		<< " | CPU/GPU overlap: " << m_frameStats.overlapRatio() * 100.0 << "%"
+		<< " (" << m_frameStats.overlappedFrames << " frames recorded while GPU busy)\n";
+	const FramePacingStats& pacing = m_pacer.getStats();
+	std::cout << "Present mode: " << presentModeName(m_presentMode)
+		<< " | Avg input to submit: " << pacing.inputToSubmitMs / std::max<uint64_t>(pacing.frames, 1) << " ms"
+		<< " | Avg input to retire: " << pacing.inputToRetireMs / std::max<uint64_t>(pacing.retiredFrames, 1) << " ms"
+		<< " | Paced frames: " << pacing.delayedFrames
+		<< " | Swapchain recreations: " << m_frameStats.swapchainRecreations << "\n";
+	const RenderGraphStats& graphStats = m_renderGraph.getStats();
+	std::cout << "Render graph: " << graphStats.passCount - graphStats.culledPassCount << "/" << graphStats.passCount << " passes"
+		<< " | Barriers per frame: " << graphStats.pipelineBarriers << " calls, " << graphStats.imageBarriers << " image barriers, "
+		<< graphStats.subpassDependencies << " subpass dependencies"
+		<< " | Aliasing saved: " << graphStats.savedBytes() / (1024 * 1024) << " of " << graphStats.imageBytes / (1024 * 1024) << " MB\n";
+#ifdef PROFILER_ENABLED
+	std::cout << "Zones (last " << PROFILER_STATS_WINDOW << " samples):\n";
+	for (const ProfileZoneSummary& zone : m_profiler.getSummary()) {
+		std::cout << "  " << (zone.gpu ? "GPU " : "CPU ") << zone.name << ": avg " << zone.windowAvgMs << " ms, max " << zone.windowMaxMs
+			<< " ms, " << zone.calls << " calls\n";
+	}
+#endif
+	if (m_config.sceneObjectCount > 0) {
+		uint64_t culledFrames = std::max<uint64_t>(m_frameStats.culledFrames, 1);
+		std::cout << "Culling on the " << (m_config.gpuCulling ? "GPU" : "CPU") << ": " << m_config.sceneObjectCount << " objects"
+			<< " | Avg visible: " << m_frameStats.visibleObjects / culledFrames
+			<< " | Avg frustum rejected: " << m_frameStats.frustumRejected / culledFrames
+			<< " | Avg occlusion rejected: " << m_frameStats.occlusionRejected / culledFrames
+			<< " | Avg drawn late: " << m_frameStats.lateDrawnObjects / culledFrames
+			<< " | Avg triangles: " << m_frameStats.submittedTriangles / std::max<uint64_t>(m_frameStats.culledFrames, 1)
+			<< " | Meshlets rejected: " << m_frameStats.meshletsRejected << "/" << m_frameStats.meshletsTested
+			<< " | Meshlet triangles rejected: " << m_frameStats.meshletTrianglesRejected
+			<< " | Avg cull: " << m_frameStats.cullMs / std::max<uint64_t>(m_frameStats.frameCount, 1) << " ms\n";
+	}
+	uint64_t frameCount = std::max<uint64_t>(m_frameStats.frameCount, 1);
+	std::cout << "Scene pass: avg " << m_frameStats.drawCalls / frameCount << " draw calls, " << m_frameStats.stateChanges / frameCount << " state changes"
+		<< " | Avg draw list: " << m_frameStats.drawListMs / frameCount << " ms, " << m_frameStats.drawSortMs / frameCount << " ms sorting\n";
+}
 
-	vkGetDeviceQueue(m_device, m_queueIndices.graphicsIndex, 0, &m_graphicsQueue);
+void Renderer::renderFrames(uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		drawFrame();
+	}
+}
 
-	VkCommandPoolCreateInfo cmdPoolInfo{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-		.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
-		.queueFamilyIndex = m_queueIndices.graphicsIndex
-	};
+void Renderer::finishFrames() {
+	vkDeviceWaitIdle(m_device);
 
-	if (vkCreateCommandPool(m_device, &cmdPoolInfo, P_DEFAULT_ALLOC, &m_cmdPool) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create Command Pool");
+	//Collect the timestamps of the frames that were still in flight, oldest first
+	for (uint32_t i = 0; i < m_framesInFlight; i++) {
+		uint32_t frameIndex = (m_currentFrame + i) % m_framesInFlight;
+		m_pacer.retired(frameIndex);
+		m_profiler.resolveFrame(frameIndex);
+		readFrameTimestamps(m_frames.at(frameIndex));
+		readVisibleCount(m_frames.at(frameIndex), frameIndex);
 	}
+}
 
-	VkCommandBufferAllocateInfo cmdBufferInfo{
-		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-		.commandPool = m_cmdPool,
-		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY
-	};
-	
-	if (vkAllocateCommandBuffers(m_device, &cmdBufferInfo, &m_cmdBuffer) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to allocate command buffer");
+void Renderer::readFrameTimestamps(FrameData& frame) {
+	if (!frame.timestampsPending) {
+		return;
 	}
+	frame.timestampsPending = false;
 
-	VkSurfaceCapabilitiesKHR surfaceCaps;
-	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_physDevice, m_surface, &surfaceCaps);
-	m_surfaceExtent = surfaceCaps.currentExtent;
+	if (m_config.collectFrameTimes) {
+		m_frameTimeSamples.cpuMs.push_back(frame.cpuFrameMs);
+	}
 
-	VkSwapchainCreateInfoKHR swapchainInfo{
-		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
-		.surface = m_surface,
-		.minImageCount = 2,
-		.imageFormat = VK_FORMAT_R8G8B8A8_SRGB,
-		.imageColorSpace = VK_COLORSPACE_SRGB_NONLINEAR_KHR,
-		.imageExtent = m_surfaceExtent,
-		.imageArrayLayers = 1,
-		.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
-		.preTransform = surfaceCaps.currentTransform,
-		.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
-		.presentMode = VK_PRESENT_MODE_FIFO_KHR,
-		.clipped = VK_TRUE
-	};
+	if (frame.timestampPool == VK_NULL_HANDLE) {
+		return;
+	}
 
-	if (vkCreateSwapchainKHR(m_device, &swapchainInfo, P_DEFAULT_ALLOC, &m_swapchain) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create Vulkan Swapchain");
+	uint64_t timestamps[TIMESTAMPS_PER_FRAME];
+	if (vkGetQueryPoolResults(m_device, frame.timestampPool, 0, TIMESTAMPS_PER_FRAME, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+		return;
 	}
 
-	uint32_t imageCount;
-	vkGetSwapchainImagesKHR(m_device, m_swapchain, &imageCount, nullptr);
-	m_swapchainImages = std::vector<VkImage>(imageCount);
-	vkGetSwapchainImagesKHR(m_device, m_swapchain, &imageCount, m_swapchainImages.data());
+	double gpuMs = static_cast<double>(timestamps[1] - timestamps[0]) * m_timestampPeriod * 1e-6;
+	m_frameStats.gpuFrameMs += gpuMs;
+	if (m_config.collectFrameTimes) {
+		m_frameTimeSamples.gpuMs.push_back(gpuMs);
+	}
+}
 
-	
-	createRenderPass();
-	preparePipelineData();
-	createProjectionPipeline();
+void Renderer::readVisibleCount(FrameData& frame, uint32_t frameIndex) {
+	if (!frame.visibleCountPending) {
+		return;
+	}
+	frame.visibleCountPending = false;
+	m_frameStats.visibleObjects += m_gpuScene.readVisibleCount(frameIndex);
+	m_frameStats.submittedTriangles += m_gpuScene.readTriangleCount(frameIndex);
+	GpuCullStats cullStats = m_gpuScene.readCullStats(frameIndex);
+	m_frameStats.frustumRejected += cullStats.frustumRejected;
+	m_frameStats.occlusionRejected += cullStats.occlusionRejected;
+	m_frameStats.lateDrawnObjects += cullStats.lateDrawn;
+	m_frameStats.culledFrames++;
+}
 
+void Renderer::drawFrame() {
+	PROFILE_ZONE(m_profiler, "drawFrame");
+	using Clock = std::chrono::steady_clock;
+	Clock::time_point frameStart = Clock::now();
+
+	FrameData& frame = m_frames.at(m_currentFrame);
+	vkWaitForFences(m_device, 1, &frame.inFlightFence, VK_TRUE, UINT64_MAX);
+	Clock::time_point fenceSignaled = Clock::now();
+	PROFILE_RECORD_ZONE(m_profiler, "waitForFence", frameStart, fenceSignaled);
+
+	//The slot's previous frame has retired, so its queries and per-frame memory can be reused
+	m_pacer.retired(m_currentFrame);
+	retireCompletedFrames();
+	readFrameTimestamps(frame);
+	readVisibleCount(frame, m_currentFrame);
+	m_allocator.beginFrame(m_currentFrame);
+	m_uniforms.beginFrame(m_currentFrame);
+	m_indexRing.beginFrame(m_currentFrame);
+	m_descriptors.beginFrame(m_currentFrame);
+	m_textures.beginFrame(m_currentFrame);
+
+	//An out of date swapchain did not signal the semaphore, the frame is skipped before its fence is reset
+	uint32_t renderImageIndex = 0;
+	if (!m_config.headless) {
+		VkResult acquireResult = vkAcquireNextImageKHR(m_device, m_swapchain, UINT64_MAX, frame.imageAvailableSem, VK_NULL_HANDLE, &renderImageIndex);
+		if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
+			recreateSwapchain();
+			return;
+		}
+		if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR) {
+			throw std::runtime_error("Failed to acquire swapchain image");
+		}
+	}
+	vkResetFences(m_device, 1, &frame.inFlightFence);
 
-}
+	const FrameData& prevFrame = m_frames.at((m_currentFrame + m_framesInFlight - 1) % m_framesInFlight);
+	if (m_framesInFlight > 1 && vkGetFenceStatus(m_device, prevFrame.inFlightFence) == VK_NOT_READY) {
+		m_frameStats.overlappedFrames++;
+	}
+
+	vkResetCommandPool(m_device, frame.cmdPool, 0);
+	for (WorkerCommands& commands : frame.workerCommands) {
+		vkResetCommandPool(m_device, commands.cmdPool, 0);
+		commands.usedCount = 0;
+	}
 
-void Renderer::loop() {
-	uint32_t renderImageIndex;
-	vkAcquireNextImageKHR(m_device, m_swapchain, UINT64_MAX, m_imageAvailableSem, VK_NULL_HANDLE, &renderImageIndex);
 	VkCommandBufferBeginInfo beginInfo{
 		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
 		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
 	};
-	vkBeginCommandBuffer(m_cmdBuffer, &beginInfo);
-
-	VkRenderPassBeginInfo passBeginInfo{
-		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-		.renderPass = m_renderPass,
-		.framebuffer = m_framebuffer,
-		.renderArea = VkRect2D{
-			.offset = VkOffset2D{.x = 0,.y=0},
-			.extent = m_surfaceExtent
-		},
-		.clearValueCount = 0
-	};
+	vkBeginCommandBuffer(frame.cmdBuffer, &beginInfo);
+
+	if (frame.timestampPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(frame.cmdBuffer, frame.timestampPool, 0, TIMESTAMPS_PER_FRAME);
+		vkCmdWriteTimestamp(frame.cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestampPool, 0);
+	}
+	m_profiler.beginFrame(m_currentFrame, frame.cmdBuffer);
+
+	//Uploads queued since the last frame, texture upgrades included, go out now, finished ones are handed over to the graphics queue
+	{
+		PROFILE_GPU_ZONE(m_profiler, frame.cmdBuffer, "uploads");
+		m_textures.update();
+		m_uploads.flush();
+		m_uploads.recordAcquireBarriers(frame.cmdBuffer);
+	}
+
+	//Input is sampled as late as possible, after waiting for the GPU, the swapchain and the pacer, so the frame
+	//renders the newest input instead of input that aged while this thread was blocked
+	m_pacer.waitForFrameStart();
+	if (!m_config.headless) {
+		glfwPollEvents();
+	}
+	m_pacer.inputSampled(m_currentFrame);
+
+	//Scene frames either cull on the CPU and record the visible objects, sorted and merged into instanced draws unless
+	//instancing is off, or submit the cull to the compute queue and record a single indirect draw the GPU fills in. The occlusion cull is recorded by the render graph
+	//around the frame's draws instead.
+	CameraProjectionData cameraData{ m_camera.fetchGPUData(static_cast<float>(m_surfaceExtent.width), static_cast<float>(m_surfaceExtent.height)) };
+	m_cameraDataOffset = m_uniforms.push(cameraData).offset;
+
+	uint32_t drawCount = m_config.syntheticDrawCount;
+	VkSemaphore cullCompleteSem = VK_NULL_HANDLE;
+	if (m_config.sceneObjectCount > 0) {
+		Frustum frustum{ Culling::extractFrustum(cameraData) };
+		m_viewFrustum = frustum;
+		m_viewEye = m_camera.m_pos;
+		m_lodProjectionScale = m_config.lodThresholdPixels > 0.0f
+			? MeshLod::projectionScale(m_camera.m_FOV, static_cast<float>(m_surfaceExtent.height), m_config.lodThresholdPixels) : 0.0f;
+
+		Clock::time_point cullStart = Clock::now();
+		if (m_config.gpuCulling && m_gpuScene.isTwoPhase()) {
+			const glm::mat4& projection = cameraData.projectionMatrix;
+			OcclusionCullData occlusionData{
+				.viewMatrix = cameraData.viewMatrix,
+				.projection = glm::vec4(projection[0][0], projection[1][1], projection[2][2], projection[3][2]),
+				.nearPlane = m_camera.m_near
+			};
+			UniformAllocation occlusionAllocation = m_uniforms.push(occlusionData);
+			m_occlusionInputs.cameraData = VkDescriptorBufferInfo{ m_uniforms.getBuffer(), occlusionAllocation.offset, sizeof(OcclusionCullData) };
+			frame.visibleCountPending = true;
+			drawCount = 0;
+		}
+		else if (m_config.gpuCulling) {
+			cullCompleteSem = m_gpuScene.cull(m_currentFrame, frustum, glm::vec4(m_viewEye, m_lodProjectionScale));
+			frame.visibleCountPending = true;
+			drawCount = 0;
+		}
+		else {
+			m_visibleObjects = m_culler.cull(frustum, m_scene.getBounds(), CullShape::Sphere);
+			drawCount = static_cast<uint32_t>(m_visibleObjects.size());
+			m_frameStats.visibleObjects += drawCount;
+			m_frameStats.frustumRejected += m_scene.getObjectCount() - drawCount;
+			m_frameStats.culledFrames++;
+		}
+		Clock::time_point cullEnd = Clock::now();
+		m_frameStats.cullMs += std::chrono::duration<double, std::milli>(cullEnd - cullStart).count();
+		PROFILE_RECORD_ZONE(m_profiler, m_config.gpuCulling ? "submitGpuCull" : "cull", cullStart, cullEnd);
+
+		if (usesDrawList()) {
+			buildDrawList();
+			drawCount = static_cast<uint32_t>(m_drawList.getDraws().size());
+			m_frameStats.drawListMs += std::chrono::duration<double, std::milli>(Clock::now() - cullEnd).count();
+			m_frameStats.drawSortMs += m_drawList.getStats().sortMs;
+		}
+	}
 
-	vkCmdBeginRenderPass(m_cmdBuffer, &passBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(m_cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
-	vkCmdEndRenderPass(m_cmdBuffer);
-	vkEndCommandBuffer(m_cmdBuffer);
+	//The render graph records the scene pass and, in windowed mode, the blit into the acquired image with the barriers
+	//between them
+	uint32_t recordJobCount = (drawCount + DRAWS_PER_RECORD_JOB - 1) / DRAWS_PER_RECORD_JOB;
+	m_frameDrawCount = drawCount;
+	m_frameIndirect = m_config.sceneObjectCount > 0 && m_config.gpuCulling;
+	m_frameParallel = !m_frameIndirect && recordJobCount > 1 && m_jobs.getWorkerCount() > 1;
+	m_renderGraph.setSubpassContents(m_scenePass, m_frameParallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+	if (!m_config.headless) {
+		m_renderGraph.setImportedImage(m_swapchainTarget, m_swapchainImages.at(renderImageIndex));
+	}
+	Clock::time_point recordStart = Clock::now();
+	m_renderGraph.execute(frame.cmdBuffer, m_profiler);
+	if (!m_frameIndirect && m_config.sceneObjectCount > 0) {
+		m_frameStats.submittedTriangles += m_recordedTriangles.exchange(0, std::memory_order_relaxed);
+		m_frameStats.meshletsTested += m_recordedMeshletsTested.exchange(0, std::memory_order_relaxed);
+		m_frameStats.meshletsRejected += m_recordedMeshletsRejected.exchange(0, std::memory_order_relaxed);
+		m_frameStats.meshletTrianglesRejected += m_recordedTrianglesRejected.exchange(0, std::memory_order_relaxed);
+	}
+	m_frameStats.drawCalls += m_recordedDrawCalls.exchange(0, std::memory_order_relaxed);
+	m_frameStats.stateChanges += m_recordedStateChanges.exchange(0, std::memory_order_relaxed);
+	Clock::time_point recordEnd = Clock::now();
+	m_frameStats.recordMs += std::chrono::duration<double, std::milli>(recordEnd - recordStart).count();
+	PROFILE_RECORD_ZONE(m_profiler, "record", recordStart, recordEnd);
+
+	if (frame.timestampPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(frame.cmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestampPool, 1);
+	}
+	vkEndCommandBuffer(frame.cmdBuffer);
+
+	//Headless frames have no swapchain image to wait on or present, only the fence is signaled
+	std::vector<VkSemaphore> waitSems;
+	std::vector<VkPipelineStageFlags> waitStages;
+	if (!m_config.headless) {
+		waitSems.push_back(frame.imageAvailableSem);
+		waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	}
+	if (cullCompleteSem != VK_NULL_HANDLE) {
+		waitSems.push_back(cullCompleteSem);
+		waitStages.push_back(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+	}
 
 	VkSubmitInfo renderSubmitInfo{
 		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &m_imageAvailableSem,
+		.waitSemaphoreCount = static_cast<uint32_t>(waitSems.size()),
+		.pWaitSemaphores = waitSems.data(),
+		.pWaitDstStageMask = waitStages.data(),
 		.commandBufferCount = 1,
-		.pCommandBuffers = &m_cmdBuffer,
-		.signalSemaphoreCount = 1,
-		.pSignalSemaphores = &m_renderCompleteSem
+		.pCommandBuffers = &frame.cmdBuffer,
+		.signalSemaphoreCount = m_config.headless ? 0u : 1u,
+		.pSignalSemaphores = &frame.renderCompleteSem
+	};
+
+	if (vkQueueSubmit(m_graphicsQueue, 1, &renderSubmitInfo, frame.inFlightFence) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit draw command buffer");
+	}
+	m_profiler.frameSubmitted(m_currentFrame);
+
+	if (!m_config.headless) {
+		VkPresentInfoKHR presentInfo{
+			.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+			.waitSemaphoreCount = 1,
+			.pWaitSemaphores = &frame.renderCompleteSem,
+			.swapchainCount = 1,
+			.pSwapchains = &m_swapchain,
+			.pImageIndices = &renderImageIndex
+		};
+
+		VkResult presentResult = vkQueuePresentKHR(m_graphicsQueue, &presentInfo);
+		m_pacer.presented(m_currentFrame);
+		if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR || windowResized()) {
+			recreateSwapchain();
+		}
+		else if (presentResult != VK_SUCCESS) {
+			throw std::runtime_error("Failed to present swapchain image");
+		}
+	}
+	else {
+		m_pacer.presented(m_currentFrame);
+	}
+	m_currentFrame = (m_currentFrame + 1) % m_framesInFlight;
+	m_pipelineCache.saveIfDue(PIPELINE_CACHE_SAVE_INTERVAL);
+
+	Clock::time_point frameEnd = Clock::now();
+	frame.cpuFrameMs = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+	frame.timestampsPending = true;
+
+	m_frameStats.frameCount++;
+	m_frameStats.fenceWaitMs += std::chrono::duration<double, std::milli>(fenceSignaled - frameStart).count();
+	m_frameStats.cpuFrameMs += frame.cpuFrameMs;
+}
+
+//Recorded inside the scene render pass. Draws are either one indirect draw the GPU cull fills in, recorded inline, or
+//split into jobs that record secondary buffers on the workers while this thread helps out. Nothing between the
+//submission and the wait may throw, the jobs reference this stack frame.
+void Renderer::recordScenePass(VkCommandBuffer cmdBuffer) {
+	FrameData& frame = m_frames.at(m_currentFrame);
+	uint32_t drawCount = m_frameDrawCount;
+	if (m_frameIndirect) {
+		recordIndirectDraws(cmdBuffer, m_currentFrame, 0);
+	}
+	else if (m_frameParallel) {
+		uint32_t recordJobCount = (drawCount + DRAWS_PER_RECORD_JOB - 1) / DRAWS_PER_RECORD_JOB;
+		frame.secondaryCmdBuffers.assign(recordJobCount, VK_NULL_HANDLE);
+		JobCounter recordDone;
+		m_jobs.parallelFor(recordJobCount, 1, [this, &frame, drawCount](uint32_t jobIndex, uint32_t, uint32_t workerIndex) {
+			uint32_t firstDraw = jobIndex * DRAWS_PER_RECORD_JOB;
+			recordSecondaryDraws(frame, jobIndex, workerIndex, firstDraw, std::min(DRAWS_PER_RECORD_JOB, drawCount - firstDraw));
+		}, recordDone);
+		m_jobs.wait(recordDone);
+		if (std::find(frame.secondaryCmdBuffers.begin(), frame.secondaryCmdBuffers.end(), VK_NULL_HANDLE) != frame.secondaryCmdBuffers.end()) {
+			throw std::runtime_error("Failed to record secondary command buffers");
+		}
+		vkCmdExecuteCommands(cmdBuffer, static_cast<uint32_t>(frame.secondaryCmdBuffers.size()), frame.secondaryCmdBuffers.data());
+		m_frameStats.parallelRecordedFrames++;
+	}
+	else {
+		recordDraws(cmdBuffer, 0, drawCount);
+	}
+}
+
+//Draws [firstDraw, firstDraw + drawCount) of the frame, the synthetic triangles, the merged draws of the draw list or,
+//without instancing, one draw per visible object in the order the cull returned them
+void Renderer::recordDraws(VkCommandBuffer cmdBuffer, uint32_t firstDraw, uint32_t drawCount) {
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+	setViewportAndScissor(cmdBuffer);
+
+	VkDeviceSize vertexBufferOffset = 0;
+	MeshPushConstants meshConstants{
+		.positionScale = glm::vec4(m_mesh.getPositionDecode().scale, 0.0f),
+		.positionOffset = glm::vec4(m_mesh.getPositionDecode().offset, 0.0f),
+		.instanceBase = m_instanceBase
+	};
+	bindFrameDescriptorSets(cmdBuffer, m_currentFrame);
+	vkCmdBindVertexBuffers(cmdBuffer, BINDING_VERTEX_BUFFER, 1, &m_meshVertexBuf, &vertexBufferOffset);
+	vkCmdBindIndexBuffer(cmdBuffer, m_meshIndexBuf, 0, m_mesh.getIndexType());
+	vkCmdPushConstants(cmdBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(MeshPushConstants), &meshConstants);
+	SceneRecordCounters counters{ .drawCalls = drawCount, .stateChanges = 5 };
+
+	if (m_config.sceneObjectCount == 0) {
+		for (uint32_t i = firstDraw; i < firstDraw + drawCount; i++) {
+			vkCmdDrawIndexed(cmdBuffer, m_mesh.getIndexCount(), 1, 0, 0, 0);
+		}
+		addRecordCounters(counters);
+		return;
+	}
+
+	//Sorted draws of one pipeline and descriptor set only switch index buffers where the mesh levels end and the
+	//compacted draws, which sort last, begin. Their objects are found through the instance list.
+	if (usesDrawList()) {
+		std::span<const InstancedDraw> draws = m_drawList.getDraws();
+		VkBuffer boundIndexBuffer = m_meshIndexBuf;
+		for (uint32_t i = firstDraw; i < firstDraw + drawCount; i++) {
+			const InstancedDraw& draw = draws[i];
+			VkBuffer indexBuffer = DrawKeys::mesh(draw.key) == DRAW_MESH_INDEX_RING ? m_indexRing.getBuffer() : m_meshIndexBuf;
+			if (indexBuffer != boundIndexBuffer) {
+				vkCmdBindIndexBuffer(cmdBuffer, indexBuffer, 0, m_mesh.getIndexType());
+				boundIndexBuffer = indexBuffer;
+				counters.stateChanges++;
+			}
+			vkCmdDrawIndexed(cmdBuffer, draw.indexCount, draw.instanceCount, draw.firstIndex, 0, draw.firstInstance);
+		}
+		addRecordCounters(counters);
+		return;
+	}
+
+	//Scene draws pick their object's transform through the instance index. Objects only partly covered by their
+	//surviving meshlets draw those meshlets' triangles from the index ring, once the static draws are done so the
+	//index buffer is rebound only once per job.
+	std::vector<uint32_t> visibleMeshlets(m_indexRing.getBuffer() != VK_NULL_HANDLE ? m_meshlets.meshlets.size() : 0);
+	std::vector<VkDrawIndexedIndirectCommand> compactedDraws;
+	counters.drawCalls = 0;
+	for (uint32_t i = firstDraw; i < firstDraw + drawCount; i++) {
+		uint32_t object = m_visibleObjects[i];
+		ObjectDraw draw = prepareObjectDraw(object, visibleMeshlets, counters);
+		if (draw.indexCount == 0) {
+			continue;
+		}
+		if (draw.compacted) {
+			compactedDraws.push_back(VkDrawIndexedIndirectCommand{ .indexCount = draw.indexCount, .instanceCount = 1,
+				.firstIndex = draw.firstIndex, .vertexOffset = 0, .firstInstance = object });
+			continue;
+		}
+		vkCmdDrawIndexed(cmdBuffer, draw.indexCount, 1, draw.firstIndex, 0, object);
+		counters.drawCalls++;
+	}
+
+	if (!compactedDraws.empty()) {
+		vkCmdBindIndexBuffer(cmdBuffer, m_indexRing.getBuffer(), 0, m_mesh.getIndexType());
+		counters.stateChanges++;
+		for (const VkDrawIndexedIndirectCommand& draw : compactedDraws) {
+			vkCmdDrawIndexed(cmdBuffer, draw.indexCount, 1, draw.firstIndex, 0, draw.firstInstance);
+		}
+		counters.drawCalls += compactedDraws.size();
+	}
+	addRecordCounters(counters);
+}
+
+//Picks the object's LOD by projected error. Near objects with enough meshlets at that level cull them, and when only
+//some survive their triangles are compacted into the index ring. Safe to call from several jobs at once.
+ObjectDraw Renderer::prepareObjectDraw(uint32_t object, std::span<uint32_t> visibleMeshlets, SceneRecordCounters& counters) {
+	std::span<const MeshLodLevel> lods = m_mesh.getLods();
+	const ObjectBounds& bounds = m_scene.getBounds()[object];
+	const glm::mat4& transform = m_scene.getTransforms()[object];
+	float distance = std::max(glm::length(bounds.center - m_viewEye) - bounds.radius, 0.0f);
+	uint32_t lod = 0;
+	if (m_lodProjectionScale > 0.0f) {
+		lod = MeshLod::selectLod(lods, MeshLod::transformScale(transform), distance, m_lodProjectionScale);
+	}
+	ObjectDraw draw{ .distance = distance, .lod = lod, .firstIndex = lods[lod].firstIndex, .indexCount = lods[lod].indexCount, .compacted = false };
+
+	//Both faces are rasterized, so back facing clusters are only hidden while the eye is outside the closed mesh
+	bool meshletCulling = !visibleMeshlets.empty();
+	uint32_t firstMeshlet = meshletCulling ? m_meshlets.lodFirstMeshlet[lod] : 0;
+	uint32_t meshletCount = meshletCulling ? m_meshlets.lodFirstMeshlet[lod + 1] - firstMeshlet : 0;
+	if (meshletCount >= MESHLET_CULL_MIN_MESHLETS && distance > 0.0f) {
+		MeshletCullView view{ Meshlets::makeView(m_viewFrustum, m_viewEye, transform) };
+		uint32_t survivorCount = Meshlets::cull(CullPath::Auto, view, m_meshlets.bounds, firstMeshlet, meshletCount, visibleMeshlets.data());
+		counters.meshletsTested += meshletCount;
+		uint32_t indexCount = 0;
+		for (uint32_t s = 0; s < survivorCount; s++) {
+			indexCount += m_meshlets.meshlets[visibleMeshlets[s]].triangleCount * 3;
+		}
+
+		IndexAllocation allocation{};
+		if (survivorCount > 0 && survivorCount < meshletCount) {
+			allocation = m_indexRing.allocate(indexCount, m_mesh.getIndexType());
+		}
+		//An exhausted ring falls back to the whole level, the draw is still correct
+		if (survivorCount == 0 || allocation.pData != nullptr) {
+			counters.meshletsRejected += meshletCount - survivorCount;
+			counters.trianglesRejected += lods[lod].indexCount / 3 - indexCount / 3;
+			counters.triangles += indexCount / 3;
+			//Meshlets of a level are back to back in the index buffer, so runs of survivors are copied at once
+			size_t indexSize = m_mesh.getIndexType() == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+			std::byte* pDst = static_cast<std::byte*>(allocation.pData);
+			for (uint32_t s = 0; s < survivorCount;) {
+				const Meshlet& runStart = m_meshlets.meshlets[visibleMeshlets[s]];
+				uint32_t runIndices = 0;
+				uint32_t next = s;
+				do {
+					runIndices += m_meshlets.meshlets[visibleMeshlets[next]].triangleCount * 3;
+					next++;
+				} while (next < survivorCount && visibleMeshlets[next] == visibleMeshlets[next - 1] + 1);
+				std::memcpy(pDst, m_mesh.getIndexData().data() + runStart.firstIndex * indexSize, runIndices * indexSize);
+				pDst += runIndices * indexSize;
+				s = next;
+			}
+			draw.firstIndex = allocation.firstIndex;
+			draw.indexCount = indexCount;
+			draw.compacted = true;
+			return draw;
+		}
+	}
+	counters.triangles += draw.indexCount / 3;
+	return draw;
+}
+
+void Renderer::addRecordCounters(const SceneRecordCounters& counters) {
+	m_recordedTriangles.fetch_add(counters.triangles, std::memory_order_relaxed);
+	m_recordedMeshletsTested.fetch_add(counters.meshletsTested, std::memory_order_relaxed);
+	m_recordedMeshletsRejected.fetch_add(counters.meshletsRejected, std::memory_order_relaxed);
+	m_recordedTrianglesRejected.fetch_add(counters.trianglesRejected, std::memory_order_relaxed);
+	m_recordedDrawCalls.fetch_add(counters.drawCalls, std::memory_order_relaxed);
+	m_recordedStateChanges.fetch_add(counters.stateChanges, std::memory_order_relaxed);
+}
+
+bool Renderer::usesDrawList() const {
+	return m_config.sceneObjectCount > 0 && !m_config.gpuCulling && m_config.instancing;
+}
+
+//Every visible object becomes a keyed draw item, built in parallel since the LOD selection and meshlet culling that
+//decide its indices dominate. The generated scene has a single pipeline, descriptor set and mesh, so the keys only
+//differ in mesh level, compaction and depth. The merged draws' objects go into the uniform ring for the vertex shader.
+void Renderer::buildDrawList() {
+	PROFILE_ZONE(m_profiler, "buildDrawList");
+	uint32_t visibleCount = static_cast<uint32_t>(m_visibleObjects.size());
+	std::span<DrawItem> items = m_drawList.reset(visibleCount);
+	JobCounter built;
+	m_jobs.parallelFor(visibleCount, DRAWS_PER_RECORD_JOB, [this, items](uint32_t begin, uint32_t end, uint32_t) {
+		std::vector<uint32_t> visibleMeshlets(m_indexRing.getBuffer() != VK_NULL_HANDLE ? m_meshlets.meshlets.size() : 0);
+		SceneRecordCounters counters{};
+		for (uint32_t i = begin; i < end; i++) {
+			uint32_t object = m_visibleObjects[i];
+			ObjectDraw draw = prepareObjectDraw(object, visibleMeshlets, counters);
+			uint32_t mesh = draw.compacted ? DRAW_MESH_INDEX_RING : draw.lod;
+			items[i] = DrawItem{
+				.key = DrawKeys::encode(0, 0, mesh, DrawKeys::depthBucket(draw.distance, m_camera.m_far)),
+				.object = object,
+				.firstIndex = draw.firstIndex,
+				.indexCount = draw.indexCount
+			};
+		}
+		addRecordCounters(counters);
+	}, built);
+	m_jobs.wait(built);
+	m_drawList.sortAndMerge();
+
+	std::span<const uint32_t> instances = m_drawList.getInstances();
+	UniformAllocation allocation = m_uniforms.allocate(std::max<VkDeviceSize>(instances.size_bytes(), sizeof(uint32_t)));
+	std::memcpy(allocation.pData, instances.data(), instances.size_bytes());
+	m_instanceBase = allocation.offset / sizeof(uint32_t);
+}
+
+//The generated scene only instances the placeholder mesh, so the cull output is one indirect draw per LOD. Only the
+//instance base changes between them. The late occlusion phase has its own copy of the draws starting at firstDraw.
+void Renderer::recordIndirectDraws(VkCommandBuffer cmdBuffer, uint32_t frameIndex, uint32_t firstDraw) {
+	vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+	setViewportAndScissor(cmdBuffer);
+
+	VkDeviceSize vertexBufferOffset = 0;
+	MeshPushConstants meshConstants{
+		.positionScale = glm::vec4(m_mesh.getPositionDecode().scale, 0.0f),
+		.positionOffset = glm::vec4(m_mesh.getPositionDecode().offset, 0.0f),
+		.instanceBase = m_gpuScene.getInstanceBase(firstDraw)
 	};
+	bindFrameDescriptorSets(cmdBuffer, frameIndex);
+	vkCmdBindVertexBuffers(cmdBuffer, BINDING_VERTEX_BUFFER, 1, &m_meshVertexBuf, &vertexBufferOffset);
+	vkCmdBindIndexBuffer(cmdBuffer, m_meshIndexBuf, 0, m_mesh.getIndexType());
+	vkCmdPushConstants(cmdBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(MeshPushConstants), &meshConstants);
+	SceneRecordCounters counters{ .drawCalls = m_gpuScene.getDrawCount(), .stateChanges = 4 + m_gpuScene.getDrawCount() };
+	for (uint32_t i = firstDraw; i < firstDraw + m_gpuScene.getDrawCount(); i++) {
+		if (i > firstDraw) {
+			meshConstants.instanceBase = m_gpuScene.getInstanceBase(i);
+			vkCmdPushConstants(cmdBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(MeshPushConstants, instanceBase), sizeof(uint32_t),
+				&meshConstants.instanceBase);
+		}
+		vkCmdDrawIndexedIndirect(cmdBuffer, m_gpuScene.getDrawBuffer(frameIndex), i * sizeof(GpuDrawCommand), 1, sizeof(GpuDrawCommand));
+	}
+	addRecordCounters(counters);
+}
 
-	vkQueueSubmit(m_graphicsQueue, 1, &renderSubmitInfo, VK_NULL_HANDLE);
-	VkPresentInfoKHR presentInfo{
-		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &m_renderCompleteSem,
-		.swapchainCount = 1,
-		.pSwapchains = &m_swapchain,
-		.pImageIndices = &renderImageIndex
+//Dynamic state is not inherited by secondary command buffers, every buffer that draws sets it
+void Renderer::setViewportAndScissor(VkCommandBuffer cmdBuffer) {
+	VkViewport viewport{
+		.x = 0.0f,
+		.y = 0.0f,
+		.width = static_cast<float>(m_surfaceExtent.width),
+		.height = static_cast<float>(m_surfaceExtent.height),
+		.minDepth = 0.0f,
+		.maxDepth = 1.0f
 	};
+	VkRect2D scissor{
+		.offset = { .x = 0, .y = 0 },
+		.extent = m_surfaceExtent
+	};
+	vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+}
+
+//Set 0 holds this frame's camera data through its dynamic offset, set 1 the scene objects when a scene is drawn
+void Renderer::bindFrameDescriptorSets(VkCommandBuffer cmdBuffer, uint32_t frameIndex) {
+	VkDescriptorSet sets[]{ m_lowFreqDescSet, VK_NULL_HANDLE };
+	uint32_t setCount = 1;
+	if (usesDrawList()) {
+		sets[setCount++] = m_instanceDescSet;
+	}
+	else if (m_config.sceneObjectCount > 0) {
+		sets[setCount++] = m_gpuScene.getDescriptorSet(frameIndex);
+	}
+	vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, SET_LOW_FREQ, setCount, sets, 1, &m_cameraDataOffset);
+}
+
+//Runs on a worker. Failures leave the job's slot null for drawFrame() to report, jobs may not throw.
+void Renderer::recordSecondaryDraws(FrameData& frame, uint32_t jobIndex, uint32_t workerIndex, uint32_t firstDraw, uint32_t drawCount) {
+	PROFILE_ZONE(m_profiler, "recordSecondaryDraws");
+	WorkerCommands& commands = frame.workerCommands.at(workerIndex);
+	if (commands.usedCount == commands.cmdBuffers.size()) {
+		VkCommandBufferAllocateInfo cmdBufferInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = commands.cmdPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+			.commandBufferCount = 1
+		};
+		VkCommandBuffer cmdBuffer;
+		if (vkAllocateCommandBuffers(m_device, &cmdBufferInfo, &cmdBuffer) != VK_SUCCESS) {
+			return;
+		}
+		commands.cmdBuffers.push_back(cmdBuffer);
+	}
+	VkCommandBuffer cmdBuffer = commands.cmdBuffers[commands.usedCount++];
 
-	vkQueuePresentKHR(m_graphicsQueue, &presentInfo);
-	vkResetCommandBuffer(m_cmdBuffer, 0);
+	VkCommandBufferInheritanceInfo inheritanceInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.renderPass = m_renderGraph.getRenderPass(m_scenePass),
+		.subpass = 0,
+		.framebuffer = m_renderGraph.getFramebuffer(m_scenePass)
+	};
+	VkCommandBufferBeginInfo beginInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+		.pInheritanceInfo = &inheritanceInfo
+	};
+	if (vkBeginCommandBuffer(cmdBuffer, &beginInfo) != VK_SUCCESS) {
+		return;
+	}
+	recordDraws(cmdBuffer, firstDraw, drawCount);
+	if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS) {
+		return;
+	}
+	frame.secondaryCmdBuffers[jobIndex] = cmdBuffer;
 }
 
 void Renderer::cleanup() {
-	vkDestroyPipeline(m_device, m_pipeline, P_DEFAULT_ALLOC);
-	vkDestroyPipelineLayout(m_device, m_pipelineLayout, P_DEFAULT_ALLOC);
-	vkDestroyDescriptorSetLayout(m_device, m_lowFreqDescSetLayout, P_DEFAULT_ALLOC);
-	vkDestroyBuffer(m_device, m_projectionDataBuf, P_DEFAULT_ALLOC);
-	vkDestroyFramebuffer(m_device, m_framebuffer, P_DEFAULT_ALLOC);
-	vkDestroyImageView(m_device, m_depthAttachView, P_DEFAULT_ALLOC);
-	vkDestroyImageView(m_device, m_colorAttachView, P_DEFAULT_ALLOC);
-	vkDestroyImage(m_device, m_depthAttachImage, P_DEFAULT_ALLOC);
-	vkDestroyImage(m_device, m_colorAttachImage, P_DEFAULT_ALLOC);
-	vkDestroyRenderPass(m_device, m_renderPass, P_DEFAULT_ALLOC);
-	vkDestroySwapchainKHR(m_device, m_swapchain, P_DEFAULT_ALLOC);
-	vkDestroyCommandPool(m_device, m_cmdPool, P_DEFAULT_ALLOC);
-	vkDestroyDevice(m_device, P_DEFAULT_ALLOC);
-	vkDestroySurfaceKHR(m_instance, m_surface, P_DEFAULT_ALLOC);
-	vkDestroyInstance(m_instance, P_DEFAULT_ALLOC);
-	glfwDestroyWindow(m_pWindow);
+	if (!m_config.tracePath.empty()) {
+		std::ofstream trace(m_config.tracePath);
+		m_profiler.writeChromeTrace(trace);
+		if (!trace) {
+			std::cerr << "Failed to write trace to " << m_config.tracePath << "\n";
+		}
+	}
+	m_profiler.destroy();
+	m_textures.destroy();
+	m_uploads.destroy();
+	if (m_config.sceneObjectCount > 0) {
+		if (m_gpuScene.isTwoPhase()) {
+			m_depthPyramid.destroy();
+		}
+		m_gpuScene.destroy();
+	}
+	m_pipelines.destroy();
+	if (m_pipelineLayout != VK_NULL_HANDLE) {
+		vkDestroyPipelineLayout(m_device, m_pipelineLayout, P_DEFAULT_ALLOC);
+	}
+	m_descriptors.destroy();
+	m_uniforms.destroy();
+	m_indexRing.destroy();
+	if (m_meshIndexBuf != VK_NULL_HANDLE) {
+		m_allocator.destroyBuffer(m_meshIndexBuf, m_meshIndexAlloc);
+	}
+	if (m_meshVertexBuf != VK_NULL_HANDLE) {
+		m_allocator.destroyBuffer(m_meshVertexBuf, m_meshVertexAlloc);
+	}
+	m_renderGraph.destroy();
+	if (m_swapchain != VK_NULL_HANDLE) {
+		vkDestroySwapchainKHR(m_device, m_swapchain, P_DEFAULT_ALLOC);
+	}
+	destroyFrameResources();
+	m_pipelineCache.destroy();
+	m_allocator.destroy();
+	if (m_device != VK_NULL_HANDLE) {
+		vkDestroyDevice(m_device, P_DEFAULT_ALLOC);
+	}
+	if (m_surface != VK_NULL_HANDLE) {
+		vkDestroySurfaceKHR(m_instance, m_surface, P_DEFAULT_ALLOC);
+	}
+	if (m_instance != VK_NULL_HANDLE) {
+		vkDestroyInstance(m_instance, P_DEFAULT_ALLOC);
+	}
+	if (m_pWindow != nullptr) {
+		glfwDestroyWindow(m_pWindow);
+	}
 }
\ No newline at end of file
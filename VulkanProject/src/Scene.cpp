@@ -1,5 +1,148 @@
 #include "Scene.h"
 
-void Scene::addObject(Object* obj) {
-	m_objectRefs.push_back(obj);
+#include <cmath>
+#include <stdexcept>
+
+ObjectHandle Scene::addObject(const glm::mat4& transform, const Mesh* pMesh, uint32_t flags) {
+	uint32_t slot;
+	if (!m_freeSlots.empty()) {
+		slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else {
+		slot = static_cast<uint32_t>(m_slots.size());
+		m_slots.push_back(Slot{ .denseIndex = 0, .generation = 0 });
+	}
+
+	uint32_t denseIndex = static_cast<uint32_t>(m_transforms.size());
+	m_slots[slot].denseIndex = denseIndex;
+	ObjectHandle handle{ .slot = slot, .generation = m_slots[slot].generation };
+
+	m_transforms.push_back(transform);
+	m_bounds.push_back(ObjectBounds{});
+	m_meshes.push_back(pMesh);
+	m_flags.push_back(flags);
+	m_handles.push_back(handle);
+	computeBounds(denseIndex);
+	return handle;
+}
+
+void Scene::removeObject(ObjectHandle handle) {
+	uint32_t denseIndex = checkedIndex(handle);
+	uint32_t lastIndex = static_cast<uint32_t>(m_transforms.size()) - 1;
+
+	if (denseIndex != lastIndex) {
+		m_transforms[denseIndex] = m_transforms[lastIndex];
+		m_bounds[denseIndex] = m_bounds[lastIndex];
+		m_meshes[denseIndex] = m_meshes[lastIndex];
+		m_flags[denseIndex] = m_flags[lastIndex];
+		m_handles[denseIndex] = m_handles[lastIndex];
+		m_slots[m_handles[denseIndex].slot].denseIndex = denseIndex;
+	}
+	m_transforms.pop_back();
+	m_bounds.pop_back();
+	m_meshes.pop_back();
+	m_flags.pop_back();
+	m_handles.pop_back();
+
+	m_slots[handle.slot].generation++;
+	m_freeSlots.push_back(handle.slot);
+}
+
+bool Scene::isValid(ObjectHandle handle) const {
+	return handle.slot < m_slots.size() && m_slots[handle.slot].generation == handle.generation;
+}
+
+uint32_t Scene::getObjectCount() const {
+	return static_cast<uint32_t>(m_transforms.size());
+}
+
+uint32_t Scene::getDenseIndex(ObjectHandle handle) const {
+	return checkedIndex(handle);
+}
+
+const glm::mat4& Scene::getTransform(ObjectHandle handle) const {
+	return m_transforms[checkedIndex(handle)];
+}
+
+void Scene::setTransform(ObjectHandle handle, const glm::mat4& transform) {
+	uint32_t denseIndex = checkedIndex(handle);
+	m_transforms[denseIndex] = transform;
+	computeBounds(denseIndex);
+}
+
+const Mesh* Scene::getMesh(ObjectHandle handle) const {
+	return m_meshes[checkedIndex(handle)];
+}
+
+uint32_t Scene::getFlags(ObjectHandle handle) const {
+	return m_flags[checkedIndex(handle)];
+}
+
+void Scene::setFlags(ObjectHandle handle, uint32_t flags) {
+	m_flags[checkedIndex(handle)] = flags;
+}
+
+std::span<glm::mat4> Scene::getTransforms() {
+	return m_transforms;
+}
+
+std::span<const glm::mat4> Scene::getTransforms() const {
+	return m_transforms;
+}
+
+std::span<ObjectBounds> Scene::getBounds() {
+	return m_bounds;
+}
+
+std::span<const ObjectBounds> Scene::getBounds() const {
+	return m_bounds;
+}
+
+std::span<const Mesh* const> Scene::getMeshes() const {
+	return m_meshes;
+}
+
+std::span<uint32_t> Scene::getFlags() {
+	return m_flags;
+}
+
+std::span<const uint32_t> Scene::getFlags() const {
+	return m_flags;
+}
+
+std::span<const ObjectHandle> Scene::getHandles() const {
+	return m_handles;
+}
+
+void Scene::updateBounds(uint32_t first, uint32_t count) {
+	for (uint32_t i = first; i < first + count; i++) {
+		computeBounds(i);
+	}
+}
+
+uint32_t Scene::checkedIndex(ObjectHandle handle) const {
+	if (!isValid(handle)) {
+		throw std::runtime_error("Stale or invalid object handle");
+	}
+	return m_slots[handle.slot].denseIndex;
+}
+
+//Transforms the mesh box by taking the absolute value of the rotation/scale part (Arvo), so the result is the tight
+//world space AABB of the transformed box rather than of its transformed corners one by one
+void Scene::computeBounds(uint32_t denseIndex) {
+	const glm::mat4& transform = m_transforms[denseIndex];
+	const Mesh* pMesh = m_meshes[denseIndex];
+	glm::vec3 localMin = pMesh != nullptr ? pMesh->getBoundsMin() : glm::vec3(0.0f);
+	glm::vec3 localMax = pMesh != nullptr ? pMesh->getBoundsMax() : glm::vec3(0.0f);
+	glm::vec3 localCenter = (localMin + localMax) * 0.5f;
+	glm::vec3 localExtents = (localMax - localMin) * 0.5f;
+
+	ObjectBounds& bounds = m_bounds[denseIndex];
+	bounds.center = glm::vec3(transform * glm::vec4(localCenter, 1.0f));
+	for (int row = 0; row < 3; row++) {
+		bounds.extents[row] = std::abs(transform[0][row]) * localExtents.x + std::abs(transform[1][row]) * localExtents.y
+			+ std::abs(transform[2][row]) * localExtents.z;
+	}
+	bounds.radius = glm::length(bounds.extents);
 }
\ No newline at end of file
@@ -1,19 +1,267 @@
 #include "ShaderCompile.h"
 
-void ShaderCompile::compileShader(const std::string& filename) { //Won't work if glslc.exe from the VulkanSDK hasn't been added to path
-	std::string input_command{ "glslc " };
-	input_command.append((SHADER_DIRECTORY / filename).generic_string());
-	input_command.append(" -o ");
-	input_command.append((SHADER_DIRECTORY / "compiled").generic_string());
-	input_command.append("/");
-	input_command.append((SHADER_DIRECTORY / filename).stem().generic_string());
-	input_command.append(".spv");
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <set>
+#include <thread>
 
-	system(input_command.c_str());
+#ifdef SHADERC_ENABLED
+#include <shaderc/shaderc.hpp>
+#include <memory>
+constexpr std::string_view SHADER_COMPILER_ID{ "shaderc" };
+#else
+constexpr std::string_view SHADER_COMPILER_ID{ "glslc" };
+#endif
+
+namespace {
+	std::string toHex(uint64_t value) {
+		char buffer[17];
+		snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+		return buffer;
+	}
+
+	std::string_view asText(const MappedFile& file) {
+		return { reinterpret_cast<const char*>(file.data()), file.size() };
+	}
+
+	std::vector<std::pair<std::string, std::string>> sortedDefines(const ShaderVariant& variant) {
+		std::vector<std::pair<std::string, std::string>> defines{ variant.defines };
+		std::sort(defines.begin(), defines.end());
+		return defines;
+	}
+
+	uint64_t hashDefines(const ShaderVariant& variant) {
+		uint64_t hash = FNV_OFFSET_BASIS;
+		for (const auto& [name, value] : sortedDefines(variant)) {
+			hash = fnv1a64(name, hash);
+			hash = fnv1a64(std::string_view{ "=" }, hash);
+			hash = fnv1a64(value, hash);
+			hash = fnv1a64(std::string_view{ ";" }, hash);
+		}
+		return hash;
+	}
+
+	//Same lookup order as the compiler: next to the including file first, then the shader root
+	std::filesystem::path resolveInclude(const std::filesystem::path& includingFile, std::string_view name) {
+		std::filesystem::path local{ includingFile.parent_path() / name };
+		if (std::filesystem::exists(local)) {
+			return local;
+		}
+		return SHADER_DIRECTORY / name;
+	}
+
+	//Hashes a file and, recursively, every #include it pulls in. Only the directive is recognised, conditional
+	//includes are always followed, which can only cause an unnecessary rebuild, never a missed one.
+	uint64_t hashWithIncludes(const std::filesystem::path& path, uint64_t hash, std::set<std::filesystem::path>& visited) {
+		if (!visited.insert(std::filesystem::weakly_canonical(path)).second) {
+			return hash;
+		}
+		hash = fnv1a64(path.filename().generic_string(), hash);
+		if (!std::filesystem::exists(path)) {
+			return hash; //let the compiler report it
+		}
+
+		MappedFile file{ path };
+		std::string_view source{ asText(file) };
+		hash = fnv1a64(source, hash);
+
+		size_t lineStart = 0;
+		while (lineStart < source.size()) {
+			size_t lineEnd = source.find('\n', lineStart);
+			if (lineEnd == std::string_view::npos) {
+				lineEnd = source.size();
+			}
+			std::string_view line{ source.substr(lineStart, lineEnd - lineStart) };
+			lineStart = lineEnd + 1;
+
+			size_t first = line.find_first_not_of(" \t");
+			if (first == std::string_view::npos || line.substr(first, 8) != "#include") {
+				continue;
+			}
+			size_t open = line.find_first_of("\"<", first + 8);
+			if (open == std::string_view::npos) {
+				continue;
+			}
+			size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+			if (close == std::string_view::npos) {
+				continue;
+			}
+			hash = hashWithIncludes(resolveInclude(path, line.substr(open + 1, close - open - 1)), hash, visited);
+		}
+		return hash;
+	}
+
+	std::filesystem::path getHashPath(const std::filesystem::path& outputPath) {
+		std::filesystem::path hashPath{ outputPath };
+		return hashPath += ".hash";
+	}
+
+	void writeHash(const std::filesystem::path& outputPath, uint64_t hash) {
+		std::ofstream file(getHashPath(outputPath), std::ios::trunc);
+		file << toHex(hash);
+	}
+
+#ifdef SHADERC_ENABLED
+	class ShaderIncluder : public shaderc::CompileOptions::IncluderInterface {
+	public:
+		shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type type, const char* requestingSource, [[maybe_unused]] size_t includeDepth) override {
+			IncludeData* pData = new IncludeData{};
+			std::filesystem::path path{ type == shaderc_include_type_relative ?
+				resolveInclude(requestingSource, requestedSource) : SHADER_DIRECTORY / requestedSource };
+
+			std::ifstream file(path, std::ios::binary);
+			if (file.is_open()) {
+				pData->sourceName = path.generic_string();
+				pData->content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			}
+			else {
+				pData->content = "Cannot find include " + std::string(requestedSource); //an empty name marks the error
+			}
+			pData->result = {
+				.source_name = pData->sourceName.c_str(),
+				.source_name_length = pData->sourceName.size(),
+				.content = pData->content.c_str(),
+				.content_length = pData->content.size(),
+				.user_data = pData
+			};
+			return &pData->result;
+		}
+
+		void ReleaseInclude(shaderc_include_result* pResult) override {
+			delete static_cast<IncludeData*>(pResult->user_data);
+		}
+
+	private:
+		struct IncludeData {
+			shaderc_include_result result;
+			std::string sourceName;
+			std::string content;
+		};
+	};
+
+	shaderc_shader_kind getShaderKind(const std::filesystem::path& path) {
+		std::string extension{ path.extension().string() };
+		if (extension == ".vert") return shaderc_vertex_shader;
+		if (extension == ".frag") return shaderc_fragment_shader;
+		if (extension == ".comp") return shaderc_compute_shader;
+		if (extension == ".geom") return shaderc_geometry_shader;
+		if (extension == ".tesc") return shaderc_tess_control_shader;
+		if (extension == ".tese") return shaderc_tess_evaluation_shader;
+		return shaderc_glsl_infer_from_source;
+	}
+#endif
+}
+
+std::string ShaderCompile::getOutputName(const ShaderVariant& variant) {
+	std::string name{ std::filesystem::path(variant.filename).stem().generic_string() };
+	if (!variant.defines.empty()) {
+		name += "_" + toHex(hashDefines(variant));
+	}
+	return name + ".spv";
+}
+
+uint64_t ShaderCompile::hashShaderSource(const ShaderVariant& variant) {
+	uint64_t hash = hashCombine(FNV_OFFSET_BASIS, SHADER_CACHE_VERSION);
+	hash = fnv1a64(SHADER_COMPILER_ID, hash);
+	hash = hashCombine(hash, hashDefines(variant));
+
+	std::set<std::filesystem::path> visited;
+	return hashWithIncludes(SHADER_DIRECTORY / variant.filename, hash, visited);
+}
+
+bool ShaderCompile::isUpToDate(const ShaderVariant& variant) {
+	std::filesystem::path outputPath{ COMPILED_SHADER_DIRECTORY / getOutputName(variant) };
+	if (!std::filesystem::exists(outputPath)) {
+		return false;
+	}
+	std::ifstream file(getHashPath(outputPath));
+	std::string storedHash;
+	return file >> storedHash && storedHash == toHex(hashShaderSource(variant));
+}
+
+void ShaderCompile::compileShader(const ShaderVariant& variant) {
+	std::filesystem::path sourcePath{ SHADER_DIRECTORY / variant.filename };
+	std::filesystem::path outputPath{ COMPILED_SHADER_DIRECTORY / getOutputName(variant) };
+	uint64_t hash = hashShaderSource(variant);
+	std::filesystem::create_directories(COMPILED_SHADER_DIRECTORY);
+
+#ifdef SHADERC_ENABLED
+	thread_local shaderc::Compiler compiler; //one per worker, compilations then never contend
+	shaderc::CompileOptions options;
+	options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+	options.SetIncluder(std::make_unique<ShaderIncluder>());
+	for (const auto& [name, value] : variant.defines) {
+		options.AddMacroDefinition(name, value);
+	}
+
+	MappedFile source{ sourcePath };
+	shaderc::SpvCompilationResult result{ compiler.CompileGlslToSpv(asText(source).data(), source.size(), getShaderKind(sourcePath),
+		sourcePath.generic_string().c_str(), options) };
+	if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
+		throw std::runtime_error("Failed to compile shader " + variant.filename + ":\n" + result.GetErrorMessage());
+	}
+
+	std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(result.cbegin()), (result.cend() - result.cbegin()) * sizeof(uint32_t));
+	if (!file) {
+		throw std::runtime_error("Failed to write shader " + outputPath.generic_string());
+	}
+#else
+	//Fallback when libshaderc isn't linked. Won't work if glslc.exe from the VulkanSDK hasn't been added to path
+	std::string input_command{ "glslc \"" };
+	input_command.append(sourcePath.generic_string());
+	input_command.append("\"");
+	for (const auto& [name, value] : variant.defines) {
+		input_command.append(" -D" + name + (value.empty() ? "" : "=" + value));
+	}
+	input_command.append(" -o \"");
+	input_command.append(outputPath.generic_string());
+	input_command.append("\"");
+
+	if (system(input_command.c_str()) != 0) {
+		throw std::runtime_error("Failed to compile shader " + variant.filename);
+	}
+#endif
+
+	writeHash(outputPath, hash);
+}
+
+ShaderBuildStats ShaderCompile::buildShaders(const std::vector<ShaderVariant>& variants) {
+	auto start = std::chrono::steady_clock::now();
+	std::atomic<uint32_t> nextVariant{ 0 };
+	std::atomic<uint32_t> compiled{ 0 };
+
+	auto worker = [&]() {
+		for (uint32_t i = nextVariant++; i < variants.size(); i = nextVariant++) {
+			if (!isUpToDate(variants[i])) {
+				compileShader(variants[i]);
+				compiled++;
+			}
+		}
+	};
+
+	uint32_t workerCount = std::min<uint32_t>(static_cast<uint32_t>(variants.size()), std::max(1u, std::thread::hardware_concurrency()));
+	std::vector<std::future<void>> workers;
+	for (uint32_t i = 1; i < workerCount; i++) {
+		workers.push_back(std::async(std::launch::async, worker));
+	}
+	worker();
+	for (std::future<void>& future : workers) {
+		future.get(); //rethrows compile errors from the other threads
+	}
+
+	return {
+		.upToDate = static_cast<uint32_t>(variants.size()) - compiled,
+		.compiled = compiled,
+		.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+	};
 }
 
 std::vector<char> ShaderCompile::readCompiledShader(const std::string& filename) {
-	std::ifstream file((SHADER_DIRECTORY/"compiled"/filename).generic_string(), std::ios::ate | std::ios::binary);
+	std::ifstream file((COMPILED_SHADER_DIRECTORY/filename).generic_string(), std::ios::ate | std::ios::binary);
 	if (!file.is_open()) { throw std::runtime_error("Failed to open file."); }
 
 	size_t fileSize = static_cast<size_t>(file.tellg());
@@ -26,6 +274,10 @@ std::vector<char> ShaderCompile::readCompiledShader(const std::string& filename)
 	return buffer;
 }
 
+MappedFile ShaderCompile::mapCompiledShader(const std::string& filename) {
+	return MappedFile(COMPILED_SHADER_DIRECTORY / filename);
+}
+
 VkShaderModule ShaderCompile::createShaderModule(VkDevice& device, const std::vector<char>& code) {
 	VkShaderModuleCreateInfo createInfo{
 		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
@@ -39,4 +291,19 @@ VkShaderModule ShaderCompile::createShaderModule(VkDevice& device, const std::ve
 		throw std::runtime_error("Failed to build Vulkan Shader.");
 	}
 	return shaderModule;
+}
+
+VkShaderModule ShaderCompile::createShaderModule(VkDevice& device, const MappedFile& code) {
+	VkShaderModuleCreateInfo createInfo{
+		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.codeSize = code.size(),
+		.pCode = reinterpret_cast<const uint32_t*>(code.data()) //mapped views are page aligned
+	};
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to build Vulkan Shader.");
+	}
+	return shaderModule;
 }
\ No newline at end of file
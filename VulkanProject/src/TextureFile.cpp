@@ -0,0 +1,276 @@
+#include "TextureFile.h"
+#include "BlockCompression.h"
+
+#include <fstream>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+static constexpr uint8_t KTX2_IDENTIFIER[12]{ 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+//Khronos data format descriptor values, section 5 of the Khronos Data Format specification
+constexpr uint32_t DFD_MODEL_RGBSDA = 1;
+constexpr uint32_t DFD_MODEL_BC1A = 128;
+constexpr uint32_t DFD_MODEL_BC5 = 132;
+constexpr uint32_t DFD_MODEL_BC7 = 134;
+constexpr uint32_t DFD_PRIMARIES_BT709 = 1;
+constexpr uint32_t DFD_TRANSFER_LINEAR = 1;
+constexpr uint32_t DFD_TRANSFER_SRGB = 2;
+constexpr uint32_t DFD_CHANNEL_ALPHA = 15;
+constexpr uint32_t DFD_QUALIFIER_LINEAR = 0x10;
+constexpr uint32_t DFD_VERSION = 2;
+
+static bool isSrgb(VkFormat format) {
+	return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK || format == VK_FORMAT_R8G8B8A8_SRGB;
+}
+
+//Basic descriptor block with one sample per channel, prefixed by the total size like the container stores it
+static std::vector<uint32_t> describeFormat(VkFormat format) {
+	struct Sample {
+		uint32_t bitOffset;
+		uint32_t bitLength;
+		uint32_t channel;
+	};
+	std::vector<Sample> samples;
+	uint32_t model = DFD_MODEL_RGBSDA;
+	uint32_t blockDimensions = 0; //each dimension minus one, a byte per dimension
+	switch (format) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		model = DFD_MODEL_BC1A;
+		samples = { { 0, 64, 0 } };
+		break;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		model = DFD_MODEL_BC5;
+		samples = { { 0, 64, 0 }, { 64, 64, 1 } };
+		break;
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		model = DFD_MODEL_BC7;
+		samples = { { 0, 128, 0 } };
+		break;
+	default:
+		samples = { { 0, 8, 0 }, { 8, 8, 1 }, { 16, 8, 2 }, { 24, 8, DFD_CHANNEL_ALPHA } };
+		break;
+	}
+	if (BlockCompression::isCompressed(format)) {
+		blockDimensions = (BC_BLOCK_EXTENT - 1) | (BC_BLOCK_EXTENT - 1) << 8;
+	}
+
+	uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+	std::vector<uint32_t> words{
+		4 + blockSize,
+		0, //Khronos vendor, basic descriptor type
+		DFD_VERSION | blockSize << 16,
+		model | DFD_PRIMARIES_BT709 << 8 | (isSrgb(format) ? DFD_TRANSFER_SRGB : DFD_TRANSFER_LINEAR) << 16,
+		blockDimensions,
+		BlockCompression::getBlockBytes(format),
+		0
+	};
+	for (const Sample& sample : samples) {
+		//Alpha is never sRGB encoded
+		uint32_t channel = sample.channel | (isSrgb(format) && sample.channel == DFD_CHANNEL_ALPHA ? DFD_QUALIFIER_LINEAR : 0);
+		words.push_back(sample.bitOffset | (sample.bitLength - 1) << 16 | channel << 24);
+		words.push_back(0);
+		words.push_back(0);
+		words.push_back(sample.bitLength >= 32 ? ~0u : (1u << sample.bitLength) - 1);
+	}
+	return words;
+}
+
+//Levels start at multiples of the least common multiple of the block size and 4
+static uint64_t levelAlignment(VkFormat format) {
+	uint32_t blockBytes = BlockCompression::getBlockBytes(format);
+	return blockBytes % 4 == 0 ? blockBytes : blockBytes * 4;
+}
+
+static uint64_t alignLevel(uint64_t offset, uint64_t alignment) {
+	return (offset + alignment - 1) / alignment * alignment;
+}
+
+//Halves the image with a 2x2 box filter, odd edges clamp to the last texel
+static std::vector<std::byte> downsample(std::span<const std::byte> rgba8, uint32_t width, uint32_t height, bool srgb) {
+	static const std::array<float, 256> toLinear = [] {
+		std::array<float, 256> table{};
+		for (uint32_t i = 0; i < 256; i++) {
+			float value = static_cast<float>(i) / 255.0f;
+			table[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+		return table;
+	}();
+	auto toSrgb = [](float value) {
+		value = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+		return static_cast<std::byte>(std::clamp(std::lround(value * 255.0f), 0l, 255l));
+	};
+
+	uint32_t levelWidth = std::max(width / 2, 1u);
+	uint32_t levelHeight = std::max(height / 2, 1u);
+	std::vector<std::byte> level(static_cast<size_t>(levelWidth) * levelHeight * 4);
+	const uint8_t* pSource = reinterpret_cast<const uint8_t*>(rgba8.data());
+	for (uint32_t y = 0; y < levelHeight; y++) {
+		uint32_t rows[2]{ std::min(y * 2, height - 1), std::min(y * 2 + 1, height - 1) };
+		for (uint32_t x = 0; x < levelWidth; x++) {
+			uint32_t columns[2]{ std::min(x * 2, width - 1), std::min(x * 2 + 1, width - 1) };
+			for (uint32_t c = 0; c < 4; c++) {
+				bool linear = srgb && c < 3;
+				float sum = 0.0f;
+				for (uint32_t row : rows) {
+					for (uint32_t column : columns) {
+						uint8_t value = pSource[(static_cast<size_t>(row) * width + column) * 4 + c];
+						sum += linear ? toLinear[value] : static_cast<float>(value);
+					}
+				}
+				level[(static_cast<size_t>(y) * levelWidth + x) * 4 + c] = linear ? toSrgb(sum * 0.25f)
+					: static_cast<std::byte>(std::lround(sum * 0.25f));
+			}
+		}
+	}
+	return level;
+}
+
+TextureFile::TextureFile(const std::filesystem::path& path) : m_file{ path } {
+	std::string name = path.string();
+	if (m_file.size() < sizeof(TextureFileHeader)) {
+		throw std::runtime_error("Failed to load texture file " + name + ", it is too small for a header");
+	}
+	m_pHeader = reinterpret_cast<const TextureFileHeader*>(m_file.data());
+	if (std::memcmp(m_pHeader->identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+		throw std::runtime_error("Failed to load texture file " + name + ", it is not a KTX2 file");
+	}
+	if (m_pHeader->supercompressionScheme != 0) {
+		throw std::runtime_error("Failed to load texture file " + name + ", supercompression scheme "
+			+ std::to_string(m_pHeader->supercompressionScheme) + " is not supported");
+	}
+	if (!BlockCompression::isSupported(getFormat())) {
+		throw std::runtime_error("Failed to load texture file " + name + ", format " + std::to_string(m_pHeader->vkFormat) + " is not supported");
+	}
+	if (m_pHeader->pixelWidth == 0 || m_pHeader->pixelHeight == 0 || m_pHeader->pixelDepth != 0 || m_pHeader->layerCount != 0
+		|| m_pHeader->faceCount != 1) {
+		throw std::runtime_error("Failed to load texture file " + name + ", it is not a single 2D image");
+	}
+	if (m_pHeader->levelCount == 0 || m_pHeader->levelCount > getFullLevelCount(m_pHeader->pixelWidth, m_pHeader->pixelHeight)
+		|| m_pHeader->levelCount > TEXTURE_FILE_MAX_LEVELS) {
+		throw std::runtime_error("Failed to load texture file " + name + ", level count " + std::to_string(m_pHeader->levelCount)
+			+ " does not fit the image size");
+	}
+
+	uint64_t indexEnd = sizeof(TextureFileHeader) + static_cast<uint64_t>(m_pHeader->levelCount) * sizeof(TextureFileLevel);
+	if (indexEnd > m_file.size()) {
+		throw std::runtime_error("Failed to load texture file " + name + ", the level index is out of bounds");
+	}
+	const TextureFileLevel* pLevels = reinterpret_cast<const TextureFileLevel*>(m_file.data() + sizeof(TextureFileHeader));
+	m_levels.resize(m_pHeader->levelCount);
+	for (uint32_t level = 0; level < m_pHeader->levelCount; level++) {
+		const TextureFileLevel& entry = pLevels[level];
+		if (entry.byteOffset < indexEnd || entry.byteOffset > m_file.size() || entry.byteLength > m_file.size() - entry.byteOffset) {
+			throw std::runtime_error("Failed to load texture file " + name + ", level " + std::to_string(level) + " is out of bounds");
+		}
+		VkExtent2D extent = getLevelExtent(level);
+		if (entry.byteLength != BlockCompression::getLevelSize(getFormat(), extent.width, extent.height)) {
+			throw std::runtime_error("Failed to load texture file " + name + ", the size of level " + std::to_string(level)
+				+ " does not match its extent");
+		}
+		m_levels[level] = std::span<const std::byte>(m_file.data() + entry.byteOffset, static_cast<size_t>(entry.byteLength));
+	}
+}
+
+uint64_t TextureFile::write(const std::filesystem::path& path, VkFormat format, uint32_t width, uint32_t height, std::span<const std::byte> rgba8) {
+	if (!BlockCompression::isSupported(format)) {
+		throw std::runtime_error("Failed to write texture file " + path.string() + ", format " + std::to_string(format) + " is not supported");
+	}
+	uint32_t levelCount = getFullLevelCount(width, height);
+	if (levelCount == 0 || levelCount > TEXTURE_FILE_MAX_LEVELS || rgba8.size() != static_cast<size_t>(width) * height * 4) {
+		throw std::runtime_error("Failed to write texture file " + path.string() + ", the image size is out of range or does not match its data");
+	}
+	std::vector<std::vector<std::byte>> levels(levelCount);
+	std::vector<std::byte> source{ rgba8.begin(), rgba8.end() };
+	for (uint32_t level = 0; level < levelCount; level++) {
+		uint32_t levelWidth = std::max(width >> level, 1u);
+		uint32_t levelHeight = std::max(height >> level, 1u);
+		levels[level] = BlockCompression::encode(format, source, levelWidth, levelHeight);
+		if (level + 1 < levelCount) {
+			source = downsample(source, levelWidth, levelHeight, isSrgb(format));
+		}
+	}
+
+	std::vector<uint32_t> dfd = describeFormat(format);
+	uint64_t dfdOffset = sizeof(TextureFileHeader) + static_cast<uint64_t>(levelCount) * sizeof(TextureFileLevel);
+	std::vector<TextureFileLevel> index(levelCount);
+	uint64_t offset = dfdOffset + dfd.size() * sizeof(uint32_t);
+	for (uint32_t level = levelCount; level-- > 0;) {
+		offset = alignLevel(offset, levelAlignment(format));
+		index[level] = TextureFileLevel{ .byteOffset = offset, .byteLength = levels[level].size(), .uncompressedByteLength = levels[level].size() };
+		offset += levels[level].size();
+	}
+
+	TextureFileHeader header{
+		.vkFormat = static_cast<uint32_t>(format),
+		.typeSize = 1,
+		.pixelWidth = width,
+		.pixelHeight = height,
+		.pixelDepth = 0,
+		.layerCount = 0,
+		.faceCount = 1,
+		.levelCount = levelCount,
+		.supercompressionScheme = 0,
+		.dfdByteOffset = static_cast<uint32_t>(dfdOffset),
+		.dfdByteLength = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t)),
+		.kvdByteOffset = 0,
+		.kvdByteLength = 0,
+		.sgdByteOffset = 0,
+		.sgdByteLength = 0
+	};
+	std::memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(TextureFileLevel));
+	out.write(reinterpret_cast<const char*>(dfd.data()), dfd.size() * sizeof(uint32_t));
+	const char padding[16]{};
+	uint64_t written = dfdOffset + dfd.size() * sizeof(uint32_t);
+	for (uint32_t level = levelCount; level-- > 0;) {
+		out.write(padding, static_cast<std::streamsize>(index[level].byteOffset - written));
+		out.write(reinterpret_cast<const char*>(levels[level].data()), static_cast<std::streamsize>(levels[level].size()));
+		written = index[level].byteOffset + levels[level].size();
+	}
+	if (!out) {
+		throw std::runtime_error("Failed to write texture file " + path.string());
+	}
+	return offset;
+}
+
+uint32_t TextureFile::getFullLevelCount(uint32_t width, uint32_t height) {
+	return static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+}
+
+VkFormat TextureFile::getFormat() const {
+	return static_cast<VkFormat>(m_pHeader->vkFormat);
+}
+
+uint32_t TextureFile::getWidth() const {
+	return m_pHeader->pixelWidth;
+}
+
+uint32_t TextureFile::getHeight() const {
+	return m_pHeader->pixelHeight;
+}
+
+uint32_t TextureFile::getLevelCount() const {
+	return m_pHeader->levelCount;
+}
+
+VkExtent2D TextureFile::getLevelExtent(uint32_t level) const {
+	return VkExtent2D{ std::max(m_pHeader->pixelWidth >> level, 1u), std::max(m_pHeader->pixelHeight >> level, 1u) };
+}
+
+std::span<const std::byte> TextureFile::getLevelData(uint32_t level) const {
+	return m_levels[level];
+}
+
+size_t TextureFile::getFileSize() const {
+	return m_file.size();
+}
\ No newline at end of file
@@ -0,0 +1,374 @@
+#include "TextureStreamer.h"
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+static VkDeviceSize getRgba8Size(const TextureFile& file, uint32_t firstLevel) {
+	VkDeviceSize size = 0;
+	for (uint32_t level = firstLevel; level < file.getLevelCount(); level++) {
+		VkExtent2D extent = file.getLevelExtent(level);
+		size += static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+	}
+	return size;
+}
+
+void TextureStreamer::init(VkPhysicalDevice physDevice, VkDevice device, GpuAllocator& allocator, UploadManager& uploads, DescriptorAllocator& descriptors,
+	uint32_t frameCount, bool bcFeatureEnabled, const TextureStreamerConfig& config) {
+	m_physDevice = physDevice;
+	m_device = device;
+	m_pAllocator = &allocator;
+	m_pUploads = &uploads;
+	m_pDescriptors = &descriptors;
+	m_config = config;
+	m_bcSupported = bcFeatureEnabled && !config.forceTranscode;
+	m_retired.resize(frameCount);
+}
+
+void TextureStreamer::destroy() {
+	if (m_device == VK_NULL_HANDLE) {
+		return;
+	}
+	m_pUploads->waitIdle();
+	for (Texture& texture : m_textures) {
+		destroyImage(texture.resident);
+		destroyImage(texture.pending);
+	}
+	for (std::vector<TextureImage>& images : m_retired) {
+		for (TextureImage& image : images) {
+			destroyImage(image);
+		}
+		images.clear();
+	}
+	m_textures.clear();
+	m_device = VK_NULL_HANDLE;
+}
+
+TextureHandle TextureStreamer::addTexture(const std::filesystem::path& path) {
+	TextureFile file{ path };
+	VkFormat format = canSample(file.getFormat()) ? file.getFormat() : BlockCompression::getTranscodeFormat(file.getFormat());
+	if (!canSample(format)) {
+		throw std::runtime_error("Failed to add texture " + path.string() + ", the device cannot sample its format");
+	}
+	VkExtent2D extent = file.getLevelExtent(0);
+	if (BlockCompression::getLevelSize(format, extent.width, extent.height) > m_pUploads->getMaxUploadSize()) {
+		throw std::runtime_error("Failed to add texture " + path.string() + ", its first level does not fit into the staging ring");
+	}
+
+	uint32_t levelCount = file.getLevelCount();
+	bool transcode = format != file.getFormat();
+	m_textures.push_back(Texture{
+		.file = std::move(file),
+		.format = format,
+		.transcode = transcode,
+		.wantedLevel = levelCount - 1,
+		.lastVisibleUpdate = 0,
+		.residentLevel = levelCount,
+		.resident = {},
+		.pendingLevel = levelCount,
+		.pending = {},
+		.pendingTicket = 0,
+		.requestedMs = -1.0,
+		.awaitingFirstMip = false
+	});
+	m_stats.textureCount++;
+	return static_cast<TextureHandle>(m_textures.size() - 1);
+}
+
+void TextureStreamer::markVisible(TextureHandle texture, uint32_t wantedLevel) {
+	Texture& entry = m_textures.at(texture);
+	wantedLevel = std::min(wantedLevel, entry.file.getLevelCount() - 1);
+	entry.wantedLevel = entry.lastVisibleUpdate == m_updateIndex ? std::min(entry.wantedLevel, wantedLevel) : wantedLevel;
+	entry.lastVisibleUpdate = m_updateIndex;
+}
+
+uint32_t TextureStreamer::getLevelForScreenSize(TextureHandle texture, float screenPixels) const {
+	const TextureFile& file = m_textures.at(texture).file;
+	uint32_t lastLevel = file.getLevelCount() - 1;
+	if (screenPixels < 1.0f) {
+		return lastLevel;
+	}
+	float texelsPerPixel = static_cast<float>(std::max(file.getWidth(), file.getHeight())) / screenPixels;
+	if (texelsPerPixel <= 1.0f) {
+		return 0;
+	}
+	return std::min(static_cast<uint32_t>(std::log2(texelsPerPixel)), lastLevel);
+}
+
+void TextureStreamer::beginFrame(uint32_t frameIndex) {
+	m_currentFrame = frameIndex;
+	for (TextureImage& image : m_retired.at(frameIndex)) {
+		m_stats.retiredBytes -= image.alloc.size;
+		destroyImage(image);
+	}
+	m_retired.at(frameIndex).clear();
+}
+
+//Requests are served smallest upload first, so a texture's mip tail is never stuck behind another texture's finest level
+void TextureStreamer::update() {
+	double startMs = nowMs();
+	for (Texture& texture : m_textures) {
+		if (texture.pending.image == VK_NULL_HANDLE || !m_pUploads->isComplete(texture.pendingTicket)) {
+			continue;
+		}
+		if (texture.resident.image != VK_NULL_HANDLE) {
+			m_stats.residentRgba8Bytes -= getRgba8Size(texture.file, texture.residentLevel);
+			retire(texture.resident);
+		} else {
+			m_stats.residentTextures++;
+		}
+		texture.resident = texture.pending;
+		texture.residentLevel = texture.pendingLevel;
+		texture.pending = {};
+		texture.pendingLevel = texture.file.getLevelCount();
+		m_stats.residentRgba8Bytes += getRgba8Size(texture.file, texture.residentLevel);
+
+		if (texture.requestedMs < 0.0) {
+			continue;
+		}
+		double waitedMs = startMs - texture.requestedMs;
+		if (texture.awaitingFirstMip) {
+			m_stats.firstMipCount++;
+			m_stats.firstMipMs += waitedMs;
+			m_stats.maxFirstMipMs = std::max(m_stats.maxFirstMipMs, waitedMs);
+			texture.awaitingFirstMip = false;
+		}
+		if (texture.residentLevel <= texture.wantedLevel) {
+			m_stats.wantedLevelCount++;
+			m_stats.wantedLevelMs += waitedMs;
+			m_stats.maxWantedLevelMs = std::max(m_stats.maxWantedLevelMs, waitedMs);
+			texture.requestedMs = -1.0;
+		}
+	}
+
+	m_requests.clear();
+	for (TextureHandle handle = 0; handle < m_textures.size(); handle++) {
+		Texture& texture = m_textures[handle];
+		bool visible = texture.lastVisibleUpdate == m_updateIndex;
+		if (!visible || texture.residentLevel <= texture.wantedLevel) {
+			if (texture.pending.image == VK_NULL_HANDLE) {
+				texture.requestedMs = -1.0; //a texture that comes back into view is timed from then
+			}
+			continue;
+		}
+		if (texture.requestedMs < 0.0) {
+			texture.requestedMs = startMs;
+			texture.awaitingFirstMip = texture.residentLevel == texture.file.getLevelCount();
+		}
+		if (texture.pending.image == VK_NULL_HANDLE) {
+			m_requests.push_back(handle);
+		}
+	}
+	std::vector<VkDeviceSize> uploadSizes(m_textures.size());
+	for (TextureHandle handle : m_requests) {
+		uploadSizes[handle] = getUploadSize(m_textures[handle], getTargetLevel(m_textures[handle]));
+	}
+	std::sort(m_requests.begin(), m_requests.end(), [&](TextureHandle a, TextureHandle b) {
+		return uploadSizes[a] < uploadSizes[b] || (uploadSizes[a] == uploadSizes[b] && a < b);
+	});
+
+	VkDeviceSize uploadedBytes = 0;
+	for (size_t i = 0; i < m_requests.size(); i++) {
+		TextureHandle handle = m_requests[i];
+		VkDeviceSize size = uploadSizes[handle];
+		if (uploadedBytes > 0 && uploadedBytes + size > m_config.uploadBytesPerUpdate) {
+			break; //the rest goes out with the next update
+		}
+		//Later requests are larger, they would not fit either
+		if (!upgrade(m_textures[handle], getTargetLevel(m_textures[handle]))) {
+			m_stats.deferrals += m_requests.size() - i;
+			break;
+		}
+		uploadedBytes += size;
+	}
+
+	m_updateIndex++;
+	m_stats.updateMs += nowMs() - startMs;
+}
+
+VkImageView TextureStreamer::getView(TextureHandle texture) const {
+	return m_textures.at(texture).resident.view;
+}
+
+uint32_t TextureStreamer::getResidentLevel(TextureHandle texture) const {
+	return m_textures.at(texture).residentLevel;
+}
+
+VkFormat TextureStreamer::getFormat(TextureHandle texture) const {
+	return m_textures.at(texture).format;
+}
+
+const TextureFile& TextureStreamer::getFile(TextureHandle texture) const {
+	return m_textures.at(texture).file;
+}
+
+bool TextureStreamer::isIdle() const {
+	return std::none_of(m_textures.begin(), m_textures.end(), [](const Texture& texture) { return texture.pending.image != VK_NULL_HANDLE; });
+}
+
+const TextureStreamerStats& TextureStreamer::getStats() const {
+	return m_stats;
+}
+
+bool TextureStreamer::canSample(VkFormat format) const {
+	if (BlockCompression::isCompressed(format) && !m_bcSupported) {
+		return false;
+	}
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(m_physDevice, format, &props);
+	return (props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
+
+VkDeviceSize TextureStreamer::getUploadSize(const Texture& texture, uint32_t firstLevel) const {
+	VkDeviceSize size = 0;
+	for (uint32_t level = firstLevel; level < texture.file.getLevelCount(); level++) {
+		VkExtent2D extent = texture.file.getLevelExtent(level);
+		size += BlockCompression::getLevelSize(texture.format, extent.width, extent.height);
+	}
+	return size;
+}
+
+//Nothing resident streams the mip tail, anything else one level finer than what is resident
+uint32_t TextureStreamer::getTargetLevel(const Texture& texture) const {
+	uint32_t levelCount = texture.file.getLevelCount();
+	if (!m_config.coarseToFine) {
+		return texture.wantedLevel;
+	}
+	if (texture.residentLevel < levelCount) {
+		return texture.residentLevel - 1;
+	}
+	uint32_t level = levelCount - 1;
+	while (level > texture.wantedLevel && getUploadSize(texture, level - 1) <= TEXTURE_MIP_TAIL_BYTES) {
+		level--;
+	}
+	return level;
+}
+
+//Evicts the least recently visible textures that were not visible this update until the bytes fit into the budget.
+//Images count until the upload manager is done with them, so textures with an upload in flight stay.
+bool TextureStreamer::makeRoom(VkDeviceSize bytes) {
+	while (m_stats.residentBytes + bytes > m_config.budgetBytes) {
+		Texture* pVictim = nullptr;
+		for (Texture& texture : m_textures) {
+			if (texture.resident.image == VK_NULL_HANDLE || texture.pending.image != VK_NULL_HANDLE || texture.lastVisibleUpdate == m_updateIndex) {
+				continue;
+			}
+			if (pVictim == nullptr || texture.lastVisibleUpdate < pVictim->lastVisibleUpdate) {
+				pVictim = &texture;
+			}
+		}
+		if (pVictim == nullptr) {
+			return false;
+		}
+		m_stats.residentRgba8Bytes -= getRgba8Size(pVictim->file, pVictim->residentLevel);
+		m_stats.residentTextures--;
+		m_stats.evictions++;
+		retire(pVictim->resident);
+		pVictim->residentLevel = pVictim->file.getLevelCount();
+	}
+	return true;
+}
+
+//The new image holds level and every coarser one, its first mip is the file's level. Memory is only allocated once the
+//budget has room for what the image actually needs.
+bool TextureStreamer::upgrade(Texture& texture, uint32_t level) {
+	VkExtent2D extent = texture.file.getLevelExtent(level);
+	uint32_t levelCount = texture.file.getLevelCount() - level;
+	VkImageCreateInfo imageInfo{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.imageType = VK_IMAGE_TYPE_2D,
+		.format = texture.format,
+		.extent = { extent.width, extent.height, 1 },
+		.mipLevels = levelCount,
+		.arrayLayers = 1,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = VK_IMAGE_TILING_OPTIMAL,
+		.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+	};
+	TextureImage& image = texture.pending;
+	if (vkCreateImage(m_device, &imageInfo, nullptr, &image.image) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create texture image");
+	}
+	VkMemoryRequirements reqs;
+	vkGetImageMemoryRequirements(m_device, image.image, &reqs);
+	if (!makeRoom(reqs.size)) {
+		vkDestroyImage(m_device, image.image, nullptr);
+		image.image = VK_NULL_HANDLE;
+		return false;
+	}
+	image.alloc = m_pAllocator->allocate(reqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, AllocationStrategy::FreeList, false);
+	vkBindImageMemory(m_device, image.image, image.alloc.memory, image.alloc.offset);
+
+	VkImageViewCreateInfo viewInfo{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.image = image.image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = texture.format,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = levelCount,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		}
+	};
+	if (vkCreateImageView(m_device, &viewInfo, nullptr, &image.view) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create texture image view");
+	}
+	m_stats.residentBytes += image.alloc.size;
+	m_stats.peakResidentBytes = std::max(m_stats.peakResidentBytes, m_stats.residentBytes);
+
+	//Coarsest first, the batch may be split when the staging ring fills up
+	UploadTicket ticket = 0;
+	for (uint32_t fileLevel = texture.file.getLevelCount(); fileLevel-- > level;) {
+		VkExtent2D levelExtent = texture.file.getLevelExtent(fileLevel);
+		std::span<const std::byte> data = texture.file.getLevelData(fileLevel);
+		if (texture.transcode) {
+			double transcodeStart = nowMs();
+			BlockCompression::decode(texture.file.getFormat(), data, levelExtent.width, levelExtent.height, m_transcoded);
+			data = m_transcoded;
+			m_stats.transcodedLevels++;
+			m_stats.transcodeMs += nowMs() - transcodeStart;
+		}
+		VkImageSubresourceLayers subresource{
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.mipLevel = fileLevel - level,
+			.baseArrayLayer = 0,
+			.layerCount = 1
+		};
+		ticket = std::max(ticket, m_pUploads->uploadImage(image.image, subresource, VkOffset3D{ 0, 0, 0 }, VkExtent3D{ levelExtent.width, levelExtent.height, 1 },
+			data.data(), data.size(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+		m_stats.uploadedBytes += data.size();
+		m_stats.uploadedLevels++;
+	}
+	texture.pendingLevel = level;
+	texture.pendingTicket = ticket;
+	m_stats.upgrades++;
+	return true;
+}
+
+void TextureStreamer::retire(TextureImage& image) {
+	m_stats.residentBytes -= image.alloc.size;
+	m_stats.retiredBytes += image.alloc.size;
+	m_retired.at(m_currentFrame).push_back(image);
+	image = {};
+}
+
+void TextureStreamer::destroyImage(TextureImage& image) {
+	if (image.image == VK_NULL_HANDLE) {
+		return;
+	}
+	m_pDescriptors->releaseSetsUsing(image.view);
+	vkDestroyImageView(m_device, image.view, nullptr);
+	m_pAllocator->destroyImage(image.image, image.alloc);
+	image = {};
+}
+
+double TextureStreamer::nowMs() const {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
\ No newline at end of file
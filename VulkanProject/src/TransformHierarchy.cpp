@@ -0,0 +1,444 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define TRANSFORM_TARGET_AVX2
+#else
+#define TRANSFORM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+//The SIMD paths load columns straight out of glm's storage
+static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "glm::mat4 must be 16 tightly packed floats");
+
+//glm::mat3_cast spelled out in the operation order of the SIMD paths, so all paths agree bit for bit
+glm::mat4 Transforms::compose(const TransformTrs& trs) {
+	const glm::quat& q = trs.rotation;
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+	return glm::mat4{
+		glm::vec4((1.0f - 2.0f * (yy + zz)) * trs.scale.x, 2.0f * (xy + wz) * trs.scale.x, 2.0f * (xz - wy) * trs.scale.x, 0.0f),
+		glm::vec4(2.0f * (xy - wz) * trs.scale.y, (1.0f - 2.0f * (xx + zz)) * trs.scale.y, 2.0f * (yz + wx) * trs.scale.y, 0.0f),
+		glm::vec4(2.0f * (xz + wy) * trs.scale.z, 2.0f * (yz - wx) * trs.scale.z, (1.0f - 2.0f * (xx + yy)) * trs.scale.z, 0.0f),
+		glm::vec4(trs.translation, 1.0f)
+	};
+}
+
+glm::mat4 Transforms::rigidInverse(const glm::mat4& transform) {
+	glm::mat3 inverseRotation = glm::transpose(glm::mat3(transform));
+	glm::mat4 inverse{ inverseRotation };
+	inverse[3] = glm::vec4(-(inverseRotation * glm::vec3(transform[3])), 1.0f);
+	return inverse;
+}
+
+void Transforms::composeScalar(const TransformTrs* const* pLocal, glm::mat4* pOut, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		pOut[i] = compose(*pLocal[i]);
+	}
+}
+
+//Spells out the same operation order as the SIMD paths so all paths agree bit for bit
+void Transforms::multiplyScalar(const glm::mat4* const* pLeft, const glm::mat4* pRight, glm::mat4* const* pOut, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		const glm::mat4& left = *pLeft[i];
+		const glm::mat4& right = pRight[i];
+		glm::mat4& out = *pOut[i];
+		for (int column = 0; column < 4; column++) {
+			out[column] = left[0] * right[column].x + left[1] * right[column].y + left[2] * right[column].z + left[3] * right[column].w;
+		}
+	}
+}
+
+#ifdef TRANSFORM_X86
+//Each node is loaded as three overlapping runs of four floats: translation and the first quaternion float, the
+//quaternion, and the last quaternion float and scale. A transpose of four nodes' runs gives one register per field.
+constexpr int TRS_TRANSLATION_RUN = 0;
+constexpr int TRS_ROTATION_RUN = 3;
+constexpr int TRS_SCALE_RUN = 6;
+constexpr int QUAT_X = static_cast<int>(offsetof(glm::quat, x) / sizeof(float));
+constexpr int QUAT_Y = static_cast<int>(offsetof(glm::quat, y) / sizeof(float));
+constexpr int QUAT_Z = static_cast<int>(offsetof(glm::quat, z) / sizeof(float));
+constexpr int QUAT_W = static_cast<int>(offsetof(glm::quat, w) / sizeof(float));
+static_assert(sizeof(TransformTrs) == 10 * sizeof(float) && offsetof(TransformTrs, rotation) == TRS_ROTATION_RUN * sizeof(float)
+	&& offsetof(TransformTrs, scale) == (TRS_SCALE_RUN + 1) * sizeof(float), "TransformTrs must be 10 tightly packed floats");
+
+void Transforms::composeSse(const TransformTrs* const* pLocal, glm::mat4* pOut, uint32_t count) {
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		auto loadRun = [pLocal, i](int run, __m128* pFields) {
+			for (int node = 0; node < 4; node++) {
+				pFields[node] = _mm_loadu_ps(reinterpret_cast<const float*>(pLocal[i + node]) + run);
+			}
+			_MM_TRANSPOSE4_PS(pFields[0], pFields[1], pFields[2], pFields[3]);
+		};
+		__m128 translation[4], rotation[4], scale[4];
+		loadRun(TRS_TRANSLATION_RUN, translation);
+		loadRun(TRS_ROTATION_RUN, rotation);
+		loadRun(TRS_SCALE_RUN, scale);
+		__m128 qx = rotation[QUAT_X], qy = rotation[QUAT_Y], qz = rotation[QUAT_Z], qw = rotation[QUAT_W];
+		__m128 sx = scale[1], sy = scale[2], sz = scale[3];
+
+		__m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+		__m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+		__m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+		//One register per matrix element, then a transpose turns each group of four into one column of every node
+		__m128 columns[4][4] = {
+			{ _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx), _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx), _mm_setzero_ps() },
+			{ _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy), _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy), _mm_setzero_ps() },
+			{ _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz), _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz), _mm_setzero_ps() },
+			{ translation[0], translation[1], translation[2], one }
+		};
+		for (int column = 0; column < 4; column++) {
+			__m128* pRows = columns[column];
+			_MM_TRANSPOSE4_PS(pRows[0], pRows[1], pRows[2], pRows[3]);
+			for (int node = 0; node < 4; node++) {
+				_mm_storeu_ps(&pOut[i + node][column][0], pRows[node]);
+			}
+		}
+	}
+	composeScalar(pLocal + i, pOut + i, count - i);
+}
+
+//_MM_TRANSPOSE4_PS on both 128 bit lanes at once
+TRANSFORM_TARGET_AVX2 static void transposeLanes(__m256* pRows) {
+	__m256 t0 = _mm256_unpacklo_ps(pRows[0], pRows[1]);
+	__m256 t1 = _mm256_unpacklo_ps(pRows[2], pRows[3]);
+	__m256 t2 = _mm256_unpackhi_ps(pRows[0], pRows[1]);
+	__m256 t3 = _mm256_unpackhi_ps(pRows[2], pRows[3]);
+	pRows[0] = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+	pRows[1] = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+	pRows[2] = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	pRows[3] = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+//Lane l of each register holds nodes 4l to 4l + 3, so every transpose stays within lanes. After the output transposes
+//register n holds one column of nodes n and n + 4, and pairs of columns are stored 32 bytes at a time.
+TRANSFORM_TARGET_AVX2 static void composeAvx2Impl(const TransformTrs* const* pLocal, glm::mat4* pOut, uint32_t count) {
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 two = _mm256_set1_ps(2.0f);
+	uint32_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 translation[4], rotation[4], scale[4];
+		for (int node = 0; node < 4; node++) {
+			const float* pLow = reinterpret_cast<const float*>(pLocal[i + node]);
+			const float* pHigh = reinterpret_cast<const float*>(pLocal[i + node + 4]);
+			translation[node] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pLow + TRS_TRANSLATION_RUN)), _mm_loadu_ps(pHigh + TRS_TRANSLATION_RUN), 1);
+			rotation[node] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pLow + TRS_ROTATION_RUN)), _mm_loadu_ps(pHigh + TRS_ROTATION_RUN), 1);
+			scale[node] = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(pLow + TRS_SCALE_RUN)), _mm_loadu_ps(pHigh + TRS_SCALE_RUN), 1);
+		}
+		transposeLanes(translation);
+		transposeLanes(rotation);
+		transposeLanes(scale);
+		__m256 qx = rotation[QUAT_X], qy = rotation[QUAT_Y], qz = rotation[QUAT_Z], qw = rotation[QUAT_W];
+		__m256 sx = scale[1], sy = scale[2], sz = scale[3];
+
+		__m256 xx = _mm256_mul_ps(qx, qx), yy = _mm256_mul_ps(qy, qy), zz = _mm256_mul_ps(qz, qz);
+		__m256 xy = _mm256_mul_ps(qx, qy), xz = _mm256_mul_ps(qx, qz), yz = _mm256_mul_ps(qy, qz);
+		__m256 wx = _mm256_mul_ps(qw, qx), wy = _mm256_mul_ps(qw, qy), wz = _mm256_mul_ps(qw, qz);
+
+		__m256 columns[4][4] = {
+			{ _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(yy, zz))), sx), _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx), _mm256_setzero_ps() },
+			{ _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy), _mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, zz))), sy),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy), _mm256_setzero_ps() },
+			{ _mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz), _mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz),
+				_mm256_mul_ps(_mm256_sub_ps(one, _mm256_mul_ps(two, _mm256_add_ps(xx, yy))), sz), _mm256_setzero_ps() },
+			{ translation[0], translation[1], translation[2], one }
+		};
+		for (int column = 0; column < 4; column++) {
+			transposeLanes(columns[column]);
+		}
+		for (int node = 0; node < 4; node++) {
+			float* pLow = &pOut[i + node][0][0];
+			float* pHigh = &pOut[i + node + 4][0][0];
+			_mm256_storeu_ps(pLow, _mm256_permute2f128_ps(columns[0][node], columns[1][node], 0x20));
+			_mm256_storeu_ps(pLow + 8, _mm256_permute2f128_ps(columns[2][node], columns[3][node], 0x20));
+			_mm256_storeu_ps(pHigh, _mm256_permute2f128_ps(columns[0][node], columns[1][node], 0x31));
+			_mm256_storeu_ps(pHigh + 8, _mm256_permute2f128_ps(columns[2][node], columns[3][node], 0x31));
+		}
+	}
+	Transforms::composeScalar(pLocal + i, pOut + i, count - i);
+}
+
+void Transforms::composeAvx2(const TransformTrs* const* pLocal, glm::mat4* pOut, uint32_t count) {
+	composeAvx2Impl(pLocal, pOut, count);
+}
+
+void Transforms::multiplySse(const glm::mat4* const* pLeft, const glm::mat4* pRight, glm::mat4* const* pOut, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		const float* pL = &(*pLeft[i])[0][0];
+		const float* pR = &pRight[i][0][0];
+		float* pO = &(*pOut[i])[0][0];
+		__m128 left0 = _mm_loadu_ps(pL);
+		__m128 left1 = _mm_loadu_ps(pL + 4);
+		__m128 left2 = _mm_loadu_ps(pL + 8);
+		__m128 left3 = _mm_loadu_ps(pL + 12);
+		for (int column = 0; column < 4; column++) {
+			__m128 right = _mm_loadu_ps(pR + column * 4);
+			__m128 sum = _mm_mul_ps(left0, _mm_shuffle_ps(right, right, _MM_SHUFFLE(0, 0, 0, 0)));
+			sum = _mm_add_ps(sum, _mm_mul_ps(left1, _mm_shuffle_ps(right, right, _MM_SHUFFLE(1, 1, 1, 1))));
+			sum = _mm_add_ps(sum, _mm_mul_ps(left2, _mm_shuffle_ps(right, right, _MM_SHUFFLE(2, 2, 2, 2))));
+			sum = _mm_add_ps(sum, _mm_mul_ps(left3, _mm_shuffle_ps(right, right, _MM_SHUFFLE(3, 3, 3, 3))));
+			_mm_storeu_ps(pO + column * 4, sum);
+		}
+	}
+}
+
+//Two columns of the right matrix per register, the in-lane shuffles broadcast each of their elements within its half
+TRANSFORM_TARGET_AVX2 static void multiplyAvx2Impl(const glm::mat4* const* pLeft, const glm::mat4* pRight, glm::mat4* const* pOut, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		const float* pL = &(*pLeft[i])[0][0];
+		const float* pR = &pRight[i][0][0];
+		float* pO = &(*pOut[i])[0][0];
+		__m256 left0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pL));
+		__m256 left1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pL + 4));
+		__m256 left2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pL + 8));
+		__m256 left3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(pL + 12));
+		for (int column = 0; column < 4; column += 2) {
+			__m256 right = _mm256_loadu_ps(pR + column * 4);
+			__m256 sum = _mm256_mul_ps(left0, _mm256_shuffle_ps(right, right, _MM_SHUFFLE(0, 0, 0, 0)));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(left1, _mm256_shuffle_ps(right, right, _MM_SHUFFLE(1, 1, 1, 1))));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(left2, _mm256_shuffle_ps(right, right, _MM_SHUFFLE(2, 2, 2, 2))));
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(left3, _mm256_shuffle_ps(right, right, _MM_SHUFFLE(3, 3, 3, 3))));
+			_mm256_storeu_ps(pO + column * 4, sum);
+		}
+	}
+}
+
+void Transforms::multiplyAvx2(const glm::mat4* const* pLeft, const glm::mat4* pRight, glm::mat4* const* pOut, uint32_t count) {
+	multiplyAvx2Impl(pLeft, pRight, pOut, count);
+}
+#else
+void Transforms::composeSse(const TransformTrs* const* pLocal, glm::mat4* pOut, uint32_t count) {
+	composeScalar(pLocal, pOut, count);
+}
+
+void Transforms::composeAvx2(const TransformTrs* const* pLocal, glm::mat4* pOut, uint32_t count) {
+	composeScalar(pLocal, pOut, count);
+}
+
+void Transforms::multiplySse(const glm::mat4* const* pLeft, const glm::mat4* pRight, glm::mat4* const* pOut, uint32_t count) {
+	multiplyScalar(pLeft, pRight, pOut, count);
+}
+
+void Transforms::multiplyAvx2(const glm::mat4* const* pLeft, const glm::mat4* pRight, glm::mat4* const* pOut, uint32_t count) {
+	multiplyScalar(pLeft, pRight, pOut, count);
+}
+#endif
+
+TransformId TransformHierarchy::addNode(TransformId parent, const TransformTrs& local) {
+	uint32_t parentIndex = parent == TRANSFORM_NO_PARENT ? TRANSFORM_NO_PARENT : getDenseIndex(parent);
+	uint32_t depth = parentIndex == TRANSFORM_NO_PARENT ? 0 : m_depths[parentIndex] + 1;
+	uint32_t denseIndex = static_cast<uint32_t>(m_parents.size());
+
+	//Appending a node no shallower than the last one keeps the arrays sorted, anything else is sorted by the next update
+	if (m_sorted && !m_depths.empty() && depth < m_depths.back()) {
+		m_sorted = false;
+	}
+	if (m_sorted) {
+		if (depth + 1 >= m_levelOffsets.size()) {
+			m_levelOffsets.resize(depth + 2, denseIndex);
+		}
+		m_levelOffsets.back() = denseIndex + 1;
+	}
+
+	TransformId id = static_cast<TransformId>(m_idToDense.size());
+	m_parents.push_back(parentIndex);
+	m_depths.push_back(depth);
+	m_locals.push_back(local);
+	m_worlds.push_back(glm::mat4{ 1.0f });
+	m_dirty.push_back(0);
+	m_idToDense.push_back(denseIndex);
+	m_denseToId.push_back(id);
+	markDirty(denseIndex);
+	return id;
+}
+
+void TransformHierarchy::setLocal(TransformId id, const TransformTrs& local) {
+	uint32_t denseIndex = getDenseIndex(id);
+	m_locals[denseIndex] = local;
+	markDirty(denseIndex);
+}
+
+const TransformTrs& TransformHierarchy::getLocal(TransformId id) const {
+	return m_locals[getDenseIndex(id)];
+}
+
+const glm::mat4& TransformHierarchy::getWorld(TransformId id) const {
+	return m_worlds[getDenseIndex(id)];
+}
+
+TransformId TransformHierarchy::getParent(TransformId id) const {
+	uint32_t parentIndex = m_parents[getDenseIndex(id)];
+	return parentIndex == TRANSFORM_NO_PARENT ? TRANSFORM_NO_PARENT : m_denseToId[parentIndex];
+}
+
+uint32_t TransformHierarchy::getNodeCount() const {
+	return static_cast<uint32_t>(m_parents.size());
+}
+
+uint32_t TransformHierarchy::getLevelCount() const {
+	return m_levelOffsets.empty() ? 0 : static_cast<uint32_t>(m_levelOffsets.size()) - 1;
+}
+
+void TransformHierarchy::markAllDirty() {
+	std::fill(m_dirty.begin(), m_dirty.end(), 1);
+	m_minDirtyDepth = 0;
+}
+
+std::span<const glm::mat4> TransformHierarchy::getWorldMatrices() const {
+	return m_worlds;
+}
+
+uint32_t TransformHierarchy::getDenseIndex(TransformId id) const {
+	if (id >= m_idToDense.size()) {
+		throw std::runtime_error("Invalid transform id");
+	}
+	return m_idToDense[id];
+}
+
+void TransformHierarchy::markDirty(uint32_t denseIndex) {
+	m_dirty[denseIndex] = 1;
+	m_minDirtyDepth = std::min(m_minDirtyDepth, m_depths[denseIndex]);
+}
+
+TransformUpdateStats TransformHierarchy::update(JobSystem* pJobs, CullPath path) {
+	TransformUpdateStats stats{};
+	if (!m_sorted) {
+		sortByDepth();
+		stats.resorted = true;
+	}
+	path = Culling::resolvePath(path);
+
+	uint32_t levelCount = getLevelCount();
+	for (uint32_t level = std::min(m_minDirtyDepth, levelCount); level < levelCount; level++) {
+		uint32_t begin = m_levelOffsets[level];
+		uint32_t count = m_levelOffsets[level + 1] - begin;
+		if (pJobs == nullptr || count <= TRANSFORM_UPDATE_BATCH || pJobs->getWorkerCount() == 1) {
+			updateRange(begin, begin + count, path);
+		}
+		else {
+			JobCounter levelDone;
+			pJobs->parallelFor(count, TRANSFORM_UPDATE_BATCH, [this, begin, path](uint32_t first, uint32_t last, uint32_t) {
+				updateRange(begin + first, begin + last, path);
+			}, levelDone);
+			pJobs->wait(levelDone);
+		}
+		stats.levelsVisited++;
+	}
+
+	//The flags told each level which parents changed, none of them are dirty anymore
+	if (m_minDirtyDepth < levelCount) {
+		uint32_t firstDirty = m_levelOffsets[m_minDirtyDepth];
+		for (uint32_t i = firstDirty; i < m_dirty.size(); i++) {
+			stats.updatedNodes += m_dirty[i];
+		}
+		std::fill(m_dirty.begin() + firstDirty, m_dirty.end(), 0);
+	}
+	m_minDirtyDepth = ~0u;
+	return stats;
+}
+
+//Roots take their local matrix as is. Other dirty nodes, and nodes whose parent changed in this update, are collected
+//into batches whose local matrices are composed in one kernel call, then multiplied by their parents' world matrices
+//in another.
+void TransformHierarchy::updateRange(uint32_t begin, uint32_t end, CullPath path) {
+	using ComposeFunction = void(*)(const TransformTrs* const*, glm::mat4*, uint32_t);
+	using MultiplyFunction = void(*)(const glm::mat4* const*, const glm::mat4*, glm::mat4* const*, uint32_t);
+	ComposeFunction compose = Transforms::composeScalar;
+	MultiplyFunction multiply = Transforms::multiplyScalar;
+	switch (path) {
+	case CullPath::Avx2: compose = Transforms::composeAvx2; multiply = Transforms::multiplyAvx2; break;
+	case CullPath::Sse: compose = Transforms::composeSse; multiply = Transforms::multiplySse; break;
+	default: break;
+	}
+
+	const glm::mat4* parents[TRANSFORM_KERNEL_BATCH];
+	const TransformTrs* localTrs[TRANSFORM_KERNEL_BATCH];
+	glm::mat4 locals[TRANSFORM_KERNEL_BATCH];
+	glm::mat4* outputs[TRANSFORM_KERNEL_BATCH];
+	uint32_t batchCount = 0;
+	auto flush = [&]() {
+		compose(localTrs, locals, batchCount);
+		multiply(parents, locals, outputs, batchCount);
+		batchCount = 0;
+	};
+	for (uint32_t i = begin; i < end; i++) {
+		uint32_t parent = m_parents[i];
+		bool parentChanged = parent != TRANSFORM_NO_PARENT && m_dirty[parent] != 0;
+		if (m_dirty[i] == 0 && !parentChanged) {
+			continue;
+		}
+		m_dirty[i] = 1;
+
+		if (parent == TRANSFORM_NO_PARENT) {
+			m_worlds[i] = Transforms::compose(m_locals[i]);
+			continue;
+		}
+		parents[batchCount] = &m_worlds[parent];
+		localTrs[batchCount] = &m_locals[i];
+		outputs[batchCount] = &m_worlds[i];
+		if (++batchCount == TRANSFORM_KERNEL_BATCH) {
+			flush();
+		}
+	}
+	if (batchCount > 0) {
+		flush();
+	}
+}
+
+//Stable counting sort by depth, so siblings keep their order and parents their place before their children
+void TransformHierarchy::sortByDepth() {
+	uint32_t nodeCount = getNodeCount();
+	uint32_t levelCount = *std::max_element(m_depths.begin(), m_depths.end()) + 1;
+	m_levelOffsets.assign(levelCount + 1, 0);
+	for (uint32_t depth : m_depths) {
+		m_levelOffsets[depth + 1]++;
+	}
+	for (uint32_t level = 0; level < levelCount; level++) {
+		m_levelOffsets[level + 1] += m_levelOffsets[level];
+	}
+
+	std::vector<uint32_t> newIndex(nodeCount);
+	std::vector<uint32_t> cursors(m_levelOffsets.begin(), m_levelOffsets.end() - 1);
+	for (uint32_t i = 0; i < nodeCount; i++) {
+		newIndex[i] = cursors[m_depths[i]]++;
+	}
+
+	std::vector<uint32_t> parents(nodeCount);
+	std::vector<uint32_t> depths(nodeCount);
+	std::vector<TransformTrs> locals(nodeCount);
+	std::vector<glm::mat4> worlds(nodeCount);
+	std::vector<uint8_t> dirty(nodeCount);
+	std::vector<TransformId> denseToId(nodeCount);
+	for (uint32_t i = 0; i < nodeCount; i++) {
+		uint32_t target = newIndex[i];
+		parents[target] = m_parents[i] == TRANSFORM_NO_PARENT ? TRANSFORM_NO_PARENT : newIndex[m_parents[i]];
+		depths[target] = m_depths[i];
+		locals[target] = m_locals[i];
+		worlds[target] = m_worlds[i];
+		dirty[target] = m_dirty[i];
+		denseToId[target] = m_denseToId[i];
+		m_idToDense[m_denseToId[i]] = target;
+	}
+	m_parents = std::move(parents);
+	m_depths = std::move(depths);
+	m_locals = std::move(locals);
+	m_worlds = std::move(worlds);
+	m_dirty = std::move(dirty);
+	m_denseToId = std::move(denseToId);
+	m_sorted = true;
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "UniformRing.h"
+
+#include <algorithm>
+
+void UniformRing::init(VkPhysicalDevice physDevice, GpuAllocator& allocator, uint32_t frameCount, VkDeviceSize frameSize) {
+	m_pAllocator = &allocator;
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(physDevice, &props);
+	m_stats.alignment = std::max<VkDeviceSize>({ props.limits.minUniformBufferOffsetAlignment, props.limits.minStorageBufferOffsetAlignment, 16 });
+	m_stats.frameSize = (frameSize + m_stats.alignment - 1) / m_stats.alignment * m_stats.alignment;
+
+	//Dynamic offsets are 32 bit
+	if (m_stats.frameSize * frameCount > ~0u) {
+		throw std::runtime_error("Uniform ring does not fit 32 bit dynamic offsets");
+	}
+
+	VkBufferCreateInfo bufferInfo{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = m_stats.frameSize * frameCount,
+		.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+	};
+	//Device local when the device offers host visible VRAM, so shaders read the constants without crossing the bus
+	m_allocation = m_pAllocator->createBuffer(bufferInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, AllocationStrategy::FreeList, m_buffer);
+	if (m_allocation.pMapped == nullptr) {
+		throw std::runtime_error("Failed to map uniform ring");
+	}
+	beginFrame(0);
+}
+
+void UniformRing::destroy() {
+	if (m_buffer != VK_NULL_HANDLE) {
+		m_pAllocator->destroyBuffer(m_buffer, m_allocation);
+		m_buffer = VK_NULL_HANDLE;
+	}
+}
+
+void UniformRing::beginFrame(uint32_t frameIndex) {
+	m_frameBegin = frameIndex * m_stats.frameSize;
+	m_head = m_frameBegin;
+}
+
+UniformAllocation UniformRing::allocate(VkDeviceSize size) {
+	VkDeviceSize offset = m_head;
+	VkDeviceSize end = offset + (size + m_stats.alignment - 1) / m_stats.alignment * m_stats.alignment;
+	if (end > m_frameBegin + m_stats.frameSize) {
+		throw std::runtime_error("Uniform ring frame region exhausted");
+	}
+	m_head = end;
+	m_stats.allocationCount++;
+	m_stats.peakFrameBytes = std::max(m_stats.peakFrameBytes, m_head - m_frameBegin);
+
+	return UniformAllocation{
+		.pData = static_cast<std::byte*>(m_allocation.pMapped) + offset,
+		.offset = static_cast<uint32_t>(offset),
+		.size = size
+	};
+}
+
+VkBuffer UniformRing::getBuffer() const {
+	return m_buffer;
+}
+
+const UniformRingStats& UniformRing::getStats() const {
+	return m_stats;
+}
\ No newline at end of file
@@ -0,0 +1,402 @@
+#include "UploadManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+
+void UploadManager::init(VkDevice device, GpuAllocator& allocator, uint32_t transferFamily, VkQueue transferQueue, uint32_t graphicsFamily, VkQueue graphicsQueue,
+	VkDeviceSize ringSize) {
+	m_device = device;
+	m_pAllocator = &allocator;
+	m_graphicsFamily = graphicsFamily;
+	m_transferFamily = transferFamily != ~0u ? transferFamily : graphicsFamily;
+	m_transferQueue = transferFamily != ~0u ? transferQueue : graphicsQueue;
+	m_ringSize = ringSize;
+
+	VkBufferCreateInfo ringInfo{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = ringSize,
+		.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE
+	};
+	m_ringAlloc = allocator.createBuffer(ringInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0,
+		AllocationStrategy::FreeList, m_ringBuffer);
+}
+
+void UploadManager::destroy() {
+	if (m_device == VK_NULL_HANDLE) {
+		return;
+	}
+	waitIdle();
+
+	for (Batch& batch : m_batches) {
+		vkDestroyFence(m_device, batch.fence, nullptr);
+		vkDestroyCommandPool(m_device, batch.cmdPool, nullptr);
+	}
+	m_batches.clear();
+	m_freeBatches.clear();
+	m_pAllocator->destroyBuffer(m_ringBuffer, m_ringAlloc);
+	m_ringBuffer = VK_NULL_HANDLE;
+	m_device = VK_NULL_HANDLE;
+}
+
+UploadTicket UploadManager::uploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* pData, VkDeviceSize size) {
+	const std::byte* pBytes = static_cast<const std::byte*>(pData);
+	VkDeviceSize maxChunk = m_ringSize / 4; //large uploads stream through the ring in pieces
+	UploadTicket ticket = 0;
+
+	for (VkDeviceSize done = 0; done < size;) {
+		VkDeviceSize chunk = std::min(size - done, maxChunk);
+		VkDeviceSize stagingOffset = allocateStaging(chunk);
+		std::memcpy(static_cast<std::byte*>(m_ringAlloc.pMapped) + stagingOffset, pBytes + done, chunk);
+
+		Batch& batch = getOpenBatch();
+		batch.bufferCopies.push_back({
+			.dst = dst,
+			.region = {
+				.srcOffset = stagingOffset,
+				.dstOffset = dstOffset + done,
+				.size = chunk
+			}
+		});
+		batch.dataBytes += chunk;
+		ticket = batch.ticket;
+		done += chunk;
+
+		if (batch.dataBytes >= maxChunk) {
+			flush(); //keep the transfer queue busy while the CPU fills the rest of the ring
+		}
+	}
+
+	m_stats.uploadCount++;
+	return ticket;
+}
+
+UploadTicket UploadManager::uploadImage(VkImage dst, const VkImageSubresourceLayers& subresource, VkOffset3D offset, VkExtent3D extent,
+	const void* pData, VkDeviceSize size, VkImageLayout finalLayout) {
+	VkDeviceSize stagingOffset = allocateStaging(size);
+	std::memcpy(static_cast<std::byte*>(m_ringAlloc.pMapped) + stagingOffset, pData, size);
+
+	Batch& batch = getOpenBatch();
+	batch.imageCopies.push_back({
+		.dst = dst,
+		.region = {
+			.bufferOffset = stagingOffset,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource = subresource,
+			.imageOffset = offset,
+			.imageExtent = extent
+		},
+		.finalLayout = finalLayout
+	});
+	batch.dataBytes += size;
+
+	m_stats.uploadCount++;
+	return batch.ticket;
+}
+
+UploadTicket UploadManager::flush() {
+	if (m_openBatch == ~0u) {
+		return m_nextTicket - 1;
+	}
+
+	Batch& batch = m_batches.at(m_openBatch);
+	record(batch);
+
+	VkSubmitInfo submitInfo{
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.commandBufferCount = 1,
+		.pCommandBuffers = &batch.cmdBuffer
+	};
+	if (vkQueueSubmit(m_transferQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to submit upload batch");
+	}
+
+	if (m_inFlight.empty()) {
+		m_activeSinceMs = nowMs();
+	}
+	m_inFlight.push_back(m_openBatch);
+	m_openBatch = ~0u;
+	m_stats.batchCount++;
+	return batch.ticket;
+}
+
+bool UploadManager::isComplete(UploadTicket ticket) {
+	retireCompleted();
+	return ticket <= (usesDedicatedQueue() ? m_acquiredTicket : m_completedTicket);
+}
+
+//With a dedicated transfer queue the data becomes usable after the next recordAcquireBarriers()
+void UploadManager::wait(UploadTicket ticket) {
+	if (m_openBatch != ~0u && m_batches.at(m_openBatch).ticket <= ticket) {
+		flush();
+	}
+	while (m_completedTicket < ticket && !m_inFlight.empty()) {
+		retireOldest();
+	}
+}
+
+void UploadManager::waitIdle() {
+	flush();
+	while (!m_inFlight.empty()) {
+		retireOldest();
+	}
+}
+
+void UploadManager::recordAcquireBarriers(VkCommandBuffer graphicsCmdBuffer) {
+	retireCompleted();
+	if (!m_pendingBufferAcquires.empty() || !m_pendingImageAcquires.empty()) {
+		vkCmdPipelineBarrier(graphicsCmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+			static_cast<uint32_t>(m_pendingBufferAcquires.size()), m_pendingBufferAcquires.data(),
+			static_cast<uint32_t>(m_pendingImageAcquires.size()), m_pendingImageAcquires.data());
+		m_pendingBufferAcquires.clear();
+		m_pendingImageAcquires.clear();
+	}
+	m_acquiredTicket = m_completedTicket;
+}
+
+const UploadStats& UploadManager::getStats() const {
+	return m_stats;
+}
+
+bool UploadManager::usesDedicatedQueue() const {
+	return m_transferFamily != m_graphicsFamily;
+}
+
+VkDeviceSize UploadManager::getMaxUploadSize() const {
+	return m_ringSize / 2;
+}
+
+UploadManager::Batch& UploadManager::getOpenBatch() {
+	if (m_openBatch != ~0u) {
+		return m_batches.at(m_openBatch);
+	}
+
+	retireCompleted();
+	if (m_freeBatches.empty()) {
+		Batch batch{};
+		VkCommandPoolCreateInfo cmdPoolInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+			.queueFamilyIndex = m_transferFamily
+		};
+		if (vkCreateCommandPool(m_device, &cmdPoolInfo, nullptr, &batch.cmdPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create upload command pool");
+		}
+
+		VkCommandBufferAllocateInfo cmdBufferInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = batch.cmdPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1
+		};
+		VkFenceCreateInfo fenceInfo{
+			.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO
+		};
+		if (vkAllocateCommandBuffers(m_device, &cmdBufferInfo, &batch.cmdBuffer) != VK_SUCCESS
+			|| vkCreateFence(m_device, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create upload batch");
+		}
+
+		m_freeBatches.push_back(static_cast<uint32_t>(m_batches.size()));
+		m_batches.push_back(std::move(batch));
+	}
+
+	m_openBatch = m_freeBatches.back();
+	m_freeBatches.pop_back();
+
+	Batch& batch = m_batches.at(m_openBatch);
+	batch.ticket = m_nextTicket++;
+	batch.ringBytes = 0;
+	batch.dataBytes = 0;
+	batch.bufferCopies.clear();
+	batch.imageCopies.clear();
+	batch.bufferAcquires.clear();
+	batch.imageAcquires.clear();
+	return batch;
+}
+
+//Staging space is handed out in submission order and released in completion order, so the ring only needs a head and a fill count
+VkDeviceSize UploadManager::allocateStaging(VkDeviceSize size) {
+	if (size > getMaxUploadSize()) {
+		throw std::runtime_error("Upload larger than half the staging ring");
+	}
+
+	while (true) {
+		if (m_ringUsed == 0) {
+			m_ringHead = 0;
+		}
+		VkDeviceSize offset = (m_ringHead + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+		if (offset + size > m_ringSize) {
+			offset = 0; //wrap, the end of the ring becomes padding
+		}
+		VkDeviceSize padding = offset >= m_ringHead ? offset - m_ringHead : m_ringSize - m_ringHead;
+
+		if (m_ringUsed + padding + size <= m_ringSize) {
+			Batch& batch = getOpenBatch();
+			batch.ringBytes += padding + size;
+			m_ringUsed += padding + size;
+			m_ringHead = offset + size;
+			return offset;
+		}
+
+		if (m_inFlight.empty()) {
+			flush(); //the open batch itself fills the ring
+			continue;
+		}
+		double stallStart = nowMs();
+		retireOldest();
+		m_stats.stallCount++;
+		m_stats.stallMs += nowMs() - stallStart;
+	}
+}
+
+void UploadManager::record(Batch& batch) {
+	vkResetCommandPool(m_device, batch.cmdPool, 0);
+	VkCommandBufferBeginInfo beginInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	};
+	vkBeginCommandBuffer(batch.cmdBuffer, &beginInfo);
+
+	bool transferOwnership = usesDedicatedQueue();
+	uint32_t srcFamily = transferOwnership ? m_transferFamily : VK_QUEUE_FAMILY_IGNORED;
+	uint32_t dstFamily = transferOwnership ? m_graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+	//A release only needs the write to be available, the acquire on the graphics queue makes it visible
+	VkAccessFlags releaseDstAccess = transferOwnership ? 0 : VK_ACCESS_MEMORY_READ_BIT;
+
+	//One transition per image subresource, shared by every region copied into it
+	std::vector<VkImageMemoryBarrier> toTransferDst;
+	std::vector<VkImageMemoryBarrier> imageReleases;
+	for (const ImageCopy& copy : batch.imageCopies) {
+		const VkImageSubresourceLayers& layers = copy.region.imageSubresource;
+		bool seen = std::any_of(toTransferDst.begin(), toTransferDst.end(), [&](const VkImageMemoryBarrier& barrier) {
+			return barrier.image == copy.dst && barrier.subresourceRange.baseMipLevel == layers.mipLevel
+				&& barrier.subresourceRange.baseArrayLayer == layers.baseArrayLayer;
+		});
+		if (seen) {
+			continue;
+		}
+
+		VkImageMemoryBarrier barrier{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask = 0,
+			.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED, //uploads replace the whole subresource
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = copy.dst,
+			.subresourceRange = {
+				.aspectMask = layers.aspectMask,
+				.baseMipLevel = layers.mipLevel,
+				.levelCount = 1,
+				.baseArrayLayer = layers.baseArrayLayer,
+				.layerCount = layers.layerCount
+			}
+		};
+		toTransferDst.push_back(barrier);
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = releaseDstAccess;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = copy.finalLayout;
+		barrier.srcQueueFamilyIndex = srcFamily;
+		barrier.dstQueueFamilyIndex = dstFamily;
+		imageReleases.push_back(barrier);
+
+		if (transferOwnership) {
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+			batch.imageAcquires.push_back(barrier);
+		}
+	}
+	if (!toTransferDst.empty()) {
+		vkCmdPipelineBarrier(batch.cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+			static_cast<uint32_t>(toTransferDst.size()), toTransferDst.data());
+	}
+
+	//Sorted by destination so every buffer gets a single vkCmdCopyBuffer, and adjacent ranges share one barrier
+	std::stable_sort(batch.bufferCopies.begin(), batch.bufferCopies.end(), [](const BufferCopy& a, const BufferCopy& b) {
+		return std::less<VkBuffer>{}(a.dst, b.dst) || (a.dst == b.dst && a.region.dstOffset < b.region.dstOffset);
+	});
+	std::vector<VkBufferCopy> regions;
+	std::vector<VkBufferMemoryBarrier> bufferReleases;
+	for (size_t i = 0; i < batch.bufferCopies.size(); i++) {
+		const BufferCopy& copy = batch.bufferCopies[i];
+		regions.push_back(copy.region);
+		if (i + 1 == batch.bufferCopies.size() || batch.bufferCopies[i + 1].dst != copy.dst) {
+			vkCmdCopyBuffer(batch.cmdBuffer, m_ringBuffer, copy.dst, static_cast<uint32_t>(regions.size()), regions.data());
+			regions.clear();
+		}
+
+		if (!bufferReleases.empty() && bufferReleases.back().buffer == copy.dst
+			&& bufferReleases.back().offset + bufferReleases.back().size >= copy.region.dstOffset) {
+			VkDeviceSize end = std::max(bufferReleases.back().offset + bufferReleases.back().size, copy.region.dstOffset + copy.region.size);
+			bufferReleases.back().size = end - bufferReleases.back().offset;
+			continue;
+		}
+		bufferReleases.push_back({
+			.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = releaseDstAccess,
+			.srcQueueFamilyIndex = srcFamily,
+			.dstQueueFamilyIndex = dstFamily,
+			.buffer = copy.dst,
+			.offset = copy.region.dstOffset,
+			.size = copy.region.size
+		});
+	}
+
+	for (size_t i = 0; i < batch.imageCopies.size(); i++) {
+		const ImageCopy& copy = batch.imageCopies[i];
+		vkCmdCopyBufferToImage(batch.cmdBuffer, m_ringBuffer, copy.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+	}
+
+	if (!bufferReleases.empty() || !imageReleases.empty()) {
+		vkCmdPipelineBarrier(batch.cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			transferOwnership ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+			static_cast<uint32_t>(bufferReleases.size()), bufferReleases.data(),
+			static_cast<uint32_t>(imageReleases.size()), imageReleases.data());
+	}
+	if (transferOwnership) {
+		for (VkBufferMemoryBarrier barrier : bufferReleases) {
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+			batch.bufferAcquires.push_back(barrier);
+		}
+	}
+
+	vkEndCommandBuffer(batch.cmdBuffer);
+}
+
+void UploadManager::retireCompleted() {
+	while (!m_inFlight.empty() && vkGetFenceStatus(m_device, m_batches.at(m_inFlight.front()).fence) == VK_SUCCESS) {
+		retireOldest();
+	}
+}
+
+void UploadManager::retireOldest() {
+	uint32_t index = m_inFlight.front();
+	Batch& batch = m_batches.at(index);
+	vkWaitForFences(m_device, 1, &batch.fence, VK_TRUE, ~0ull);
+	vkResetFences(m_device, 1, &batch.fence);
+
+	m_ringUsed -= batch.ringBytes;
+	m_completedTicket = batch.ticket;
+	m_stats.bytesUploaded += batch.dataBytes;
+	m_pendingBufferAcquires.insert(m_pendingBufferAcquires.end(), batch.bufferAcquires.begin(), batch.bufferAcquires.end());
+	m_pendingImageAcquires.insert(m_pendingImageAcquires.end(), batch.imageAcquires.begin(), batch.imageAcquires.end());
+
+	m_inFlight.pop_front();
+	m_freeBatches.push_back(index);
+	if (m_inFlight.empty()) {
+		m_stats.activeMs += nowMs() - m_activeSinceMs;
+	}
+}
+
+double UploadManager::nowMs() const {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include "Vertex.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+uint32_t VertexLayout::getPositionSize() const {
+	return position == PositionFormat::Float32 ? 3 * sizeof(float) : 4 * sizeof(uint16_t);
+}
+
+uint32_t VertexLayout::getNormalOffset() const {
+	return getPositionSize();
+}
+
+uint32_t VertexLayout::getStride() const {
+	return getNormalOffset() + (normal == NormalFormat::Float32 ? 3 * sizeof(float) : 2 * sizeof(int16_t));
+}
+
+VkVertexInputBindingDescription VertexLayout::getBindingDescription(uint32_t binding) const {
+	return {
+		.binding = binding,
+		.stride = getStride(),
+		.inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+	};
+}
+
+std::vector<VkVertexInputAttributeDescription> VertexLayout::getAttributeDescriptions(uint32_t binding) const {
+	VkFormat positionFormat = VK_FORMAT_R32G32B32_SFLOAT;
+	if (position == PositionFormat::Half) {
+		positionFormat = VK_FORMAT_R16G16B16A16_SFLOAT; //three component 16-bit formats are rarely supported as vertex input
+	}
+	else if (position == PositionFormat::Snorm16) {
+		positionFormat = VK_FORMAT_R16G16B16A16_SNORM;
+	}
+
+	return {
+		{
+			.location = 0,
+			.binding = binding,
+			.format = positionFormat,
+			.offset = 0
+		},
+		{
+			.location = 1,
+			.binding = binding,
+			.format = normal == NormalFormat::Float32 ? VK_FORMAT_R32G32B32_SFLOAT : VK_FORMAT_R16G16_SNORM,
+			.offset = getNormalOffset()
+		}
+	};
+}
+
+void VertexLayout::encode(const Vertex& vertex, const PositionDecode& decode, std::byte* pOut) const {
+	switch (position) {
+	case PositionFormat::Float32: {
+		std::memcpy(pOut, &vertex.pos, 3 * sizeof(float));
+		break;
+	}
+	case PositionFormat::Half: {
+		uint16_t half[4]{ VertexEncoding::floatToHalf(vertex.pos.x), VertexEncoding::floatToHalf(vertex.pos.y), VertexEncoding::floatToHalf(vertex.pos.z), 0 };
+		std::memcpy(pOut, half, sizeof(half));
+		break;
+	}
+	case PositionFormat::Snorm16: {
+		int16_t snorm[4]{ 0, 0, 0, 0 };
+		for (int i = 0; i < 3; i++) {
+			snorm[i] = VertexEncoding::floatToSnorm16((vertex.pos[i] - decode.offset[i]) / decode.scale[i]);
+		}
+		std::memcpy(pOut, snorm, sizeof(snorm));
+		break;
+	}
+	}
+
+	pOut += getNormalOffset();
+	if (normal == NormalFormat::Float32) {
+		std::memcpy(pOut, &vertex.normal, 3 * sizeof(float));
+	}
+	else {
+		glm::vec2 oct = VertexEncoding::octEncode(vertex.normal);
+		int16_t snorm[2]{ VertexEncoding::floatToSnorm16(oct.x), VertexEncoding::floatToSnorm16(oct.y) };
+		std::memcpy(pOut, snorm, sizeof(snorm));
+	}
+}
+
+Vertex VertexLayout::decode(const std::byte* pData, const PositionDecode& decode) const {
+	Vertex vertex{};
+	switch (position) {
+	case PositionFormat::Float32: {
+		std::memcpy(&vertex.pos, pData, 3 * sizeof(float));
+		break;
+	}
+	case PositionFormat::Half: {
+		uint16_t half[4];
+		std::memcpy(half, pData, sizeof(half));
+		vertex.pos = glm::vec3(VertexEncoding::halfToFloat(half[0]), VertexEncoding::halfToFloat(half[1]), VertexEncoding::halfToFloat(half[2]));
+		break;
+	}
+	case PositionFormat::Snorm16: {
+		int16_t snorm[4];
+		std::memcpy(snorm, pData, sizeof(snorm));
+		for (int i = 0; i < 3; i++) {
+			vertex.pos[i] = VertexEncoding::snorm16ToFloat(snorm[i]) * decode.scale[i] + decode.offset[i];
+		}
+		break;
+	}
+	}
+
+	pData += getNormalOffset();
+	if (normal == NormalFormat::Float32) {
+		std::memcpy(&vertex.normal, pData, 3 * sizeof(float));
+	}
+	else {
+		int16_t snorm[2];
+		std::memcpy(snorm, pData, sizeof(snorm));
+		vertex.normal = VertexEncoding::octDecode(glm::vec2(VertexEncoding::snorm16ToFloat(snorm[0]), VertexEncoding::snorm16ToFloat(snorm[1])));
+	}
+	return vertex;
+}
+
+//IEEE 754 binary16 with round to nearest even, matching what the GPU does when it reads R16G16B16A16_SFLOAT
+uint16_t VertexEncoding::floatToHalf(float value) {
+	uint32_t bits = std::bit_cast<uint32_t>(value);
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (((bits >> 23) & 0xff) == 0xff) {
+		return static_cast<uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0)); //inf and nan
+	}
+	if (exponent >= 31) {
+		return static_cast<uint16_t>(sign | 0x7c00);
+	}
+
+	uint32_t shift = 13;
+	uint32_t half;
+	if (exponent <= 0) { //subnormal
+		if (exponent < -10) {
+			return static_cast<uint16_t>(sign);
+		}
+		mantissa |= 0x800000;
+		shift = 14 - exponent;
+		half = mantissa >> shift;
+	}
+	else {
+		half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> shift);
+	}
+
+	uint32_t remainder = mantissa & ((1u << shift) - 1);
+	uint32_t halfway = 1u << (shift - 1);
+	if (remainder > halfway || (remainder == halfway && (half & 1) != 0)) {
+		half++; //a carry into the exponent is still the correctly rounded result
+	}
+	return static_cast<uint16_t>(sign | half);
+}
+
+float VertexEncoding::halfToFloat(uint16_t value) {
+	uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+
+	if (exponent == 0) {
+		float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+		return sign != 0 ? -magnitude : magnitude;
+	}
+	if (exponent == 31) {
+		return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+	}
+	return std::bit_cast<float>(sign | ((exponent + 127 - 15) << 23) | (mantissa << 13));
+}
+
+int16_t VertexEncoding::floatToSnorm16(float value) {
+	return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+float VertexEncoding::snorm16ToFloat(int16_t value) {
+	return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+}
+
+glm::vec2 VertexEncoding::octEncode(glm::vec3 normal) {
+	float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	float x = normal.x / l1;
+	float y = normal.y / l1;
+	if (normal.z < 0.0f) { //fold the lower hemisphere over the diagonals
+		float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+	return glm::vec2(x, y);
+}
+
+glm::vec3 VertexEncoding::octDecode(glm::vec2 encoded) {
+	float x = encoded.x;
+	float y = encoded.y;
+	float z = 1.0f - std::abs(x) - std::abs(y);
+	if (z < 0.0f) {
+		float unfoldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float unfoldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = unfoldedX;
+		y = unfoldedY;
+	}
+	float length = std::sqrt(x * x + y * y + z * z);
+	return glm::vec3(x / length, y / length, z / length);
+}
\ No newline at end of file